@@ -32,6 +32,7 @@
 #include <chrono>
 #include <thread>
 #include <interfaces/atomic_ops.h>
+#include <filesystem/file_access.h>
 #include <tscpp/buffer.h>
 #include "Logger.h"
 
@@ -72,6 +73,13 @@ void Logger::start()
         throw runtime_error("Error opening log file");
     setbuf(file, NULL);
 
+    // Reserve space for the log in advance, so that the write thread does not
+    // have to allocate clusters on the SD while logging. Not fatal if it fails
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0 &&
+        fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, st.st_size, preallocSize))
+        puts("Warning: can't preallocate log file");
+
     // The boring part, start threads one by one and if they fail, undo
     // Perhaps excessive defensive programming as thread creation failure is
     // highly unlikely (only if ram is full)
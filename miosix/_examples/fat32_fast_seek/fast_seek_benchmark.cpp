@@ -0,0 +1,106 @@
+/**
+ * This program benchmarks random reads in a large file on a FAT32 filesystem,
+ * with and without fast seek.
+ *
+ * Without fast seek, every backward seek follows the FAT chain from the start
+ * of the file, so the time it takes grows with the file size. With fast seek,
+ * enabled per file through the IOCTL_FAST_SEEK ioctl, a cluster link map of
+ * the file is kept in RAM and seeking takes constant time, as long as the file
+ * is not too fragmented.
+ *
+ * The test file, /sd/fastseek.dat, is created the first time this program is
+ * run, and this can take a while for large sizes.
+ *
+ * NOTE: this program assumes a FAT32 formatted SD card is mounted at /sd
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include "miosix.h"
+#include "filesystem/ioctl.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace miosix;
+
+const char testFile[]="/sd/fastseek.dat";
+const int fileSizeMb=64;   ///< Size of the test file in MByte
+const int numReads=256;    ///< Number of random reads per test
+const int readSize=512;    ///< Size of each random read
+
+void fail(const char *err)
+{
+    puts(err);
+    exit(1);
+}
+
+/**
+ * Create the test file if it does not exist or is too small
+ */
+void createFile()
+{
+    const off_t fileSize=fileSizeMb*1024*1024;
+    struct stat st;
+    if(stat(testFile,&st)==0 && st.st_size>=fileSize) return;
+    printf("Creating %dMB test file...\n",fileSizeMb);
+    int fd=open(testFile,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("Can't create test file");
+    const int bufferSize=16*1024;
+    int *buffer=new int[bufferSize/sizeof(int)];
+    for(off_t i=0;i<fileSize;i+=bufferSize)
+    {
+        //Fill every block with its offset, so that reads can be checked
+        for(unsigned int j=0;j<bufferSize/sizeof(int);j++)
+            buffer[j]=i+j*sizeof(int);
+        if(write(fd,buffer,bufferSize)!=bufferSize)
+            fail("Can't write test file");
+    }
+    delete[] buffer;
+    close(fd);
+}
+
+/**
+ * Perform random reads in the test file
+ * \param fd test file
+ * \return the average time in microseconds of a read
+ */
+float randomReads(int fd)
+{
+    const off_t fileSize=fileSizeMb*1024*1024;
+    int buffer[readSize/sizeof(int)];
+    srand(0); //Use the same offsets in all tests
+    auto t=system_clock::now();
+    for(int i=0;i<numReads;i++)
+    {
+        off_t pos=(static_cast<off_t>(rand())*readSize) % (fileSize-readSize);
+        pos&=~static_cast<off_t>(sizeof(int)-1);
+        if(pread(fd,buffer,readSize,pos)!=readSize) fail("pread failed");
+        if(buffer[0]!=static_cast<int>(pos)) fail("Wrong data read");
+    }
+    duration<float,micro> d=system_clock::now()-t;
+    return d.count()/numReads;
+}
+
+int main()
+{
+    createFile();
+    int fd=open(testFile,O_RDONLY);
+    if(fd<0) fail("Can't open test file");
+
+    printf("Fast seek disabled: %.1fus per read\n",randomReads(fd));
+
+    int enable=1;
+    auto t=system_clock::now();
+    if(ioctl(fd,IOCTL_FAST_SEEK,&enable)!=0) fail("Can't enable fast seek");
+    duration<float,milli> d=system_clock::now()-t;
+    printf("Cluster link map built in %.1fms\n",d.count());
+
+    printf("Fast seek enabled:  %.1fus per read\n",randomReads(fd));
+    close(fd);
+}
@@ -0,0 +1,191 @@
+/**
+ * This program benchmarks LittleFS with different mount options, to help
+ * choosing the cache and lookahead sizes for a given board.
+ *
+ * To avoid destroying the filesystem of the SD card, LittleFS is loop mounted
+ * on an image file, /sd/lfsbench.img, that is created if it does not exist.
+ * The image is formatted again for every configuration tested.
+ *
+ * Two workloads are measured:
+ * - small files: create, write, read back and delete many small files, which
+ *   stresses metadata updates and the lookahead buffer
+ * - sequential: write and read back a single large file, which is dominated
+ *   by the cache size
+ *
+ * NOTE: this program assumes LittleFS support is compiled in (WITH_LITTLEFS)
+ * and that a FAT32 formatted SD card is mounted at /sd
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "miosix.h"
+#include "filesystem/file_access.h"
+#include "filesystem/littlefs/lfs_miosix.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace miosix;
+
+const char imageFile[]="/sd/lfsbench.img";
+const char mountPoint[]="/lfsbench";
+const int imageSize=1024*1024; ///< Size of the loop mounted image
+const int numSmallFiles=64;    ///< Number of files in the small file test
+const int smallFileSize=100;   ///< Size of every file in the small file test
+const int seqFileSize=256*1024;///< Size of the sequential test file
+const int seqBlockSize=4096;   ///< Size of each read()/write() call
+
+void fail(const char *err)
+{
+    puts(err);
+    exit(1);
+}
+
+/**
+ * Create the image file if it does not exist or is too small
+ */
+void createImage()
+{
+    struct stat st;
+    if(stat(imageFile,&st)==0 && st.st_size>=imageSize) return;
+    puts("Creating image file...");
+    int fd=open(imageFile,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("Can't create image file");
+    char *buffer=new char[seqBlockSize];
+    memset(buffer,0xff,seqBlockSize);
+    for(int i=0;i<imageSize;i+=seqBlockSize)
+        if(write(fd,buffer,seqBlockSize)!=seqBlockSize)
+            fail("Can't write image file");
+    delete[] buffer;
+    close(fd);
+}
+
+/**
+ * Format the image with the given options and mount it
+ * \return true on success
+ */
+bool mountImage(const LittleFSOptions& options)
+{
+    FilesystemManager& fsm=FilesystemManager::instance();
+    string path=imageFile;
+    ResolvedPath openData=fsm.resolvePath(path);
+    if(openData.result<0) return false;
+    StringPart relativePath(path,string::npos,openData.off);
+    intrusive_ref_ptr<FileBase> image;
+    if(openData.fs->open(image,relativePath,O_RDWR,0)<0) return false;
+    LittleFSOptions opt=options;
+    opt.format=true;
+    //The image is a regular file, which does not report a geometry
+    opt.blockCount=imageSize/opt.blockSize;
+    intrusive_ref_ptr<LittleFS> fs(new LittleFS(image,opt));
+    if(fs->mountFailed()) return false;
+    mkdir(mountPoint,0755);
+    return fsm.kmount(mountPoint,fs)==0;
+}
+
+/**
+ * \return the time in milliseconds taken by the small file workload
+ */
+float smallFileTest()
+{
+    char name[32], data[smallFileSize];
+    memset(data,0x55,sizeof(data));
+    auto t=system_clock::now();
+    for(int i=0;i<numSmallFiles;i++)
+    {
+        sniprintf(name,sizeof(name),"%s/f%d",mountPoint,i);
+        int fd=open(name,O_WRONLY|O_CREAT|O_TRUNC,0644);
+        if(fd<0) fail("open failed");
+        if(write(fd,data,sizeof(data))!=sizeof(data)) fail("write failed");
+        close(fd);
+    }
+    for(int i=0;i<numSmallFiles;i++)
+    {
+        sniprintf(name,sizeof(name),"%s/f%d",mountPoint,i);
+        int fd=open(name,O_RDONLY);
+        if(fd<0) fail("open failed");
+        if(read(fd,data,sizeof(data))!=sizeof(data)) fail("read failed");
+        close(fd);
+    }
+    for(int i=0;i<numSmallFiles;i++)
+    {
+        sniprintf(name,sizeof(name),"%s/f%d",mountPoint,i);
+        if(unlink(name)!=0) fail("unlink failed");
+    }
+    duration<float,milli> d=system_clock::now()-t;
+    return d.count();
+}
+
+/**
+ * Sequential workload
+ * \param writeTime time in milliseconds to write the file
+ * \param readTime time in milliseconds to read back the file
+ */
+void sequentialTest(float& writeTime, float& readTime)
+{
+    char name[32];
+    sniprintf(name,sizeof(name),"%s/seq",mountPoint);
+    char *buffer=new char[seqBlockSize];
+    memset(buffer,0xaa,seqBlockSize);
+    auto t=system_clock::now();
+    int fd=open(name,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("open failed");
+    for(int i=0;i<seqFileSize;i+=seqBlockSize)
+        if(write(fd,buffer,seqBlockSize)!=seqBlockSize) fail("write failed");
+    close(fd);
+    duration<float,milli> d=system_clock::now()-t;
+    writeTime=d.count();
+    t=system_clock::now();
+    fd=open(name,O_RDONLY);
+    if(fd<0) fail("open failed");
+    for(int i=0;i<seqFileSize;i+=seqBlockSize)
+        if(read(fd,buffer,seqBlockSize)!=seqBlockSize) fail("read failed");
+    close(fd);
+    d=system_clock::now()-t;
+    readTime=d.count();
+    unlink(name);
+    delete[] buffer;
+}
+
+int main()
+{
+    struct Config
+    {
+        unsigned int blockSize, cacheSize, lookaheadSize;
+    };
+    //Block size, cache size, lookahead size
+    const Config configs[]=
+    {
+        {  512,  512,  16 },
+        {  512,  512, 128 },
+        { 4096,  512,  16 },
+        { 4096, 1024,  16 },
+        { 4096, 4096,  16 },
+        { 4096, 4096, 128 },
+    };
+
+    createImage();
+    puts("block cache lookahead | small files(ms) | seq write(KB/s) read(KB/s)");
+    for(auto& c : configs)
+    {
+        LittleFSOptions options;
+        options.blockSize=c.blockSize;
+        options.cacheSize=c.cacheSize;
+        options.lookaheadSize=c.lookaheadSize;
+        if(mountImage(options)==false) fail("Can't mount image file");
+        float small=smallFileTest();
+        float writeTime, readTime;
+        sequentialTest(writeTime,readTime);
+        if(FilesystemManager::instance().umount(mountPoint)<0)
+            fail("Can't umount filesystem");
+        const float seqKb=seqFileSize/1024.f;
+        printf("%5u %5u %9u | %15.1f | %15.1f %10.1f\n",c.blockSize,
+               c.cacheSize,c.lookaheadSize,small,
+               seqKb*1000.f/writeTime,seqKb*1000.f/readTime);
+    }
+    rmdir(mountPoint);
+    puts("Done");
+}
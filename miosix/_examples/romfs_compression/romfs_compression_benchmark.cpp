@@ -0,0 +1,133 @@
+/**
+ * This program measures the read throughput of the files in the RomFs, to
+ * compare an image built with compression against an uncompressed one.
+ *
+ * Build the firmware twice, once with the RomFs image built as usual and once
+ * with buildromfs --compress (optionally with --block-size=<n>), and compare
+ * the results. buildromfs prints the image size and how much was saved by
+ * compression, while this program prints the time taken to read every regular
+ * file in the RomFs:
+ * - sequentially, with different read() sizes. Reads smaller than the
+ *   compression block size go through the per-file block buffer, reads of
+ *   whole blocks are decompressed directly in the caller's buffer
+ * - at random offsets, which for compressed files requires decompressing
+ *   one block per read
+ *
+ * NOTE: this program assumes the RomFs is mounted as the root filesystem
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const char rootDir[]="/";   ///< RomFs mountpoint
+const int numRandomReads=64; ///< Number of random reads per file
+const int randomReadSize=64; ///< Size of each random read
+
+/**
+ * Recursively list the regular files in a directory tree, skipping other
+ * filesystems mounted inside it
+ * \param dir directory path, ending with /
+ * \param dev device id of the RomFs
+ * \param files regular files are appended here
+ */
+void listFiles(const string& dir, dev_t dev, vector<string>& files)
+{
+    DIR *d=opendir(dir.c_str());
+    if(d==nullptr) return;
+    while(struct dirent *e=readdir(d))
+    {
+        if(strcmp(e->d_name,".")==0 || strcmp(e->d_name,"..")==0) continue;
+        string path=dir+e->d_name;
+        struct stat st;
+        if(lstat(path.c_str(),&st)!=0 || st.st_dev!=dev) continue;
+        if(S_ISDIR(st.st_mode)) listFiles(path+"/",dev,files);
+        else if(S_ISREG(st.st_mode)) files.push_back(path);
+    }
+    closedir(d);
+}
+
+/**
+ * Read all files sequentially
+ * \param files files to read
+ * \param readSize size of each read() call
+ * \return throughput in KByte/s
+ */
+float sequentialReads(const vector<string>& files, int readSize)
+{
+    char *buffer=new char[readSize];
+    unsigned int total=0;
+    auto t=system_clock::now();
+    for(auto& f : files)
+    {
+        int fd=open(f.c_str(),O_RDONLY);
+        if(fd<0) continue;
+        ssize_t r;
+        while((r=read(fd,buffer,readSize))>0) total+=r;
+        close(fd);
+    }
+    auto d=duration_cast<microseconds>(system_clock::now()-t);
+    delete[] buffer;
+    return static_cast<float>(total)*1000000.f/1024.f/d.count();
+}
+
+/**
+ * Read all files at random offsets
+ * \param files files to read
+ * \return the average time in microseconds of a read
+ */
+float randomReads(const vector<string>& files)
+{
+    char buffer[randomReadSize];
+    int numReads=0;
+    srand(0); //Use the same offsets in all tests
+    auto t=system_clock::now();
+    for(auto& f : files)
+    {
+        int fd=open(f.c_str(),O_RDONLY);
+        if(fd<0) continue;
+        struct stat st;
+        if(fstat(fd,&st)==0 && st.st_size>0)
+        {
+            for(int i=0;i<numRandomReads;i++)
+            {
+                pread(fd,buffer,randomReadSize,rand() % st.st_size);
+                numReads++;
+            }
+        }
+        close(fd);
+    }
+    auto d=duration_cast<microseconds>(system_clock::now()-t);
+    return numReads>0 ? static_cast<float>(d.count())/numReads : 0.f;
+}
+
+int main()
+{
+    struct stat st;
+    if(stat(rootDir,&st)!=0)
+    {
+        puts("RomFs not found");
+        return 1;
+    }
+    vector<string> files;
+    listFiles(rootDir,st.st_dev,files);
+    unsigned int totalSize=0;
+    for(auto& f : files) if(stat(f.c_str(),&st)==0) totalSize+=st.st_size;
+    printf("%u files, %u bytes\n",files.size(),totalSize);
+
+    for(int readSize : {64,512,4096})
+        printf("Sequential %4d byte reads: %.1fKB/s\n",readSize,
+               sequentialReads(files,readSize));
+    printf("Random %d byte reads: %.1fus per read\n",randomReadSize,
+           randomReads(files));
+}
@@ -23,6 +23,7 @@
  
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
 #include "tree.h"
 #include "mkromfs.h"
 
@@ -32,8 +33,15 @@ int main(int argc, char *argv[])
 {
     if(argc<4)
     {
-        cerr<<"Miosix buildromfs utility v2.00"<<endl
-            <<"use: buildromfs <target file> --from-directory <source directory>"<<endl;
+        cerr<<"Miosix buildromfs utility v2.02"<<endl
+            <<"use: buildromfs <target file> --from-directory <source directory> [options]"<<endl
+            <<"Options:"<<endl
+            <<"    --no-index          Build an image without directory name index,"<<endl
+            <<"                        that can also be mounted by older kernels"<<endl
+            <<"    --compress          Compress files that are not elf programs"<<endl
+            <<"    --block-size=<n>    Compression block size, a power of 2 from"<<endl
+            <<"                        512 to 65536 (default 4096). Each open"<<endl
+            <<"                        compressed file uses a RAM buffer this large"<<endl;
         return 1;
     }
 
@@ -48,6 +56,28 @@ int main(int argc, char *argv[])
         cerr<<argv[2]<<": unsupported option"<<endl;
         return 1;
     }
+    MkRomFsOptions options;
+    for(int i=4;i<argc;i++)
+    {
+        string arg=argv[i];
+        if(arg=="--no-index") options.sortedIndex=false;
+        else if(arg=="--compress") options.compress=true;
+        else if(arg.compare(0,13,"--block-size=")==0)
+        {
+            unsigned long size=strtoul(arg.c_str()+13,nullptr,0);
+            options.blockShift=0;
+            while(size<=65536 && (1ul<<options.blockShift)<size)
+                options.blockShift++;
+            if(size<512 || size>65536 || (1ul<<options.blockShift)!=size)
+            {
+                cerr<<arg<<": block size must be a power of 2 from 512 to 65536"<<endl;
+                return 1;
+            }
+        } else {
+            cerr<<argv[i]<<": unsupported option"<<endl;
+            return 1;
+        }
+    }
 
     // Open the output image
     fstream io(argv[1], ios::in | ios::out | ios::trunc | ios::binary);
@@ -58,7 +88,12 @@ int main(int argc, char *argv[])
     }
 
     // Build the image and write it to file
-    MkRomFs img(io,root);
+    MkRomFs img(io,root,options);
     cout<<"RomFs size "<<img.size()<<endl;
+    if(options.compress)
+    {
+        cout<<"Compressed "<<img.compressedFiles()<<" files from "
+            <<img.uncompressedBytes()<<" to "<<img.compressedBytes()<<" bytes"<<endl;
+    }
     return 0;
 }
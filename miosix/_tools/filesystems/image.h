@@ -76,6 +76,24 @@ public:
         return offset;
     }
 
+    /**
+     * Append a buffer to the image
+     * \param data buffer to add
+     * \param size buffer size
+     * \param alignment pad the image to the desired alignment before
+     * storing the buffer. No padding is added after the buffer
+     * \return offset in bytes from the image start where the buffer was placed
+     */
+    unsigned int appendBuffer(const void *data, unsigned int size,
+                              unsigned int alignment=1)
+    {
+        align(alignment);
+        unsigned int offset=totalSize;
+        io.write(reinterpret_cast<const char*>(data),size);
+        totalSize=io.tellp();
+        return offset;
+    }
+
     /**
      * Append a string of arbitrary length, nul terminated to the image.
      * \param s string to add
@@ -0,0 +1,85 @@
+ /***************************************************************************
+  *   Copyright (C) 2026 by agent                                           *
+  *                                                                         *
+  *   This program is free software; you can redistribute it and/or modify  *
+  *   it under the terms of the GNU General Public License as published by  *
+  *   the Free Software Foundation; either version 2 of the License, or     *
+  *   (at your option) any later version.                                   *
+  *                                                                         *
+  *   This program is distributed in the hope that it will be useful,       *
+  *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+  *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+  *   GNU General Public License for more details.                          *
+  *                                                                         *
+  *   You should have received a copy of the GNU General Public License     *
+  *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+  ***************************************************************************/
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * Compress a block of data in the LZ4 block format, without frame. The output
+ * can be decompressed by any LZ4 block decoder, including the one in RomFs.
+ * This is a simple greedy compressor optimized for code size, not for speed
+ * \param src data to compress, must be at most 64KByte
+ * \param size size of data to compress
+ * \return compressed data
+ */
+inline std::vector<unsigned char> lz4Compress(const unsigned char *src,
+                                              unsigned int size)
+{
+    using namespace std;
+    const unsigned int minMatch=4;     //Shortest match encoded by LZ4
+    const unsigned int lastLiterals=5; //The last 5 bytes are always literals
+    const unsigned int mfLimit=12;     //No match can start in the last 12 bytes
+    const unsigned int hashBits=12;
+    assert(size<=65536);
+
+    vector<unsigned char> out;
+    auto appendLength=[&](unsigned int length) {
+        for(;length>=255;length-=255) out.push_back(255);
+        out.push_back(length);
+    };
+    auto appendSequence=[&](unsigned int anchor, unsigned int literals,
+                            unsigned int offset, unsigned int matchLength) {
+        unsigned char token=min(literals,15u)<<4;
+        if(offset) token|=min(matchLength-minMatch,15u);
+        out.push_back(token);
+        if(literals>=15) appendLength(literals-15);
+        out.insert(out.end(),src+anchor,src+anchor+literals);
+        if(offset==0) return; //Last sequence, literals only
+        out.push_back(offset & 0xff);
+        out.push_back(offset>>8);
+        if(matchLength-minMatch>=15) appendLength(matchLength-minMatch-15);
+    };
+    auto hash=[&](unsigned int i) {
+        unsigned int x;
+        memcpy(&x,src+i,sizeof(x));
+        return (x*2654435761u)>>(32-hashBits);
+    };
+
+    vector<int> table(1<<hashBits,-1); //Last position with a given hash
+    unsigned int anchor=0; //First byte not yet encoded
+    unsigned int i=0;
+    while(size>=mfLimit && i<=size-mfLimit)
+    {
+        unsigned int h=hash(i);
+        int candidate=table[h];
+        table[h]=i;
+        if(candidate<0 || i-candidate>65535 ||
+           memcmp(src+candidate,src+i,minMatch)!=0) { i++; continue; }
+        unsigned int matchLength=minMatch;
+        unsigned int maxLength=size-lastLiterals-i;
+        while(matchLength<maxLength && src[candidate+matchLength]==src[i+matchLength])
+            matchLength++;
+        appendSequence(anchor,i-anchor,i-candidate,matchLength);
+        i+=matchLength;
+        anchor=i;
+    }
+    appendSequence(anchor,size-anchor,0,0);
+    return out;
+}
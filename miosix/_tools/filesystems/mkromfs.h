@@ -20,6 +20,8 @@
 #include <cstring>
 #include <fstream>
 #include <list>
+#include <iterator>
+#include <vector>
 #include <cassert>
 #include <algorithm>
 #include <stdexcept>
@@ -27,6 +29,7 @@
 #include <sys/stat.h>
 #include "tree.h"
 #include "image.h"
+#include "lz4.h"
 #include "romfs_types.h"
 #include "elf_types.h"
 
@@ -61,6 +64,24 @@ T toLittleEndian(T x)
 auto toLittleEndian16=toLittleEndian<unsigned short>;
 auto toLittleEndian32=toLittleEndian<unsigned int>;
 
+/**
+ * Options affecting the RomFs image format
+ */
+struct MkRomFsOptions
+{
+    /// If true, build a RomFs 2.02 image with a sorted name index for each
+    /// directory. If false, and compression is disabled, build a RomFs 2.01
+    /// image which is also readable by older kernels
+    bool sortedIndex=true;
+    /// If true, compress regular files except elf programs, that are left
+    /// uncompressed to allow executing them in place. Files are only stored
+    /// compressed if this saves at least 1/8 of their size
+    bool compress=false;
+    /// log2 of the compression block size. Larger blocks compress better but
+    /// each open compressed file requires a RAM buffer of one block
+    unsigned int blockShift=12;
+};
+
 /**
  * Create a RomFs image from a directory tree
  */
@@ -71,14 +92,27 @@ public:
      * Everything is done in the constructor, the class exists as a convenience
      * \param io iostream where the image will be built
      * \param root root of the directory tree
+     * \param options image format options
      */
-    MkRomFs(std::iostream& io, const FilesystemEntry& root) : img(io)
+    MkRomFs(std::iostream& io, const FilesystemEntry& root,
+            const MkRomFsOptions& options=MkRomFsOptions())
+        : img(io), options(options)
     {
+        if(options.blockShift<9 || options.blockShift>16)
+            throw std::runtime_error("compression block size out of range");
+
         // Construct the filesystem header
         RomFsHeader header;
         memset(&header,0,sizeof(RomFsHeader));
         strncpy(header.marker,"wwwww",6);
-        strncpy(header.fsName,"RomFs 2.01",11);
+        unsigned int features=0;
+        if(options.sortedIndex) features|=ROMFS_SORTED_INDEX;
+        if(options.compress) features|=ROMFS_COMPRESSION;
+        if(features)
+        {
+            strncpy(header.fsName,"RomFs 2.02",11);
+            header.features=toLittleEndian32(features);
+        } else strncpy(header.fsName,"RomFs 2.01",11);
         strncpy(header.osName,"Miosix",7);
         //header.imageSize still unknown at this point
         auto headerOffset=img.append(header,romFsStructAlignment);
@@ -113,6 +147,22 @@ public:
      */
     unsigned int size() const { return img.size(); }
 
+    /**
+     * \return the number of files that were stored compressed
+     */
+    unsigned int compressedFiles() const { return numCompressed; }
+
+    /**
+     * \return the total size of the files that were stored compressed
+     */
+    unsigned int uncompressedBytes() const { return bytesBefore; }
+
+    /**
+     * \return the total size in the image of the files stored compressed,
+     * including the block tables
+     */
+    unsigned int compressedBytes() const { return bytesAfter; }
+
 private:
     struct InodeInfo
     {
@@ -162,6 +212,10 @@ private:
         // NOTE: Must be done before we recursively add the directory content!
         auto size=img.size()-inode; //inode is also address of first byte
 
+        // The name index is not part of the directory size so that it is
+        // skipped when listing the directory content
+        if(options.sortedIndex) addDirectoryIndex(dir,entryOffsets);
+
         // Then for each entry, recursively add the content
         list<InodeInfo> entryContent;
         for(auto& d : dir.directoryEntries)
@@ -195,6 +249,29 @@ private:
         return InodeInfo(inode,size);
     }
 
+    /**
+     * Add the sorted name index of a directory to the image
+     * \param dir directory whose index is added
+     * \param entryOffsets offsets of the directory entries, in the same order
+     * as dir.directoryEntries
+     */
+    void addDirectoryIndex(const FilesystemEntry& dir,
+                           const std::list<unsigned int>& entryOffsets)
+    {
+        using namespace std;
+
+        // Entries are sorted directories first, the kernel needs strcmp order
+        vector<pair<const char*,unsigned int>> index;
+        auto o=begin(entryOffsets);
+        for(auto& d : dir.directoryEntries) index.push_back({d.name.c_str(),*o++});
+        sort(begin(index),end(index),[](auto& a, auto& b) {
+            return strcmp(a.first,b.first)<0;
+        });
+
+        img.append(toLittleEndian32(index.size()),romFsStructAlignment);
+        for(auto& i : index) img.append(toLittleEndian32(i.second));
+    }
+
     /**
      * Add a file inode to the image
      * \param dir directory to add
@@ -205,8 +282,8 @@ private:
         assert(file.isFile());
         std::ifstream in(file.path, std::ios::binary);
         if(!in) throw std::runtime_error(file.path+": file not found");
-        unsigned int fileAlignment=getFileAlignment(file.path,in);
-        fileAlignment=std::max(fileAlignment,romFsFileAlignment);
+        unsigned int requiredAlignment=getFileAlignment(file.path,in);
+        unsigned int fileAlignment=std::max(requiredAlignment,romFsFileAlignment);
         if(fileAlignment>romFsImageAlignment)
         {
             throw std::runtime_error(file.path+" alignment ("
@@ -215,6 +292,26 @@ private:
                 +std::to_string(romFsImageAlignment)+"Byte)");
         }
         in.seekg(0); //Make sure we write the whole file
+        //Only elf files have alignment requirements, never compress them so
+        //that they can be executed in place
+        if(options.compress && requiredAlignment==1)
+        {
+            std::vector<unsigned char> data(
+                (std::istreambuf_iterator<char>(in)),
+                std::istreambuf_iterator<char>());
+            auto compressed=compressFile(data);
+            if(compressed.size()>0 && compressed.size()<=data.size()-data.size()/8)
+            {
+                auto inode=img.appendBuffer(compressed.data(),compressed.size(),
+                                            romFsStructAlignment);
+                numCompressed++;
+                bytesBefore+=data.size();
+                bytesAfter+=compressed.size();
+                return InodeInfo(inode | romFsCompressedFlag,data.size());
+            }
+            in.clear();
+            in.seekg(0);
+        }
         auto inode=img.appendStream(in,fileAlignment);
 
         // Compute the file inode size. If it is zero, append one dummy extra
@@ -225,6 +322,43 @@ private:
         return InodeInfo(inode,size);
     }
 
+    /**
+     * Compress a file in the RomFsCompressedFile format
+     * \param data file content
+     * \return the compressed file including its header, or an empty vector
+     * if the file is empty
+     */
+    std::vector<unsigned char> compressFile(const std::vector<unsigned char>& data)
+    {
+        using namespace std;
+        if(data.empty()) return {};
+        const unsigned int blockSize=1<<options.blockShift;
+        const unsigned int numBlocks=(data.size()+blockSize-1)/blockSize;
+        const unsigned int headerSize=sizeof(RomFsCompressedFile)
+                                     +(numBlocks+1)*sizeof(unsigned int);
+        vector<unsigned char> result(headerSize);
+        vector<unsigned int> blocks;
+        for(unsigned int i=0;i<data.size();i+=blockSize)
+        {
+            unsigned int size=min<unsigned int>(blockSize,data.size()-i);
+            blocks.push_back(toLittleEndian32(result.size()));
+            auto compressed=lz4Compress(data.data()+i,size);
+            //Blocks that don't compress are stored as they are
+            if(compressed.size()<size)
+                result.insert(result.end(),compressed.begin(),compressed.end());
+            else result.insert(result.end(),data.begin()+i,data.begin()+i+size);
+        }
+        blocks.push_back(toLittleEndian32(result.size()));
+        RomFsCompressedFile header;
+        memset(&header,0,sizeof(RomFsCompressedFile));
+        header.algorithm=ROMFS_LZ4;
+        header.blockShift=options.blockShift;
+        memcpy(result.data(),&header,sizeof(RomFsCompressedFile));
+        memcpy(result.data()+sizeof(RomFsCompressedFile),blocks.data(),
+               blocks.size()*sizeof(unsigned int));
+        return result;
+    }
+
     /**
      * Add a symlink inode to the image
      * \param dir directory to add
@@ -275,5 +409,9 @@ private:
         return result;
     }
 
-    Image<unsigned int> img; ///< Backing storage
+    Image<unsigned int> img;      ///< Backing storage
+    MkRomFsOptions options;       ///< Image format options
+    unsigned int numCompressed=0; ///< Number of compressed files
+    unsigned int bytesBefore=0;   ///< Size of compressed files before compression
+    unsigned int bytesAfter=0;    ///< Size of compressed files after compression
 };
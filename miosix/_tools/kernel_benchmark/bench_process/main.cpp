@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/************************************************************************
+* Part of the Miosix Embedded OS. Process side of the kernel microbenchmark
+* suite, measures the syscall round trip time from userspace and the pipe
+* throughput between two processes.
+*************************************************************************/
+
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include "../benchmark_stats.h"
+
+using namespace std;
+
+/// Number of samples, same as the kernel side
+const unsigned int numSamples=1000;
+/// Number of syscalls averaged in a single sample, to amortize the cost of
+/// clock_gettime() which is itself a syscall
+const unsigned int syscallsPerSample=16;
+/// Number of blocks written before collecting samples in the pipe benchmark
+const unsigned int numWarmup=16;
+/// Size of a block transferred through the pipe
+const int pipeBlockSize=1024;
+
+static unsigned int samples[numSamples];
+static char block[pipeBlockSize];
+
+static long long timestamp()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC,&t);
+    return static_cast<long long>(t.tv_sec)*1000000000LL+t.tv_nsec;
+}
+
+static void benchSyscall(BenchmarkFormat format)
+{
+    for(unsigned int i=0;i<numSamples;i++)
+    {
+        long long start=timestamp();
+        for(unsigned int j=0;j<syscallsPerSample;j++) getpid();
+        long long end=timestamp();
+        samples[i]=static_cast<unsigned int>((end-start)/syscallsPerSample);
+    }
+    printBenchmarkResult(format,"process_syscall_getpid","ns",samples,numSamples);
+}
+
+/**
+ * Writer side of the pipe benchmark, stdout is the write end of the pipe
+ */
+static int pipeWrite()
+{
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        memset(block,i,pipeBlockSize);
+        if(write(STDOUT_FILENO,block,pipeBlockSize)!=pipeBlockSize) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Reader side of the pipe benchmark, stdin is the read end of the pipe.
+ * Every sample is the time to receive a whole block.
+ */
+static int pipeRead(BenchmarkFormat format, const char *name)
+{
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        long long start=timestamp();
+        for(int got=0;got<pipeBlockSize;)
+        {
+            ssize_t r=read(STDIN_FILENO,block+got,pipeBlockSize-got);
+            if(r<=0) return 1;
+            got+=r;
+        }
+        long long end=timestamp();
+        if(i>=numWarmup) samples[i-numWarmup]=static_cast<unsigned int>(end-start);
+    }
+    printBenchmarkResult(format,name,"ns/KiB",samples,numSamples);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkFormat format=BenchmarkFormat::CSV;
+    if(argc>1 && strcmp(argv[1],"json")==0) format=BenchmarkFormat::JSON;
+    if(argc>2 && strcmp(argv[2],"pipe-write")==0) return pipeWrite();
+    if(argc>3 && strcmp(argv[2],"pipe-read")==0) return pipeRead(format,argv[3]);
+    benchSyscall(format);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/************************************************************************
+* Part of the Miosix Embedded OS. Common code to print the results of the
+* kernel microbenchmarks, shared between the kernel side and the process side
+* so that both produce rows in the same format.
+*************************************************************************/
+
+#pragma once
+
+#include <cstdio>
+#include <algorithm>
+
+/**
+ * Benchmark result output format. Both formats produce exactly one line of
+ * output per benchmark, so the output of two different releases or boards can
+ * be compared with a line-oriented diff tool.
+ */
+enum class BenchmarkFormat
+{
+    CSV,  ///< Comma separated values, with a header line
+    JSON  ///< JSON lines, one object per benchmark
+};
+
+/**
+ * Print the header of the result table, if the format requires it
+ * \param format output format
+ */
+inline void printBenchmarkHeader(BenchmarkFormat format)
+{
+    if(format==BenchmarkFormat::CSV)
+        iprintf("benchmark,unit,samples,min,median,p99,max\n");
+}
+
+/**
+ * Compute the statistics of a benchmark and print them as a single line.
+ * \param format output format
+ * \param name benchmark name, must not contain commas or quotes
+ * \param unit unit of measurement of the samples, such as "cycles" or "ns"
+ * \param samples samples array. Note that it is sorted in place
+ * \param numSamples number of samples, must be greater than zero
+ */
+inline void printBenchmarkResult(BenchmarkFormat format, const char *name,
+        const char *unit, unsigned int *samples, unsigned int numSamples)
+{
+    std::sort(samples,samples+numSamples);
+    unsigned int minimum=samples[0];
+    unsigned int median=samples[numSamples/2];
+    //Nearest rank percentile, ceil(0.99*n)-1
+    unsigned int p99=samples[(numSamples*99+99)/100-1];
+    unsigned int maximum=samples[numSamples-1];
+    if(format==BenchmarkFormat::CSV)
+        iprintf("%s,%s,%u,%u,%u,%u,%u\n",name,unit,numSamples,
+                minimum,median,p99,maximum);
+    else
+        iprintf("{\"benchmark\":\"%s\",\"unit\":\"%s\",\"samples\":%u,"
+                "\"min\":%u,\"median\":%u,\"p99\":%u,\"max\":%u}\n",
+                name,unit,numSamples,minimum,median,p99,maximum);
+}
@@ -0,0 +1,631 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/************************************************************************
+* Part of the Miosix Embedded OS. Kernel microbenchmark suite, used to track
+* the cost of the kernel primitives across releases and boards.
+* Every benchmark collects a fixed number of samples and prints a single line
+* with min/median/p99/max, so that two runs can be compared with diff.
+*************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "miosix.h"
+#include "config/miosix_settings.h"
+#include "interfaces/arch_registers.h"
+#include "util/version.h"
+#include "e20/e20.h"
+#ifdef WITH_FILESYSTEM
+#include "filesystem/pipe/pipe.h"
+#endif //WITH_FILESYSTEM
+#include "benchmark_stats.h"
+
+using namespace std;
+using namespace miosix;
+
+/// Number of samples collected by each benchmark
+const unsigned int numSamples=1000;
+/// Number of iterations run before collecting samples, to warm up caches
+const unsigned int numWarmup=16;
+/// Stack size of the helper threads
+const unsigned int STACK_BENCH=768;
+/// Stack size of the event queue helper threads, that need to unwind exceptions
+const unsigned int STACK_EVENT=2048;
+/// Number of events posted at once by the event queue burst benchmarks
+const unsigned int eventBurst=8;
+/// Priority of the benchmark thread, helper threads run at the same priority
+/// or one lower
+const int benchPriority=1;
+
+static BenchmarkFormat format;
+static unsigned int *samples;
+
+//
+// Timestamp source. On cores with a DWT cycle counter samples are in CPU
+// cycles, otherwise fall back to the kernel time in nanoseconds.
+//
+
+static const char *unit="ns";
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+static bool useCycleCounter=false;
+#endif //__ARM_ARCH_7M__ || __ARM_ARCH_7EM__
+
+static void initTimestamp()
+{
+    #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    CoreDebug->DEMCR|=CoreDebug_DEMCR_TRCENA_Msk;
+    #if defined(__CORTEX_M) && (__CORTEX_M==7)
+    DWT->LAR=0xc5acce55; //Cortex-M7 requires unlocking the DWT
+    #endif
+    if((DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk)==0)
+    {
+        DWT->CYCCNT=0;
+        DWT->CTRL|=DWT_CTRL_CYCCNTENA_Msk;
+        useCycleCounter=true;
+        unit="cycles";
+    }
+    #endif //__ARM_ARCH_7M__ || __ARM_ARCH_7EM__
+}
+
+/**
+ * \return a timestamp. Only the difference between two timestamps is
+ * meaningful, as the counter is allowed to wrap around
+ */
+static inline unsigned int timestamp()
+{
+    #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    if(useCycleCounter) return DWT->CYCCNT;
+    #endif //__ARM_ARCH_7M__ || __ARM_ARCH_7EM__
+    return static_cast<unsigned int>(getTime());
+}
+
+static void report(const char *name)
+{
+    printBenchmarkResult(format,name,unit,samples,numSamples);
+}
+
+//
+// Thread::yield() round trip to another thread of the same priority
+//
+
+static volatile bool yieldStop;
+
+static void *yieldHelper(void *)
+{
+    while(yieldStop==false) Thread::yield();
+    return nullptr;
+}
+
+static void benchYield()
+{
+    yieldStop=false;
+    Thread *t=Thread::create(yieldHelper,STACK_BENCH,benchPriority,nullptr,
+            Thread::JOINABLE);
+    for(unsigned int i=0;i<numWarmup;i++) Thread::yield();
+    for(unsigned int i=0;i<numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        Thread::yield();
+        samples[i]=timestamp()-start;
+    }
+    yieldStop=true;
+    t->join();
+    report("yield");
+}
+
+//
+// Uncontended lock/unlock pair
+//
+
+template<typename M>
+static void benchUncontended(const char *name)
+{
+    M m;
+    for(unsigned int i=0;i<numWarmup;i++) { m.lock(); m.unlock(); }
+    for(unsigned int i=0;i<numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        m.lock();
+        m.unlock();
+        samples[i]=timestamp()-start;
+    }
+    report(name);
+}
+
+//
+// Contended lock. A lower priority helper holds the mutex when the benchmark
+// thread tries to lock it. With Mutex the helper inherits the priority of the
+// benchmark thread, with FastMutex it runs because the benchmark thread blocks.
+// The sample is the time from lock() to getting ownership of the mutex.
+//
+
+template<typename M>
+struct ContendedData
+{
+    M m;
+    Semaphore go;
+    Semaphore held;
+    volatile bool stop=false;
+};
+
+template<typename M>
+static void *contendedHelper(void *argv)
+{
+    auto d=reinterpret_cast<ContendedData<M>*>(argv);
+    for(;;)
+    {
+        d->go.wait();
+        if(d->stop) break;
+        d->m.lock();
+        d->held.signal(); //Preempted here by the benchmark thread
+        d->m.unlock();
+    }
+    return nullptr;
+}
+
+template<typename M>
+static void benchContended(const char *name)
+{
+    ContendedData<M> d;
+    Thread *t=Thread::create(contendedHelper<M>,STACK_BENCH,benchPriority-1,&d,
+            Thread::JOINABLE);
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        d.go.signal();
+        d.held.wait();
+        unsigned int start=timestamp();
+        d.m.lock();
+        unsigned int end=timestamp();
+        d.m.unlock();
+        if(i>=numWarmup) samples[i-numWarmup]=end-start;
+    }
+    d.stop=true;
+    d.go.signal();
+    t->join();
+    report(name);
+}
+
+//
+// Semaphore, uncontended signal/wait pair and ping-pong between two threads
+//
+
+static void benchSemaphoreUncontended()
+{
+    Semaphore s;
+    for(unsigned int i=0;i<numWarmup;i++) { s.signal(); s.wait(); }
+    for(unsigned int i=0;i<numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        s.signal();
+        s.wait();
+        samples[i]=timestamp()-start;
+    }
+    report("semaphore_signal_wait");
+}
+
+struct PingPongData
+{
+    Semaphore ping;
+    Semaphore pong;
+    volatile bool stop=false;
+};
+
+static void *semaphoreHelper(void *argv)
+{
+    auto d=reinterpret_cast<PingPongData*>(argv);
+    for(;;)
+    {
+        d->ping.wait();
+        if(d->stop) break;
+        d->pong.signal();
+    }
+    return nullptr;
+}
+
+static void benchSemaphorePingPong()
+{
+    PingPongData d;
+    Thread *t=Thread::create(semaphoreHelper,STACK_BENCH,benchPriority,&d,
+            Thread::JOINABLE);
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        d.ping.signal();
+        d.pong.wait();
+        unsigned int end=timestamp();
+        if(i>=numWarmup) samples[i-numWarmup]=end-start;
+    }
+    d.stop=true;
+    d.ping.signal();
+    t->join();
+    report("semaphore_pingpong");
+}
+
+//
+// ConditionVariable ping-pong between two threads
+//
+
+struct CondVarData
+{
+    FastMutex m;
+    ConditionVariable cv;
+    int turn=0;
+    bool stop=false;
+};
+
+static void *condVarHelper(void *argv)
+{
+    auto d=reinterpret_cast<CondVarData*>(argv);
+    Lock<FastMutex> l(d->m);
+    for(;;)
+    {
+        while(d->turn!=1 && d->stop==false) d->cv.wait(l);
+        if(d->stop) break;
+        d->turn=0;
+        d->cv.signal();
+    }
+    return nullptr;
+}
+
+static void benchCondVarPingPong()
+{
+    CondVarData d;
+    Thread *t=Thread::create(condVarHelper,STACK_BENCH,benchPriority,&d,
+            Thread::JOINABLE);
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        {
+            Lock<FastMutex> l(d.m);
+            d.turn=1;
+            d.cv.signal();
+            while(d.turn!=0) d.cv.wait(l);
+        }
+        unsigned int end=timestamp();
+        if(i>=numWarmup) samples[i-numWarmup]=end-start;
+    }
+    {
+        Lock<FastMutex> l(d.m);
+        d.stop=true;
+        d.cv.signal();
+    }
+    t->join();
+    report("condvar_pingpong");
+}
+
+//
+// Queue, put/get from the same thread and put from interrupt context waking a
+// blocked thread. Interrupt handlers run with interrupts disabled and can't
+// block, so the interrupt side is emulated with IRQput() with interrupts
+// disabled followed by a yield, which is what an interrupt handler waking a
+// thread of the same priority causes. The sample is the time from IRQput()
+// to the blocked thread returning from get().
+//
+
+static void benchQueueThread()
+{
+    Queue<unsigned int,4> q;
+    unsigned int x;
+    for(unsigned int i=0;i<numWarmup;i++) { q.put(i); q.get(x); }
+    for(unsigned int i=0;i<numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        q.put(i);
+        q.get(x);
+        samples[i]=timestamp()-start;
+    }
+    report("queue_put_get");
+}
+
+/// Value used to stop the queue helper thread
+const unsigned int queueStop=0xffffffff;
+
+struct QueueData
+{
+    Queue<unsigned int,4> q;
+    volatile unsigned int end;
+};
+
+static void *queueHelper(void *argv)
+{
+    auto d=reinterpret_cast<QueueData*>(argv);
+    for(;;)
+    {
+        unsigned int x;
+        d->q.get(x);
+        d->end=timestamp();
+        if(x==queueStop) break;
+    }
+    return nullptr;
+}
+
+static void benchQueueIrq()
+{
+    QueueData d;
+    Thread *t=Thread::create(queueHelper,STACK_BENCH,benchPriority,&d,
+            Thread::JOINABLE);
+    Thread::yield(); //Make sure the helper is blocked in get()
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        unsigned int start;
+        {
+            FastInterruptDisableLock dLock;
+            start=timestamp();
+            d.q.IRQput(i);
+        }
+        Thread::yield();
+        if(i>=numWarmup) samples[i-numWarmup]=d.end-start;
+    }
+    d.q.put(queueStop);
+    t->join();
+    report("queue_irqput_to_thread");
+}
+
+//
+// Event queues, latency from post() to the event running in a thread blocked
+// in run(), and time to post a burst of events till the last one has run.
+// The thread calling run() has the same priority, so the benchmark thread
+// yields after posting until the events have run.
+//
+
+#ifndef __NO_EXCEPTIONS
+static volatile unsigned int eventEnd;
+static volatile unsigned int eventCount; ///< Events run by the helper
+
+static void eventTimestamp()
+{
+    eventEnd=timestamp();
+    eventCount=eventCount+1;
+}
+
+static void eventStop() { throw 0; }
+
+template<typename Q>
+static void *eventQueueHelper(void *argv)
+{
+    try {
+        reinterpret_cast<Q*>(argv)->run();
+    } catch(int) {}
+    return nullptr;
+}
+
+template<typename Q>
+static void benchEventQueue(Q& q, const char *latencyName,
+        const char *burstName)
+{
+    Thread *t=Thread::create(eventQueueHelper<Q>,STACK_EVENT,benchPriority,&q,
+            Thread::JOINABLE);
+    Thread::yield(); //Make sure the helper is blocked in run()
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        eventCount=0;
+        unsigned int start=timestamp();
+        q.post(eventTimestamp);
+        //The helper may not have run the event by the time yield() returns
+        while(eventCount<1) Thread::yield();
+        if(i>=numWarmup) samples[i-numWarmup]=eventEnd-start;
+    }
+    report(latencyName);
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        eventCount=0;
+        unsigned int start=timestamp();
+        for(unsigned int j=0;j<eventBurst;j++) q.post(eventTimestamp);
+        while(eventCount<eventBurst) Thread::yield();
+        if(i>=numWarmup) samples[i-numWarmup]=eventEnd-start;
+    }
+    report(burstName);
+    q.post(eventStop);
+    t->join();
+}
+
+static void benchEventQueues()
+{
+    EventQueue eq;
+    benchEventQueue(eq,"eventqueue_post_to_run","eventqueue_burst8");
+    FixedEventQueue<eventBurst> feq;
+    benchEventQueue(feq,"fixedeventqueue_post_to_run","fixedeventqueue_burst8");
+    PooledEventQueue<eventBurst> peq;
+    benchEventQueue(peq,"pooledeventqueue_post_to_run","pooledeventqueue_burst8");
+}
+#endif //__NO_EXCEPTIONS
+
+//
+// Thread creation and join, includes the allocation of the thread stack
+//
+
+static void *emptyThread(void *) { return nullptr; }
+
+static void benchThreadCreateJoin()
+{
+    for(unsigned int i=0;i<numWarmup+numSamples;i++)
+    {
+        unsigned int start=timestamp();
+        Thread *t=Thread::create(emptyThread,STACK_BENCH,benchPriority,nullptr,
+                Thread::JOINABLE);
+        if(t==nullptr)
+        {
+            iprintf("Error, can't create thread\n");
+            return;
+        }
+        t->join();
+        unsigned int end=timestamp();
+        if(i>=numWarmup) samples[i-numWarmup]=end-start;
+    }
+    report("thread_create_join");
+}
+
+//
+// Syscall round trip from a process. The process measures itself and prints
+// its own result line, always in nanoseconds as processes can't access the
+// cycle counter.
+//
+
+#ifdef WITH_PROCESSES
+/**
+ * Spawn /bin/bench_process
+ * \param mode benchmark to run in the process, or nullptr for the syscall one
+ * \param name name of the result line printed by the process, or nullptr
+ * \return the pid of the process, or -1 on failure
+ */
+static pid_t spawnBenchProcess(const char *mode, const char *name)
+{
+    const char *arg[]={"/bin/bench_process",
+            format==BenchmarkFormat::CSV ? "csv" : "json", mode, name, nullptr};
+    const char *env[]={nullptr};
+    pid_t pid;
+    if(posix_spawn(&pid,arg[0],NULL,NULL,(char* const*)arg,(char* const*)env)!=0)
+        return -1;
+    return pid;
+}
+
+/**
+ * Wait for a process spawned by spawnBenchProcess() and check its exit code
+ */
+static void waitBenchProcess(pid_t pid)
+{
+    int ec;
+    if(waitpid(pid,&ec,0)!=pid || !WIFEXITED(ec) || WEXITSTATUS(ec)!=0)
+        iprintf("Error, /bin/bench_process failed\n");
+}
+
+static void benchProcessSyscall()
+{
+    pid_t pid=spawnBenchProcess(nullptr,nullptr);
+    if(pid<0) iprintf("Error, can't spawn /bin/bench_process\n");
+    else waitBenchProcess(pid);
+}
+
+//
+// Pipe throughput between two processes, the writer has the write end as
+// stdout and the reader the read end as stdin. The reader prints the result.
+//
+
+#ifdef WITH_FILESYSTEM
+static void benchProcessPipe(int capacity, const char *name)
+{
+    int fds[2];
+    if(pipe(fds)!=0)
+    {
+        iprintf("Error, can't create pipe\n");
+        return;
+    }
+    if(fcntl(fds[1],F_SETPIPE_SZ,capacity)!=capacity)
+        iprintf("Error, can't set pipe size to %d\n",capacity);
+    //No printing while stdout is redirected to the pipe
+    int oldStdin=dup(STDIN_FILENO);
+    int oldStdout=dup(STDOUT_FILENO);
+    dup2(fds[1],STDOUT_FILENO);
+    pid_t writer=spawnBenchProcess("pipe-write",nullptr);
+    dup2(oldStdout,STDOUT_FILENO);
+    dup2(fds[0],STDIN_FILENO);
+    pid_t reader=spawnBenchProcess("pipe-read",name);
+    dup2(oldStdin,STDIN_FILENO);
+    //Close our copies, so that the reader sees EOF when the writer exits
+    close(fds[0]);
+    close(fds[1]);
+    close(oldStdin);
+    close(oldStdout);
+    if(writer<0 || reader<0) iprintf("Error, can't spawn /bin/bench_process\n");
+    if(writer>=0) waitBenchProcess(writer);
+    if(reader>=0) waitBenchProcess(reader);
+}
+#endif //WITH_FILESYSTEM
+#endif //WITH_PROCESSES
+
+static void runBenchmarks()
+{
+    samples=new unsigned int[numSamples];
+    if(format==BenchmarkFormat::CSV) iprintf("# %s\n",getMiosixVersion());
+    else iprintf("{\"version\":\"%s\"}\n",getMiosixVersion());
+    printBenchmarkHeader(format);
+    benchUncontended<Mutex>("mutex_pi_uncontended");
+    benchUncontended<FastMutex>("fastmutex_uncontended");
+    benchSemaphoreUncontended();
+    benchQueueThread();
+    //The EDF scheduler does not support yield and priority based preemption
+    #ifndef SCHED_TYPE_EDF
+    benchYield();
+    benchContended<Mutex>("mutex_pi_contended");
+    benchContended<FastMutex>("fastmutex_contended");
+    benchSemaphorePingPong();
+    benchCondVarPingPong();
+    benchQueueIrq();
+    #ifndef __NO_EXCEPTIONS
+    benchEventQueues();
+    #endif //__NO_EXCEPTIONS
+    benchThreadCreateJoin();
+    #endif //SCHED_TYPE_EDF
+    #ifdef WITH_PROCESSES
+    benchProcessSyscall();
+    #ifdef WITH_FILESYSTEM
+    benchProcessPipe(256,"process_pipe_256");
+    benchProcessPipe(4096,"process_pipe_4096");
+    #endif //WITH_FILESYSTEM
+    #endif //WITH_PROCESSES
+    delete[] samples;
+}
+
+int main()
+{
+    Thread::setPriority(benchPriority);
+    initTimestamp();
+    for(;;)
+    {
+        iprintf("Type:\n"
+                " 'c' for benchmarks with CSV output\n"
+                " 'j' for benchmarks with JSON lines output\n"
+                " 's' for shutdown\n");
+        char c;
+        for(;;)
+        {
+            c=getchar();
+            if(c!='\n') break;
+        }
+        switch(c)
+        {
+            case 'c':
+                format=BenchmarkFormat::CSV;
+                runBenchmarks();
+                break;
+            case 'j':
+                format=BenchmarkFormat::JSON;
+                runBenchmarks();
+                break;
+            case 's':
+                iprintf("Shutting down\n");
+                shutdown();
+            default:
+                iprintf("Unrecognized option\n");
+        }
+    }
+}
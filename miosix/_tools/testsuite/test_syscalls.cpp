@@ -37,7 +37,17 @@ static void fs_test_4();
 static void fs_test_5();
 static void fs_test_6();
 static void fs_test_7();
+static void fs_test_8();
+#ifndef IN_PROCESS
+static void fs_test_9();
+#endif //IN_PROCESS
+static void fs_test_10();
+static void fs_test_11();
+#ifndef IN_PROCESS
+static void fs_test_12();
+#endif //IN_PROCESS
 static void sys_test_pipe();
+static void sys_test_poll();
 #endif //WITH_FILESYSTEM
 static void sys_test_time();
 static void sys_test_getpid();
@@ -46,6 +56,7 @@ static void sys_test_isatty();
 static void sys_test_spawn();
 #ifdef IN_PROCESS
 static void proc_test_global_ctor_dtor();
+static void proc_test_pthread();
 #endif
 #endif
 
@@ -62,7 +73,17 @@ void test_syscalls()
     fs_test_5();
     fs_test_6();
     fs_test_7();
+    fs_test_8();
+    #ifndef IN_PROCESS
+    fs_test_9();
+    #endif //IN_PROCESS
+    fs_test_10();
+    fs_test_11();
+    #ifndef IN_PROCESS
+    fs_test_12();
+    #endif //IN_PROCESS
     sys_test_pipe();
+    sys_test_poll();
     #else //WITH_FILESYSTEM
     iprintf("Filesystem tests skipped, filesystem support is disabled\n");
     #endif //WITH_FILESYSTEM
@@ -73,6 +94,7 @@ void test_syscalls()
     sys_test_spawn();
     #ifdef IN_PROCESS
     proc_test_global_ctor_dtor();
+    proc_test_pthread();
     #endif
     #endif
     #ifndef IN_PROCESS
@@ -530,7 +552,7 @@ stat/fstat
 */
 
 unsigned int checkInodes(const char *dir, unsigned int curInode,
-        unsigned int parentInode, short curDev, short parentDev)
+        unsigned int parentInode, dev_t curDev, dev_t parentDev)
 {
     size_t getcwdBufSz=256;//strlen(dir)+1;
     char *getcwdBuf=new char[getcwdBufSz];
@@ -544,7 +566,7 @@ unsigned int checkInodes(const char *dir, unsigned int curInode,
     getcwdRes=getcwd(getcwdBuf,getcwdBufSz);
     if(getcwdRes!=getcwdBuf) fail("getcwd result (1)");
     if(strcmp(getcwdBuf,dir)!=0) fail("getcwd (2)");
-    delete getcwdBuf;
+    delete[] getcwdBuf;
     
     DIR *d=opendir(".");
     if(d==NULL) fail("opendir");
@@ -558,7 +580,7 @@ unsigned int checkInodes(const char *dir, unsigned int curInode,
         
         struct stat st;
         if(stat(de->d_name,&st)) fail("stat");
-        printf("inode=%lu dev=%d %s\n",st.st_ino,st.st_dev,de->d_name);
+        printf("inode=%lu dev=%d %s\n",st.st_ino,static_cast<int>(st.st_dev),de->d_name);
         
         if(de->d_ino!=st.st_ino) fail("inode mismatch");
         
@@ -612,10 +634,10 @@ static void fs_test_4()
 {
     test_name("Directory listing");
     unsigned int curInode=0, parentInode=0, binFsInode=0, sdInode=0;
-    short curDevice=0, binDevice=0, sdDevice=0;
+    dev_t curDevice=0, binDevice=0, sdDevice=0;
     #ifdef WITH_DEVFS
     unsigned int devFsInode=0;
-    short devDevice=0;
+    dev_t devDevice=0;
     #endif
     DIR *d=opendir("/");
     if(d==NULL) fail("opendir");
@@ -664,7 +686,7 @@ static void fs_test_4()
             sdDevice=st.st_dev;
         }
         
-        printf("inode=%lu dev=%d %s\n",st.st_ino,st.st_dev,de->d_name);
+        printf("inode=%lu dev=%d %s\n",st.st_ino,static_cast<int>(st.st_dev),de->d_name);
     }
     closedir(d);
     
@@ -980,6 +1002,408 @@ static void fs_test_7()
     pass();
 }
 
+//
+// Filesystem test 8
+//
+/*
+tests:
+pread
+pwrite
+preadv (kernel only)
+pwritev (kernel only)
+*/
+
+static void fs_test_8()
+{
+    test_name("pread/pwrite");
+    const char name[]="/sd/preadtest.dat";
+    int fd=open(name,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("open");
+    char buf[128];
+    for(int i=0;i<1000;i+=sizeof(buf))
+    {
+        for(unsigned int j=0;j<sizeof(buf);j++) buf[j]=(i+j) & 0xff;
+        int len=min<int>(sizeof(buf),1000-i);
+        if(write(fd,buf,len)!=len) fail("write");
+    }
+    if(lseek(fd,100,SEEK_SET)!=100) fail("lseek");
+    if(pread(fd,buf,50,500)!=50) fail("pread");
+    for(int i=0;i<50;i++) if(buf[i]!=static_cast<char>((500+i) & 0xff))
+        fail("pread data");
+    if(pwrite(fd,"xyz",3,900)!=3) fail("pwrite");
+    if(pread(fd,buf,4,899)!=4 || memcmp(buf,"\x83xyz",4)) fail("pwrite data");
+    //Past the end, the gap must be zero filled
+    if(pwrite(fd,"abc",3,1100)!=3) fail("pwrite past the end");
+    if(pread(fd,buf,104,999)!=104) fail("pread gap");
+    if(buf[0]!=static_cast<char>(999 & 0xff)) fail("pread gap data");
+    for(int i=1;i<101;i++) if(buf[i]!=0) fail("gap not zeroed");
+    if(memcmp(buf+101,"abc",3)) fail("pread gap data");
+    if(pread(fd,buf,sizeof(buf),1103)!=0) fail("pread at eof");
+    if(pread(fd,buf,1,-1)!=-1 || errno!=EINVAL) fail("pread negative");
+    #ifndef IN_PROCESS
+    char a[3], b[10];
+    struct iovec iov[2]={{a,sizeof(a)},{b,sizeof(b)}};
+    if(preadv(fd,iov,2,898)!=13) fail("preadv");
+    if(memcmp(a,"\x82\x83x",3) || memcmp(b,"yz",2) || b[9]!=static_cast<char>(910 & 0xff))
+        fail("preadv data");
+    char c[2]={'1','2'}, d[2]={'3','4'};
+    struct iovec iov2[2]={{c,sizeof(c)},{d,sizeof(d)}};
+    if(pwritev(fd,iov2,2,1101)!=4) fail("pwritev");
+    if(pread(fd,buf,6,1100)!=5 || memcmp(buf,"a1234",5)) fail("pwritev data");
+    #endif //IN_PROCESS
+    //The file pointer must not have moved
+    if(lseek(fd,0,SEEK_CUR)!=100) fail("file pointer moved");
+    if(close(fd)!=0) fail("close");
+    //Pipes are not seekable
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    if(pread(fds[0],buf,1,0)!=-1 || errno!=ESPIPE) fail("pread on pipe");
+    close(fds[0]);
+    close(fds[1]);
+    if(unlink(name)!=0) fail("unlink");
+    pass();
+}
+
+#ifndef IN_PROCESS
+/*
+tests:
+ioctl(IOCTL_FAST_SEEK) on FAT32 files (kernel only)
+*/
+
+static void fs_test_9_append(int fd, off_t size)
+{
+    int buf[1024];
+    off_t pos=lseek(fd,0,SEEK_END);
+    for(;pos<size;pos+=sizeof(buf))
+    {
+        for(unsigned int i=0;i<sizeof(buf)/sizeof(int);i++)
+            buf[i]=pos+i*sizeof(int);
+        if(write(fd,buf,sizeof(buf))!=sizeof(buf)) fail("write");
+    }
+}
+
+static void fs_test_9_check(int fd, off_t size)
+{
+    //Go backwards, as forward seeks are fast even without the link map
+    for(off_t pos=size-sizeof(int);pos>=0;pos-=4093*sizeof(int))
+    {
+        int x;
+        if(pread(fd,&x,sizeof(x),pos)!=sizeof(x) || x!=pos) fail("pread");
+    }
+}
+
+static void fs_test_9()
+{
+    test_name("FAT32 fast seek");
+    const char name1[]="/sd/fastseek1.dat";
+    const char name2[]="/sd/fastseek2.dat";
+    int fd1=open(name1,O_RDWR|O_CREAT|O_TRUNC,0644);
+    int fd2=open(name2,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(fd1<0 || fd2<0) fail("open");
+    //Interleave writes to fragment the files
+    for(off_t size=4096;size<=65536;size+=4096)
+    {
+        fs_test_9_append(fd1,size);
+        fs_test_9_append(fd2,size);
+    }
+    int enable=1;
+    if(ioctl(fd1,IOCTL_FAST_SEEK,&enable)!=0) fail("enable fast seek");
+    fs_test_9_check(fd1,65536);
+    //Growing the file must refresh the link map
+    for(off_t size=69632;size<=98304;size+=4096)
+    {
+        fs_test_9_append(fd1,size);
+        fs_test_9_append(fd2,size);
+    }
+    fs_test_9_check(fd1,98304);
+    if(ftruncate(fd1,40000)!=0) fail("ftruncate");
+    fs_test_9_check(fd1,40000);
+    int x;
+    if(pread(fd1,&x,sizeof(x),40000)!=0) fail("pread past the end");
+    fs_test_9_append(fd1,98304);
+    if(lseek(fd1,65536,SEEK_SET)!=65536) fail("lseek");
+    if(read(fd1,&x,sizeof(x))!=sizeof(x) || x!=65536) fail("read");
+    enable=0;
+    if(ioctl(fd1,IOCTL_FAST_SEEK,&enable)!=0) fail("disable fast seek");
+    fs_test_9_check(fd1,98304);
+    //Only FAT32 files support fast seek
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    enable=1;
+    if(ioctl(fds[0],IOCTL_FAST_SEEK,&enable)==0) fail("fast seek on pipe");
+    close(fds[0]);
+    close(fds[1]);
+    if(close(fd1)!=0 || close(fd2)!=0) fail("close");
+    if(unlink(name1)!=0 || unlink(name2)!=0) fail("unlink");
+    pass();
+}
+#endif //IN_PROCESS
+
+/*
+tests:
+fallocate
+posix_fallocate
+*/
+
+static void fs_test_10()
+{
+    test_name("fallocate");
+    const char name[]="/sd/falloc.dat";
+    int fd=open(name,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("open");
+    struct stat st;
+    //Reserving space must not change the file size
+    if(fallocate(fd,FALLOC_FL_KEEP_SIZE,0,65536)!=0) fail("fallocate");
+    if(fstat(fd,&st)!=0 || st.st_size!=0) fail("fallocate size");
+    char buf[128];
+    memset(buf,'x',sizeof(buf));
+    for(int i=0;i<1000;i+=100) if(write(fd,buf,100)!=100) fail("write");
+    //posix_fallocate extends the file with zeros
+    if(posix_fallocate(fd,3000,2000)!=0) fail("posix_fallocate");
+    if(fstat(fd,&st)!=0 || st.st_size!=5000) fail("posix_fallocate size");
+    if(lseek(fd,0,SEEK_CUR)!=1000) fail("file pointer moved");
+    if(pread(fd,buf,sizeof(buf),999)!=sizeof(buf) || buf[0]!='x') fail("pread");
+    for(unsigned int i=1;i<sizeof(buf);i++) if(buf[i]!=0) fail("not zeroed");
+    //Shrinking is never done
+    if(posix_fallocate(fd,0,10)!=0) fail("posix_fallocate 2");
+    if(fstat(fd,&st)!=0 || st.st_size!=5000) fail("posix_fallocate size 2");
+    if(posix_fallocate(fd,-1,10)!=EINVAL) fail("posix_fallocate offset");
+    if(posix_fallocate(fd,0,0)!=EINVAL) fail("posix_fallocate len");
+    if(fallocate(fd,0x100,0,10)!=-1 || errno!=EOPNOTSUPP) fail("fallocate mode");
+    if(close(fd)!=0) fail("close");
+    //Unwritten reserved space is released on close
+    fd=open(name,O_RDONLY);
+    if(fd<0) fail("open 2");
+    if(fstat(fd,&st)!=0 || st.st_size!=5000) fail("size after close");
+    if(posix_fallocate(fd,0,10000)!=EBADF) fail("posix_fallocate read only");
+    if(close(fd)!=0) fail("close 2");
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    if(posix_fallocate(fds[1],0,10)==0) fail("posix_fallocate on pipe");
+    close(fds[0]);
+    close(fds[1]);
+    if(unlink(name)!=0) fail("unlink");
+    pass();
+}
+
+//
+// Filesystem test 11
+//
+/*
+tests:
+fsync
+fdatasync
+*/
+
+static void fs_test_11()
+{
+    test_name("fsync");
+    const char name[]="/sd/fsync.dat";
+    int fd=open(name,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(fd<0) fail("open");
+    char buf[100];
+    memset(buf,'s',sizeof(buf));
+    if(write(fd,buf,sizeof(buf))!=sizeof(buf)) fail("write");
+    if(fsync(fd)!=0) fail("fsync");
+    if(write(fd,buf,sizeof(buf))!=sizeof(buf)) fail("write 2");
+    if(fdatasync(fd)!=0) fail("fdatasync");
+    //Syncing a clean file is a no-op
+    if(fsync(fd)!=0) fail("fsync 2");
+    struct stat st;
+    if(stat(name,&st)!=0 || st.st_size!=2*sizeof(buf)) fail("size");
+    if(close(fd)!=0) fail("close");
+    if(fsync(fd)!=-1 || errno!=EBADF) fail("fsync closed fd");
+    if(fdatasync(fd)!=-1 || errno!=EBADF) fail("fdatasync closed fd");
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    if(fsync(fds[1])!=-1 || errno!=EINVAL) fail("fsync on pipe");
+    if(fdatasync(fds[1])!=-1 || errno!=EINVAL) fail("fdatasync on pipe");
+    close(fds[0]);
+    close(fds[1]);
+    if(unlink(name)!=0) fail("unlink");
+    pass();
+}
+
+#ifndef IN_PROCESS
+//
+// Filesystem test 12
+//
+/*
+tests:
+BlockCache LRU eviction, write back, readahead, large access bypass and
+unaligned read-modify-write (kernel only)
+ioctl(IOCTL_BLOCK_CACHE_STATS) on /dev/sda
+*/
+
+/**
+ * RAM disk that counts device accesses, to observe what BlockCache does
+ */
+class Fs12Disk : public Device
+{
+public:
+    Fs12Disk() : Device(Device::BLOCK), reads(0), writes(0), lastSize(0)
+    {
+        for(unsigned int i=0;i<sizeof(disk);i++) disk[i]=i*7+i/512;
+    }
+
+    virtual ssize_t readBlock(void *buffer, size_t size, off_t where)
+    {
+        if(where<0 || where+size>sizeof(disk)) return -EIO;
+        memcpy(buffer,disk+where,size);
+        reads++;
+        lastSize=size;
+        return size;
+    }
+
+    virtual ssize_t writeBlock(const void *buffer, size_t size, off_t where)
+    {
+        if(where<0 || where+size>sizeof(disk)) return -EIO;
+        memcpy(disk+where,buffer,size);
+        writes++;
+        lastSize=size;
+        return size;
+    }
+
+    virtual int ioctl(int cmd, void *arg)
+    {
+        return cmd==IOCTL_SYNC ? 0 : -ENOTTY;
+    }
+
+    unsigned char disk[64*512];
+    int reads, writes;
+    size_t lastSize;
+};
+
+static const unsigned int fs12bs=BlockCache::blockSize;
+
+/**
+ * Read one block through the cache, and check it matches the disk
+ */
+static void fs_test_12_read(intrusive_ref_ptr<BlockCache> c, Fs12Disk *d,
+                            unsigned int lba)
+{
+    unsigned char buf[fs12bs];
+    if(c->readBlock(buf,fs12bs,lba*fs12bs)!=fs12bs) fail("readBlock");
+    if(memcmp(buf,d->disk+lba*fs12bs,fs12bs)!=0) fail("read data");
+}
+
+static void fs_test_12()
+{
+    test_name("Block cache");
+    intrusive_ref_ptr<Fs12Disk> d(new Fs12Disk);
+    //8 blocks, 2 blocks of readahead, so accesses of 4 blocks bypass it
+    intrusive_ref_ptr<BlockCache> c(new BlockCache(d,8,2));
+    unsigned char buf[4*fs12bs];
+    BlockCacheStats stats;
+
+    //LRU eviction order
+    for(unsigned int lba=2;lba<=16;lba+=2) fs_test_12_read(c,d.get(),lba);
+    if(d->reads!=8) fail("fill");
+    fs_test_12_read(c,d.get(),2); //Block 4 is now the least recently used
+    fs_test_12_read(c,d.get(),20);
+    if(d->reads!=9) fail("evict");
+    fs_test_12_read(c,d.get(),2);
+    fs_test_12_read(c,d.get(),6);
+    if(d->reads!=9) fail("evicted wrong block");
+    fs_test_12_read(c,d.get(),4);
+    if(d->reads!=10) fail("LRU block not evicted");
+    if(c->ioctl(IOCTL_BLOCK_CACHE_STATS,&stats)!=0) fail("stats");
+    if(stats.hits!=3 || stats.misses!=10 || stats.readahead!=0
+        || stats.numBlocks!=8 || stats.blockSize!=fs12bs) fail("stats 1");
+
+    //Readahead on reads that continue where the previous one ended
+    c=new BlockCache(d,8,2);
+    d->reads=0;
+    fs_test_12_read(c,d.get(),30);
+    if(d->reads!=1 || d->lastSize!=fs12bs) fail("not sequential");
+    fs_test_12_read(c,d.get(),31);
+    if(d->reads!=2 || d->lastSize!=3*fs12bs) fail("readahead");
+    fs_test_12_read(c,d.get(),32);
+    fs_test_12_read(c,d.get(),33);
+    if(d->reads!=2) fail("readahead not used");
+    //Reading in advance stops at the end of the device
+    fs_test_12_read(c,d.get(),62);
+    fs_test_12_read(c,d.get(),63);
+    if(d->reads!=4 || d->lastSize!=fs12bs) fail("readahead past the end");
+    if(c->ioctl(IOCTL_BLOCK_CACHE_STATS,&stats)!=0) fail("stats");
+    if(stats.readahead!=2) fail("stats 2");
+
+    //Dirty blocks are written back on eviction
+    c=new BlockCache(d,8,2);
+    d->reads=d->writes=0;
+    memset(buf,'a',fs12bs);
+    if(c->writeBlock(buf,fs12bs,40*fs12bs)!=fs12bs) fail("writeBlock");
+    //Overwriting a whole block does not need to read it
+    if(d->reads!=0 || d->writes!=0) fail("write through");
+    if(d->disk[40*fs12bs]=='a') fail("write through 2");
+    for(unsigned int lba=42;lba<=54;lba+=2) fs_test_12_read(c,d.get(),lba);
+    if(d->writes!=0) fail("early write back");
+    fs_test_12_read(c,d.get(),56);
+    if(d->writes!=1 || memcmp(d->disk+40*fs12bs,buf,fs12bs)!=0)
+        fail("write back on eviction");
+
+    //Dirty blocks are written back on sync and on deletion
+    memset(buf,'b',fs12bs);
+    if(c->writeBlock(buf,fs12bs,41*fs12bs)!=fs12bs) fail("writeBlock");
+    if(d->writes!=1) fail("write through 3");
+    if(c->ioctl(IOCTL_SYNC,nullptr)!=0) fail("sync");
+    if(d->writes!=2 || memcmp(d->disk+41*fs12bs,buf,fs12bs)!=0)
+        fail("write back on sync");
+    if(c->ioctl(IOCTL_SYNC,nullptr)!=0 || d->writes!=2) fail("sync clean");
+    memset(buf,'c',fs12bs);
+    if(c->writeBlock(buf,fs12bs,43*fs12bs)!=fs12bs) fail("writeBlock");
+    c.reset();
+    if(d->writes!=3 || memcmp(d->disk+43*fs12bs,buf,fs12bs)!=0)
+        fail("write back on delete");
+    c=new BlockCache(d,8,2);
+    if(c->ioctl(IOCTL_BLOCK_CACHE_STATS,&stats)!=0) fail("stats");
+    if(stats.hits!=0 || stats.misses!=0 || stats.writebacks!=0) fail("stats 3");
+
+    //Large block aligned reads and writes bypass the cache
+    d->reads=d->writes=0;
+    if(c->readBlock(buf,4*fs12bs,10*fs12bs)!=4*fs12bs) fail("large read");
+    if(memcmp(buf,d->disk+10*fs12bs,4*fs12bs)!=0) fail("large read data");
+    if(d->reads!=1 || d->lastSize!=4*fs12bs) fail("large read bypass");
+    fs_test_12_read(c,d.get(),11);
+    if(d->reads!=2) fail("large read cached");
+    memset(buf,'d',fs12bs);
+    if(c->writeBlock(buf,fs12bs,20*fs12bs)!=fs12bs) fail("writeBlock");
+    memset(buf,'e',4*fs12bs);
+    if(c->writeBlock(buf,4*fs12bs,20*fs12bs)!=4*fs12bs) fail("large write");
+    if(d->writes!=1 || d->lastSize!=4*fs12bs) fail("large write bypass");
+    //The stale dirty copy of block 20 must have been dropped
+    if(c->ioctl(IOCTL_SYNC,nullptr)!=0 || d->writes!=1) fail("stale block");
+    fs_test_12_read(c,d.get(),20);
+    if(d->disk[20*fs12bs]!='e') fail("large write data");
+
+    //Unaligned writes read the block, modify it and write it back
+    d->reads=d->writes=0;
+    unsigned char expected[2*fs12bs];
+    memcpy(expected,d->disk+59*fs12bs,sizeof(expected));
+    memset(buf,'f',20);
+    if(c->writeBlock(buf,20,60*fs12bs-10)!=20) fail("unaligned write");
+    if(d->reads!=2 || d->writes!=0) fail("read-modify-write");
+    memset(expected+fs12bs-10,'f',20);
+    if(c->readBlock(buf,700,59*fs12bs+100)!=700) fail("unaligned read");
+    if(memcmp(buf,expected+100,700)!=0) fail("unaligned read data");
+    if(d->reads!=2) fail("unaligned read cached");
+    if(c->ioctl(IOCTL_SYNC,nullptr)!=0) fail("sync 2");
+    if(memcmp(d->disk+59*fs12bs,expected,sizeof(expected))!=0)
+        fail("unaligned write data");
+    c.reset();
+
+    #ifdef WITH_BLOCK_CACHE
+    //The filesystem on /sd is mounted on top of a BlockCache
+    int fd=open("/dev/sda",O_RDONLY);
+    if(fd<0) fail("open /dev/sda");
+    if(ioctl(fd,IOCTL_BLOCK_CACHE_STATS,&stats)!=0) fail("/dev/sda stats");
+    if(stats.numBlocks!=BLOCK_CACHE_BLOCKS || stats.hits==0) fail("/dev/sda");
+    close(fd);
+    #endif //WITH_BLOCK_CACHE
+    pass();
+}
+#endif //IN_PROCESS
+
 //
 // Pipe test
 //
@@ -1049,6 +1473,29 @@ static void sys_test_pipe_tryLargeReadAndWrite(size_t rdSz, size_t wrSz)
 }
 #endif
 
+static void sys_test_pipe_nonblocking()
+{
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    if(fcntl(fds[0],F_GETPIPE_SZ)!=256) fail("F_GETPIPE_SZ");
+    if(fcntl(fds[1],F_SETPIPE_SZ,512)!=512) fail("F_SETPIPE_SZ");
+    if(fcntl(fds[0],F_GETPIPE_SZ)!=512) fail("F_GETPIPE_SZ after F_SETPIPE_SZ");
+    if(fcntl(fds[0],F_SETFL,O_NONBLOCK)!=0) fail("F_SETFL (1)");
+    if(fcntl(fds[1],F_SETFL,O_NONBLOCK)!=0) fail("F_SETFL (2)");
+    char buf[64];
+    if(read(fds[0],buf,1)!=-1 || errno!=EAGAIN) fail("read from empty pipe");
+    memset(buf,'x',sizeof(buf));
+    for(int i=0;i<512/64;i++)
+        if(write(fds[1],buf,sizeof(buf))!=sizeof(buf)) fail("write");
+    if(write(fds[1],buf,1)!=-1 || errno!=EAGAIN) fail("write to full pipe");
+    if(close(fds[1])!=0) fail("close (1)");
+    //Data written before closing the write end is still readable, then EOF
+    for(int i=0;i<512/64;i++)
+        if(read(fds[0],buf,sizeof(buf))!=sizeof(buf)) fail("read");
+    if(read(fds[0],buf,1)!=0) fail("EOF");
+    if(close(fds[0])!=0) fail("close (2)");
+}
+
 static void sys_test_pipe()
 {
     test_name("pipes");
@@ -1091,6 +1538,86 @@ static void sys_test_pipe()
     sys_test_pipe_tryLargeReadAndWrite(512, 100);
     #endif
 
+    sys_test_pipe_nonblocking();
+    pass();
+}
+
+//
+// poll and select
+//
+/*
+tests:
+select
+poll (kernel only)
+*/
+
+static void sys_test_poll()
+{
+    test_name("poll/select");
+    int fds[2];
+    if(pipe(fds)!=0) fail("pipe");
+    int closedFd=dup(fds[0]);
+    if(closedFd<0 || close(closedFd)!=0) fail("dup/close");
+    int maxFd=fds[0]>fds[1] ? fds[0] : fds[1];
+
+    //An empty pipe is writable but not readable
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    FD_SET(fds[0],&rd);
+    FD_SET(fds[1],&wr);
+    struct timeval tv={0,0};
+    if(select(maxFd+1,&rd,&wr,nullptr,&tv)!=1) fail("select (1)");
+    if(FD_ISSET(fds[0],&rd) || !FD_ISSET(fds[1],&wr)) fail("select (2)");
+
+    //Timeout
+    FD_ZERO(&rd);
+    FD_SET(fds[0],&rd);
+    tv.tv_sec=0;
+    tv.tv_usec=50000;
+    struct timespec a,b;
+    clock_gettime(CLOCK_MONOTONIC,&a);
+    if(select(fds[0]+1,&rd,nullptr,nullptr,&tv)!=0) fail("select (3)");
+    clock_gettime(CLOCK_MONOTONIC,&b);
+    long long elapsed=(b.tv_sec-a.tv_sec)*1000000000LL+(b.tv_nsec-a.tv_nsec);
+    if(elapsed<50000000LL) fail("select timeout too short");
+
+    //Readable pipe
+    if(write(fds[1],"x",1)!=1) fail("write");
+    FD_ZERO(&rd);
+    FD_SET(fds[0],&rd);
+    if(select(fds[0]+1,&rd,nullptr,nullptr,nullptr)!=1) fail("select (4)");
+    if(!FD_ISSET(fds[0],&rd)) fail("select (5)");
+
+    //Invalid file descriptor
+    FD_ZERO(&rd);
+    FD_SET(closedFd,&rd);
+    if(select(closedFd+1,&rd,nullptr,nullptr,&tv)!=-1 || errno!=EBADF)
+        fail("select (6)");
+
+    #ifndef IN_PROCESS
+    struct pollfd pfd[2];
+    pfd[0].fd=fds[0];
+    pfd[0].events=POLLIN;
+    pfd[1].fd=closedFd;
+    pfd[1].events=POLLIN;
+    if(poll(pfd,2,0)!=2) fail("poll (1)");
+    if(pfd[0].revents!=POLLIN || pfd[1].revents!=POLLNVAL) fail("poll (2)");
+    char c;
+    if(read(fds[0],&c,1)!=1 || c!='x') fail("read");
+    if(poll(pfd,1,0)!=0 || pfd[0].revents!=0) fail("poll (3)");
+
+    //Wakeup by a write from another thread
+    std::thread t([&]{
+        Thread::sleep(20);
+        if(write(fds[1],"y",1)!=1) fail("write (thread)");
+    });
+    if(poll(pfd,1,-1)!=1 || pfd[0].revents!=POLLIN) fail("poll (4)");
+    t.join();
+    #endif //IN_PROCESS
+
+    if(close(fds[0])!=0) fail("close (1)");
+    if(close(fds[1])!=0) fail("close (2)");
     pass();
 }
 
@@ -1108,6 +1635,7 @@ gettimeofday
 miosix::nanoSleepUntil
 clock_nanosleep/nanosleep
 usleep
+time page
 */
 
 #ifdef IN_PROCESS
@@ -1115,6 +1643,11 @@ namespace miosix {
 extern long long getTime();
 extern void nanoSleepUntil(long long t);
 }
+// Time syscalls, in crt0.s
+extern "C" {
+long long __miosix_gettime(clockid_t clockid);
+const volatile void *__miosix_time_page();
+}
 #else
 namespace miosix {
 static inline void nanoSleepUntil(long long t)
@@ -1201,6 +1734,31 @@ void sys_test_time()
     if (!(900000000<=dt&&dt<=1100000000))
         fail("usleep and clock_gettime do not agree");
 
+    //Time must never go backwards, also when processes read it without a
+    //syscall through the time page
+    t0=miosix::getTime();
+    for(int i=0;i<100000;i++)
+    {
+        long long t1=miosix::getTime();
+        if(t1<t0) fail("getTime is not monotonic");
+        t0=t1;
+    }
+
+    #ifdef IN_PROCESS
+    //The time page must be available, and the time computed from it must
+    //agree with the one returned by the GETTIME syscall
+    #ifdef TIME_PAGE_SUPPORTED
+    if(__miosix_time_page()==nullptr) fail("time page not available");
+    #endif //TIME_PAGE_SUPPORTED
+    for(int i=0;i<1000;i++)
+    {
+        long long before=__miosix_gettime(CLOCK_MONOTONIC);
+        long long t1=miosix::getTime();
+        long long after=__miosix_gettime(CLOCK_MONOTONIC);
+        if(t1<before || t1>after) fail("getTime and GETTIME do not agree");
+    }
+    #endif //IN_PROCESS
+
     pass();
 }
 
@@ -1414,6 +1972,126 @@ static void proc_test_global_ctor_dtor()
     pass();
 }
 
+//
+// Threads in processes
+//
+
+static pthread_mutex_t pt_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pt_cond=PTHREAD_COND_INITIALIZER;
+static volatile int pt_counter;
+static volatile bool pt_flag;
+static volatile int pt_waiting;
+
+static void *pt_t1(void *argv)
+{
+    for(int i=0;i<1000;i++)
+    {
+        pthread_mutex_lock(&pt_mutex);
+        pt_counter=pt_counter+1;
+        pthread_mutex_unlock(&pt_mutex);
+    }
+    return argv;
+}
+
+static void *pt_t2(void *argv)
+{
+    pthread_mutex_lock(&pt_mutex);
+    while(pt_flag==false) pthread_cond_wait(&pt_cond,&pt_mutex);
+    pt_counter=0;
+    pthread_mutex_unlock(&pt_mutex);
+    return nullptr;
+}
+
+static void *pt_t3(void *argv)
+{
+    pthread_mutex_lock(&pt_mutex);
+    pt_waiting=pt_waiting+1;
+    while(pt_flag==false) pthread_cond_wait(&pt_cond,&pt_mutex);
+    pt_counter=pt_counter+1;
+    pthread_mutex_unlock(&pt_mutex);
+    return nullptr;
+}
+
+static void proc_test_pthread()
+{
+    test_name("Threads in processes");
+    //Thread creation/join, with return value and mutual exclusion. The mutex
+    //is held while the threads start, so that they all block on it
+    pt_counter=0;
+    pthread_mutex_lock(&pt_mutex);
+    pthread_t t[3];
+    for(int i=0;i<3;i++)
+        if(pthread_create(&t[i],nullptr,pt_t1,reinterpret_cast<void*>(i+1))!=0)
+            fail("pthread_create (1)");
+    usleep(10000);
+    if(pt_counter!=0) fail("mutex not held");
+    pthread_mutex_unlock(&pt_mutex);
+    for(int i=0;i<3;i++)
+    {
+        void *result;
+        if(pthread_join(t[i],&result)!=0) fail("pthread_join (1)");
+        if(result!=reinterpret_cast<void*>(i+1)) fail("thread return value");
+    }
+    if(pt_counter!=3000) fail("mutex");
+    //Recursive mutexes
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_t rm;
+    pthread_mutex_init(&rm,&attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_lock(&rm);
+    pthread_mutex_lock(&rm);
+    if(pthread_mutex_trylock(&rm)!=0) fail("recursive trylock");
+    pthread_mutex_unlock(&rm);
+    pthread_mutex_unlock(&rm);
+    pthread_mutex_unlock(&rm);
+    if(pthread_mutex_destroy(&rm)!=0) fail("pthread_mutex_destroy");
+    //Condition variables
+    pt_flag=false;
+    pt_counter=1;
+    if(pthread_create(&t[0],nullptr,pt_t2,nullptr)!=0) fail("pthread_create (2)");
+    usleep(10000);
+    pthread_mutex_lock(&pt_mutex);
+    if(pt_counter!=1) fail("cond wait");
+    pt_flag=true;
+    pthread_cond_signal(&pt_cond);
+    pthread_mutex_unlock(&pt_mutex);
+    if(pthread_join(t[0],nullptr)!=0) fail("pthread_join (2)");
+    if(pt_counter!=0) fail("cond signal");
+    //Broadcast wakes all waiters, once they are all waiting
+    pt_flag=false;
+    pt_counter=0;
+    pt_waiting=0;
+    for(int i=0;i<3;i++)
+        if(pthread_create(&t[i],nullptr,pt_t3,nullptr)!=0)
+            fail("pthread_create (3)");
+    for(;;)
+    {
+        pthread_mutex_lock(&pt_mutex);
+        if(pt_waiting==3) break;
+        pthread_mutex_unlock(&pt_mutex);
+        usleep(1000);
+    }
+    pt_flag=true;
+    pthread_cond_broadcast(&pt_cond);
+    pthread_mutex_unlock(&pt_mutex);
+    usleep(10000);
+    if(pt_counter!=3) fail("cond broadcast");
+    for(int i=0;i<3;i++)
+        if(pthread_join(t[i],nullptr)!=0) fail("pthread_join (3)");
+    //Timed wait
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    ts.tv_nsec+=10000000;
+    if(ts.tv_nsec>=1000000000) { ts.tv_sec++; ts.tv_nsec-=1000000000; }
+    pthread_mutex_lock(&pt_mutex);
+    if(pthread_cond_timedwait(&pt_cond,&pt_mutex,&ts)!=ETIMEDOUT)
+        fail("pthread_cond_timedwait");
+    pthread_mutex_unlock(&pt_mutex);
+    pass();
+}
+
 #endif // IN_PROCESS
 
 #endif // WITH_PROCESSES
@@ -46,10 +46,30 @@
 #include <sys/times.h>
 #include <spawn.h>
 #include <sys/wait.h>
+#include <sys/select.h>
+#include <pthread.h>
 #ifndef IN_PROCESS
 #include <thread>
+#include "filesystem/poll.h"
+#include "filesystem/pipe/pipe.h"
+#include "filesystem/file_access.h"
+#include "filesystem/ioctl.h"
+#include "filesystem/blockcache/block_cache.h"
+#include <sys/ioctl.h>
 #endif
 
+//Included by relative path, the process side has no kernel include paths
+#include "../../stdlib_integration/pipe_fcntl.h"
+
+//Provided by libsyscalls, but not declared by newlib
+#ifdef IN_PROCESS
+extern "C" {
+int posix_fallocate(int fd, off_t offset, off_t len);
+int fallocate(int fd, int mode, off_t offset, off_t len);
+}
+#define FALLOC_FL_KEEP_SIZE 0x01
+#endif //IN_PROCESS
+
 int spawnAndWait(const char *arg[]);
 pid_t spawnWithPipe(const char *arg[], int& pipeFdOut);
 
@@ -39,6 +39,7 @@
 #include <vector>
 #include <cassert>
 #include <functional>
+#include <memory>
 #include <sys/wait.h>
 #include <signal.h>
 #include <pthread.h>
@@ -58,6 +59,8 @@
 #include "interfaces/endianness.h"
 #include "e20/e20.h"
 #include "kernel/intrusive.h"
+#include "kernel/pthread_private.h"
+#include "kernel/pthread_prio.h"
 #include "util/crc16.h"
 
 #if defined(_ARCH_CORTEXM7_STM32F7) || defined(_ARCH_CORTEXM7_STM32H7)
@@ -87,6 +90,14 @@ const unsigned int MAX_TIME_IRQ_DISABLED=14000;//us
 const unsigned int MAX_TIME_IRQ_DISABLED=500;//us
 #endif
 
+#ifndef _ARCH_LINUX_HOST
+const long long HOST_LATENCY=0;//ns
+#else
+//The simulator is a process of a general purpose OS, whose timer signals are
+//delivered with a much higher and less predictable latency than interrupts
+const long long HOST_LATENCY=20000000;//ns
+#endif
+
 //Functions common to all tests
 static void test_name(const char *name);
 static void pass();
@@ -120,6 +131,7 @@ static void test_24();
 static void test_25();
 static void test_26();
 static void test_27();
+static void test_28();
 #if defined(_ARCH_CORTEXM7_STM32F7) || defined(_ARCH_CORTEXM7_STM32H7)
 void testCacheAndDMA();
 #endif //_ARCH_CORTEXM7_STM32F7/H7
@@ -191,6 +203,7 @@ int main()
                 test_25();
                 test_26();
                 test_27();
+                test_28();
                 #if defined(_ARCH_CORTEXM7_STM32F7) || defined(_ARCH_CORTEXM7_STM32H7)
                 testCacheAndDMA();
                 #endif //_ARCH_CORTEXM7_STM32F7/H7
@@ -298,7 +311,7 @@ static void t1_p1(void *argv)
 
 static void t1_p3(void *argv)
 {
-    if(reinterpret_cast<unsigned int>(argv)!=0xdeadbeef) fail("argv passing");
+    if(reinterpret_cast<uintptr_t>(argv)!=0xdeadbeef) fail("argv passing");
 }
 
 static void t1_f1(Thread *p)
@@ -483,7 +496,8 @@ static void t3_p1(void *argv)
         Thread::sleep(SLEEP_TIME);
         if(Thread::testTerminate()) break;
         long long x2=getTime();
-        if(llabs((x2-x1)/1000000-SLEEP_TIME)>0) //Max tolerated error is 1ms
+        //Max tolerated error is 1ms
+        if(llabs((x2-x1)/1000000-SLEEP_TIME)>HOST_LATENCY/1000000)
             fail("Thread::sleep() or getTime()");
     }
 }
@@ -517,9 +531,10 @@ static void test_3()
         delta=IRQgetTime()-start;
     }
     iprintf("%lld\n",delta);
-    //10% tolerance
+    //10% tolerance, the host may also preempt a busy waiting simulator
     auto m=MAX_TIME_IRQ_DISABLED*1000;
-    if(delta<(m-m/10) || delta>(m+m/10)) fail("getTime and delayUs don't agree");
+    if(delta<(m-m/10) || delta>(m+m/10+HOST_LATENCY))
+        fail("getTime and delayUs don't agree");
     Thread *p=Thread::create(t3_p1,STACK_SMALL,0,NULL,Thread::JOINABLE);
     for(int i=0;i<4;i++)
     {
@@ -578,7 +593,8 @@ static void test_3()
         //time is in number of ns passed, wakeup time should not differ by > 1ms
         Thread::nanoSleepUntil(time);
         long long t2 = getTime();
-        if(llabs(t2-time)/1000000>0) fail("Thread::nanoSleepUntil()");
+        if(llabs(t2-time)/1000000>HOST_LATENCY/1000000)
+            fail("Thread::nanoSleepUntil()");
         time+=period;
     }
     pass();
@@ -1014,7 +1030,7 @@ bool checkIft6_m5IsLocked()
     Thread *t=Thread::create(t6_p7,STACK_SMALL,0,0,Thread::JOINABLE);
     void *result;
     t->join(&result);
-    return reinterpret_cast<int>(result)==0 ? false : true;
+    return reinterpret_cast<intptr_t>(result)==0 ? false : true;
 }
 
 static void *t6_p7a(void *argv)
@@ -1029,7 +1045,7 @@ bool checkIft6_m5aIsLocked()
     Thread *t=Thread::create(t6_p7a,STACK_SMALL,0,0,Thread::JOINABLE);
     void *result;
     t->join(&result);
-    return reinterpret_cast<int>(result)==0 ? false : true;
+    return reinterpret_cast<intptr_t>(result)==0 ? false : true;
 }
 
 static void test_6()
@@ -1835,7 +1851,7 @@ void test_14()
     Thread::yield();
     if(t->join(&result)==false) fail("Thread::join (1)");
     if(Thread::exists(t)) fail("Therad::exists (1)");
-    if(reinterpret_cast<unsigned>(result)!=0xdeadbeef) fail("join result (1)");
+    if(reinterpret_cast<uintptr_t>(result)!=0xdeadbeef) fail("join result (1)");
     Thread::sleep(10);
 
     //Test 2: join on joinable, but detach called before
@@ -1874,7 +1890,7 @@ void test_14()
     if(Thread::exists(t)==false) fail("Therad::exists (2)");
     if(t->join(&result)==false) fail("Thread::join (6)");
     if(Thread::exists(t)) fail("Therad::exists (3)");
-    if(reinterpret_cast<unsigned>(result)!=0xdeadbeef) fail("join result (2)");
+    if(reinterpret_cast<uintptr_t>(result)!=0xdeadbeef) fail("join result (2)");
     Thread::sleep(10);
 
     //Test 7: join on already detached and deleted
@@ -1989,6 +2005,8 @@ static void test_15()
     timeout1+=200000;
     timeout2+=250000;
     #endif
+    timeout1+=HOST_LATENCY;
+    timeout2+=HOST_LATENCY;
     long long b,a=getTime()+10000000; //10ms
     {
         Lock<Mutex> l(t15_m1);
@@ -2199,7 +2217,8 @@ static void test_16()
     t->wakeup();
     void *res;
     if(pthread_join(thread,&res)!=0) fail("join return value");
-    if(((unsigned)res)!=0xdeadbeef) fail("entry point return value");
+    if(reinterpret_cast<uintptr_t>(res)!=0xdeadbeef)
+        fail("entry point return value");
     if(Thread::exists(t)) fail("not joined");
     Thread::sleep(10);
     //Testing create with no pthread_attr_t
@@ -2303,6 +2322,8 @@ static void test_16()
     timeout1+=200000;
     timeout2+=250000;
     #endif
+    timeout1+=HOST_LATENCY;
+    timeout2+=HOST_LATENCY;
     timespec a,b;
     clock_gettime(CLOCK_MONOTONIC,&a);
     timespecAdd(&a,10000000); //10ms
@@ -2330,14 +2351,16 @@ static void test_16()
     //
     //Note: implementation detail since otherwise by the very nature of
     //pthread_once, it wouldn't be possible to run the test more than once ;)
-    if(t16_o1.init_executed) t16_o1.init_executed=0;
-    if(t16_o2.init_executed) t16_o2.init_executed=0;
+    if(fields(&t16_o1)->init_executed) fields(&t16_o1)->init_executed=0;
+    if(fields(&t16_o2)->init_executed) fields(&t16_o2)->init_executed=0;
     t16_v2=0;
     if(pthread_once(&t16_o1,t16_f1)!=0) fail("pthread_once 1");
     if(t16_v2!=1) fail("pthread_once 2");
     if(pthread_once(&t16_o1,t16_f1)!=0) fail("pthread_once 2");
     if(t16_v2!=1) fail("pthread_once 3");
+    #ifndef _ARCH_LINUX_HOST
     if(sizeof(pthread_once_t)!=2) fail("pthread_once 4");
+    #endif //_ARCH_LINUX_HOST
     t16_v2=0;
     Thread::create(t16_p5,STACK_MIN);
     Thread::sleep(50);
@@ -2680,6 +2703,7 @@ tests:
 class Callback
 class EventQueue
 class FixedEventQueue
+class PooledEventQueue
 */
 
 int t20_v1;
@@ -2721,6 +2745,48 @@ void thrower()
     throw 5;
 }
 
+void t20_t3(void* arg)
+{
+    PooledEventQueue<2> *eq=reinterpret_cast<PooledEventQueue<2>*>(arg);
+    t20_v1=0;
+    eq->post(t20_f1);
+    eq->post(t20_f1);
+    unsigned long long t1=getTime();
+    eq->post(bind(t20_f2,10,4)); //This should block
+    unsigned long long t2=getTime();
+    //The other thread sleep for 50ms before calling run()
+    if((t2-t1)/1000000 < 40)
+        fail("Not blocked");
+    Thread::sleep(10);
+    if(t20_v1!=14) fail("Not called");
+    
+    Thread::sleep(10);
+    eq->post(thrower);
+}
+
+void t20_slowThrower()
+{
+    Thread::sleep(50);
+    throw 5;
+}
+
+void t20_t4(void* arg)
+{
+    PooledEventQueue<2> *eq=reinterpret_cast<PooledEventQueue<2>*>(arg);
+    //Start waiting after the other thread took the events
+    Thread::sleep(20);
+    try {
+        eq->run();
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+}
+
+void t20_periodic()
+{
+    if(++t20_v1==3) throw 5;
+}
+
 void t20_t1(void* arg)
 {
     EventQueue *eq=reinterpret_cast<EventQueue*>(arg);
@@ -2891,6 +2957,126 @@ static void test_20()
     if(feq.empty()==false || feq.size()!=0) fail("Empty EventQueue");
     #endif //__NO_EXCEPTIONS
     
+    //
+    // Testing PooledEventQueue
+    //
+    PooledEventQueue<2> peq;
+    if(peq.empty()==false || peq.size()!=0) fail("Empty EventQueue");
+    
+    peq.runOne(); //This tests that runOne() does not block
+    
+    t20_v1=0;
+    peq.post(t20_f1);
+    if(peq.postNonBlocking(bind(t20_f2,2,3))==false) fail("PostNonBlocking 1");
+    if(peq.postNonBlocking(t20_f1)==true) fail("PostNonBlocking 2");
+    if(t20_v1!=0) fail("Too early");
+    if(peq.empty() || peq.size()!=2) fail("Not empty EventQueue");
+    peq.runOne();
+    if(t20_v1!=1234) fail("Not called");
+    if(peq.empty() || peq.size()!=1) fail("Not empty EventQueue");
+    peq.runOne();
+    if(t20_v1!=5) fail("Not called");
+    if(peq.empty()==false || peq.size()!=0) fail("Empty EventQueue");
+    
+    #ifndef __NO_EXCEPTIONS
+    //An event throwing in the middle of a batch leaves the others queued
+    t20_v1=0;
+    peq.post(thrower);
+    peq.post(t20_f1);
+    try {
+        peq.run();
+        fail("run() returned");
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+    if(t20_v1!=0 || peq.size()!=1) fail("Batch");
+    peq.runOne();
+    if(t20_v1!=1234) fail("Not called");
+    
+    t=Thread::create(t20_t3,STACK_SMALL,0,&peq,Thread::JOINABLE);
+    Thread::sleep(50);
+    try {
+        peq.run();
+        fail("run() returned");
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+    t->join();
+    if(peq.empty()==false || peq.size()!=0) fail("Empty EventQueue");
+    
+    //Events put back after a throw are run by threads idle in run()
+    t20_v1=0;
+    peq.post(t20_slowThrower);
+    peq.post(t20_f1);
+    t=Thread::create(t20_t4,STACK_SMALL,0,&peq,Thread::JOINABLE);
+    try {
+        peq.run();
+        fail("run() returned");
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+    Thread::sleep(20);
+    if(t20_v1!=1234 || peq.size()!=0) fail("Requeued event not run");
+    peq.post(thrower);
+    t->join();
+    #endif //__NO_EXCEPTIONS
+    
+    //
+    // Testing timed events
+    //
+    FixedEventQueue<2,20,2> teq;
+    t20_v1=0;
+    unsigned int id1=teq.postAfter(t20_f1,20000000);
+    unsigned int id2=teq.postAfter(bind(t20_f2,2,3),10000000);
+    if(id1==0 || id2==0 || id1==id2) fail("postAfter");
+    if(teq.postAfter(t20_f1,10000000)!=0) fail("Timer slots full");
+    teq.runOne();
+    if(t20_v1!=0) fail("Too early");
+    Thread::sleep(15);
+    teq.runOne();
+    if(t20_v1!=5) fail("Not called");
+    if(teq.cancel(id2)==true) fail("Cancel");
+    if(teq.cancel(id1)==false) fail("Cancel");
+    Thread::sleep(10);
+    teq.runOne();
+    if(t20_v1!=5) fail("Cancel not effective");
+    
+    eq.postAfter(t20_f1,10000000);
+    eq.runOne();
+    if(t20_v1!=5) fail("Too early");
+    Thread::sleep(15);
+    eq.runOne();
+    if(t20_v1!=1234) fail("Not called");
+    
+    #ifndef __NO_EXCEPTIONS
+    t20_v1=0;
+    long long t1=getTime();
+    unsigned int id3=teq.postPeriodic(t20_periodic,10000000);
+    try {
+        teq.run();
+        fail("run() returned");
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+    long long t2=getTime();
+    if(t20_v1!=3 || (t2-t1)/1000000 < 29 || (t2-t1)/1000000 > 35)
+        fail("postPeriodic");
+    if(teq.cancel(id3)==false) fail("Cancel");
+    
+    t20_v1=0;
+    t1=getTime();
+    id3=eq.postPeriodic(t20_periodic,10000000);
+    try {
+        eq.run();
+        fail("run() returned");
+    } catch(int i) {
+        if(i!=5) fail("Wrong");
+    }
+    t2=getTime();
+    if(t20_v1!=3 || (t2-t1)/1000000 < 29 || (t2-t1)/1000000 > 35)
+        fail("postPeriodic");
+    if(eq.cancel(id3)==false) fail("Cancel");
+    #endif //__NO_EXCEPTIONS
     
     pass();
 }
@@ -3789,7 +3975,7 @@ static void test_25()
         auto a=chrono::system_clock::now().time_since_epoch().count();
         this_thread::sleep_for(chrono::milliseconds(100));
         auto b=chrono::system_clock::now().time_since_epoch().count();
-        if(llabs(b-a-100000000)>5000000) fail("sleep_for");
+        if(llabs(b-a-100000000)>5000000+HOST_LATENCY) fail("sleep_for");
     }
     //
     // Testing steady_clock/this_thread::sleep_until
@@ -3798,7 +3984,7 @@ static void test_25()
         auto a=chrono::steady_clock::now().time_since_epoch().count();
         this_thread::sleep_until(chrono::steady_clock::now()+chrono::milliseconds(100));
         auto b=chrono::steady_clock::now().time_since_epoch().count();
-        if(llabs(b-a-100000000)>5000000) fail("sleep_until");
+        if(llabs(b-a-100000000)>5000000+HOST_LATENCY) fail("sleep_until");
     }
     //
     // Testing condition_variable timed wait
@@ -3814,6 +4000,8 @@ static void test_25()
     timeout1+=200000;
     timeout2+=250000;
     #endif
+    timeout1+=HOST_LATENCY;
+    timeout2+=HOST_LATENCY;
     {
         unique_lock<mutex> l(t25_m1);
         auto a=chrono::steady_clock::now().time_since_epoch().count();
@@ -3991,6 +4179,97 @@ static void test_27()
     pass();
 }
 
+//
+// Test 28
+//
+/*
+tests:
+Mutex with priority ceiling
+pthread_mutexattr_setprotocol
+pthread_mutexattr_setprioceiling
+*/
+
+static volatile bool t28_v1;
+
+static void *t28_p1(void *argv)
+{
+    t28_v1=true;
+    return nullptr;
+}
+
+static void test_28()
+{
+    test_name("Mutex priority ceiling");
+    #ifndef SCHED_TYPE_EDF
+    Mutex m(Priority(2));
+    Mutex m2;
+    m.lock();
+    if(Thread::getCurrentThread()->getPriority()!=2) fail("ceiling not applied");
+    m2.lock();
+    m.unlock();
+    //m2 has no ceiling and no waiting threads
+    if(Thread::getCurrentThread()->getPriority()!=0) fail("ceiling not removed (1)");
+    m2.unlock();
+    if(m.tryLock()==false) fail("tryLock");
+    if(Thread::getCurrentThread()->getPriority()!=2) fail("ceiling not applied (tryLock)");
+    //Changing priority while holding the mutex is deferred to the unlock
+    Thread::setPriority(1);
+    if(Thread::getCurrentThread()->getPriority()!=2) fail("setPriority");
+    m.unlock();
+    if(Thread::getCurrentThread()->getPriority()!=1) fail("ceiling not removed (2)");
+    Thread::setPriority(0);
+
+    #ifndef SCHED_TYPE_CONTROL_BASED
+    //A thread with priority lower than the ceiling can't preempt the owner
+    t28_v1=false;
+    m.lock();
+    Thread *t=Thread::create(t28_p1,STACK_SMALL,1,nullptr,Thread::JOINABLE);
+    Thread::yield();
+    delayMs(10);
+    if(t28_v1) fail("preempted by lower priority than ceiling");
+    m.unlock();
+    Thread::yield();
+    if(t28_v1==false) fail("not preempted after unlock");
+    t->join();
+    #endif //SCHED_TYPE_CONTROL_BASED
+
+    //Same, using the pthread API
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    int protocol;
+    pthread_mutexattr_getprotocol(&attr,&protocol);
+    if(protocol!=PTHREAD_PRIO_NONE) fail("default protocol");
+    if(pthread_mutexattr_setprotocol(&attr,PTHREAD_PRIO_PROTECT)!=0)
+        fail("setprotocol");
+    if(pthread_mutexattr_setprioceiling(&attr,PRIORITY_MAX)!=EINVAL)
+        fail("setprioceiling out of range");
+    //pthread priorities are reversed, see pthread_create
+    if(pthread_mutexattr_setprioceiling(&attr,PRIORITY_MAX-1-2)!=0)
+        fail("setprioceiling");
+    pthread_mutex_t pm;
+    if(pthread_mutex_init(&pm,&attr)!=0) fail("pthread_mutex_init");
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_lock(&pm);
+    if(Thread::getCurrentThread()->getPriority()!=2) fail("ceiling not applied (pthread)");
+    if(pthread_mutex_trylock(&pm)!=EBUSY) fail("pthread_mutex_trylock");
+    if(pthread_mutex_destroy(&pm)!=EBUSY) fail("pthread_mutex_destroy (1)");
+    pthread_mutex_unlock(&pm);
+    if(Thread::getCurrentThread()->getPriority()!=0) fail("ceiling not removed (pthread)");
+    if(pthread_mutex_destroy(&pm)!=0) fail("pthread_mutex_destroy (2)");
+    //A recursive mutex locked by the caller must not be destroyed either
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr,PTHREAD_PRIO_INHERIT);
+    if(pthread_mutex_init(&pm,&attr)!=0) fail("pthread_mutex_init (recursive)");
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_lock(&pm);
+    if(pthread_mutex_destroy(&pm)!=EBUSY) fail("pthread_mutex_destroy (3)");
+    pthread_mutex_unlock(&pm);
+    if(pthread_mutex_destroy(&pm)!=0) fail("pthread_mutex_destroy (4)");
+    #endif //SCHED_TYPE_EDF
+    pass();
+}
+
 #if defined(_ARCH_CORTEXM7_STM32F7) || defined(_ARCH_CORTEXM7_STM32H7)
 static Thread *waiting=nullptr; /// Thread waiting on DMA completion IRQ
 
@@ -4196,7 +4475,7 @@ static int throwable(std::vector<int>& v)
 
 static void test(void *argv)
 {
-	const int n=reinterpret_cast<int>(argv);
+	const int n=reinterpret_cast<intptr_t>(argv);
 	for(;;)
 	{
 		try {
@@ -4252,15 +4531,21 @@ static void benchmark_1()
 {
     using namespace std::chrono;
     auto t=system_clock::now();
+    #ifndef _ARCH_LINUX_HOST
     extern unsigned long _data asm("_data");
+    #else //_ARCH_LINUX_HOST
+    extern unsigned long _data asm("__data_start"); //From the host C library
+    #endif //_ARCH_LINUX_HOST
     char *data=reinterpret_cast<char*>(&_data);
     memDump(data,2048);
     auto d=system_clock::now()-t;
     //every line dumps 16 bytes, and is 81 char long (considering \r\n)
     //so (2048/16)*81=10368
-    iprintf("Time required to print 10368 char is %lldms\n",
-        duration_cast<milliseconds>(d).count());
-    unsigned int baudrate=10368*10000/duration_cast<milliseconds>(d).count();
+    long long ms=duration_cast<milliseconds>(d).count();
+    iprintf("Time required to print 10368 char is %lldms\n",ms);
+    //A console faster than a serial port, such as a Linux terminal, may take
+    //less than 1ms
+    unsigned int baudrate=10368*10000/max(ms,1LL);
     iprintf("Effective baud rate =%u\n",baudrate);
 }
 
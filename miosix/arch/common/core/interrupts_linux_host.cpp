@@ -0,0 +1,146 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <time.h>
+#include <cstring>
+#include "kernel/logging.h"
+#include "kernel/kernel.h"
+#include "kernel/error.h"
+#include "config/miosix_settings.h"
+#include "interfaces/portability.h"
+#include "interrupts.h"
+
+using namespace miosix;
+
+/// \internal Number of signals that can be used as emulated interrupts, as
+/// pending ones are recorded in a 32 bit mask
+static const int numSignals=32;
+
+/// \internal The emulated interrupt vector table
+static void (*signalTable[numSignals])()={nullptr};
+
+/// \internal Stack where signal handlers run
+static unsigned int signalStack[16*1024] __attribute__((aligned(16)));
+
+/// \internal Host timer used to retry emulated interrupts that arrived while
+/// the host C library was running
+static timer_t retryTimer;
+
+/// \internal Delay before retrying, in nanoseconds
+static const long retryDelay=50000;
+
+//Defined by the host linker, they delimit the code of the simulator executable
+extern "C" char __executable_start, etext;
+
+/**
+ * \internal
+ * Common entry point of all emulated interrupts
+ */
+static void signalHandler(int sig, siginfo_t *info, void *context)
+{
+    //Signal handlers are not reentrant, as all signals are blocked while one
+    //runs, and pendingSignals is only cleared here, so it does not need atomic
+    //operations. Every handler runs all the pending ones.
+    miosix_private::pendingSignals|=1u<<sig;
+    if(miosix_private::interruptsDisabled) return; //Raised when enabled
+    ucontext_t *uc=reinterpret_cast<ucontext_t*>(context);
+    auto pc=reinterpret_cast<const char*>(uc->uc_mcontext.gregs[REG_RIP]);
+    if(pc<&__executable_start || pc>=&etext)
+    {
+        //The interrupted thread is running code of the host C library, which
+        //does not expect to be reentered by another thread as the host only
+        //sees one, so a context switch here could for example corrupt the
+        //heap. Retry shortly, as the thread will soon return to Miosix code
+        itimerspec retry={{0,0},{0,retryDelay}};
+        timer_settime(retryTimer,0,&retry,nullptr);
+        return;
+    }
+    saveContext(uc);
+    unsigned int pending=miosix_private::pendingSignals;
+    miosix_private::pendingSignals=0;
+    for(int i=0;pending!=0;i++,pending>>=1)
+    {
+        if((pending & 1)==0 || i==dispatchSignal) continue;
+        if(signalTable[i]) signalTable[i]();
+        else unexpectedInterrupt();
+    }
+    restoreContext(uc);
+}
+
+/**
+ * \internal
+ * Install signalHandler as the handler of a signal
+ * \param sig signal number
+ */
+static void IRQinstallSignalHandler(int sig)
+{
+    struct sigaction sa;
+    memset(&sa,0,sizeof(sa));
+    sa.sa_sigaction=signalHandler;
+    sa.sa_flags=SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+    //Block all signals while an handler runs, as interrupts are assumed to be
+    //in mutual exclusion. Synchronous faults still kill the process
+    sigfillset(&sa.sa_mask);
+    if(sigaction(sig,&sa,nullptr)<0) errorHandler(UNEXPECTED);
+}
+
+namespace miosix {
+
+void IRQregisterSignalHandler(int sig, void (*handler)())
+{
+    static bool initialized=false;
+    if(initialized==false)
+    {
+        stack_t ss;
+        ss.ss_sp=signalStack;
+        ss.ss_flags=0;
+        ss.ss_size=sizeof(signalStack);
+        if(sigaltstack(&ss,nullptr)<0) errorHandler(UNEXPECTED);
+        sigevent sev;
+        memset(&sev,0,sizeof(sev));
+        sev.sigev_signo=dispatchSignal;
+        sev.sigev_notify=SIGEV_SIGNAL;
+        if(timer_create(CLOCK_MONOTONIC,&sev,&retryTimer)<0)
+            errorHandler(UNEXPECTED);
+        IRQinstallSignalHandler(dispatchSignal);
+        initialized=true;
+    }
+    if(sig<=0 || sig>=numSignals || sig==dispatchSignal)
+        errorHandler(UNEXPECTED);
+    signalTable[sig]=handler;
+    IRQinstallSignalHandler(sig);
+}
+
+} //namespace miosix
+
+void unexpectedInterrupt()
+{
+    #ifdef WITH_ERRLOG
+    IRQerrorLog("\r\n***Unexpected Peripheral interrupt\r\n");
+    #endif //WITH_ERRLOG
+    miosix_private::IRQsystemReboot();
+}
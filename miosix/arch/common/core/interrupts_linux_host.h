@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include <signal.h>
+
+/**
+ * Called when an unexpected interrupt occurs.
+ * In the simulator, this is a signal for which no handler was registered.
+ */
+void unexpectedInterrupt();
+
+namespace miosix {
+
+/**
+ * \internal
+ * Signal used to run the handlers of emulated interrupts that could not run
+ * when their signal arrived, either because interrupts were disabled or
+ * because the host C library was running. It has no handler of its own.
+ */
+const int dispatchSignal=SIGUSR2;
+
+/**
+ * \internal
+ * In the simulator interrupts are emulated with Linux signals. This function
+ * installs a handler for a signal, which is then called as an interrupt
+ * routine, that is, with the context of the interrupted thread saved, so that
+ * it can call Scheduler::IRQfindNextThread() to cause a context switch.
+ * The handler is deferred while interrupts are disabled or while the
+ * interrupted thread is running code of the host C library, is executed on a
+ * dedicated signal stack and is never preempted by other emulated interrupts.
+ * Can only be called before the kernel is started or with interrupts disabled.
+ * \param sig host signal number, lower than 32 and other than dispatchSignal
+ * \param handler interrupt routine
+ */
+void IRQregisterSignalHandler(int sig, void (*handler)());
+
+} //namespace miosix
@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstring>
+#include <time.h>
+#include "kernel/kernel.h"
+#include "kernel/error.h"
+#include "interfaces/os_timer.h"
+#include "interfaces-impl/host_syscall.h"
+#include "interrupts.h"
+
+/*
+ * The os timer of the Linux host simulator. Time is read from the host
+ * CLOCK_MONOTONIC, and the timer interrupt is a POSIX timer delivering SIGALRM
+ * at an absolute time, so the timer has a nominal resolution of 1ns.
+ */
+
+using namespace miosix::host;
+
+namespace miosix {
+
+namespace internal {
+
+static timer_t timerId;          ///< Host POSIX timer
+static long long bootTime;       ///< Host time at boot, in ns
+static long long timeOffset=0;   ///< Added by IRQosTimerSetTime(), in ns
+static long long nextInterrupt=0x7fffffffffffffffLL; ///< Kernel time, in ns
+
+/**
+ * \internal
+ * Program the host timer to fire at nextInterrupt. If the time is already
+ * in the past, the host kernel delivers the signal immediately.
+ */
+static void IRQarmHostTimer() noexcept
+{
+    long long t=nextInterrupt-timeOffset+bootTime;
+    if(t<=0) t=1; //Zero would disarm the timer
+    itimerspec value;
+    value.it_interval.tv_sec=0;
+    value.it_interval.tv_nsec=0;
+    value.it_value.tv_sec=t/1000000000LL;
+    value.it_value.tv_nsec=t%1000000000LL;
+    timer_settime(timerId,TIMER_ABSTIME,&value,nullptr);
+}
+
+/**
+ * \internal
+ * SIGALRM handler. The signal may be delivered late if it arrived while
+ * interrupts were disabled, or refer to a timeout that was since moved
+ * forward, so check if the deadline has actually passed.
+ */
+static void IRQtimerInterruptHandler()
+{
+    long long t=IRQgetTime();
+    if(t>=nextInterrupt) IRQtimerInterrupt(t);
+}
+
+void IRQosTimerInit()
+{
+    bootTime=hostMonotonicTime();
+    sigevent sev;
+    memset(&sev,0,sizeof(sev));
+    sev.sigev_signo=SIGALRM;
+    sev.sigev_notify=SIGEV_SIGNAL;
+    if(timer_create(CLOCK_MONOTONIC,&sev,&timerId)<0)
+        errorHandler(UNEXPECTED);
+    IRQregisterSignalHandler(SIGALRM,IRQtimerInterruptHandler);
+}
+
+void IRQosTimerSetInterrupt(long long ns) noexcept
+{
+    nextInterrupt=ns;
+    IRQarmHostTimer();
+}
+
+void IRQosTimerSetTime(long long ns) noexcept
+{
+    //The os timer needs to be monotonic, can only move forward
+    long long delta=ns-IRQgetTime();
+    if(delta<=0) return;
+    timeOffset+=delta;
+    //The mapping between kernel and host time changed, so reprogram the timer
+    IRQarmHostTimer();
+}
+
+unsigned int osTimerGetFrequency()
+{
+    return 1000000000;
+}
+
+} //namespace internal
+
+long long getTime() noexcept
+{
+    //timeOffset can change in IRQ context
+    FastInterruptDisableLock dLock;
+    return IRQgetTime();
+}
+
+long long IRQgetTime() noexcept
+{
+    return hostMonotonicTime()-internal::bootTime+internal::timeOffset;
+}
+
+} //namespace miosix
@@ -0,0 +1,360 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * C and C++ library integration for the Linux host simulator.
+ * The simulator is linked with the C and C++ libraries of the host instead of
+ * the Miosix patched newlib. The system calls in stdlib_integration are shared
+ * with newlib, while this file contains what depends on the host libraries:
+ * heap statistics, the stand-in reentrancy structure, the functions whose
+ * signature differs from the newlib one, and replacements for the functions
+ * of the host libraries that would otherwise bypass Miosix.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdarg>
+#include <cerrno>
+#include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <reent.h>
+#include <future>
+#include "kernel/kernel.h"
+#include "kernel/sync.h"
+#include "util/util.h"
+#include "stdlib_integration/libc_integration.h"
+
+namespace miosix {
+
+//
+// Heap statistics
+// ===============
+
+// The simulator uses the heap of the host C library, which grows on demand and
+// keeps no high watermark, so the heap size is the memory it got so far and
+// the minimum free heap is the current one
+
+unsigned int getLargestFreeHeapBlock()
+{
+    //The top chunk of the heap is the free memory at the end of the heap
+    return mallinfo2().keepcost;
+}
+
+unsigned int MemoryProfiling::getHeapSize()
+{
+    struct mallinfo2 mallocData=mallinfo2();
+    return mallocData.arena+mallocData.hblkhd;
+}
+
+unsigned int MemoryProfiling::getAbsoluteFreeHeap()
+{
+    return getCurrentFreeHeap();
+}
+
+unsigned int MemoryProfiling::getCurrentFreeHeap()
+{
+    return mallinfo2().fordblks;
+}
+
+} //namespace miosix
+
+/// Stand-in reentrancy structure used before the kernel is started, see the
+/// reent.h header of this architecture
+static struct _reent globalReent;
+struct _reent *const _global_impure_ptr=&globalReent;
+
+extern "C" {
+
+//
+// Functions with a different signature in the host C library
+// ===========================================================
+
+//Miosix system calls not declared by the host C library
+int _ioctl_r(struct _reent *ptr, int fd, int cmd, void *arg);
+int getdents(int fd, struct dirent *buf, unsigned int size);
+
+int ioctl(int fd, unsigned long cmd, ...)
+{
+    //The host C library declares ioctl as variadic
+    va_list arg;
+    va_start(arg,cmd);
+    void *opt=va_arg(arg,void*);
+    va_end(arg);
+    return _ioctl_r(_GLOBAL_REENT,fd,cmd,opt);
+}
+
+//The libstdc++ of the host uses this instead of pthread_cond_timedwait, all
+//clocks are the same clock in Miosix so clockid is not considered
+int pthread_cond_clockwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           clockid_t clockid, const struct timespec *abstime)
+{
+    return pthread_cond_timedwait(cond,mutex,abstime);
+}
+
+//
+// Host C library integration
+// ==========================
+
+// The system calls in stdlib_integration replace those of the host C library
+// when called by Miosix and application code, but the host C library itself
+// performs system calls directly on the host. The functions below replace
+// those of the host C library that would otherwise access host files or block
+// the whole simulator. Note that the host C library only sees one thread, so a
+// stdio stream must not be used concurrently by more threads.
+
+/**
+ * \internal
+ * Read callback of stdio streams, reads from a Miosix file descriptor
+ */
+static ssize_t cookieRead(void *cookie, char *buf, size_t size)
+{
+    return read(static_cast<int>(reinterpret_cast<intptr_t>(cookie)),buf,size);
+}
+
+/**
+ * \internal
+ * Write callback of stdio streams, writes to a Miosix file descriptor
+ */
+static ssize_t cookieWrite(void *cookie, const char *buf, size_t size)
+{
+    return write(static_cast<int>(reinterpret_cast<intptr_t>(cookie)),buf,size);
+}
+
+/**
+ * \internal
+ * Seek callback of stdio streams, seeks a Miosix file descriptor
+ */
+static int cookieSeek(void *cookie, off64_t *pos, int whence)
+{
+    off_t result=lseek(static_cast<int>(reinterpret_cast<intptr_t>(cookie)),
+                       *pos,whence);
+    if(result<0) return -1;
+    *pos=result;
+    return 0;
+}
+
+/**
+ * \internal
+ * Close callback of stdio streams, closes a Miosix file descriptor
+ */
+static int cookieClose(void *cookie)
+{
+    return close(static_cast<int>(reinterpret_cast<intptr_t>(cookie)));
+}
+
+FILE *fdopen(int fd, const char *mode)
+{
+    cookie_io_functions_t io={cookieRead,cookieWrite,cookieSeek,cookieClose};
+    FILE *result=fopencookie(reinterpret_cast<void*>(static_cast<intptr_t>(fd)),
+                             mode,io);
+    //Streams of the host C library are file streams, so fileno() only needs
+    //the file descriptor number, that is not otherwise used by cookie streams
+    if(result) result->_fileno=fd;
+    return result;
+}
+
+FILE *fopen(const char *name, const char *mode)
+{
+    int flags;
+    switch(mode[0])
+    {
+        case 'r': flags=O_RDONLY; break;
+        case 'w': flags=O_WRONLY | O_CREAT | O_TRUNC; break;
+        case 'a': flags=O_WRONLY | O_CREAT | O_APPEND; break;
+        default:
+            errno=EINVAL;
+            return nullptr;
+    }
+    for(const char *m=mode+1;*m;m++)
+    {
+        if(*m=='+') flags=(flags & ~O_ACCMODE) | O_RDWR;
+        else if(*m=='x') flags|=O_EXCL;
+    }
+    int fd=open(name,flags,0666);
+    if(fd<0) return nullptr;
+    FILE *result=fdopen(fd,mode);
+    if(result==nullptr) close(fd);
+    return result;
+}
+
+int remove(const char *path)
+{
+    return unlink(path);
+}
+
+/**
+ * \internal
+ * Directory stream, the host C library one is opaque
+ */
+struct __dirstream
+{
+    int fd;   ///< Miosix file descriptor of the directory
+    int pos;  ///< Offset of the next entry in buffer
+    int size; ///< Number of valid bytes in buffer
+    char buffer[1024] __attribute__((aligned(8))); ///< Entries from getdents
+};
+
+DIR *fdopendir(int fd)
+{
+    DIR *result=reinterpret_cast<DIR*>(malloc(sizeof(DIR)));
+    if(result==nullptr) return nullptr;
+    result->fd=fd;
+    result->pos=0;
+    result->size=0;
+    return result;
+}
+
+DIR *opendir(const char *name)
+{
+    int fd=open(name,O_RDONLY | O_DIRECTORY);
+    if(fd<0) return nullptr;
+    DIR *result=fdopendir(fd);
+    if(result==nullptr) close(fd);
+    return result;
+}
+
+struct dirent *readdir(DIR *dir)
+{
+    if(dir->pos>=dir->size)
+    {
+        int result=getdents(dir->fd,reinterpret_cast<struct dirent*>(
+            dir->buffer),sizeof(dir->buffer));
+        if(result<=0) return nullptr;
+        dir->pos=0;
+        dir->size=result;
+    }
+    auto result=reinterpret_cast<struct dirent*>(dir->buffer+dir->pos);
+    if(result->d_reclen==0) return nullptr; //Terminating entry
+    dir->pos+=result->d_reclen;
+    return result;
+}
+
+void rewinddir(DIR *dir)
+{
+    lseek(dir->fd,0,SEEK_SET);
+    dir->pos=0;
+    dir->size=0;
+}
+
+int dirfd(DIR *dir)
+{
+    return dir->fd;
+}
+
+int closedir(DIR *dir)
+{
+    int result=close(dir->fd);
+    free(dir);
+    return result;
+}
+
+unsigned int sleep(unsigned int seconds)
+{
+    struct timespec ts;
+    ts.tv_sec=seconds;
+    ts.tv_nsec=0;
+    return nanosleep(&ts,nullptr)==0 ? 0 : seconds;
+}
+
+int usleep(useconds_t us)
+{
+    struct timespec ts;
+    ts.tv_sec=us/1000000;
+    ts.tv_nsec=(us%1000000)*1000;
+    return nanosleep(&ts,nullptr);
+}
+
+/**
+ * \internal
+ * Replace the standard streams of the host C library with ones using the
+ * Miosix file descriptors 0, 1 and 2. This runs before all other global
+ * constructors, so also the C++ standard streams use the new ones.
+ */
+static void __attribute__((constructor(101))) redirectStandardStreams()
+{
+    stdin=fdopen(STDIN_FILENO,"r");
+    stdout=fdopen(STDOUT_FILENO,"w");
+    stderr=fdopen(STDERR_FILENO,"w");
+    //Same buffering as in the Miosix C library
+    setvbuf(stdout,nullptr,_IOLBF,BUFSIZ);
+    setvbuf(stderr,nullptr,_IONBF,0);
+}
+
+} //extern "C"
+
+//
+// libstdc++ futex support, used by std::future
+// ============================================
+
+// The libstdc++ of the host waits with the futex syscall, that would block all
+// threads, as they all run in the same host thread. Waiting is done instead on
+// a single condition variable shared by all futex words, as libstdc++ already
+// tolerates spurious wakeups.
+
+static miosix::FastMutex futexMutex;
+static miosix::ConditionVariable futexCv;
+
+namespace std {
+
+static bool futexWaitUntil(unsigned *addr, unsigned val, bool hasTimeout,
+        chrono::seconds s, chrono::nanoseconds ns)
+{
+    miosix::Lock<miosix::FastMutex> l(futexMutex);
+    if(__atomic_load_n(addr,__ATOMIC_SEQ_CST)!=val) return true;
+    if(hasTimeout==false)
+    {
+        futexCv.wait(l);
+        return true;
+    }
+    //All clocks are the same clock in Miosix
+    long long absTime=chrono::nanoseconds(s).count()+ns.count();
+    return futexCv.timedWait(l,absTime)==miosix::TimedWaitResult::NoTimeout;
+}
+
+bool __atomic_futex_unsigned_base::_M_futex_wait_until(unsigned *addr,
+        unsigned val, bool hasTimeout, chrono::seconds s, chrono::nanoseconds ns)
+{
+    return futexWaitUntil(addr,val,hasTimeout,s,ns);
+}
+
+bool __atomic_futex_unsigned_base::_M_futex_wait_until_steady(unsigned *addr,
+        unsigned val, bool hasTimeout, chrono::seconds s, chrono::nanoseconds ns)
+{
+    return futexWaitUntil(addr,val,hasTimeout,s,ns);
+}
+
+void __atomic_futex_unsigned_base::_M_futex_notify_all(unsigned *addr)
+{
+    miosix::Lock<miosix::FastMutex> l(futexMutex);
+    futexCv.broadcast();
+}
+
+} //namespace std
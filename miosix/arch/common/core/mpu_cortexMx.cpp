@@ -45,6 +45,20 @@ unsigned int sizeToMpu(unsigned int size)
 
 #ifdef WITH_PROCESSES
 
+void IRQconfigureUserspaceReadableRegion(unsigned int region,
+        const volatile void *base, unsigned int size, bool device)
+{
+    #if __MPU_PRESENT==1
+    MPU->RBAR=(reinterpret_cast<unsigned int>(base) & (~0x1f))
+            | MPU_RBAR_VALID_Msk | region;
+    MPU->RASR=2<<MPU_RASR_AP_Pos //Privileged: RW, unprivileged: RO
+            | MPU_RASR_XN_Msk
+            | (device ? MPU_RASR_B_Msk : MPU_RASR_C_Msk) //Device or normal
+            | 1 //Enable bit
+            | sizeToMpu(size)<<1;
+    #endif //__MPU_PRESENT==1
+}
+
 //
 // class MPUConfiguration
 //
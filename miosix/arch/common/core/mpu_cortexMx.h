@@ -54,6 +54,20 @@ inline void IRQenableMPUatBoot()
 
 #ifdef WITH_PROCESSES
 
+/**
+ * \internal
+ * Configure an MPU region that unprivileged code can read but not write or
+ * execute, to let processes read kernel data or peripheral registers without
+ * a syscall. The region stays configured regardless of the running process.
+ * \param region MPU region. Regions 0 to 2 are used by IRQconfigureCache() and
+ * regions 6 and 7 by processes, so this should be either 4 or 5
+ * \param base base address, must be aligned to size
+ * \param size size, must be at least 32 and a power of 2
+ * \param device true if the region contains peripheral registers
+ */
+void IRQconfigureUserspaceReadableRegion(unsigned int region,
+        const volatile void *base, unsigned int size, bool device);
+
 /**
  * \internal
  * This class is used to manage the MemoryProtectionUnit
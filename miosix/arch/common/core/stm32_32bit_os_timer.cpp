@@ -28,6 +28,8 @@
 #include "kernel/kernel.h"
 #include "interfaces/os_timer.h"
 #include "interfaces/arch_registers.h"
+#include "interfaces/portability.h"
+#include <cstddef>
 
 namespace miosix {
 
@@ -162,6 +164,22 @@ public:
         T::get()->ARR = 0xFFFFFFFF;
         T::get()->EGR = TIM_EGR_UG; //To enforce the timer to apply PSC
     }
+
+    #ifdef WITH_PROCESSES
+    static void IRQinitTimePage(TimePage& page)
+    {
+        //Reading the timer registers has no side effects, so make the ones up
+        //to CNT readable by processes, to let them get the time without a
+        //syscall. TIM2 and TIM5 are aligned to 1KByte, as required by the MPU
+        static_assert(offsetof(TIM_TypeDef,CNT)<64,"CNT outside MPU region");
+        IRQconfigureUserspaceReadableRegion(4,&page,sizeof(TimePage),false);
+        IRQconfigureUserspaceReadableRegion(5,T::get(),64,true);
+        //Casts are needed as uint32_t is unsigned long
+        page.counter=reinterpret_cast<volatile unsigned int*>(&T::get()->CNT);
+        page.overflowFlag=reinterpret_cast<volatile unsigned int*>(&T::get()->SR);
+        page.overflowBit=TIM_SR_UIF_Pos;
+    }
+    #endif //WITH_PROCESSES
 };
 
 static STM32Timer<TIMER_HW_CLASS> timer;
@@ -259,6 +259,16 @@ int EFM32Serial::ioctl(int cmd, void* arg)
     }
 }
 
+int EFM32Serial::poll(int events, PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    pollQueue.IRQadd(reg);
+    //No tx queue, see the limitation documented in the header
+    int result=POLLOUT;
+    if(!rxQueue.isEmpty()) result|=POLLIN;
+    return result;
+}
+
 void EFM32Serial::IRQhandleInterrupt()
 {
     bool atLeastOne=false;
@@ -271,13 +281,18 @@ void EFM32Serial::IRQhandleInterrupt()
             if(rxQueue.tryPut(c & 0xff)==false) /*fifo overflow*/;
         }
     }
-    if(atLeastOne && rxWaiting)
+    if(atLeastOne)
     {
-        rxWaiting->IRQwakeup();
-        if(rxWaiting->IRQgetPriority()>
-            Thread::IRQgetCurrentThread()->IRQgetPriority())
-                Scheduler::IRQfindNextThread();
-        rxWaiting=0;
+        bool hppw=false;
+        if(rxWaiting)
+        {
+            rxWaiting->IRQwakeup();
+            if(rxWaiting->IRQgetPriority()>
+                Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
+            rxWaiting=0;
+        }
+        pollQueue.IRQwakeup(hppw);
+        if(hppw) Scheduler::IRQfindNextThread();
     }
     
 }
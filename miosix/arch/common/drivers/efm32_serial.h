@@ -28,6 +28,7 @@
 #pragma once
 
 #include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "kernel/queue.h"
 
@@ -95,6 +96,19 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the serial port is ready for I/O. The port is readable
+     * when there are received characters in the queue, and always writable.
+     * This is a deliberate limitation: writeBlock() has no tx queue, it
+     * busy waits for TXBL before each character, so a write only waits for
+     * the time it takes to transmit the data, and there is no interrupt to
+     * wake pollers when the transmitter becomes free
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
     
     /**
      * \internal the serial port interrupts call this member function.
@@ -124,6 +138,7 @@ private:
     DynUnsyncQueue<char> rxQueue;     ///< Receiving queue
     static const unsigned int rxQueueMin=1; ///< Minimum queue size
     Thread *rxWaiting;                ///< Thread waiting for rx, or 0
+    PollQueue pollQueue;              ///< Threads polling for rx
     
     USART_TypeDef *port;              ///< Pointer to USART peripheral
 
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "linux_host_block.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "interfaces-impl/host_syscall.h"
+
+using namespace miosix::host;
+
+namespace miosix {
+
+LinuxHostBlockDevice::LinuxHostBlockDevice(const char *path,
+        unsigned int eraseSize) : Device(Device::BLOCK), eraseSize(eraseSize)
+{
+    fd=hostOpen(path,O_RDWR,0);
+    size=fd>=0 ? hostLseek(fd,0,SEEK_END) : 0;
+    if(size<0) size=0;
+}
+
+ssize_t LinuxHostBlockDevice::readBlock(void *buffer, size_t size, off_t where)
+{
+    if(where % 512 || size % 512) return -EFAULT;
+    if(fd<0) return -EIO;
+    Lock<FastMutex> l(mutex);
+    //Host disk I/O is blocking, and blocks the whole simulator just like a
+    //polled driver would block the CPU
+    char *buf=reinterpret_cast<char*>(buffer);
+    size_t done=0;
+    while(done<size)
+    {
+        ssize_t result=hostPread(fd,buf+done,size-done,where+done);
+        if(result==-EINTR) continue;
+        if(result<=0) return -EIO; //Reading past the end of the image fails
+        done+=result;
+    }
+    return size;
+}
+
+ssize_t LinuxHostBlockDevice::writeBlock(const void *buffer, size_t size,
+                                         off_t where)
+{
+    if(where % 512 || size % 512) return -EFAULT;
+    if(fd<0) return -EIO;
+    Lock<FastMutex> l(mutex);
+    const char *buf=reinterpret_cast<const char*>(buffer);
+    size_t done=0;
+    while(done<size)
+    {
+        ssize_t result=hostPwrite(fd,buf+done,size-done,where+done);
+        if(result==-EINTR) continue;
+        if(result<=0) return -EIO;
+        done+=result;
+    }
+    return size;
+}
+
+int LinuxHostBlockDevice::ioctl(int cmd, void *arg)
+{
+    if(fd<0) return -EIO;
+    switch(cmd)
+    {
+        case IOCTL_SYNC:
+        {
+            Lock<FastMutex> l(mutex);
+            return hostFsync(fd)==0 ? 0 : -EIO;
+        }
+        case IOCTL_GET_GEOMETRY:
+        {
+            if(arg==nullptr) return -EFAULT;
+            auto geometry=reinterpret_cast<BlockDeviceGeometry*>(arg);
+            geometry->readSize=512;
+            geometry->progSize=512;
+            geometry->eraseSize=eraseSize;
+            geometry->blockCount=size/eraseSize;
+            return 0;
+        }
+    }
+    return -ENOTTY;
+}
+
+LinuxHostBlockDevice::~LinuxHostBlockDevice()
+{
+    if(fd>=0) hostClose(fd);
+}
+
+} //namespace miosix
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "kernel/sync.h"
+#include "filesystem/devfs/devfs.h"
+#include "filesystem/ioctl.h"
+
+namespace miosix {
+
+/**
+ * Block device for the Linux host simulator, backed by a disk image file on
+ * the host filesystem. Like SD card drivers, it only accepts reads and writes
+ * that are aligned to a 512 byte sector. The geometry reported through
+ * IOCTL_GET_GEOMETRY can be changed to emulate flash memories.
+ */
+class LinuxHostBlockDevice : public Device
+{
+public:
+    /**
+     * Constructor
+     * \param path path of the disk image in the host filesystem
+     * \param eraseSize erase block size reported by IOCTL_GET_GEOMETRY, must
+     * be a multiple of 512
+     */
+    LinuxHostBlockDevice(const char *path, unsigned int eraseSize=512);
+
+    /**
+     * \return true if the disk image could be opened
+     */
+    bool isOpen() const { return fd>=0; }
+
+    virtual ssize_t readBlock(void *buffer, size_t size, off_t where);
+
+    virtual ssize_t writeBlock(const void *buffer, size_t size, off_t where);
+
+    virtual int ioctl(int cmd, void *arg);
+
+    /**
+     * Destructor
+     */
+    ~LinuxHostBlockDevice();
+
+private:
+    FastMutex mutex;
+    int fd; ///< Host file descriptor of the disk image
+    unsigned int eraseSize; ///< Reported erase block size
+    long long size; ///< Size of the disk image
+};
+
+} //namespace miosix
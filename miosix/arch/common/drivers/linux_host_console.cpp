@@ -0,0 +1,172 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "linux_host_console.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <cstring>
+#include <termios.h>
+#include <asm/ioctls.h>
+#include "kernel/kernel.h"
+#include "kernel/scheduler/scheduler.h"
+#include "filesystem/ioctl.h"
+#include "core/interrupts.h"
+
+using namespace miosix::host;
+
+namespace miosix {
+
+/// Thread waiting for input, or nullptr
+static Thread *rxWaiting=nullptr;
+/// Set by the SIGIO handler, cleared before reading
+static volatile bool rxReady=false;
+/// Threads polling for input
+static PollQueue pollQueue;
+/// Host terminal settings, valid if hostTerminalSaved is true
+static termios hostTerminal;
+static bool hostTerminalSaved=false;
+
+LinuxHostConsole::LinuxHostConsole() : Device(Device::TTY)
+{
+    if(hostIoctl(0,TCGETS,&hostTerminal)==0)
+    {
+        hostTerminalSaved=true;
+        termios raw=hostTerminal;
+        raw.c_lflag&=~(ICANON | ECHO);
+        hostIoctl(0,TCSETS,&raw);
+    }
+    InterruptDisableLock dLock;
+    IRQregisterSignalHandler(SIGIO,IRQhandleSigio);
+    hostFcntl(0,F_SETOWN,hostGetpid());
+    int flags=hostFcntl(0,F_GETFL,0);
+    if(flags>=0) hostFcntl(0,F_SETFL,flags | O_NONBLOCK | O_ASYNC);
+}
+
+ssize_t LinuxHostConsole::readBlock(void *buffer, size_t size, off_t where)
+{
+    Lock<FastMutex> l(rxMutex);
+    for(;;)
+    {
+        rxReady=false;
+        ssize_t result=hostRead(0,buffer,size);
+        if(result>=0) return result;
+        if(result!=-EAGAIN && result!=-EINTR) return -EIO;
+        //Wait for data, unless SIGIO arrived in the meantime
+        FastInterruptDisableLock dLock;
+        while(rxReady==false)
+        {
+            rxWaiting=Thread::IRQgetCurrentThread();
+            Thread::IRQenableIrqAndWait(dLock);
+        }
+    }
+}
+
+ssize_t LinuxHostConsole::writeBlock(const void *buffer, size_t size,
+                                     off_t where)
+{
+    Lock<FastMutex> l(txMutex);
+    const char *buf=reinterpret_cast<const char*>(buffer);
+    size_t written=0;
+    while(written<size)
+    {
+        ssize_t result=hostWrite(1,buf+written,size-written);
+        if(result==-EINTR || result==-EAGAIN) continue;
+        if(result<0) return written>0 ? written : -EIO;
+        written+=result;
+    }
+    return size;
+}
+
+void LinuxHostConsole::IRQwrite(const char *str)
+{
+    hostWrite(1,str,strlen(str));
+}
+
+int LinuxHostConsole::ioctl(int cmd, void *arg)
+{
+    if(reinterpret_cast<uintptr_t>(arg) & 0b11) return -EFAULT; //Unaligned
+    termios *t=reinterpret_cast<termios*>(arg);
+    switch(cmd)
+    {
+        case IOCTL_SYNC:
+            return 0; //Writes to the host are synchronous
+        case IOCTL_TCGETATTR:
+            t->c_iflag=IGNBRK | IGNPAR;
+            t->c_oflag=0;
+            t->c_cflag=CS8;
+            t->c_lflag=0;
+            return 0;
+        case IOCTL_TCSETATTR_NOW:
+        case IOCTL_TCSETATTR_DRAIN:
+        case IOCTL_TCSETATTR_FLUSH:
+            //Changing things at runtime unsupported, so do nothing, but don't
+            //return error as console_device.h implements some attribute changes
+            return 0;
+        default:
+            return -ENOTTY; //Means the operation does not apply to this descriptor
+    }
+}
+
+int LinuxHostConsole::poll(int events, PollRegistration *reg)
+{
+    pollQueue.add(reg);
+    //If the host can't tell, report stdin as readable so that the caller will
+    //find out with a read
+    int available=0;
+    int result=POLLOUT;
+    if(hostIoctl(0,FIONREAD,&available)!=0 || available>0) result|=POLLIN;
+    return result;
+}
+
+void LinuxHostConsole::IRQrestoreHostTerminal()
+{
+    if(hostTerminalSaved) hostIoctl(0,TCSETS,&hostTerminal);
+}
+
+LinuxHostConsole::~LinuxHostConsole()
+{
+    int flags=hostFcntl(0,F_GETFL,0);
+    if(flags>=0) hostFcntl(0,F_SETFL,flags & ~(O_NONBLOCK | O_ASYNC));
+    IRQrestoreHostTerminal();
+}
+
+void LinuxHostConsole::IRQhandleSigio()
+{
+    rxReady=true;
+    bool hppw=false;
+    pollQueue.IRQwakeup(hppw);
+    if(rxWaiting)
+    {
+        rxWaiting->IRQwakeup();
+        if(rxWaiting->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+            hppw=true;
+        rxWaiting=nullptr;
+    }
+    if(hppw) Scheduler::IRQfindNextThread();
+}
+
+} //namespace miosix
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
+#include "kernel/sync.h"
+#include "interfaces-impl/host_syscall.h"
+
+namespace miosix {
+
+/**
+ * Console driver for the Linux host simulator, using the stdin and stdout
+ * of the simulator process in place of a serial port.
+ * Reads are interrupt-driven: stdin is put in nonblocking mode and configured
+ * to deliver SIGIO when data is available, so a thread waiting for input does
+ * not block the whole simulator. If stdin is a terminal, echo and line
+ * buffering are disabled on the host side, as TerminalDevice already
+ * implements them.
+ */
+class LinuxHostConsole : public Device
+{
+public:
+    /**
+     * Constructor
+     */
+    LinuxHostConsole();
+
+    /**
+     * Read a block of data
+     * \param buffer buffer where read data will be stored
+     * \param size buffer size
+     * \param where where to read from
+     * \return number of bytes read or a negative number on failure. Note that
+     * it is normal for this function to return less character than the amount
+     * asked
+     */
+    ssize_t readBlock(void *buffer, size_t size, off_t where);
+
+    /**
+     * Write a block of data
+     * \param buffer buffer where take data to write
+     * \param size buffer size
+     * \param where where to write to
+     * \return number of bytes written or a negative number on failure
+     */
+    ssize_t writeBlock(const void *buffer, size_t size, off_t where);
+
+    /**
+     * Write a string.
+     * An extension to the Device interface that adds a new member function,
+     * which is used by the kernel on console devices to write debug information
+     * before the kernel is started or in case of serious errors, right before
+     * rebooting.
+     * Can ONLY be called when the kernel is not yet started, paused or within
+     * an interrupt.
+     * \param str the string to write. The string must be NUL terminated.
+     */
+    void IRQwrite(const char *str);
+
+    /**
+     * Performs device-specific operations
+     * \param cmd specifies the operation to perform
+     * \param arg optional argument that some operation require
+     * \return the exact return value depends on CMD, -1 is returned on error
+     */
+    int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the console is ready for I/O. The console is readable
+     * when the host reports data available on stdin, and always writable,
+     * as writes to the host are synchronous and the simulator is not notified
+     * when a host stdout that would block becomes writable
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
+
+    /**
+     * Restore the host terminal settings changed by the constructor.
+     * Called when the simulator exits.
+     */
+    static void IRQrestoreHostTerminal();
+
+    /**
+     * Destructor
+     */
+    ~LinuxHostConsole();
+
+private:
+    /**
+     * \internal
+     * SIGIO handler, wakes the thread waiting for input
+     */
+    static void IRQhandleSigio();
+
+    FastMutex rxMutex; ///< Mutex locked during reception
+    FastMutex txMutex; ///< Mutex locked during transmission
+};
+
+} //namespace miosix
@@ -151,6 +151,8 @@ void RP2040PL011SerialBase::IRQhandleInterrupt()
         // Wake up the thread currently writing and clear interrupt status
         txLowWaterFlag.IRQsignal(hppw);
         uart->icr = UART_UARTICR_TXIC_BITS;
+        // The FIFO has space again, wake up threads waiting for POLLOUT
+        pollQueue.IRQwakeup(hppw);
     }
     if(flags & (UART_UARTMIS_RXMIS_BITS|UART_UARTMIS_RTMIS_BITS))
     {
@@ -167,11 +169,23 @@ void RP2040PL011SerialBase::IRQhandleInterrupt()
         // without losing the line idle status information (which only exists
         // in the interrupt flags).
         if(rxQueue.isFull()) disableRXInterrupts();
+        pollQueue.IRQwakeup(hppw);
     }
     // Reschedule if needed
     if(hppw) Scheduler::IRQfindNextThread();
 }
 
+int RP2040PL011SerialBase::poll(int events, PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    pollQueue.IRQadd(reg);
+    int result=0;
+    if(!rxQueue.isEmpty() || !(uart->fr & UART_UARTFR_RXFE_BITS))
+        result|=POLLIN;
+    if(!(uart->fr & UART_UARTFR_TXFF_BITS)) result|=POLLOUT;
+    return result;
+}
+
 int RP2040PL011SerialBase::ioctl(int cmd, void *arg)
 {
     if(reinterpret_cast<unsigned>(arg) & 0b11) return -EFAULT; //Unaligned
@@ -28,6 +28,7 @@
 #pragma once
 
 #include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "kernel/queue.h"
 #include "interfaces/arch_registers.h"
@@ -99,6 +100,16 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the serial port is ready for I/O. The port is readable
+     * when there are received bytes in the software queue or hardware FIFO,
+     * and writable when there is space in the hardware tx FIFO
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
     
     /**
      * Destructor
@@ -161,6 +172,8 @@ private:
     Semaphore txLowWaterFlag;
     /// Software queue used for buffering bytes from the hardware RX FIFO
     DynQueue<uint8_t> rxQueue;
+    /// Threads polling for received bytes
+    PollQueue pollQueue;
 };
 
 class RP2040PL011Serial0 : public RP2040PL011SerialBase
@@ -15,6 +15,8 @@
 #include "serial_atsam4l.h"
 #elif defined(_ARCH_CORTEXM0PLUS_RP2040)
 #include "rp2040_serial.h"
+#elif defined(_ARCH_LINUX_HOST)
+#include "linux_host_console.h"
 #else
 #error "Unknown arch"
 #endif
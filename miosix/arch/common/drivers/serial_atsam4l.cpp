@@ -188,6 +188,16 @@ int ATSAMSerial::ioctl(int cmd, void *arg)
     }
 }
 
+int ATSAMSerial::poll(int events, PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    pollQueue.IRQadd(reg);
+    //No tx queue, see the limitation documented in the header
+    int result=POLLOUT;
+    if(!rxQueue.isEmpty()) result|=POLLIN;
+    return result;
+}
+
 void ATSAMSerial::IRQhandleInterrupt()
 {
     bool wake=false;
@@ -212,13 +222,18 @@ void ATSAMSerial::IRQhandleInterrupt()
         idle=true;
     }
     
-    if(wake && rxWaiting)
+    if(wake)
     {
-        rxWaiting->IRQwakeup();
-        if(rxWaiting->IRQgetPriority()>
-            Thread::IRQgetCurrentThread()->IRQgetPriority())
-                Scheduler::IRQfindNextThread();
-        rxWaiting=0;
+        bool hppw=false;
+        if(rxWaiting)
+        {
+            rxWaiting->IRQwakeup();
+            if(rxWaiting->IRQgetPriority()>
+                Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
+            rxWaiting=0;
+        }
+        pollQueue.IRQwakeup(hppw);
+        if(hppw) Scheduler::IRQfindNextThread();
     }
 }
 
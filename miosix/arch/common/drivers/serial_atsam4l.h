@@ -28,6 +28,7 @@
 #pragma once
 
 #include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "kernel/queue.h"
 
@@ -97,6 +98,19 @@ public:
      */
     int ioctl(int cmd, void *arg);
 
+    /**
+     * Check whether the serial port is ready for I/O. The port is readable
+     * when there are received characters in the queue, and always writable.
+     * This is a deliberate limitation, as writeBlock() has no tx queue and
+     * busy waits on TXRDY for each character, so a write never waits for
+     * longer than it takes to transmit the data, but it is never
+     * non-blocking either
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
+
     /**
      * \internal the serial port interrupts call this member function.
      * Never call this from user code.
@@ -125,6 +139,7 @@ private:
     DynUnsyncQueue<char> rxQueue;     ///< Receiving queue
     static const unsigned int rxQueueMin=1; ///< Minimum queue size
     Thread *rxWaiting;                ///< Thread waiting for rx, or 0
+    PollQueue pollQueue;              ///< Threads polling for rx
     bool idle;                        ///< Receiver idle
     
     Usart *port;                      ///< Pointer to USART peripheral
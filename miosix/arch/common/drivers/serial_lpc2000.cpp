@@ -228,11 +228,22 @@ int LPC2000Serial::ioctl(int cmd, void* arg)
     }
 }
 
+int LPC2000Serial::poll(int events, PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    pollQueue.IRQadd(reg);
+    int result=0;
+    if(!rxQueue.isEmpty()) result|=POLLIN;
+    if(!txQueue.isFull()) result|=POLLOUT;
+    return result;
+}
+
 void LPC2000Serial::IRQhandleInterrupt()
 {
     char c;
     bool hppw=false;
     bool wakeup=false;
+    bool txSpace=false;
     switch(serial->IIR & 0xf)
     {
         case 0x6: //RLS
@@ -267,6 +278,7 @@ void LPC2000Serial::IRQhandleInterrupt()
                 if(txQueue.tryGet(c)==false) break; //If software queue empty, stop
                 serial->THR=c;
             }
+            txSpace=true;
             break;
     }
     if(wakeup && rxWaiting)
@@ -276,6 +288,7 @@ void LPC2000Serial::IRQhandleInterrupt()
                 Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
         rxWaiting=nullptr;
     }
+    if(wakeup || txSpace) pollQueue.IRQwakeup(hppw);
     if(hppw) Scheduler::IRQfindNextThread();
 }
 
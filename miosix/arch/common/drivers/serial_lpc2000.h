@@ -30,6 +30,7 @@
 #define SERIAL_LPC2000_H
 
 #include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "kernel/queue.h"
 #include "interfaces/delays.h"
@@ -93,6 +94,16 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the serial port is ready for I/O. The port is readable
+     * when there are received characters in the rx queue, and writable when
+     * there is space in the tx queue
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
     
     /**
      * \internal the serial port interrupts call this member function.
@@ -175,6 +186,7 @@ private:
     DynUnsyncQueue<char>  rxQueue;///< Rx software queue
     Thread *txWaiting;  ///< Thread waiting on rx queue
     Thread *rxWaiting;  ///< Thread waiting on rx queue
+    PollQueue pollQueue;///< Threads polling the port
     bool idle;          ///< Receiver idle
     
     Usart16550 *serial; ///< Serial port registers
@@ -1007,6 +1007,17 @@ int STM32Serial::ioctl(int cmd, void* arg)
     }
 }
 
+int STM32Serial::poll(int events, PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    pollQueue.IRQadd(reg);
+    //Writes block only until the characters are transmitted, so the port
+    //is considered always writable, see the header
+    int result=POLLOUT;
+    if(!rxQueue.isEmpty()) result|=POLLIN;
+    return result;
+}
+
 void STM32Serial::IRQhandleInterrupt()
 {
     #if !defined(_ARCH_CORTEXM7_STM32F7) && !defined(_ARCH_CORTEXM7_STM32H7) \
@@ -1061,14 +1072,16 @@ void STM32Serial::IRQhandleInterrupt()
     if((status & USART_SR_IDLE) || rxQueue.size()>=rxQueueMin)
     {
         //Enough data in buffer or idle line, awake thread
+        bool hppw=false;
         if(rxWaiting)
         {
             rxWaiting->IRQwakeup();
             if(rxWaiting->IRQgetPriority()>
-                Thread::IRQgetCurrentThread()->IRQgetPriority())
-                    Scheduler::IRQfindNextThread();
+                Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
             rxWaiting=0;
         }
+        if(!rxQueue.isEmpty()) pollQueue.IRQwakeup(hppw);
+        if(hppw) Scheduler::IRQfindNextThread();
     }
 }
 
@@ -1087,11 +1100,16 @@ void STM32Serial::IRQhandleDMArx()
 {
     IRQreadDma();
     idle=false;
-    if(rxWaiting==0) return;
-    rxWaiting->IRQwakeup();
-    if(rxWaiting->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
-        Scheduler::IRQfindNextThread();
-    rxWaiting=0;
+    bool hppw=false;
+    pollQueue.IRQwakeup(hppw);
+    if(rxWaiting)
+    {
+        rxWaiting->IRQwakeup();
+        if(rxWaiting->IRQgetPriority()>
+            Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
+        rxWaiting=0;
+    }
+    if(hppw) Scheduler::IRQfindNextThread();
 }
 #endif //SERIAL_DMA
 
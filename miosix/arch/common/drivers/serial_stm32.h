@@ -29,6 +29,7 @@
 #define	SERIAL_STM32_H
 
 #include "filesystem/console/console_device.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "kernel/queue.h"
 #include "interfaces/gpio.h"
@@ -173,6 +174,23 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the serial port is ready for I/O. The port is readable
+     * when there are received characters in the queue, and always writable.
+     * Reporting POLLOUT unconditionally is a deliberate limitation: there is
+     * no tx queue whose free space could be reported, writeBlock() returns
+     * once the data is transmitted (or handed to the DMA, after the previous
+     * transfer completed), and no interrupt wakes pollers when the
+     * transmitter becomes free. So POLLOUT means that a write takes bounded
+     * time, not that it does not block at all. With hardware flow control a
+     * write also stalls for as long as the other end deasserts CTS, which is
+     * not reported
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(int events, PollRegistration *reg);
     
     /**
      * \internal the serial port interrupts call this member function.
@@ -263,6 +281,7 @@ private:
     DynUnsyncQueue<char> rxQueue;     ///< Receiving queue
     static const unsigned int rxQueueMin=16; ///< Minimum queue size
     Thread *rxWaiting=0;              ///< Thread waiting for rx, or 0
+    PollQueue pollQueue;              ///< Threads polling for rx
     
     USART_TypeDef *port;              ///< Pointer to USART peripheral
     #ifdef SERIAL_DMA
@@ -79,6 +79,14 @@ unsigned int osTimerGetFrequency()
     return b->getTimerFrequency();
 }
 
+#ifdef WITH_PROCESSES
+const TimePage *osTimerGetTimePage()
+{
+    //Time is corrected in software, processes need to use the syscall
+    return nullptr;
+}
+#endif //WITH_PROCESSES
+
 } //namespace internal
 
 } //namespace miosix
@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/// \internal The host C runtime calls the global constructors, of both the
+/// kernel and the application, before main, so the stage 2 boot must not call
+/// them again
+#define ARCH_CRT_CALLS_CONSTRUCTORS
+
+namespace miosix {
+
+/**
+ * \addtogroup Settings
+ * \{
+ */
+
+/// \internal Size of vector to store registers during ctx switch.
+/// The simulator saves the x86_64 general purpose registers from r8 to rflags
+/// in the order of the host mcontext_t (18 qwords, 36 words), the 512 byte
+/// fxsave area of the FPU/SSE unit (128 words) and errno (1 word), all taken
+/// from the signal frame of the interrupted thread.
+const unsigned char CTXSAVE_SIZE=36+128+1;
+
+/// \internal some architectures save part of the context on their stack.
+/// This constant is used to increase the stack size by the size of context
+/// save frame. If zero, this architecture does not save anything on stack
+/// during context save. Size is in bytes, not words.
+/// MUST be divisible by 4.
+/// The simulator delivers its signals on a dedicated signal stack, so nothing
+/// is saved on the thread stack, but threads call into the host C library,
+/// whose functions such as printf need far more stack than the Miosix ones.
+/// This space is added to the stack of every thread to account for it.
+const unsigned int CTXSAVE_ON_STACK=32*1024;
+
+/// \internal stack alignment for this specific architecture
+/// The x86_64 System V ABI requires 16 byte alignment.
+const unsigned int CTXSAVE_STACK_ALIGNMENT=16;
+
+/**
+ * \}
+ */
+
+} //namespace miosix
@@ -0,0 +1,183 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/*
+ * The simulator has no GPIOs, but code using them can still be compiled and
+ * run, as this implementation keeps the state of simulated pins in memory.
+ * A value written to an output pin can be read back, and input pins read as
+ * the last written value.
+ */
+
+//Simulated GPIO ports, each with 32 pins
+const unsigned int GPIOA_BASE=0;
+const unsigned int GPIOB_BASE=1;
+const unsigned int GPIOC_BASE=2;
+const unsigned int GPIOD_BASE=3;
+
+namespace miosix {
+
+class Mode
+{
+public:
+    /**
+     * GPIO mode (INPUT, OUTPUT, ...)
+     * \code pin::mode(Mode::INPUT);\endcode
+     */
+    enum Mode_
+    {
+        INPUT,
+        INPUT_PULL_UP,
+        INPUT_PULL_DOWN,
+        OUTPUT,
+        OPEN_DRAIN,
+        DISABLED
+    };
+private:
+    Mode(); //Just a wrapper class, disallow creating instances
+};
+
+/**
+ * \internal
+ * \param port simulated port
+ * \return the state of the simulated port
+ */
+inline volatile unsigned int& simulatedGpioPort(unsigned int port)
+{
+    static volatile unsigned int ports[4]={0};
+    return ports[port & 3];
+}
+
+/**
+ * This class allows to easiliy pass a Gpio as a parameter to a function.
+ * Accessing a GPIO through this class is slower than with just the Gpio,
+ * but is a convenient alternative in some cases. Also, an instance of this
+ * class occupies a few bytes of memory, unlike the Gpio class.
+ * 
+ * To instantiate classes of this type, use Gpio<P,N>::getPin()
+ * \code
+ * typedef Gpio<PORTA_BASE,0> led;
+ * GpioPin ledPin=led::getPin();
+ * \endcode
+ */
+class GpioPin
+{
+public:
+    /**
+     * \internal
+     * Constructor. Don't instantiate classes through this constructor,
+     * rather caller Gpio<P,N>::getPin().
+     * \param port port
+     * \param n which pin (0 to 31)
+     */
+    GpioPin(unsigned int port, unsigned char n): P(port), N(n) {}
+
+    /**
+     * Set the GPIO to the desired mode (INPUT, OUTPUT, ...)
+     * \param m enum Mode_
+     */
+    void mode(Mode::Mode_ m) {}
+
+    /**
+     * Set the pin to 1, if it is an output
+     */
+    void high() { simulatedGpioPort(P)|=1u<<N; }
+
+    /**
+     * Set the pin to 0, if it is an output
+     */
+    void low() { simulatedGpioPort(P)&=~(1u<<N); }
+
+    /**
+     * Allows to read the pin status
+     * \return 0 or 1
+     */
+    int value() { return (simulatedGpioPort(P)>>N) & 1; }
+
+    /**
+     * \return the pin port
+     */
+    unsigned int getPort() const { return P; }
+
+    /**
+     * \return the pin number, from 0 to 31
+     */
+    unsigned char getNumber() const { return N; }
+
+private:
+    unsigned int P;
+    unsigned char N;
+};
+
+/**
+ * Gpio template class
+ * \param P port, GPIOA_BASE, GPIOB_BASE, ...
+ * \param N which pin (0 to 31)
+ * The intended use is to make a typedef to this class with a meaningful name.
+ * \code
+ * typedef Gpio<GPIOA_BASE,0> green_led;
+ * green_led::mode(Mode::OUTPUT);
+ * green_led::high();//Turn on LED
+ * \endcode
+ */
+template<unsigned int P, unsigned char N>
+class Gpio
+{
+public:
+    /**
+     * Set the GPIO to the desired mode (INPUT, OUTPUT, ...)
+     * \param m enum Mode_
+     */
+    static void mode(Mode::Mode_ m) {}
+
+    /**
+     * Set the pin to 1, if it is an output
+     */
+    static void high() { simulatedGpioPort(P)|=1u<<N; }
+
+    /**
+     * Set the pin to 0, if it is an output
+     */
+    static void low() { simulatedGpioPort(P)&=~(1u<<N); }
+
+    /**
+     * Allows to read the pin status
+     * \return 0 or 1
+     */
+    static int value() { return (simulatedGpioPort(P)>>N) & 1; }
+
+    /**
+     * \return this Gpio converted as a GpioPin class
+     */
+    static GpioPin getPin() { return GpioPin(P,N); }
+
+private:
+    Gpio(); //Only static member functions, disallow creating instances
+};
+
+} //namespace miosix
@@ -0,0 +1,171 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * \internal
+ * \file host_syscall.h
+ * Functions of the host C library such as read() and write() are replaced by
+ * the Miosix ones, which operate on the Miosix file descriptor table, so the
+ * services the simulator needs from the Linux kernel are requested through raw
+ * x86_64 system calls. This also guarantees that they can be used from
+ * emulated interrupts, as they never modify errno, and that the program counter
+ * stays in the simulator executable, which is required to perform a context
+ * switch (see interrupts_linux_host.cpp).
+ */
+
+namespace miosix {
+namespace host {
+
+inline long syscall1(long nr, long a)
+{
+    long result;
+    asm volatile("syscall":"=a"(result):"a"(nr),"D"(a):"rcx","r11","memory");
+    return result;
+}
+
+inline long syscall2(long nr, long a, long b)
+{
+    long result;
+    asm volatile("syscall":"=a"(result):"a"(nr),"D"(a),"S"(b)
+                 :"rcx","r11","memory");
+    return result;
+}
+
+inline long syscall3(long nr, long a, long b, long c)
+{
+    long result;
+    asm volatile("syscall":"=a"(result):"a"(nr),"D"(a),"S"(b),"d"(c)
+                 :"rcx","r11","memory");
+    return result;
+}
+
+inline long syscall4(long nr, long a, long b, long c, long d)
+{
+    long result;
+    register long r10 asm("r10")=d;
+    asm volatile("syscall":"=a"(result):"a"(nr),"D"(a),"S"(b),"d"(c),"r"(r10)
+                 :"rcx","r11","memory");
+    return result;
+}
+
+//
+// Wrappers for the system calls used by the simulator. As the Linux kernel
+// ABI does, they return a negative errno code on failure
+//
+
+inline long hostRead(int fd, void *buf, size_t size)
+{
+    return syscall3(SYS_read,fd,reinterpret_cast<long>(buf),size);
+}
+
+inline long hostWrite(int fd, const void *buf, size_t size)
+{
+    return syscall3(SYS_write,fd,reinterpret_cast<long>(buf),size);
+}
+
+inline long hostPread(int fd, void *buf, size_t size, long long offset)
+{
+    return syscall4(SYS_pread64,fd,reinterpret_cast<long>(buf),size,offset);
+}
+
+inline long hostPwrite(int fd, const void *buf, size_t size, long long offset)
+{
+    return syscall4(SYS_pwrite64,fd,reinterpret_cast<long>(buf),size,offset);
+}
+
+inline long long hostLseek(int fd, long long offset, int whence)
+{
+    return syscall3(SYS_lseek,fd,offset,whence);
+}
+
+inline int hostOpen(const char *path, int flags, int mode)
+{
+    return syscall3(SYS_open,reinterpret_cast<long>(path),flags,mode);
+}
+
+inline int hostClose(int fd)
+{
+    return syscall1(SYS_close,fd);
+}
+
+inline int hostFsync(int fd)
+{
+    return syscall1(SYS_fsync,fd);
+}
+
+inline int hostFcntl(int fd, int cmd, long arg)
+{
+    return syscall3(SYS_fcntl,fd,cmd,arg);
+}
+
+inline int hostIoctl(int fd, unsigned long cmd, void *arg)
+{
+    return syscall3(SYS_ioctl,fd,cmd,reinterpret_cast<long>(arg));
+}
+
+inline int hostGetpid()
+{
+    long result;
+    asm volatile("syscall":"=a"(result):"a"(SYS_getpid):"rcx","r11","memory");
+    return result;
+}
+
+inline int hostKill(int pid, int sig)
+{
+    return syscall2(SYS_kill,pid,sig);
+}
+
+inline void hostPause()
+{
+    long result;
+    asm volatile("syscall":"=a"(result):"a"(SYS_pause):"rcx","r11","memory");
+}
+
+inline void __attribute__((noreturn)) hostExit(int code)
+{
+    syscall1(SYS_exit_group,code);
+    __builtin_unreachable();
+}
+
+/**
+ * \return the host CLOCK_MONOTONIC in nanoseconds
+ */
+inline long long hostMonotonicTime()
+{
+    timespec ts;
+    syscall2(SYS_clock_gettime,CLOCK_MONOTONIC,reinterpret_cast<long>(&ts));
+    return static_cast<long long>(ts.tv_sec)*1000000000LL+ts.tv_nsec;
+}
+
+} //namespace host
+} //namespace miosix
@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstring>
+#include "interfaces/portability.h"
+#include "kernel/kernel.h"
+#include "kernel/error.h"
+#include "interfaces/bsp.h"
+#include "kernel/scheduler/scheduler.h"
+#include "core/interrupts.h"
+#include "drivers/linux_host_console.h"
+
+using namespace miosix::host;
+
+namespace miosix_private {
+
+volatile bool interruptsDisabled=true; //Interrupts are disabled at boot
+volatile unsigned int pendingSignals=0;
+int hostPid;
+
+void raisePendingSignals()
+{
+    //The handler of any signal runs all the pending ones
+    hostKill(hostPid,miosix::dispatchSignal);
+}
+
+/**
+ * \internal
+ * Called by the SIGUSR1 handler, yield to next thread
+ */
+void ISR_yield()
+{
+    miosix::Thread::IRQstackOverflowCheck();
+    miosix::Scheduler::IRQfindNextThread();
+}
+
+void IRQsystemReboot()
+{
+    //The host can't be rebooted, so the simulator just exits
+    miosix::LinuxHostConsole::IRQrestoreHostTerminal();
+    hostExit(1);
+}
+
+void initCtxsave(unsigned int *ctxsave, void *(*pc)(void *), unsigned int *sp,
+        void *argv)
+{
+    //Stack is full descending. Make threadLauncher believe it was called, so
+    //rsp+8 must be aligned to 16 bytes, and the return address is zero
+    uintptr_t stackPtr=reinterpret_cast<uintptr_t>(sp);
+    stackPtr&=~static_cast<uintptr_t>(miosix::CTXSAVE_STACK_ALIGNMENT-1);
+    stackPtr-=sizeof(void*);
+    *reinterpret_cast<void**>(stackPtr)=nullptr;
+
+    greg_t gregs[savedGregs];
+    memset(gregs,0,sizeof(gregs));
+    gregs[REG_RDI-REG_R8]=reinterpret_cast<greg_t>(pc);           //--> arg 1
+    gregs[REG_RSI-REG_R8]=reinterpret_cast<greg_t>(argv);         //--> arg 2
+    gregs[REG_RSP-REG_R8]=stackPtr;
+    gregs[REG_RIP-REG_R8]=reinterpret_cast<greg_t>(
+            &miosix::Thread::threadLauncher);
+    gregs[REG_EFL-REG_R8]=0x202;
+    memcpy(ctxsave,gregs,sizeof(gregs));
+    //Default FPU state in fxsave format, as after the finit instruction
+    unsigned int *fxsave=ctxsave+fxsaveOffsetInCtxsave;
+    for(int i=0;i<fxsaveSize/4;i++) fxsave[i]=0;
+    fxsave[0]=0x037f;                                             //--> fcw
+    fxsave[6]=0x1f80;                                             //--> mxcsr
+    ctxsave[errnoOffsetInCtxsave]=0;
+}
+
+void IRQportableStartKernel()
+{
+    miosix::IRQregisterSignalHandler(SIGUSR1,ISR_yield);
+
+    //create a temporary space to save current registers. This data is useless
+    //since there's no way to stop the sheduler, but we need to save it anyway.
+    unsigned int s_ctxsave[miosix::CTXSAVE_SIZE];
+    ctxsave=s_ctxsave;//make global ctxsave point to it
+    //Note, we can't use enableInterrupts() now since the call is not mathced
+    //by a call to disableInterrupts()
+    doEnableInterrupts();
+    miosix::Thread::yield();
+    //Never reaches here
+}
+
+void sleepCpu()
+{
+    //Like the wfi instruction, returns after the next interrupt
+    hostPause();
+}
+
+} //namespace miosix_private
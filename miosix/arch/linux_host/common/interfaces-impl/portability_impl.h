@@ -0,0 +1,208 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+//Miosix kernel
+
+#ifndef PORTABILITY_IMPL_H
+#define PORTABILITY_IMPL_H
+
+#include "config/miosix_settings.h"
+#include "interfaces-impl/host_syscall.h"
+#include <ucontext.h>
+#include <signal.h>
+#include <errno.h>
+#include <cstring>
+
+/**
+ * \addtogroup Drivers
+ * \{
+ */
+
+/*
+ * This pointer is used by the kernel, and should not be used by end users.
+ * this is a pointer to a location where to store the thread's registers during
+ * context switch. It requires C linkage to be used inside asm statement.
+ * Registers are saved in the following order:
+ * *ctxsave+656 --> errno
+ * *ctxsave+144 .. *ctxsave+655 --> fxsave area
+ * *ctxsave+136 --> rflags
+ * *ctxsave+128 --> rip
+ * *ctxsave+120 --> rsp
+ * *ctxsave+112 --> rcx
+ * *ctxsave+104 --> rax
+ * *ctxsave+96  --> rdx
+ * *ctxsave+88  --> rbx
+ * *ctxsave+80  --> rbp
+ * *ctxsave+72  --> rsi
+ * *ctxsave+64  --> rdi
+ * *ctxsave+0 .. *ctxsave+63 --> r8-r15
+ * The stack pointer spans two words, the kernel reads it with a memcpy.
+ */
+extern "C" {
+extern volatile unsigned int *ctxsave;
+}
+const int stackPtrOffsetInCtxsave=30; ///< Allows to locate the stack pointer
+
+namespace miosix {
+namespace host {
+
+/// Number of registers saved, from REG_R8 to REG_EFL
+const int savedGregs=REG_EFL+1;
+/// Offset in ctxsave of the fxsave area
+const int fxsaveOffsetInCtxsave=savedGregs*sizeof(greg_t)/sizeof(unsigned int);
+/// Size of the fxsave area
+const int fxsaveSize=512;
+/// Offset in the fxsave area of the software reserved bytes, which start with
+/// FP_XSTATE_MAGIC1 if the host kernel saved the FPU state in xsave format
+const int fxsaveSwReservedOffset=464;
+/// Offset in ctxsave of errno
+const int errnoOffsetInCtxsave=fxsaveOffsetInCtxsave+fxsaveSize/4;
+
+} //namespace host
+} //namespace miosix
+
+/**
+ * \internal
+ * Save context from a signal handler.
+ * In the simulator interrupts are Linux signals, and the registers of the
+ * interrupted thread are found in the signal frame, so saving the context
+ * means copying them from there to ctxsave. errno is thread local in the host
+ * C library, but all Miosix threads run in the same host thread, so it is
+ * saved as well. Only signal handlers installed with
+ * IRQregisterSignalHandler() can perform a context switch.
+ * \param uc the ucontext_t passed by the kernel to the signal handler
+ */
+inline void saveContext(ucontext_t *uc)
+{
+    using namespace miosix::host;
+    unsigned int *ctx=const_cast<unsigned int*>(ctxsave);
+    std::memcpy(ctx,&uc->uc_mcontext.gregs[REG_R8],savedGregs*sizeof(greg_t));
+    if(uc->uc_mcontext.fpregs)
+        std::memcpy(ctx+fxsaveOffsetInCtxsave,uc->uc_mcontext.fpregs,
+                    fxsaveSize);
+    ctx[errnoOffsetInCtxsave]=errno;
+    asm volatile("":::"memory");
+}
+
+/**
+ * \internal
+ * Restore context in a signal handler where saveContext() is used. Overwrites
+ * the signal frame with the registers of the thread pointed to by ctxsave, so
+ * that returning from the signal handler resumes that thread.
+ * \param uc the ucontext_t passed by the kernel to the signal handler
+ */
+inline void restoreContext(ucontext_t *uc)
+{
+    using namespace miosix::host;
+    asm volatile("":::"memory");
+    const unsigned int *ctx=const_cast<const unsigned int*>(ctxsave);
+    std::memcpy(&uc->uc_mcontext.gregs[REG_R8],ctx,savedGregs*sizeof(greg_t));
+    unsigned char *fp=reinterpret_cast<unsigned char*>(uc->uc_mcontext.fpregs);
+    if(fp)
+    {
+        std::memcpy(fp,ctx+fxsaveOffsetInCtxsave,fxsaveSize);
+        //If the frame is in xsave format, the host kernel restores from the
+        //fxsave area only the components marked as in use in the header, so
+        //mark the x87 and SSE state as in use, as they may have been in their
+        //initial state for the interrupted thread but not for this one
+        unsigned int magic;
+        std::memcpy(&magic,fp+fxsaveSwReservedOffset,sizeof(magic));
+        if(magic==FP_XSTATE_MAGIC1)
+        {
+            unsigned long long xstateBv;
+            std::memcpy(&xstateBv,fp+fxsaveSize,sizeof(xstateBv));
+            xstateBv|=0b11;
+            std::memcpy(fp+fxsaveSize,&xstateBv,sizeof(xstateBv));
+        }
+    }
+    errno=ctx[errnoOffsetInCtxsave];
+}
+
+/**
+ * \}
+ */
+
+namespace miosix_private {
+    
+/**
+ * \addtogroup Drivers
+ * \{
+ */
+
+/**
+ * \internal
+ * Emulated interrupt mask. Blocking signals with sigprocmask would cost two
+ * system calls per critical section, so interrupts are disabled by setting
+ * this flag, and signals arriving while it is set are recorded in
+ * pendingSignals and handled when interrupts are enabled.
+ */
+extern volatile bool interruptsDisabled;
+
+/// \internal Bitmask of signals whose handler has not yet run
+extern volatile unsigned int pendingSignals;
+
+/// \internal Pid of the simulator process, used to raise signals
+extern int hostPid;
+
+/**
+ * \internal
+ * Run the handlers of signals that arrived while interrupts were disabled
+ */
+void raisePendingSignals();
+
+inline void doYield()
+{
+    miosix::host::hostKill(hostPid,SIGUSR1);
+}
+
+inline void doDisableInterrupts()
+{
+    interruptsDisabled=true;
+    //The new fastDisableInterrupts/fastEnableInterrupts are inline, so there's
+    //the need for a memory barrier to avoid aggressive reordering
+    asm volatile("":::"memory");
+}
+
+inline void doEnableInterrupts()
+{
+    asm volatile("":::"memory");
+    interruptsDisabled=false;
+    asm volatile("":::"memory");
+    if(pendingSignals) raisePendingSignals();
+}
+
+inline bool checkAreInterruptsEnabled()
+{
+    return interruptsDisabled==false;
+}
+
+/**
+ * \}
+ */
+
+} //namespace miosix_private
+
+#endif //PORTABILITY_IMPL_H
@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/*
+ * Miosix is written against its patched newlib, while the Linux host simulator
+ * is linked with the host C library. This header is included in every file
+ * compiled for the simulator through the -include compiler option, and maps
+ * the few newlib extensions used by the kernel and by applications to their
+ * standard equivalents.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+// Integer-only variants of printf and scanf. There is no code size to save on
+// the host, so they are aliases of the full versions. They are declared with
+// an assembler name rather than with macros not to clash with class members
+// with the same name.
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+int iprintf(const char *format, ...) __asm__("printf");
+int fiprintf(FILE *stream, const char *format, ...) __asm__("fprintf");
+int siprintf(char *str, const char *format, ...) __asm__("sprintf");
+int sniprintf(char *str, size_t size, const char *format, ...)
+    __asm__("snprintf");
+int viprintf(const char *format, va_list ap) __asm__("vprintf");
+int vfiprintf(FILE *stream, const char *format, va_list ap)
+    __asm__("vfprintf");
+int vsiprintf(char *str, const char *format, va_list ap) __asm__("vsprintf");
+int vsniprintf(char *str, size_t size, const char *format, va_list ap)
+    __asm__("vsnprintf");
+int iscanf(const char *format, ...) __asm__("scanf");
+int fiscanf(FILE *stream, const char *format, ...) __asm__("fscanf");
+int siscanf(const char *str, const char *format, ...) __asm__("sscanf");
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+// Newlib headers declare the reentrancy structure, that in the simulator is
+// defined by the reent.h header of this architecture
+struct _reent;
+
+// File open flags as seen by filesystems, which increment O_RDONLY, O_WRONLY
+// and O_RDWR to turn them into the _FREAD and _FWRITE bits
+#define _FREAD      1
+#define _FWRITE     2
+#define _FAPPEND    O_APPEND
+#define _FCREAT     O_CREAT
+#define _FTRUNC     O_TRUNC
+#define _FEXCL      O_EXCL
+#define _FDIRECTORY O_DIRECTORY
+
+// Directories are opened for reading to search them, as the host O_PATH is
+// not understood by the Miosix filesystems
+#ifndef O_SEARCH
+#define O_SEARCH O_RDONLY
+#endif //O_SEARCH
+
+// Static initializer for recursive mutexes, named differently by the host
+#define PTHREAD_MUTEX_RECURSIVE_INITIALIZER_NP \
+    PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+
+// The C runtime of the Linux host already has an _init function, so the one
+// of the stage 2 boot is renamed
+#define _init miosix_init
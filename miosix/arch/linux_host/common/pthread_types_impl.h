@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/*
+ * The Linux host simulator is linked with the host C library, whose pthread
+ * types have a different layout than those of the Miosix C library. This
+ * header is included by kernel/pthread_private.h, and defines the fields used
+ * by Miosix, that are stored in the storage of the host pthread types.
+ */
+
+#include <pthread.h>
+#include <cstddef>
+
+namespace miosix {
+
+/**
+ * Element of the list of threads waiting on a mutex
+ */
+struct WaitingList
+{
+    void *thread;
+    WaitingList *next;
+};
+
+/**
+ * Recursion depth of a mutex, stored offset by one in the place of the kind
+ * field of the host pthread_mutex_t, so that the host static initializers
+ * result in an unlocked non recursive mutex (PTHREAD_MUTEX_INITIALIZER) or in
+ * an unlocked recursive mutex (PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
+ */
+class MutexDepth
+{
+public:
+    operator int() const { return value-1; }
+    MutexDepth& operator=(int depth) { value=depth+1; return *this; }
+    int operator++(int) { return value++ - 1; }
+    int operator--(int) { return value-- - 1; }
+private:
+    int value;
+};
+
+struct PthreadMutex
+{
+    void *owner;
+    WaitingList *first;
+    MutexDepth recursive;
+    WaitingList *last;
+};
+
+struct PthreadMutexattr
+{
+    short recursive;
+    short type;
+};
+
+struct PthreadAttr
+{
+    int detachstate;
+    size_t stacksize;
+    sched_param schedparam;
+};
+
+struct PthreadOnce
+{
+    int init_executed;
+    /// The host pthread_once_t has no field to check that it was initialized
+    static constexpr int is_initialized=1;
+};
+
+static_assert(sizeof(PthreadMutex)<=sizeof(pthread_mutex_t),
+    "Invalid pthread_mutex_t size");
+static_assert(offsetof(PthreadMutex,recursive)
+    ==offsetof(pthread_mutex_t,__data.__kind),"Invalid pthread_mutex_t layout");
+static_assert(sizeof(PthreadMutexattr)<=sizeof(pthread_mutexattr_t),
+    "Invalid pthread_mutexattr_t size");
+static_assert(sizeof(PthreadAttr)<=sizeof(pthread_attr_t),
+    "Invalid pthread_attr_t size");
+static_assert(sizeof(PthreadOnce)<=sizeof(pthread_once_t),
+    "Invalid pthread_once_t size");
+
+} //namespace miosix
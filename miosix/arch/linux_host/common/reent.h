@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/*
+ * The C library of the Linux host has no reentrancy structure, and errno is
+ * made per-thread by saving it together with the registers on context
+ * switches. This header is found in place of the newlib one, and provides a
+ * stand-in reentrancy structure so that the kernel and the system calls shared
+ * with newlib, that report errors through ptr->_errno, work unchanged.
+ */
+
+#include <errno.h>
+
+struct _reent
+{
+    struct HostErrno
+    {
+        HostErrno& operator= (int e) { errno=e; return *this; }
+        operator int() const { return errno; }
+    } _errno;
+};
+
+/// Reentrancy structure used before the kernel is started
+extern "C" struct _reent *const _global_impure_ptr;
+#define _GLOBAL_REENT _global_impure_ptr
+
+/// There is nothing to initialize or reclaim in the stand-in structure
+#define _REENT_INIT_PTR(ptr) ((void)(ptr))
+inline void _reclaim_reent(struct _reent *ptr) {}
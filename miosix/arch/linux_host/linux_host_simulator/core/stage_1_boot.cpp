@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Boot code for the Linux host simulator.
+ * The simulator is a regular Linux executable, so the host C library has
+ * already done what the stage 1 boot does on a microcontroller: .data is
+ * loaded, .bss is zeroed, there is a valid stack and global constructors have
+ * been called. The program is linked with --wrap=main, so that the host C
+ * library calls __wrap_main(), which starts the kernel. When the kernel then
+ * calls the application main(), this also goes through __wrap_main(), which
+ * forwards the call to the real main() the second time. The initial stack is
+ * used until the kernel starts, and then abandoned, just like the Cortex-M
+ * main stack is only used for interrupts.
+ */
+
+#include <sys/single_threaded.h>
+#include "interfaces/bsp.h"
+#include "interfaces/portability.h"
+#include "core/interrupts.h"
+#include "kernel/stage_2_boot.h"
+
+///<\internal Entry point for application code
+extern "C" int __real_main(int argc, char *argv[]);
+
+/**
+ * Called by the host C library in place of main(), starts the kernel.
+ * Never returns. Called again by the kernel to run the application main().
+ */
+extern "C" int __wrap_main(int argc, char *argv[])
+{
+    static bool kernelStarted=false;
+    if(kernelStarted) return __real_main(argc,argv);
+    kernelStarted=true;
+
+    miosix_private::hostPid=miosix::host::hostGetpid();
+    miosix::IRQsetHostCommandLine(argc,argv);
+    //Miosix threads run in the same host thread, but they can preempt each
+    //other, so the host C++ library must not skip atomic operations
+    __libc_single_threaded=0;
+
+    //Move on to stage 2
+    _init();
+
+    //Never reach here
+    miosix::host::hostExit(1);
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/***********************************************************************
+* bsp.cpp Part of the Miosix Embedded OS.
+* Board support package, this file initializes hardware.
+************************************************************************/
+
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "interfaces/bsp.h"
+#include "kernel/kernel.h"
+#include "kernel/sync.h"
+#include "interfaces/portability.h"
+#include "interfaces/arch_registers.h"
+#include "config/miosix_settings.h"
+#include "kernel/logging.h"
+#include "filesystem/file_access.h"
+#include "filesystem/console/console_device.h"
+#include "drivers/linux_host_console.h"
+#include "drivers/linux_host_block.h"
+#include "core/interrupts.h"
+#include "board_settings.h"
+
+using namespace miosix::host;
+
+namespace miosix {
+
+static const char *diskImage=LINUX_HOST_DISK_IMAGE;
+
+void IRQsetHostCommandLine(int argc, char *argv[])
+{
+    if(argc>1) diskImage=argv[1];
+}
+
+/**
+ * \internal
+ * SIGINT and SIGTERM handler, so that the simulator can be stopped with
+ * Ctrl-C without leaving the host terminal in raw mode
+ */
+static void IRQhandleTermination()
+{
+    LinuxHostConsole::IRQrestoreHostTerminal();
+    hostExit(0);
+}
+
+//
+// Initialization
+//
+
+void IRQbspInit()
+{
+    DefaultConsole::instance().IRQset(intrusive_ref_ptr<Device>(
+        new LinuxHostConsole));
+    IRQregisterSignalHandler(SIGINT,IRQhandleTermination);
+    IRQregisterSignalHandler(SIGTERM,IRQhandleTermination);
+}
+
+void bspInit2()
+{
+    #ifdef WITH_FILESYSTEM
+    intrusive_ref_ptr<LinuxHostBlockDevice> disk(
+        new LinuxHostBlockDevice(diskImage));
+    if(disk->isOpen()) basicFilesystemSetup(disk);
+    else basicFilesystemSetup(intrusive_ref_ptr<Device>());
+    #endif //WITH_FILESYSTEM
+}
+
+//
+// Shutdown and reboot
+//
+
+void shutdown()
+{
+    ioctl(STDOUT_FILENO,IOCTL_SYNC,0);
+
+    #ifdef WITH_FILESYSTEM
+    FilesystemManager::instance().umountAll();
+    #endif //WITH_FILESYSTEM
+
+    disableInterrupts();
+    LinuxHostConsole::IRQrestoreHostTerminal();
+    hostExit(0);
+}
+
+void reboot()
+{
+    ioctl(STDOUT_FILENO,IOCTL_SYNC,0);
+    
+    #ifdef WITH_FILESYSTEM
+    FilesystemManager::instance().umountAll();
+    #endif //WITH_FILESYSTEM
+
+    disableInterrupts();
+    miosix_private::IRQsystemReboot();
+}
+
+} //namespace miosix
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+/**
+ * \internal
+ * Versioning for board_settings.h for out of git tree projects
+ */
+#define BOARD_SETTINGS_VERSION 300
+
+namespace miosix {
+
+/**
+ * \addtogroup Settings
+ * \{
+ */
+
+/// Size of stack for main().
+/// x86 code is more stack-hungry than Thumb2 code, and the host has plenty
+/// of memory, so main() gets a large stack.
+const unsigned int MAIN_STACK_SIZE=64*1024;
+
+/// Disk image used as block device for the filesystem, unless a different
+/// path is passed as first command line argument to the simulator.
+/// If the file does not exist, the simulator boots without a filesystem on
+/// a block device. Create the image with i.e.
+/// dd if=/dev/zero of=miosix_disk.img bs=1M count=64 && mkfs.vfat -F 32 miosix_disk.img
+#define LINUX_HOST_DISK_IMAGE "miosix_disk.img"
+
+/// The simulator enables the block cache between the disk image and the
+/// filesystem on /sd, so that the testsuite exercises it
+#define WITH_BLOCK_CACHE
+
+/**
+ * \}
+ */
+
+} //namespace miosix
@@ -122,14 +122,40 @@ constexpr unsigned int FATFS_EXTEND_BUFFER=512;
 /// By default it is not defined (RomFS is disabled)
 //#define WITH_ROMFS
 
+/// \def WITH_BLOCK_CACHE
+/// Allows to enable a write-back block cache between the filesystem mounted on
+/// /sd and its block device, to reduce the number of device accesses at the
+/// cost of BLOCK_CACHE_BLOCKS*512 bytes of RAM. Modified blocks are written to
+/// the device only when evicted or on fsync()/close(), so data that is not
+/// synced is lost on power failure. Hit/miss statistics can be read with the
+/// IOCTL_BLOCK_CACHE_STATS ioctl on /dev/sda
+/// By default it is not defined (block cache is disabled)
+//#define WITH_BLOCK_CACHE
+/// Number of 512 byte blocks in the block cache
+constexpr unsigned int BLOCK_CACHE_BLOCKS=16;
+/// Number of blocks read in advance when a read continues where the previous
+/// one ended. Reading in advance is limited to half the cache size
+constexpr unsigned int BLOCK_CACHE_READAHEAD=4;
+
 /// \def SYNC_AFTER_WRITE
 /// Increases filesystem write robustness. After each write operation the
 /// filesystem is synced so that a power failure happens data is not lost
 /// (unless power failure happens exactly between the write and the sync)
 /// Unfortunately write latency and throughput becomes twice as worse
 /// By default it is defined (slow but safe)
+/// If not defined, FAT32 filesystems default to write-back mode, see below.
+/// The policy can also be chosen for each mounted filesystem through
+/// Fat32Options
 #define SYNC_AFTER_WRITE
 
+/// In write-back mode, a background thread syncs files on FAT32 filesystems
+/// FATFS_WRITEBACK_MS milliseconds after they are first written, or as soon as
+/// FATFS_WRITEBACK_BYTES bytes are written without a sync, whichever comes
+/// first. This bounds the data lost on power failure while letting small
+/// writes share the cost of a sync. fsync() and close() sync immediately
+constexpr unsigned int FATFS_WRITEBACK_MS=1000;
+constexpr unsigned int FATFS_WRITEBACK_BYTES=16384;
+
 /// Maximum number of files a single process (or the kernel) can open. This
 /// constant is used to size file descriptor tables. Individual filesystems can
 /// introduce futher limitations. Cannot be less than 3, as the first three are
@@ -181,6 +207,31 @@ const unsigned char MAX_OPEN_FILES=8;
  */
 //#define JTAG_DISABLE_SLEEP
 
+/// \def WITH_TLSF_MALLOC
+/// Uncomment to replace the newlib malloc with a two level segregated fit
+/// (TLSF) allocator. malloc, free, realloc and memalign then take a bounded
+/// time regardless of the state of the heap, and fragmentation over long
+/// uptimes is lower, at the cost of ~800 bytes of RAM for the free lists.
+/// Processes are not affected, and keep using the newlib malloc.
+/// By default it is not defined (newlib malloc is used)
+//#define WITH_TLSF_MALLOC
+
+/// \def WITH_HEAP_COUNTER
+/// Uncomment to enable HeapCounter, which keeps track of the heap memory
+/// allocated by each thread (live bytes, peak bytes, allocation count) to help
+/// finding memory leaks. Adds a pointer-sized overhead to every allocation.
+/// Requires WITH_TLSF_MALLOC.
+/// By default it is not defined (HeapCounter is disabled)
+//#define WITH_HEAP_COUNTER
+
+#if defined(WITH_HEAP_COUNTER) && !defined(WITH_TLSF_MALLOC)
+#error HeapCounter requires the TLSF allocator
+#endif //defined(WITH_HEAP_COUNTER) && !defined(WITH_TLSF_MALLOC)
+
+#if defined(WITH_TLSF_MALLOC) && defined(_ARCH_LINUX_HOST)
+#error The Linux host simulator uses the heap of the host C library
+#endif //defined(WITH_TLSF_MALLOC) && defined(_ARCH_LINUX_HOST)
+
 #if defined(WITH_DEEP_SLEEP) && defined(JTAG_DISABLE_SLEEP)
 #error Deep sleep cannot work together with jtag
 #endif //defined(WITH_PROCESSES) && !defined(WITH_DEVFS)
@@ -211,6 +262,10 @@ const unsigned int MIN_PROCESS_STACK_SIZE=1024;
 /// thread is running in kernelspace (MUST be divisible by 4)
 const unsigned int SYSTEM_MODE_PROCESS_STACK_SIZE=2048;
 
+/// Maximum number of threads of a process, including the main thread and
+/// terminated threads that have not yet been joined
+const unsigned int MAX_PROCESS_THREADS=8;
+
 /// Maximum number of arguments passed through argv to a process
 /// Also maximum number of environment variables passed through envp to a process
 const unsigned int MAX_PROCESS_ARGS=16;
@@ -230,7 +285,7 @@ static_assert(SYSTEM_MODE_PROCESS_STACK_SIZE>=STACK_MIN,"");
 /// the priority of the idle thread.
 /// The meaning of a thread's priority depends on the chosen scheduler.
 #ifdef SCHED_TYPE_PRIORITY
-//Can be modified, but a high value makes context switches more expensive
+//Can be modified up to 32, a high value only costs a few bytes of RAM per priority
 const short int PRIORITY_MAX=4;
 #elif defined(SCHED_TYPE_CONTROL_BASED)
 //Don't touch, the limit is due to the fixed point implementation
@@ -266,12 +321,15 @@ const unsigned int WATERMARK_FILL=0xaaaaaaaa;
 const unsigned int STACK_FILL=0xbbbbbbbb;
 
 // Compiler version checks
+// The Linux host simulator is built with the host compiler, not the Miosix one
+#ifndef _ARCH_LINUX_HOST
 #if !defined(_MIOSIX_GCC_PATCH_MAJOR) || _MIOSIX_GCC_PATCH_MAJOR < 3
 #error "You are using a too old or unsupported compiler. Get the latest one from https://miosix.org/wiki/index.php?title=Miosix_Toolchain"
 #endif
 #if _MIOSIX_GCC_PATCH_MAJOR > 3
 #warning "You are using a too new compiler, which may not be supported"
 #endif
+#endif //_ARCH_LINUX_HOST
 
 /**
  * \}
@@ -105,7 +105,8 @@ protected:
  * store the function objects. If the line starting with 'typedef char check1'
  * starts failing it means it is time to increase this number. The size
  * of an instance of this object is N+sizeof(void (*)()), but with N rounded
- * by excess to four byte boundaries.
+ * by excess to four byte boundaries. N is meant for 32 bit targets, on 64 bit
+ * ones pointers are twice as large and so is the storage.
  */
 template<unsigned N>
 class Callback : private CallbackBase
@@ -201,7 +202,7 @@ private:
     /// of callbacks. Therefore any is declared as an array of ints but aligned
     /// to 8 bytes. This allows i.e. declaring Callback<20> with 20 bytes of
     /// useful storage and 4 bytes of pointer, despite 20 is not a multiple of 8
-    int32_t any[(N+3)/4] __attribute__((aligned(8)));
+    int32_t any[(N*(sizeof(void*)/4)+3)/4] __attribute__((aligned(8)));
     void (*operation)(int32_t *a, const int32_t *b, Op op);
 };
 
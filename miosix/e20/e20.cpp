@@ -42,15 +42,56 @@ void EventQueue::post(function<void ()> event)
     cv.signal();
 }
 
+unsigned int EventQueue::postTimed(function<void ()>&& event, long long when,
+        long long period)
+{
+    //Allocate the list node before locking the mutex
+    list<TimedEvent> node;
+    node.emplace_back(std::move(event),when,period,0);
+    Lock<FastMutex> l(m);
+    if(++lastId==0) lastId=1; //0 is never a valid handle
+    node.front().id=lastId;
+    if(insertTimed(node,node.begin())) cv.signal();
+    return lastId;
+}
+
+bool EventQueue::cancel(unsigned int id)
+{
+    list<TimedEvent> removed; //Destroy the event after unlocking the mutex
+    if(id==0) return false;
+    Lock<FastMutex> l(m);
+    for(auto it=timedEvents.begin();it!=timedEvents.end();++it)
+    {
+        if(it->id!=id) continue;
+        removed.splice(removed.begin(),timedEvents,it);
+        return true;
+    }
+    //A running periodic event is removed when it completes
+    for(auto& e : runningEvents)
+    {
+        if(e.id!=id) continue;
+        e.id=0;
+        return true;
+    }
+    return false;
+}
+
 void EventQueue::run()
 {
     Lock<FastMutex> l(m);
     for(;;)
     {
-        while(events.empty()) cv.wait(l);
-        function<void ()> f=events.front();
-        events.pop_front();
+        function<void ()> f;
+        list<TimedEvent>::iterator periodic;
+        while(dequeue(f,periodic)==false)
+        {
+            if(timedEvents.empty()) cv.wait(l);
+            else cv.timedWait(l,timedEvents.front().when);
+        }
+        if(periodic!=runningEvents.end())
         {
+            runPeriodic(l,periodic);
+        } else {
             Unlock<FastMutex> u(l);
             f();
         }
@@ -62,11 +103,79 @@ void EventQueue::runOne()
     function<void ()> f;
     {
         Lock<FastMutex> l(m);
-        if(events.empty()) return;
-        f=events.front();
-        events.pop_front();
+        list<TimedEvent>::iterator periodic;
+        if(dequeue(f,periodic)==false) return;
+        if(periodic!=runningEvents.end())
+        {
+            runPeriodic(l,periodic);
+            return;
+        }
     }
     f();
 }
 
+bool EventQueue::insertTimed(list<TimedEvent>& from, list<TimedEvent>::iterator it)
+{
+    //Splicing does not allocate, so periodic events are rescheduled for free
+    auto pos=timedEvents.begin();
+    while(pos!=timedEvents.end() && pos->when<=it->when) ++pos;
+    bool first=pos==timedEvents.begin();
+    timedEvents.splice(pos,from,it);
+    return first;
+}
+
+bool EventQueue::dequeue(function<void ()>& f,
+        list<TimedEvent>::iterator& periodic)
+{
+    periodic=runningEvents.end();
+    if(timedEvents.empty()==false)
+    {
+        long long now=getTime();
+        auto it=timedEvents.begin();
+        if(it->when<=now)
+        {
+            if(it->period>0)
+            {
+                //Skip missed activations, if any, without drifting
+                it->when+=((now-it->when)/it->period+1)*it->period;
+                runningEvents.splice(runningEvents.begin(),timedEvents,it);
+                periodic=it;
+            } else {
+                f=std::move(it->event);
+                timedEvents.pop_front();
+            }
+            return true;
+        }
+    }
+    if(events.empty()) return false;
+    f=std::move(events.front());
+    events.pop_front();
+    return true;
+}
+
+void EventQueue::runPeriodic(Lock<FastMutex>& l, list<TimedEvent>::iterator it)
+{
+    /*
+     * Puts the event back in the timed event list when destroyed, after the
+     * mutex has been locked again
+     */
+    class Reschedule
+    {
+    public:
+        Reschedule(EventQueue& q, list<TimedEvent>::iterator it) : q(q), it(it) {}
+        ~Reschedule()
+        {
+            if(it->id==0) q.runningEvents.erase(it); //Cancelled while running
+            else if(q.insertTimed(q.runningEvents,it)) q.cv.signal();
+        }
+    private:
+        EventQueue& q;
+        list<TimedEvent>::iterator it;
+    };
+
+    Reschedule r(*this,it);
+    Unlock<FastMutex> u(l);
+    it->event();
+}
+
 } //namespace miosix
@@ -31,6 +31,7 @@
 
 #include <list>
 #include <functional>
+#include <utility>
 #include <miosix.h>
 #include "callback.h"
 
@@ -41,12 +42,18 @@ namespace miosix {
  * 
  * Makes use of heap allocations and as such it is not possible to post events
  * from within interrupt service routines. For this, use FixedEventQueue.
+ * For real-time producers, PooledEventQueue avoids heap allocations and
+ * has lower synchronization overhead.
  * 
  * This class acts as a synchronization point, multiple threads can post
  * events, and multiple threads can call run() or runOne() (thread pooling).
  * 
  * Events are function that are posted by a thread through post() but executed
  * in the context of the thread that calls run() or runOne()
+ *
+ * Events can also be posted to run at a given time, or periodically, through
+ * postAt(), postAfter() and postPeriodic(). Timed events are run by run() and
+ * runOne() once their time has come, in the same thread as the other events.
  */
 class EventQueue
 {
@@ -65,6 +72,64 @@ public:
      */
     void post(std::function<void ()> event);
 
+    /**
+     * Post an event to be run at a given time. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * \param absoluteTimeNs absolute time in nanoseconds, as returned by
+     * getTime(), after which the event has to run
+     * \return a nonzero handle that can be passed to cancel()
+     * \throws std::bad_alloc if there is not enough heap memory
+     */
+    unsigned int postAt(std::function<void ()> event, long long absoluteTimeNs)
+    {
+        return postTimed(std::move(event),absoluteTimeNs,0);
+    }
+
+    /**
+     * Post an event to be run after a given time. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * \param relativeTimeNs time in nanoseconds from now after which the event
+     * has to run
+     * \return a nonzero handle that can be passed to cancel()
+     * \throws std::bad_alloc if there is not enough heap memory
+     */
+    unsigned int postAfter(std::function<void ()> event, long long relativeTimeNs)
+    {
+        return postTimed(std::move(event),getTime()+relativeTimeNs,0);
+    }
+
+    /**
+     * Post an event to be run periodically, starting one period from now,
+     * until it is cancelled. If the event loop falls behind by more than one
+     * period the missed activations are skipped, but the following ones stay
+     * aligned to the original period. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * \param periodNs period in nanoseconds, must be greater than zero
+     * \return a nonzero handle that can be passed to cancel(), or 0 if the
+     * period is not valid
+     * \throws std::bad_alloc if there is not enough heap memory
+     */
+    unsigned int postPeriodic(std::function<void ()> event, long long periodNs)
+    {
+        if(periodNs<=0) return 0;
+        return postTimed(std::move(event),getTime()+periodNs,periodNs);
+    }
+
+    /**
+     * Cancel a timed or periodic event. A periodic event can also cancel
+     * itself from within the event function.
+     * \param id handle returned when posting the event
+     * \return true if the event was cancelled, false if it was not found,
+     * i.e: a non periodic event that already ran
+     */
+    bool cancel(unsigned int id);
+
     /**
      * This function blocks waiting for events being posted, and when available
      * it calls the event function. To return from this event loop an event
@@ -82,7 +147,8 @@ public:
     void runOne();
 
     /**
-     * \return the number of events in the queue
+     * \return the number of events in the queue, not counting timed events
+     * that are not yet due
      */
     unsigned int size() const
     {
@@ -103,11 +169,120 @@ public:
     EventQueue& operator= (const EventQueue&) = delete;
 
 private:
+    /**
+     * \internal Element of the timed event list
+     */
+    class TimedEvent
+    {
+    public:
+        TimedEvent(std::function<void ()>&& event, long long when,
+                long long period, unsigned int id)
+            : event(std::move(event)), when(when), period(period), id(id) {}
+
+        std::function<void ()> event; ///< Event function
+        long long when;   ///< Absolute time in ns when the event is due
+        long long period; ///< Period in ns, 0 for non periodic events
+        unsigned int id;  ///< Handle returned to the caller
+    };
+
+    /**
+     * Post a timed event
+     * \param event event to post
+     * \param when absolute time when the event is due
+     * \param period period for periodic events, 0 otherwise
+     * \return the event handle
+     */
+    unsigned int postTimed(std::function<void ()>&& event, long long when,
+            long long period);
+
+    /**
+     * Insert an element of the timed event list, which must not be part of
+     * timedEvents, in the position corresponding to its due time.
+     * Must be called with the mutex locked.
+     * \param from list containing the element
+     * \param it element to move
+     * \return true if the element is now the first of timedEvents
+     */
+    bool insertTimed(std::list<TimedEvent>& from,
+            std::list<TimedEvent>::iterator it);
+
+    /**
+     * Get the first timed event that is due, or else the first event in the
+     * queue. Must be called with the mutex locked.
+     * \param f the event is returned here, unless it is periodic
+     * \param periodic if the event is periodic, it is moved to runningEvents
+     * and not copied into f, to be run in place. This iterator is set to it,
+     * or to runningEvents.end() if the event is not periodic
+     * \return true if an event was returned
+     */
+    bool dequeue(std::function<void ()>& f,
+            std::list<TimedEvent>::iterator& periodic);
+
+    /**
+     * Run a periodic event returned by dequeue(), then put it back in the
+     * timed event list, also if it throws.
+     * \param l lock on the mutex, unlocked while the event runs
+     * \param it periodic event, in runningEvents
+     */
+    void runPeriodic(Lock<FastMutex>& l, std::list<TimedEvent>::iterator it);
+
     std::list<std::function<void ()>> events; ///< Event queue
+    std::list<TimedEvent> timedEvents; ///< Timed events, sorted by due time
+    /// Periodic events being run, their id is set to 0 if they are cancelled
+    std::list<TimedEvent> runningEvents;
+    unsigned int lastId=0;             ///< Last handle returned
     mutable FastMutex m; ///< Mutex for synchronisation
     ConditionVariable cv; ///< Condition variable for synchronisation
 };
 
+/**
+ * \internal
+ * Slot for a timed event of a FixedEventQueue
+ */
+template<unsigned SlotSize>
+class TimedEventSlot
+{
+public:
+    Callback<SlotSize> event; ///< Event to run
+    long long when=0;         ///< Absolute time in ns when the event is due
+    long long period=0;       ///< Period in ns, 0 for non periodic events
+    unsigned int id=0;        ///< Handle returned to the caller
+};
+
+/**
+ * \internal
+ * Fixed size storage for the timed events of a FixedEventQueue.
+ * The slots are accessed through an array of pointers, whose first elements
+ * are a binary min heap of the pending timed events ordered by due time, while
+ * the remaining ones point to the free slots.
+ */
+template<unsigned SlotSize, unsigned NumTimers>
+class FixedEventQueueTimers
+{
+public:
+    FixedEventQueueTimers()
+    {
+        for(unsigned int i=0;i<NumTimers;i++) heap[i]=&slots[i];
+    }
+
+    TimedEventSlot<SlotSize> **get() { return heap; }
+
+private:
+    TimedEventSlot<SlotSize> *heap[NumTimers];
+    TimedEventSlot<SlotSize> slots[NumTimers];
+};
+
+/**
+ * \internal
+ * Specialization for FixedEventQueue without timed events, uses no memory
+ */
+template<unsigned SlotSize>
+class FixedEventQueueTimers<SlotSize,0>
+{
+public:
+    TimedEventSlot<SlotSize> **get() { return nullptr; }
+};
+
 /**
  * \internal
  * This class is to extract from FixedEventQueue code that
@@ -143,6 +318,29 @@ protected:
     bool IRQpostImpl(Callback<SlotSize>& event, Callback<SlotSize> *events,
             unsigned int size, bool *hppw=nullptr);
 
+    /**
+     * Post a timed event from an interrupt, or with interrupts disabled.
+     * \param event event to post
+     * \param when absolute time in ns when the event is due
+     * \param period period in ns for periodic events, 0 otherwise
+     * \param timed pointer to timed event heap
+     * \param numTimed number of timed event slots
+     * \param hppw if not null set to true if a higher priority thread is
+     * awakened, otherwise the variable is not modified
+     * \return the event handle, or 0 if there were no free timed event slots
+     */
+    unsigned int IRQpostTimedImpl(Callback<SlotSize>& event, long long when,
+            long long period, TimedEventSlot<SlotSize> **timed,
+            unsigned int numTimed, bool *hppw=nullptr);
+
+    /**
+     * Cancel a timed event
+     * \param id event handle
+     * \param timed pointer to timed event heap
+     * \return true if the event was found
+     */
+    bool cancelImpl(unsigned int id, TimedEventSlot<SlotSize> **timed);
+
     /**
      * This function blocks waiting for events being posted, and when available
      * it calls the event function. To return from this event loop an event
@@ -150,18 +348,22 @@ protected:
      * 
      * \param events pointer to event queue
      * \param size event queue size
+     * \param timed pointer to timed event heap
      * \throws any exception that is thrown by the event functions
      */
-    void runImpl(Callback<SlotSize> *events, unsigned int size);
+    void runImpl(Callback<SlotSize> *events, unsigned int size,
+            TimedEventSlot<SlotSize> **timed);
 
     /**
      * Run at most one event. This function does not block.
      * 
      * \param events pointer to event queue
      * \param size event queue size
+     * \param timed pointer to timed event heap
      * \throws any exception that is thrown by the event functions
      */
-    void runOneImpl(Callback<SlotSize> *events, unsigned int size);
+    void runOneImpl(Callback<SlotSize> *events, unsigned int size,
+            TimedEventSlot<SlotSize> **timed);
 
     /**
      * \return the number of events in the queue
@@ -173,6 +375,47 @@ protected:
     }
 
 private:
+    /**
+     * Get the first timed event that is due, or else the first event in the
+     * queue. Can only be called with interrupts disabled.
+     * \param f the event is returned here
+     * \param events pointer to event queue
+     * \param size event queue size
+     * \param timed pointer to timed event heap
+     * \return true if an event was returned
+     */
+    bool IRQgetImpl(Callback<SlotSize>& f, Callback<SlotSize> *events,
+            unsigned int size, TimedEventSlot<SlotSize> **timed);
+
+    /**
+     * Wake the first thread waiting in run(), if any
+     * \param hppw if not null set to true if a higher priority thread is
+     * awakened, otherwise the variable is not modified
+     */
+    void IRQwakeGetter(bool *hppw);
+
+    /**
+     * Remove an element from the timed event heap
+     * \param timed pointer to timed event heap
+     * \param i index of the element to remove
+     */
+    void IRQremoveTimed(TimedEventSlot<SlotSize> **timed, unsigned int i);
+
+    /**
+     * Move an element of the timed event heap towards the root
+     * \param timed pointer to timed event heap
+     * \param i index of the element to move
+     * \return the new index of the element
+     */
+    unsigned int IRQsiftUp(TimedEventSlot<SlotSize> **timed, unsigned int i);
+
+    /**
+     * Move an element of the timed event heap towards the leaves
+     * \param timed pointer to timed event heap
+     * \param i index of the element to move
+     */
+    void IRQsiftDown(TimedEventSlot<SlotSize> **timed, unsigned int i);
+
     /**
      * \internal Element of a thread waiting list
      */
@@ -186,6 +429,8 @@ private:
     unsigned int put=0; ///< Put position into events
     unsigned int get=0; ///< Get position into events
     unsigned int n=0;   ///< Number of occupied event slots
+    unsigned int nTimed=0; ///< Number of pending timed events
+    unsigned int lastId=0; ///< Last timed event handle returned
     IntrusiveList<WaitToken> waitingGet, waitingPut; ///< Waiting on get/put
 };
 
@@ -213,42 +458,74 @@ bool FixedEventQueueBase<SlotSize>::IRQpostImpl(Callback<SlotSize>& event,
     events[put]=event; //This may allocate memory
     if(++put>=size) put=0;
     n++;
-    if(waitingGet.empty()==false)
+    IRQwakeGetter(hppw);
+    return true;
+}
+
+template<unsigned SlotSize>
+unsigned int FixedEventQueueBase<SlotSize>::IRQpostTimedImpl(
+        Callback<SlotSize>& event, long long when, long long period,
+        TimedEventSlot<SlotSize> **timed, unsigned int numTimed, bool *hppw)
+{
+    if(nTimed>=numTimed) return 0;
+    TimedEventSlot<SlotSize> *t=timed[nTimed];
+    t->event=event; //This may allocate memory
+    t->when=when;
+    t->period=period;
+    if(++lastId==0) lastId=1; //0 is never a valid handle
+    t->id=lastId;
+    //Threads in run() only need to be woken if their timeout got shorter
+    if(IRQsiftUp(timed,nTimed++)==0) IRQwakeGetter(hppw);
+    return t->id;
+}
+
+template<unsigned SlotSize>
+bool FixedEventQueueBase<SlotSize>::cancelImpl(unsigned int id,
+        TimedEventSlot<SlotSize> **timed)
+{
+    //Not FastInterruptDisableLock as the destructor of the bound
+    //parameters of the Callback may deallocate
+    InterruptDisableLock dLock;
+    for(unsigned int i=0;i<nTimed;i++)
     {
-        Thread *t=waitingGet.front()->thread;
-        waitingGet.front()->thread=nullptr;
-        waitingGet.pop_front();
-        t->IRQwakeup();
-        if(hppw && t->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
-            *hppw=true;
+        if(timed[i]->id!=id) continue;
+        IRQremoveTimed(timed,i);
+        return true;
     }
-    return true;
+    return false;
 }
 
 template<unsigned SlotSize>
 void FixedEventQueueBase<SlotSize>::runImpl(Callback<SlotSize> *events,
-        unsigned int size)
+        unsigned int size, TimedEventSlot<SlotSize> **timed)
 {
     //Not FastInterruptDisableLock as the operator= of the bound
     //parameters of the Callback may allocate
     InterruptDisableLock dLock;
     for(;;)
     {
-        while(n<=0)
+        Callback<SlotSize> f;
+        while(IRQgetImpl(f,events,size,timed)==false)
         {
             WaitToken w(Thread::IRQgetCurrentThread());
             waitingGet.push_back(&w);
-            //w.thread must be set to nullptr to protect against spurious wakeups
-            while(w.thread) Thread::IRQenableIrqAndWait(dLock);
-        }
-        Callback<SlotSize> f=events[get]; //This may allocate memory
-        if(++get>=size) get=0;
-        n--;
-        if(waitingPut.empty()==false)
-        {
-            waitingPut.front()->thread->IRQwakeup();
-            waitingPut.front()->thread=nullptr;
-            waitingPut.pop_front();
+            if(nTimed>0)
+            {
+                //Wait till the first timed event is due, posting an earlier
+                //timed event wakes us up to wait again with a shorter timeout
+                long long when=timed[0]->when;
+                while(w.thread)
+                {
+                    if(Thread::IRQenableIrqAndTimedWait(dLock,when)==TimedWaitResult::Timeout)
+                    {
+                        waitingGet.removeFast(&w);
+                        break;
+                    }
+                }
+            } else {
+                //w.thread must be set to nullptr to protect against spurious wakeups
+                while(w.thread) Thread::IRQenableIrqAndWait(dLock);
+            }
         }
         {
             InterruptEnableLock eLock(dLock);
@@ -259,25 +536,109 @@ void FixedEventQueueBase<SlotSize>::runImpl(Callback<SlotSize> *events,
 
 template<unsigned SlotSize>
 void FixedEventQueueBase<SlotSize>::runOneImpl(Callback<SlotSize> *events,
-        unsigned int size)
+        unsigned int size, TimedEventSlot<SlotSize> **timed)
 {
     Callback<SlotSize> f;
     {
         //Not FastInterruptDisableLock as the operator= of the bound
         //parameters of the Callback may allocate
         InterruptDisableLock dLock;
-        if(n<=0) return;
-        f=events[get]; //This may allocate memory
-        if(++get>=size) get=0;
-        n--;
-        if(waitingPut.empty()==false)
+        if(IRQgetImpl(f,events,size,timed)==false) return;
+    }
+    f();
+}
+
+template<unsigned SlotSize>
+bool FixedEventQueueBase<SlotSize>::IRQgetImpl(Callback<SlotSize>& f,
+        Callback<SlotSize> *events, unsigned int size,
+        TimedEventSlot<SlotSize> **timed)
+{
+    if(nTimed>0)
+    {
+        long long now=IRQgetTime();
+        TimedEventSlot<SlotSize> *t=timed[0];
+        if(t->when<=now)
         {
-            waitingPut.front()->thread->IRQwakeup();
-            waitingPut.front()->thread=nullptr;
-            waitingPut.pop_front();
+            f=t->event; //This may allocate memory
+            if(t->period>0)
+            {
+                //Skip missed activations, if any, without drifting
+                t->when+=((now-t->when)/t->period+1)*t->period;
+                IRQsiftDown(timed,0);
+            } else IRQremoveTimed(timed,0);
+            return true;
         }
     }
-    f();
+    if(n<=0) return false;
+    f=events[get]; //This may allocate memory
+    if(++get>=size) get=0;
+    n--;
+    if(waitingPut.empty()==false)
+    {
+        waitingPut.front()->thread->IRQwakeup();
+        waitingPut.front()->thread=nullptr;
+        waitingPut.pop_front();
+    }
+    return true;
+}
+
+template<unsigned SlotSize>
+void FixedEventQueueBase<SlotSize>::IRQwakeGetter(bool *hppw)
+{
+    if(waitingGet.empty()) return;
+    Thread *t=waitingGet.front()->thread;
+    waitingGet.front()->thread=nullptr;
+    waitingGet.pop_front();
+    t->IRQwakeup();
+    if(hppw && t->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+        *hppw=true;
+}
+
+template<unsigned SlotSize>
+void FixedEventQueueBase<SlotSize>::IRQremoveTimed(
+        TimedEventSlot<SlotSize> **timed, unsigned int i)
+{
+    TimedEventSlot<SlotSize> *t=timed[i];
+    t->event.clear();
+    t->id=0;
+    //Move the last element in place of the removed one, and put the now
+    //free slot past the end of the heap
+    timed[i]=timed[--nTimed];
+    timed[nTimed]=t;
+    if(i<nTimed) IRQsiftDown(timed,IRQsiftUp(timed,i));
+}
+
+template<unsigned SlotSize>
+unsigned int FixedEventQueueBase<SlotSize>::IRQsiftUp(
+        TimedEventSlot<SlotSize> **timed, unsigned int i)
+{
+    TimedEventSlot<SlotSize> *t=timed[i];
+    while(i>0)
+    {
+        unsigned int parent=(i-1)/2;
+        if(timed[parent]->when<=t->when) break;
+        timed[i]=timed[parent];
+        i=parent;
+    }
+    timed[i]=t;
+    return i;
+}
+
+template<unsigned SlotSize>
+void FixedEventQueueBase<SlotSize>::IRQsiftDown(
+        TimedEventSlot<SlotSize> **timed, unsigned int i)
+{
+    TimedEventSlot<SlotSize> *t=timed[i];
+    for(;;)
+    {
+        unsigned int child=2*i+1;
+        if(child>=nTimed) break;
+        if(child+1<nTimed && timed[child+1]->when<timed[child]->when) child++;
+        if(t->when<=timed[child]->when) break;
+        timed[i]=timed[child];
+        i=child;
+    }
+    timed[i]=t;
 }
 
 /**
@@ -294,14 +655,23 @@ void FixedEventQueueBase<SlotSize>::runOneImpl(Callback<SlotSize> *events,
  * Events are function that are posted by a thread through post() but executed
  * in the context of the thread that calls run() or runOne()
  * 
+ * Events can also be posted to run at a given time, or periodically, through
+ * postAt(), postAfter() and postPeriodic(). Timed events are stored in a
+ * separate fixed size table, and the thread calling run() sleeps until the
+ * earliest one is due, so a single event loop thread can replace many threads
+ * that periodically sleep and do some work.
+ * 
  * \param NumSlots maximum queue length
  * \param SlotSize size of the Callback objects. This limits the maximum number
  * of parameters that can be bound to a function. If you get compile-time
  * errors in callback.h, consider increasing this value. The default is 20
  * bytes, which is enough to bind a member function pointer, a "this" pointer
  * and two byte or pointer sized parameters.
+ * \param NumTimers maximum number of pending timed and periodic events. The
+ * default is zero, in which case posting timed events is a compile-time error
+ * and no memory is used for them.
  */
-template<unsigned NumSlots, unsigned SlotSize=20>
+template<unsigned NumSlots, unsigned SlotSize=20, unsigned NumTimers=0>
 class FixedEventQueue : private FixedEventQueueBase<SlotSize>
 {
 public:
@@ -390,6 +760,121 @@ public:
         return this->IRQpostImpl(event,events,NumSlots,&hppw);
     }
 
+    /**
+     * Post an event to be run at a given time. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * The same restrictions of post() apply to the bound parameters.
+     * \param absoluteTimeNs absolute time in nanoseconds, as returned by
+     * getTime(), after which the event has to run
+     * \return a nonzero handle that can be passed to cancel(), or 0 if all the
+     * NumTimers timed event slots are in use
+     */
+    unsigned int postAt(Callback<SlotSize> event, long long absoluteTimeNs)
+    {
+        static_assert(NumTimers>0,"FixedEventQueue has no timed event slots");
+        InterruptDisableLock dLock;
+        return this->IRQpostTimedImpl(event,absoluteTimeNs,0,timers.get(),
+                                      NumTimers);
+    }
+
+    /**
+     * Post an event to be run after a given time. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * The same restrictions of post() apply to the bound parameters.
+     * \param relativeTimeNs time in nanoseconds from now after which the event
+     * has to run
+     * \return a nonzero handle that can be passed to cancel(), or 0 if all the
+     * NumTimers timed event slots are in use
+     */
+    unsigned int postAfter(Callback<SlotSize> event, long long relativeTimeNs)
+    {
+        return postAt(event,getTime()+relativeTimeNs);
+    }
+
+    /**
+     * Post an event to be run periodically, starting one period from now,
+     * until it is cancelled. The event keeps its timed event slot till then.
+     * If the event loop falls behind by more than one period the missed
+     * activations are skipped, but the following ones stay aligned to the
+     * original period. This function never blocks.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * The same restrictions of post() apply to the bound parameters.
+     * \param periodNs period in nanoseconds, must be greater than zero
+     * \return a nonzero handle that can be passed to cancel(), or 0 if all the
+     * NumTimers timed event slots are in use or the period is not valid
+     */
+    unsigned int postPeriodic(Callback<SlotSize> event, long long periodNs)
+    {
+        static_assert(NumTimers>0,"FixedEventQueue has no timed event slots");
+        if(periodNs<=0) return 0;
+        InterruptDisableLock dLock;
+        return this->IRQpostTimedImpl(event,IRQgetTime()+periodNs,periodNs,
+                                      timers.get(),NumTimers);
+    }
+
+    /**
+     * Post an event to be run at a given time.
+     * Can be called only with interrupts disabled or within an interrupt
+     * handler, allowing device drivers to schedule work for a thread.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * The same restrictions of IRQpost() apply to the bound parameters.
+     * \param absoluteTimeNs absolute time in nanoseconds, as returned by
+     * getTime(), after which the event has to run
+     * \return a nonzero handle that can be passed to cancel(), or 0 if all the
+     * NumTimers timed event slots are in use
+     */
+    unsigned int IRQpostAt(Callback<SlotSize> event, long long absoluteTimeNs)
+    {
+        static_assert(NumTimers>0,"FixedEventQueue has no timed event slots");
+        return this->IRQpostTimedImpl(event,absoluteTimeNs,0,timers.get(),
+                                      NumTimers);
+    }
+
+    /**
+     * Post an event to be run at a given time.
+     * Can be called only with interrupts disabled or within an interrupt
+     * handler, allowing device drivers to schedule work for a thread.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * The same restrictions of IRQpost() apply to the bound parameters.
+     * \param absoluteTimeNs absolute time in nanoseconds, as returned by
+     * getTime(), after which the event has to run
+     * \param hppw returns true if a higher priority thread was awakened as
+     * part of posting the event. Can be used inside an IRQ to call the
+     * scheduler.
+     * \return a nonzero handle that can be passed to cancel(), or 0 if all the
+     * NumTimers timed event slots are in use
+     */
+    unsigned int IRQpostAt(Callback<SlotSize> event, long long absoluteTimeNs,
+            bool& hppw)
+    {
+        static_assert(NumTimers>0,"FixedEventQueue has no timed event slots");
+        hppw=false;
+        return this->IRQpostTimedImpl(event,absoluteTimeNs,0,timers.get(),
+                                      NumTimers,&hppw);
+    }
+
+    /**
+     * Cancel a timed or periodic event, freeing its timed event slot. A
+     * periodic event can also cancel itself from within the event function.
+     * \param id handle returned when posting the event
+     * \return true if the event was cancelled, false if it was not found,
+     * i.e: a non periodic event that already ran
+     */
+    bool cancel(unsigned int id)
+    {
+        return this->cancelImpl(id,timers.get());
+    }
+
     /**
      * This function blocks waiting for events being posted, and when available
      * it calls the event function. To return from this event loop an event
@@ -399,7 +884,7 @@ public:
      */
     void run()
     {
-        this->runImpl(events,NumSlots);
+        this->runImpl(events,NumSlots,timers.get());
     }
 
     /**
@@ -409,11 +894,12 @@ public:
      */
     void runOne()
     {
-        this->runOneImpl(events,NumSlots);
+        this->runOneImpl(events,NumSlots,timers.get());
     }
     
     /**
-     * \return the number of events in the queue
+     * \return the number of events in the queue, not counting timed events
+     * that are not yet due
      */
     unsigned int size() const
     {
@@ -433,6 +919,358 @@ public:
 
 private:
     Callback<SlotSize> events[NumSlots]; ///< Fixed size queue of events
+    FixedEventQueueTimers<SlotSize,NumTimers> timers; ///< Timed events
+};
+
+/**
+ * \internal
+ * This class is to extract from PooledEventQueue code that
+ * does not depend on the NumNodes template parameters.
+ */
+template<unsigned SlotSize>
+class PooledEventQueueBase
+{
+protected:
+    /**
+     * \internal Element of the node pool, holds a posted event
+     */
+    class Node
+    {
+    public:
+        Callback<SlotSize> event; ///< Posted event
+        Node *next=nullptr;       ///< Next node in the queue or free list
+    };
+
+    /**
+     * Constructor.
+     */
+    PooledEventQueueBase() {}
+
+    /**
+     * Put all the nodes in the free list. Called by the derived class once
+     * its node array has been constructed.
+     * \param nodes pointer to the node array
+     * \param size number of nodes
+     */
+    void initPool(Node *nodes, unsigned int size);
+
+    /**
+     * Post an event.
+     * \param event event to post
+     * \param block if true, block if there are no free nodes
+     * \return false if there were no free nodes and block is false
+     */
+    bool postImpl(Callback<SlotSize>& event, bool block);
+
+    /**
+     * This function blocks waiting for events being posted, and when available
+     * it calls the event functions. To return from this event loop an event
+     * function must throw an exception.
+     * 
+     * \throws any exception that is thrown by the event functions
+     */
+    void runImpl();
+
+    /**
+     * Run at most one event. This function does not block.
+     * 
+     * \throws any exception that is thrown by the event functions
+     */
+    void runOneImpl();
+
+    /**
+     * \return the number of events in the queue
+     */
+    unsigned int sizeImpl() const
+    {
+        Lock<FastMutex> l(m);
+        return n;
+    }
+
+private:
+    /**
+     * \internal
+     * Events taken from the queue to be run without holding the mutex.
+     * Must be constructed and destroyed with the mutex locked. The destructor
+     * gives the nodes of the events that were run back to the pool, and if an
+     * event function threw puts the remaining ones back at the front of the
+     * queue, waking idle threads so that they can run them.
+     */
+    class Batch
+    {
+    public:
+        /**
+         * Constructor, removes events from the front of the queue
+         * \param q queue
+         * \param count number of events to take, must be at least one and
+         * no more than the number of pending events
+         */
+        Batch(PooledEventQueueBase& q, unsigned int count);
+
+        /**
+         * Run the events, with the mutex unlocked
+         */
+        void run();
+
+        /**
+         * Destructor
+         */
+        ~Batch();
+
+        Batch(const Batch&) = delete;
+        Batch& operator= (const Batch&) = delete;
+
+    private:
+        PooledEventQueueBase& q; ///< Queue the events were taken from
+        Node *first;             ///< First event of the batch
+        Node *next;              ///< First event not yet run
+    };
+
+    Node *freeList=nullptr; ///< Free nodes
+    Node *head=nullptr;     ///< First pending event
+    Node *tail=nullptr;     ///< Last pending event
+    unsigned int n=0;       ///< Number of pending events
+    unsigned int idle=0;    ///< Number of threads waiting for events in run()
+    mutable FastMutex m;    ///< Mutex for synchronisation
+    ConditionVariable cvGet, cvPut; ///< Waiting on get/put
+};
+
+template<unsigned SlotSize>
+void PooledEventQueueBase<SlotSize>::initPool(Node *nodes, unsigned int size)
+{
+    for(unsigned int i=0;i<size;i++)
+    {
+        nodes[i].next=freeList;
+        freeList=&nodes[i];
+    }
+}
+
+template<unsigned SlotSize>
+bool PooledEventQueueBase<SlotSize>::postImpl(Callback<SlotSize>& event,
+        bool block)
+{
+    Lock<FastMutex> l(m);
+    while(freeList==nullptr)
+    {
+        if(block==false) return false;
+        cvPut.wait(l);
+    }
+    Node *node=freeList;
+    freeList=node->next;
+    node->event=event; //This may allocate memory
+    node->next=nullptr;
+    if(tail) tail->next=node;
+    else head=node;
+    tail=node;
+    n++;
+    cvGet.signal();
+    return true;
+}
+
+template<unsigned SlotSize>
+void PooledEventQueueBase<SlotSize>::runImpl()
+{
+    Lock<FastMutex> l(m);
+    for(;;)
+    {
+        while(head==nullptr)
+        {
+            idle++;
+            cvGet.wait(l);
+            idle--;
+        }
+        //Take only a fair share of the events, leave the rest to idle threads
+        Batch batch(*this,(n+idle)/(idle+1));
+        {
+            Unlock<FastMutex> u(l);
+            batch.run();
+        }
+    }
+}
+
+template<unsigned SlotSize>
+void PooledEventQueueBase<SlotSize>::runOneImpl()
+{
+    Lock<FastMutex> l(m);
+    if(head==nullptr) return;
+    Batch batch(*this,1);
+    Unlock<FastMutex> u(l);
+    batch.run();
+}
+
+template<unsigned SlotSize>
+PooledEventQueueBase<SlotSize>::Batch::Batch(PooledEventQueueBase& q,
+        unsigned int count) : q(q), first(q.head), next(q.head)
+{
+    Node *last=first;
+    for(unsigned int i=1;i<count;i++) last=last->next;
+    q.head=last->next;
+    if(q.head==nullptr) q.tail=nullptr;
+    last->next=nullptr;
+    q.n-=count;
+}
+
+template<unsigned SlotSize>
+void PooledEventQueueBase<SlotSize>::Batch::run()
+{
+    //Free the bound parameters without holding the lock, even if the event
+    //function throws
+    class Clear
+    {
+    public:
+        Clear(Callback<SlotSize>& event) : event(event) {}
+        ~Clear() { event.clear(); }
+    private:
+        Callback<SlotSize>& event;
+    };
+
+    while(next)
+    {
+        Node *node=next;
+        next=node->next;
+        Clear c(node->event);
+        node->event();
+    }
+}
+
+template<unsigned SlotSize>
+PooledEventQueueBase<SlotSize>::Batch::~Batch()
+{
+    if(first!=next)
+    {
+        while(first!=next)
+        {
+            Node *node=first;
+            first=node->next;
+            node->next=q.freeList;
+            q.freeList=node;
+        }
+        q.cvPut.broadcast();
+    }
+    if(next==nullptr) return;
+    unsigned int count=1;
+    Node *last=next;
+    while(last->next)
+    {
+        last=last->next;
+        count++;
+    }
+    last->next=q.head;
+    if(q.head==nullptr) q.tail=last;
+    q.head=next;
+    q.n+=count;
+    //Threads idle in run() may take the events that were put back
+    q.cvGet.broadcast();
+}
+
+/**
+ * An event queue with a fixed size pool of event nodes.
+ * 
+ * Like FixedEventQueue it makes no use of the heap, but events can only be
+ * posted from threads, as synchronization uses a FastMutex instead of
+ * disabling interrupts. This allows to use it from real-time producers
+ * without affecting interrupt latency. post() is a single lock acquisition
+ * and a constant amount of work, while run() takes the pending events in a
+ * single lock acquisition and runs them in place, without copying them out of
+ * the queue, giving their nodes back to the pool in a single lock acquisition
+ * once they all ran. When other threads are idle in run(), it takes only its
+ * share of the pending events, so that they are spread among the threads.
+ * 
+ * This class acts as a synchronization point, multiple threads can post
+ * events, and multiple threads can call run() or runOne() (thread pooling).
+ * 
+ * Events are function that are posted by a thread through post() but executed
+ * in the context of the thread that calls run() or runOne()
+ * 
+ * \param NumNodes maximum number of events. As nodes are given back to the
+ * pool after the batch of events they are part of has run, events that are
+ * being run still count towards this limit. An event function calling the
+ * blocking post() on its own queue needs to take this into account.
+ * \param SlotSize size of the Callback objects. This limits the maximum number
+ * of parameters that can be bound to a function. If you get compile-time
+ * errors in callback.h, consider increasing this value. The default is 20
+ * bytes, which is enough to bind a member function pointer, a "this" pointer
+ * and two byte or pointer sized parameters.
+ */
+template<unsigned NumNodes, unsigned SlotSize=20>
+class PooledEventQueue : private PooledEventQueueBase<SlotSize>
+{
+public:
+    /**
+     * Constructor.
+     */
+    PooledEventQueue()
+    {
+        this->initPool(nodes,NumNodes);
+    }
+
+    /**
+     * Post an event, blocking if there are no free nodes.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     */
+    void post(Callback<SlotSize> event)
+    {
+        this->postImpl(event,true);
+    }
+
+    /**
+     * Post an event in the queue, or return if there are no free nodes.
+     * 
+     * \param event function function to be called in the thread that calls
+     * run() or runOne(). Bind can be used to bind parameters to the function.
+     * \return false if there was no space in the queue
+     */
+    bool postNonBlocking(Callback<SlotSize> event)
+    {
+        return this->postImpl(event,false);
+    }
+
+    /**
+     * This function blocks waiting for events being posted, and when available
+     * it calls the event functions. To return from this event loop an event
+     * function must throw an exception.
+     * 
+     * \throws any exception that is thrown by the event functions
+     */
+    void run()
+    {
+        this->runImpl();
+    }
+
+    /**
+     * Run at most one event. This function does not block.
+     * 
+     * \throws any exception that is thrown by the event functions
+     */
+    void runOne()
+    {
+        this->runOneImpl();
+    }
+
+    /**
+     * \return the number of events in the queue, not counting those that are
+     * being run
+     */
+    unsigned int size() const
+    {
+        return this->sizeImpl();
+    }
+
+    /**
+     * \return true if the queue has no events
+     */
+    bool empty() const
+    {
+        return this->sizeImpl()==0;
+    }
+
+    PooledEventQueue(const PooledEventQueue&) = delete;
+    PooledEventQueue& operator= (const PooledEventQueue&) = delete;
+
+private:
+    typename PooledEventQueueBase<SlotSize>::Node nodes[NumNodes]; ///< Node pool
 };
 
 } //namespace miosix
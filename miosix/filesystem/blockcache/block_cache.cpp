@@ -0,0 +1,297 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "block_cache.h"
+#include "filesystem/ioctl.h"
+#include <cstring>
+#include <climits>
+
+using namespace std;
+
+#ifdef WITH_FILESYSTEM
+
+namespace miosix {
+
+//
+// class BlockCache
+//
+
+BlockCache::BlockCache(intrusive_ref_ptr<Device> dev, unsigned int numBlocks,
+        unsigned int readahead) : Device(Device::BLOCK), dev(dev),
+        data(new unsigned char[numBlocks*blockSize]),
+        entries(new Entry[numBlocks]), numBlocks(numBlocks),
+        maxRun(numBlocks>=2 ? numBlocks/2 : 1), readahead(readahead),
+        useCounter(0), nextLba(0)
+{
+    for(unsigned int i=0;i<numBlocks;i++)
+    {
+        entries[i].lba=0;
+        entries[i].lastUse=0;
+        entries[i].valid=false;
+        entries[i].dirty=false;
+    }
+    memset(&stats,0,sizeof(stats));
+    stats.blockSize=blockSize;
+    stats.numBlocks=numBlocks;
+}
+
+ssize_t BlockCache::readBlock(void *buffer, size_t size, off_t where)
+{
+    if(where<0) return -EINVAL;
+    auto buf=reinterpret_cast<unsigned char*>(buffer);
+    Lock<FastMutex> l(mutex);
+    size_t done=0;
+    while(done<size)
+    {
+        off_t pos=where+done;
+        unsigned int lba=pos/blockSize;
+        unsigned int offset=pos%blockSize;
+        size_t chunk=blockSize-offset<size-done ? blockSize-offset : size-done;
+        int index=lookup(lba);
+        if(index>=0)
+        {
+            stats.hits++;
+        } else {
+            unsigned int whole=offset==0 ? (size-done)/blockSize : 0;
+            unsigned int run=whole>=maxRun ? missingRun(lba,whole) : 0;
+            if(run>=maxRun)
+            {
+                //Large read, don't pollute the cache
+                ssize_t r=dev->readBlock(buf+done,run*blockSize,pos);
+                if(r!=static_cast<ssize_t>(run*blockSize))
+                    return r<0 ? r : -EIO;
+                stats.misses+=run;
+                done+=run*blockSize;
+                nextLba=lba+run;
+                continue;
+            }
+            unsigned int requested=(offset+size-done+blockSize-1)/blockSize;
+            run=missingRun(lba,requested<maxRun ? requested : maxRun);
+            index=fetch(lba,run,lba==nextLba ? readahead : 0);
+            if(index<0) return index;
+        }
+        touch(index);
+        memcpy(buf+done,data+index*blockSize+offset,chunk);
+        done+=chunk;
+        nextLba=(pos+chunk)/blockSize;
+    }
+    return size;
+}
+
+ssize_t BlockCache::writeBlock(const void *buffer, size_t size, off_t where)
+{
+    if(where<0) return -EINVAL;
+    auto buf=reinterpret_cast<const unsigned char*>(buffer);
+    Lock<FastMutex> l(mutex);
+    size_t done=0;
+    while(done<size)
+    {
+        off_t pos=where+done;
+        unsigned int lba=pos/blockSize;
+        unsigned int offset=pos%blockSize;
+        size_t chunk=blockSize-offset<size-done ? blockSize-offset : size-done;
+        unsigned int whole=offset==0 ? (size-done)/blockSize : 0;
+        if(whole>=maxRun)
+        {
+            //Large write, don't pollute the cache. Cached copies of the
+            //blocks are overwritten, so drop them even if dirty
+            for(unsigned int i=0;i<whole;i++)
+            {
+                int index=lookup(lba+i);
+                if(index<0) continue;
+                entries[index].valid=false;
+                entries[index].dirty=false;
+            }
+            ssize_t r=dev->writeBlock(buf+done,whole*blockSize,pos);
+            if(r!=static_cast<ssize_t>(whole*blockSize))
+                return r<0 ? r : -EIO;
+            done+=whole*blockSize;
+            continue;
+        }
+        int index=lookup(lba);
+        if(index>=0)
+        {
+            stats.hits++;
+        } else if(chunk==blockSize) {
+            //The whole block is overwritten, no need to read it
+            index=evict(1);
+            if(index<0) return index;
+            entries[index].lba=lba;
+            entries[index].valid=true;
+            stats.misses++;
+        } else {
+            index=fetch(lba,1,0);
+            if(index<0) return index;
+        }
+        touch(index);
+        memcpy(data+index*blockSize+offset,buf+done,chunk);
+        entries[index].dirty=true;
+        done+=chunk;
+    }
+    return size;
+}
+
+int BlockCache::ioctl(int cmd, void *arg)
+{
+    switch(cmd)
+    {
+        case IOCTL_SYNC:
+        {
+            Lock<FastMutex> l(mutex);
+            int result=flush();
+            if(result<0) return result;
+            break;
+        }
+        case IOCTL_BLOCK_CACHE_STATS:
+        {
+            if(arg==nullptr) return -EFAULT;
+            Lock<FastMutex> l(mutex);
+            *reinterpret_cast<BlockCacheStats*>(arg)=stats;
+            return 0;
+        }
+    }
+    return dev->ioctl(cmd,arg);
+}
+
+BlockCache::~BlockCache()
+{
+    flush();
+    delete[] entries;
+    delete[] data;
+}
+
+int BlockCache::lookup(unsigned int lba) const
+{
+    for(unsigned int i=0;i<numBlocks;i++)
+        if(entries[i].valid && entries[i].lba==lba) return i;
+    return -1;
+}
+
+int BlockCache::evict(unsigned int count)
+{
+    //Pick the window whose most recently used entry is the oldest. Ages are
+    //computed as differences so that useCounter can wrap around
+    unsigned int best=0, bestAge=0;
+    for(unsigned int i=0;i+count<=numBlocks;i++)
+    {
+        unsigned int age=UINT_MAX;
+        for(unsigned int j=i;j<i+count;j++)
+        {
+            if(entries[j].valid==false) continue;
+            unsigned int a=useCounter-entries[j].lastUse;
+            if(a<age) age=a;
+        }
+        if(age>bestAge || i==0)
+        {
+            best=i;
+            bestAge=age;
+        }
+    }
+    for(unsigned int i=best;i<best+count;)
+    {
+        unsigned int run=1;
+        if(entries[i].valid && entries[i].dirty)
+        {
+            while(i+run<best+count && entries[i+run].valid
+                && entries[i+run].dirty
+                && entries[i+run].lba==entries[i].lba+run) run++;
+            int result=writeBack(i,run);
+            if(result<0) return result;
+        }
+        for(unsigned int j=i;j<i+run;j++) entries[j].valid=false;
+        i+=run;
+    }
+    return best;
+}
+
+int BlockCache::fetch(unsigned int lba, unsigned int count, unsigned int extra)
+{
+    if(extra>maxRun-count) extra=maxRun-count;
+    extra=missingRun(lba+count,extra);
+    int index=evict(count+extra);
+    if(index<0) return index;
+    unsigned char *dest=data+index*blockSize;
+    off_t where=static_cast<off_t>(lba)*blockSize;
+    ssize_t r=dev->readBlock(dest,(count+extra)*blockSize,where);
+    if(r!=static_cast<ssize_t>((count+extra)*blockSize) && extra>0)
+    {
+        //Reading in advance may have gone past the end of the device
+        extra=0;
+        r=dev->readBlock(dest,count*blockSize,where);
+    }
+    if(r!=static_cast<ssize_t>(count*blockSize+extra*blockSize))
+        return r<0 ? r : -EIO;
+    for(unsigned int i=0;i<count+extra;i++)
+    {
+        entries[index+i].lba=lba+i;
+        entries[index+i].valid=true;
+        entries[index+i].dirty=false;
+        touch(index+i);
+    }
+    stats.misses+=count;
+    stats.readahead+=extra;
+    return index;
+}
+
+int BlockCache::flush()
+{
+    for(unsigned int i=0;i<numBlocks;)
+    {
+        unsigned int run=1;
+        if(entries[i].valid && entries[i].dirty)
+        {
+            while(i+run<numBlocks && entries[i+run].valid
+                && entries[i+run].dirty
+                && entries[i+run].lba==entries[i].lba+run) run++;
+            int result=writeBack(i,run);
+            if(result<0) return result;
+        }
+        i+=run;
+    }
+    return 0;
+}
+
+int BlockCache::writeBack(unsigned int index, unsigned int count)
+{
+    ssize_t r=dev->writeBlock(data+index*blockSize,count*blockSize,
+                              static_cast<off_t>(entries[index].lba)*blockSize);
+    if(r!=static_cast<ssize_t>(count*blockSize)) return r<0 ? r : -EIO;
+    for(unsigned int i=index;i<index+count;i++) entries[i].dirty=false;
+    stats.writebacks+=count;
+    return 0;
+}
+
+unsigned int BlockCache::missingRun(unsigned int lba, unsigned int limit) const
+{
+    unsigned int result=0;
+    while(result<limit && lookup(lba+result)<0) result++;
+    return result;
+}
+
+} //namespace miosix
+
+#endif //WITH_FILESYSTEM
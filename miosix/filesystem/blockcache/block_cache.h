@@ -0,0 +1,197 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "filesystem/devfs/devfs.h"
+#include "kernel/sync.h"
+#include "config/miosix_settings.h"
+
+#ifdef WITH_FILESYSTEM
+
+namespace miosix {
+
+/**
+ * Statistics returned by the IOCTL_BLOCK_CACHE_STATS ioctl of a BlockCache
+ */
+struct BlockCacheStats
+{
+    unsigned int hits;       ///< Blocks found in the cache
+    unsigned int misses;     ///< Blocks read from the device on request
+    unsigned int readahead;  ///< Blocks read from the device in advance
+    unsigned int writebacks; ///< Dirty blocks written back to the device
+    unsigned int blockSize;  ///< Size in bytes of a cache block
+    unsigned int numBlocks;  ///< Number of blocks in the cache
+};
+
+/**
+ * A bounded size LRU block cache with write-back that can be put between a
+ * block device and the filesystem mounted on it. Being itself a block Device,
+ * any filesystem can be mounted on top of it without changes.
+ *
+ * Written blocks are kept in the cache and only written to the underlying
+ * device when evicted, when IOCTL_SYNC is called (filesystems do so on
+ * fsync() and close()) or when the cache is deleted.
+ * When a read continues where the previous one ended, some blocks after the
+ * requested ones are read in advance with the same device access.
+ * Large block aligned reads and writes bypass the cache, as caching them would
+ * only evict more useful blocks.
+ *
+ * Unlike most block devices, reads and writes need not be block aligned.
+ */
+class BlockCache : public Device
+{
+public:
+    /**
+     * Constructor
+     * \param dev block device to cache
+     * \param numBlocks number of blocks in the cache
+     * \param readahead number of blocks read in advance on sequential reads
+     */
+    BlockCache(intrusive_ref_ptr<Device> dev,
+               unsigned int numBlocks=BLOCK_CACHE_BLOCKS,
+               unsigned int readahead=BLOCK_CACHE_READAHEAD);
+
+    /**
+     * Read a block of data
+     * \param buffer buffer where read data will be stored
+     * \param size buffer size
+     * \param where where to read from
+     * \return number of bytes read or a negative number on failure
+     */
+    virtual ssize_t readBlock(void *buffer, size_t size, off_t where);
+
+    /**
+     * Write a block of data
+     * \param buffer buffer where take data to write
+     * \param size buffer size
+     * \param where where to write to
+     * \return number of bytes written or a negative number on failure
+     */
+    virtual ssize_t writeBlock(const void *buffer, size_t size, off_t where);
+
+    /**
+     * Performs device-specific operations. IOCTL_SYNC writes back all dirty
+     * blocks before being forwarded to the device, IOCTL_BLOCK_CACHE_STATS
+     * fills the BlockCacheStats pointed to by arg, all other operations are
+     * forwarded to the device
+     * \param cmd specifies the operation to perform
+     * \param arg optional argument that some operation require
+     * \return the exact return value depends on CMD, -1 is returned on error
+     */
+    virtual int ioctl(int cmd, void *arg);
+
+    /**
+     * Destructor, writes back all dirty blocks
+     */
+    virtual ~BlockCache();
+
+    static const unsigned int blockSize=512; ///< Size of a cache block
+
+private:
+    BlockCache(const BlockCache&)=delete;
+    BlockCache& operator=(const BlockCache&)=delete;
+
+    /**
+     * A cache entry, its data is at data[index*blockSize]
+     */
+    struct Entry
+    {
+        unsigned int lba;     ///< Block number on the device
+        unsigned int lastUse; ///< Value of useCounter when last accessed
+        bool valid;           ///< True if the entry holds a block
+        bool dirty;           ///< True if the block was modified
+    };
+
+    /**
+     * \param lba block number
+     * \return the index of the entry holding the block, or -1
+     */
+    int lookup(unsigned int lba) const;
+
+    /**
+     * Mark an entry as the most recently used
+     * \param index entry index
+     */
+    void touch(unsigned int index) { entries[index].lastUse=++useCounter; }
+
+    /**
+     * Make room for consecutive blocks by evicting the least recently used
+     * window of count consecutive entries, writing back dirty ones
+     * \param count number of entries, at most maxRun
+     * \return the index of the first entry of the window or a negative number
+     * if a write back failed
+     */
+    int evict(unsigned int count);
+
+    /**
+     * Read consecutive blocks from the device into the cache
+     * \param lba first block to read
+     * \param count number of blocks requested
+     * \param extra number of blocks to read in advance after them, if possible
+     * \return the index of the entry holding lba or a negative number on
+     * failure
+     */
+    int fetch(unsigned int lba, unsigned int count, unsigned int extra);
+
+    /**
+     * Write back dirty entries to the device, coalescing consecutive blocks
+     * \return 0 on success, or a negative number on failure
+     */
+    int flush();
+
+    /**
+     * Write back a run of consecutive dirty entries
+     * \param index first entry
+     * \param count number of entries
+     * \return 0 on success, or a negative number on failure
+     */
+    int writeBack(unsigned int index, unsigned int count);
+
+    /**
+     * \param lba first block
+     * \param limit maximum value to return
+     * \return number of consecutive blocks starting from lba that are not in
+     * the cache, up to limit
+     */
+    unsigned int missingRun(unsigned int lba, unsigned int limit) const;
+
+    FastMutex mutex;
+    intrusive_ref_ptr<Device> dev; ///< Cached device
+    unsigned char *data;           ///< Cached data, numBlocks*blockSize bytes
+    Entry *entries;                ///< Cache entries
+    const unsigned int numBlocks;  ///< Number of entries
+    const unsigned int maxRun;     ///< Longest run of blocks that is cached
+    const unsigned int readahead;  ///< Blocks read in advance
+    unsigned int useCounter;       ///< Incremented at every access, for LRU
+    unsigned int nextLba;          ///< Block after the end of the last read
+    BlockCacheStats stats;
+};
+
+} //namespace miosix
+
+#endif //WITH_FILESYSTEM
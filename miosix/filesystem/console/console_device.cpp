@@ -27,6 +27,8 @@
 
 #include "console_device.h"
 #include "filesystem/ioctl.h"
+#include <new>
+#include <cstring>
 #include <errno.h>
 #include <termios.h>
 
@@ -40,40 +42,48 @@ namespace miosix {
 
 TerminalDevice::TerminalDevice(intrusive_ref_ptr<Device> device)
         : FileBase(intrusive_ref_ptr<FilesystemBase>(),O_RDWR), device(device),
-          mutex(), echo(true), binary(false), skipNewline(false) {}
+          mutex(), writeMutex(), outSize(0), outUsed(0),
+          outMode(TERMINAL_UNBUFFERED), echo(true), binary(false),
+          skipNewline(false) {}
+
+TerminalDevice::~TerminalDevice()
+{
+    Lock<FastMutex> l(writeMutex);
+    flushOutput();
+}
 
 ssize_t TerminalDevice::write(const void *data, size_t length)
 {
-    if(binary) return device->writeBlock(data,length,0);
-    //No mutex here to avoid blocking writes while reads are in progress
     const char *buffer=static_cast<const char*>(data);
-    const char *start=buffer;
-    //Try to write data in chunks, stop at every \n to replace with \r\n
-    //Although it may be tempting to call echoBack() from here since it performs
-    //a similar task, it is not possible, as echoBack() uses a class field,
-    //chunkStart, and write is not mutexed to allow concurrent writing
-    for(size_t i=0;i<length;i++,buffer++)
     {
-        if(*buffer!='\n') continue;
-        if(buffer>start)
+        Lock<FastMutex> l(writeMutex);
+        if(outMode!=TERMINAL_UNBUFFERED)
         {
-            ssize_t r=device->writeBlock(start,buffer-start,0);
-            if(r<=0) return r;
+            if(binary)
+            {
+                //Preserve ordering with previously buffered output
+                if(int r=flushOutput()) return r;
+                return device->writeBlock(data,length,0);
+            }
+            ssize_t result=stage(buffer,length,outBuffer.get(),outSize,outUsed);
+            if(result<0) return result;
+            bool flush=outMode==TERMINAL_LINE_BUFFERED &&
+                       memchr(buffer,'\n',length);
+            if(flush) if(int r=flushOutput()) return r;
+            return result;
         }
-        ssize_t r=device->writeBlock("\r\n",2,0);//Add \r\n
-        if(r<=0) return r;
-        start=buffer+1;
     }
-    if(buffer>start)
-    {
-        ssize_t r=device->writeBlock(start,buffer-start,0);
-        if(r<=0) return r;
-    }
-    return length;
+    //Unbuffered writes release writeMutex, as they only use the stack
+    return writeUnbuffered(buffer,length);
 }
 
 ssize_t TerminalDevice::read(void *data, size_t length)
 {
+    {
+        //Output such as a prompt must be visible before waiting for input
+        Lock<FastMutex> l(writeMutex);
+        flushOutput(); //Ignore write errors, does nothing if unbuffered
+    }
     if(binary)
     {
         ssize_t result=device->readBlock(data,length,0);
@@ -110,6 +120,20 @@ int TerminalDevice::isatty() const { return device->isatty(); }
 
 int TerminalDevice::ioctl(int cmd, void *arg)
 {
+    switch(cmd)
+    {
+        case IOCTL_TERMINAL_BUFFERING:
+            return setBuffering(reinterpret_cast<const TerminalBuffering*>(arg));
+        case IOCTL_SYNC:
+        case IOCTL_TCSETATTR_DRAIN:
+        {
+            Lock<FastMutex> l(writeMutex);
+            if(int result=flushOutput()) return result;
+            break;
+        }
+        default:
+            break;
+    }
     if(int result=device->ioctl(cmd,arg)!=0) return result;
     termios *t=reinterpret_cast<termios*>(arg);
     switch(cmd)
@@ -130,6 +154,11 @@ int TerminalDevice::ioctl(int cmd, void *arg)
     return 0;
 }
 
+int TerminalDevice::poll(int events, PollRegistration *reg)
+{
+    return device->poll(events,reg);
+}
+
 pair<size_t,bool> TerminalDevice::normalize(char *buffer, ssize_t begin,
         ssize_t end)
 {
@@ -192,6 +221,116 @@ void TerminalDevice::echoBack(const char *chunkEnd, const char *sep, size_t sepL
     if(sep) device->writeBlock(sep,sepLen,0); //Ignore write errors
 }
 
+ssize_t TerminalDevice::writeUnbuffered(const char *data, size_t length)
+{
+    if(binary) return device->writeBlock(data,length,0);
+    //No mutex here to avoid blocking writes while reads are in progress,
+    //and concurrent writes, so the staging buffer is on the stack.
+    //Although it may be tempting to call echoBack() from here since it
+    //performs a similar task, it is not possible, as echoBack() uses a
+    //class field, chunkStart
+    char staging[unbufferedStagingSize];
+    unsigned int used=0;
+    const char *end=data+length;
+    while(data<end)
+    {
+        //Short runs of data and the \r\n replacing each \n are staged, runs
+        //too long for the staging buffer are written straight from data
+        auto nl=static_cast<const char*>(memchr(data,'\n',end-data));
+        size_t n=(nl ? nl : end)-data;
+        if(used+n+2>sizeof(staging) && used>0)
+        {
+            ssize_t r=device->writeBlock(staging,used,0);
+            if(r<=0) return r;
+            used=0;
+        }
+        if(n+2>sizeof(staging))
+        {
+            ssize_t r=device->writeBlock(data,n,0);
+            if(r<=0) return r;
+        } else {
+            memcpy(staging+used,data,n);
+            used+=n;
+        }
+        if(nl==nullptr) break;
+        staging[used++]='\r';
+        staging[used++]='\n';
+        data=nl+1;
+    }
+    if(used==0) return length;
+    ssize_t r=device->writeBlock(staging,used,0);
+    return r<=0 ? r : length;
+}
+
+ssize_t TerminalDevice::stage(const char *data, size_t length, char *buffer,
+                              unsigned int size, unsigned int& used)
+{
+    const char *end=data+length;
+    while(data<end)
+    {
+        //Make sure there is always room for a \r\n
+        if(used+2>size)
+        {
+            ssize_t r=device->writeBlock(buffer,used,0);
+            if(r<=0) return r;
+            used=0;
+        }
+        //If a \n is found in the first size-used-1 bytes, there is room for
+        //the bytes before it and \r\n
+        size_t n=min<size_t>(end-data,size-used-1);
+        auto nl=static_cast<const char*>(memchr(data,'\n',n));
+        if(nl) n=nl-data;
+        memcpy(buffer+used,data,n);
+        used+=n;
+        data+=n;
+        if(nl)
+        {
+            buffer[used++]='\r';
+            buffer[used++]='\n';
+            data++;
+        }
+    }
+    return length;
+}
+
+int TerminalDevice::flushOutput()
+{
+    if(outUsed==0) return 0;
+    ssize_t r=device->writeBlock(outBuffer.get(),outUsed,0);
+    outUsed=0; //Discard output on errors, like unbuffered writes do
+    if(r<0) return r;
+    return r==0 ? -EIO : 0;
+}
+
+int TerminalDevice::setBuffering(const TerminalBuffering *tb)
+{
+    if(tb==nullptr) return -EFAULT;
+    if(tb->mode!=TERMINAL_UNBUFFERED && tb->mode!=TERMINAL_LINE_BUFFERED &&
+       tb->mode!=TERMINAL_FULLY_BUFFERED) return -EINVAL;
+    unsigned int size=tb->size;
+    if(size!=0 && (size<minBufferSize || size>maxBufferSize)) return -EINVAL;
+    Lock<FastMutex> l(writeMutex);
+    if(int r=flushOutput()) return r;
+    if(tb->mode==TERMINAL_UNBUFFERED)
+    {
+        //Unbuffered writes need no buffer, release memory
+        outMode=TERMINAL_UNBUFFERED;
+        outBuffer.reset();
+        outSize=0;
+        return 0;
+    }
+    if(size==0) size=outSize!=0 ? outSize : defaultBufferSize;
+    if(size!=outSize)
+    {
+        char *newBuffer=new (nothrow) char[size];
+        if(newBuffer==nullptr) return -ENOMEM;
+        outBuffer.reset(newBuffer);
+        outSize=size;
+    }
+    outMode=tb->mode;
+    return 0;
+}
+
 //
 // class DefaultConsole 
 //
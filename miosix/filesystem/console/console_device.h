@@ -28,15 +28,21 @@
 #ifndef CONSOLE_DEVICE_H
 #define	CONSOLE_DEVICE_H
 
+#include <memory>
 #include "config/miosix_settings.h"
 #include "filesystem/devfs/devfs.h"
+#include "filesystem/ioctl.h"
 #include "kernel/sync.h"
 
 namespace miosix {
 
 /**
  * Teriminal device, proxy object supporting additional terminal-specific
- * features
+ * features.
+ * Output is translated from \n to \r\n while being copied in a staging
+ * buffer, so that the underlying device is called once per buffer instead of
+ * once per line. By default output is written before write() returns, the
+ * IOCTL_TERMINAL_BUFFERING ioctl allows to keep it buffered for longer.
  */
 class TerminalDevice : public FileBase
 {
@@ -46,6 +52,11 @@ public:
      * \param device proxed device.
      */
     TerminalDevice(intrusive_ref_ptr<Device> device);
+
+    /**
+     * Destructor, writes buffered output
+     */
+    ~TerminalDevice();
     
     /**
      * Write data to the file, if the file supports writing.
@@ -107,6 +118,17 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     virtual int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the terminal is ready for I/O. Readiness is that of the
+     * underlying device, so in canonical mode the terminal is reported as
+     * readable as soon as some characters are available, even if a read()
+     * would still block waiting for the end of the line.
+     * \param events events the caller is interested in
+     * \param reg registration to add to the device PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    virtual int poll(int events, PollRegistration *reg);
     
     /**
      * Enables or disables echo of commands on the terminal
@@ -151,9 +173,59 @@ private:
      * \param sepLen separator length
      */
     void echoBack(const char *chunkEnd, const char *sep=0, size_t sepLen=0);
-    
+
+    /**
+     * Write data translating \n to \r\n, used when output is unbuffered.
+     * Short runs of data are collected in a staging buffer allocated on the
+     * stack, while runs that do not fit in it are written straight from data
+     * \param data data to write
+     * \param length data length
+     * \return length, or a negative number in case of errors
+     */
+    ssize_t writeUnbuffered(const char *data, size_t length);
+
+    /**
+     * Copy data to a staging buffer translating \n to \r\n, and write the
+     * buffer to the device every time it becomes full
+     * \param data data to write
+     * \param length data length
+     * \param buffer staging buffer
+     * \param size staging buffer size, must be at least 2
+     * \param used number of bytes in the staging buffer, updated
+     * \return length, or a negative number in case of errors
+     */
+    ssize_t stage(const char *data, size_t length, char *buffer,
+                  unsigned int size, unsigned int& used);
+
+    /**
+     * Write the content of outBuffer to the device.
+     * Must be called with writeMutex locked
+     * \return 0 on success, or a negative number in case of errors
+     */
+    int flushOutput();
+
+    /**
+     * Change the output buffering
+     * \param tb new buffering mode and size
+     * \return 0 on success, or a negative number in case of errors
+     */
+    int setBuffering(const TerminalBuffering *tb);
+
+    /// Size of the staging buffer allocated on the stack by unbuffered writes
+    static const unsigned int unbufferedStagingSize=64;
+    /// Default size of outBuffer for line and fully buffered modes
+    static const unsigned int defaultBufferSize=256;
+    /// Limits of the outBuffer size
+    static const unsigned int minBufferSize=16;
+    static const unsigned int maxBufferSize=16384;
+
     intrusive_ref_ptr<Device> device; ///< Underlying TTY device
     FastMutex mutex;                  ///< Mutex to serialze concurrent reads
+    FastMutex writeMutex;             ///< Protects outBuffer and outMode
+    std::unique_ptr<char[]> outBuffer;///< Staging buffer, if output buffered
+    unsigned int outSize;             ///< Size of outBuffer
+    unsigned int outUsed;             ///< Bytes waiting in outBuffer
+    int outMode;                      ///< Output TerminalBufferingMode
     const char *chunkStart;           ///< First character to echo in echoBack()
     bool echo;                        ///< True if echo enabled
     bool binary;                      ///< True if binary mode enabled
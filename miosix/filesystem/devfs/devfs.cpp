@@ -30,6 +30,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include "filesystem/stringpart.h"
+#include "filesystem/poll.h"
+#include "kernel/heap_counter.h"
 
 using namespace std;
 
@@ -94,6 +96,26 @@ public:
      */
     virtual off_t lseek(off_t pos, int whence);
 
+    /**
+     * Read data at a given position, without changing the file pointer.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pread(void *data, size_t len, off_t pos);
+
+    /**
+     * Write data at a given position, without changing the file pointer.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param pos offset from the beginning of the file
+     * \return the number of written characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pwrite(const void *data, size_t len, off_t pos);
+
     /**
      * Truncate the file
      * \param size new file size
@@ -123,6 +145,14 @@ public:
      */
     virtual int ioctl(int cmd, void *arg);
 
+    /**
+     * Check whether the file is ready for I/O
+     * \param events events the caller is interested in
+     * \param reg registration to add to the device PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    virtual int poll(int events, PollRegistration *reg);
+
 private:
     intrusive_ref_ptr<Device> dev; ///< Device file
     off_t seekPoint;               ///< Seek point (note that off_t is 64bit)
@@ -148,6 +178,26 @@ ssize_t DevFsFile::read(void *data, size_t len)
     return result;
 }
 
+ssize_t DevFsFile::pread(void *data, size_t len, off_t pos)
+{
+    if(flags & _NOSEEK) return -ESPIPE;
+    if((flags & _FREAD)==0) return -EINVAL;
+    if(pos<0) return -EINVAL;
+    if(pos+static_cast<off_t>(len)<0)
+        len=numeric_limits<off_t>::max()-pos-len;
+    return dev->readBlock(data,len,pos);
+}
+
+ssize_t DevFsFile::pwrite(const void *data, size_t len, off_t pos)
+{
+    if(flags & _NOSEEK) return -ESPIPE;
+    if((flags & _FWRITE)==0) return -EINVAL;
+    if(pos<0) return -EINVAL;
+    if(pos+static_cast<off_t>(len)<0)
+        len=numeric_limits<off_t>::max()-pos-len;
+    return dev->writeBlock(data,len,pos);
+}
+
 off_t DevFsFile::lseek(off_t pos, int whence)
 {
     if(flags & _NOSEEK) return -EBADF; //No seek support
@@ -186,6 +236,11 @@ int DevFsFile::ioctl(int cmd, void *arg)
     return dev->ioctl(cmd,arg);
 }
 
+int DevFsFile::poll(int events, PollRegistration *reg)
+{
+    return dev->poll(events,reg);
+}
+
 //
 // class Device
 //
@@ -231,6 +286,11 @@ int Device::ioctl(int cmd, void *arg)
     return -ENOTTY; //Means the operation does not apply to this descriptor
 }
 
+int Device::poll(int events, PollRegistration *reg)
+{
+    return events & (POLLIN | POLLOUT); //Never blocks
+}
+
 Device::~Device() {}
 
 #ifdef WITH_DEVFS
@@ -325,6 +385,9 @@ DevFs::DevFs() : mutex(FastMutex::RECURSIVE), inodeCount(rootDirInode+1)
 {
     addDevice("null",intrusive_ref_ptr<Device>(new Device(Device::STREAM)));
     addDevice("zero",intrusive_ref_ptr<Device>(new Device(Device::STREAM)));
+    #ifdef WITH_HEAP_COUNTER
+    addDevice("heapstat",intrusive_ref_ptr<Device>(new HeapCounterDevice));
+    #endif //WITH_HEAP_COUNTER
 }
 
 bool DevFs::addDevice(const char *name, intrusive_ref_ptr<Device> dev)
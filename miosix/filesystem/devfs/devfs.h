@@ -151,6 +151,21 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     virtual int ioctl(int cmd, void *arg);
+
+    /**
+     * Check whether the device is ready for I/O, used to implement poll() and
+     * select(). Devices whose readBlock() or writeBlock() can block need to
+     * override this member function. If reg is not nullptr, the device must
+     * add it to its PollQueue before checking its state, and wake the queue
+     * every time its state changes, as explained in the PollQueue
+     * documentation.
+     * \param events events the caller is interested in (POLLIN, POLLOUT, ...)
+     * \param reg registration to add to the device PollQueue, or nullptr if
+     * the caller will not wait for state changes
+     * \return the events that are currently ready. The default implementation
+     * reports the device as always readable and writable
+     */
+    virtual int poll(int events, PollRegistration *reg);
     
     /**
      * Destructor
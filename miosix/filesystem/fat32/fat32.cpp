@@ -36,6 +36,7 @@
 #include <string>
 #include <cstdio>
 #include <memory>
+#include <limits>
 #include "filesystem/stringpart.h"
 #include "filesystem/ioctl.h"
 #include "util/unicode.h"
@@ -182,7 +183,7 @@ Fat32Directory::~Fat32Directory()
 /**
  * Files of the Fat32Fs filesystem
  */
-class Fat32File : public FileBase
+class Fat32File : public FileBase, public IntrusiveListItem
 {
 public:
     /**
@@ -220,6 +221,36 @@ public:
      */
     virtual off_t lseek(off_t pos, int whence);
 
+    /**
+     * Read data at a given position, without changing the file pointer.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pread(void *data, size_t len, off_t pos);
+
+    /**
+     * Write data at a given position, without changing the file pointer.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param pos offset from the beginning of the file
+     * \return the number of written characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pwrite(const void *data, size_t len, off_t pos);
+
+    /**
+     * Allocate disk space for the file, contiguously if possible. Space
+     * allocated past the end of the file is released when the file is closed
+     * \param mode 0 or FALLOC_FL_KEEP_SIZE
+     * \param offset start of the range
+     * \param len length of the range
+     * \return 0 on success, or a negative number on failure
+     */
+    virtual int fallocate(int mode, off_t offset, off_t len);
+
     /**
      * Truncate the file
      * \param size new file size
@@ -258,12 +289,50 @@ public:
     ~Fat32File();
     
 private:
+    /**
+     * Enable or disable fast seek. When enabled, a cluster link map of the
+     * file is kept in RAM so that seeking does not need to follow the FAT
+     * chain from the start of the file
+     * \param enable true to enable fast seek, false to disable it
+     * \return 0 on success, or a negative number on failure
+     */
+    int fastSeek(bool enable);
+
+    /**
+     * Rebuild the cluster link map, growing it if it is too small
+     * \return 0 on success, or a negative number on failure
+     */
+    int updateLinkMap();
+
+    /**
+     * Move the FatFs file pointer, using the cluster link map if fast seek
+     * is enabled
+     * \param pos offset from the beginning of the file, must not be past
+     * the end of the file
+     * \return 0 on success, or a negative number on failure
+     */
+    int seek(DWORD pos);
+
     FIL file;
     FastMutex& mutex;
     int inode=0;
     /// Used to map FatFs behavior into POSIX. Variable is 0 as long as we seek
     /// within, contains by how many bytes we seeked past the end otherwise
     off_t seekPastEnd=0;
+    /// Cluster link map used for fast seek, nullptr if fast seek is disabled.
+    /// It is only given to FatFs while seeking, as reads and writes follow
+    /// the FAT chain one cluster at a time anyway
+    unique_ptr<DWORD[]> linkMap;
+    unsigned int linkMapSize=0; ///< Size of linkMap in DWORDs
+    bool linkMapValid=false;    ///< False if the cluster chain changed
+    bool preallocated=false;    ///< True if fallocate() was called
+    /// Write-back mode only, all fields are managed by Fat32Fs
+    bool dirty=false;           ///< True if in Fat32Fs::dirtyFiles
+    unsigned int dirtyBytes=0;  ///< Bytes written since the last sync
+    long long dirtySince=0;     ///< Time of the first write since last sync
+    int syncError=0;            ///< Error of a background sync, if any
+
+    friend class Fat32Fs;
 };
 
 //
@@ -277,6 +346,8 @@ ssize_t Fat32File::write(const void *data, size_t len)
 {
     Lock<FastMutex> l(mutex);
     unsigned int bytesWritten;
+    //Growing the file may append clusters to the chain
+    if(seekPastEnd>0 || f_tell(&file)+len>f_size(&file)) linkMapValid=false;
     //NOTE: if we lseek'd past the end, we f_lseek'd to the end and seekPastEnd
     //is >0. We need to handle this special case by filling the gap with zeros
     //Note that in this case write should not return the number of bytes written
@@ -300,9 +371,18 @@ ssize_t Fat32File::write(const void *data, size_t len)
         }
     }
     if(int res=translateError(f_write(&file,data,len,&bytesWritten))) return res;
-    #ifdef SYNC_AFTER_WRITE
-    if(f_sync(&file)!=FR_OK) return -EIO;
-    #endif //SYNC_AFTER_WRITE    
+    auto fs=static_cast<Fat32Fs*>(getParent().get());
+    switch(fs->options.sync)
+    {
+        case Fat32Sync::ALWAYS:
+            if(f_sync(&file)!=FR_OK) return -EIO;
+            break;
+        case Fat32Sync::WRITE_BACK:
+            fs->markDirty(this,bytesWritten);
+            break;
+        case Fat32Sync::ON_CLOSE:
+            break;
+    }
     return static_cast<int>(bytesWritten);
 }
 
@@ -349,11 +429,63 @@ off_t Fat32File::lseek(off_t pos, int whence)
         seekPastEnd=offset-fileSize;
         offset=fileSize;
     } else seekPastEnd=0;
-    if(int result=translateError(
-        f_lseek(&file,static_cast<unsigned long>(offset)))) return result;
+    if(int result=seek(static_cast<DWORD>(offset))) return result;
     return offset+seekPastEnd;
 }
 
+ssize_t Fat32File::pread(void *data, size_t len, off_t pos)
+{
+    if(pos<0) return -EINVAL;
+    Lock<FastMutex> l(mutex);
+    if(pos>=static_cast<off_t>(f_size(&file))) return 0;
+    //FatFs has a single file pointer, so move it and restore it afterwards
+    //while holding the lock. seekPastEnd is not touched, as we never seek
+    //past the end here
+    DWORD curPos=f_tell(&file);
+    if(int res=seek(static_cast<DWORD>(pos))) return res;
+    unsigned int bytesRead;
+    int res=translateError(f_read(&file,data,len,&bytesRead));
+    int res2=seek(curPos);
+    if(res) return res;
+    if(res2) return res2;
+    return static_cast<int>(bytesRead);
+}
+
+ssize_t Fat32File::pwrite(const void *data, size_t len, off_t pos)
+{
+    if(pos<0) return -EINVAL;
+    Lock<FastMutex> l(mutex);
+    //Reuse lseek() and write() which handle writing past the end, the mutex
+    //is recursive
+    off_t curPos=static_cast<off_t>(f_tell(&file))+seekPastEnd;
+    off_t r=lseek(pos,SEEK_SET);
+    if(r<0) return r;
+    ssize_t result=write(data,len);
+    r=lseek(curPos,SEEK_SET);
+    if(r<0) return r;
+    return result;
+}
+
+int Fat32File::fallocate(int mode, off_t offset, off_t len)
+{
+    Lock<FastMutex> l(mutex);
+    if((file.flag & FA_WRITE)==0) return -EBADF;
+    if(offset>0xffffffff || len>0xffffffff-offset) return -EFBIG;
+    off_t size=offset+len;
+    //Allocate clusters up front, so that writes up to size only need to
+    //follow the cluster chain instead of updating the FAT
+    FRESULT res=f_expand(&file,static_cast<DWORD>(size));
+    linkMapValid=false;
+    preallocated=true;
+    if(res==FR_DENIED) return -ENOSPC;
+    if(res!=FR_OK) return translateError(res);
+    if((mode & FALLOC_FL_KEEP_SIZE) || size<=static_cast<off_t>(f_size(&file)))
+        return 0;
+    //POSIX requires the file to grow, reading zeros. Fill the preallocated
+    //clusters, the mutex is recursive
+    return ftruncate(size);
+}
+
 int Fat32File::ftruncate(off_t size)
 {
     Lock<FastMutex> l(mutex);
@@ -365,9 +497,10 @@ int Fat32File::ftruncate(off_t size)
     if(size<fileSize)
     {
         //Shrinking, FatFs f_truncate truncates to the current file position
-        int r=translateError(f_lseek(&file,static_cast<unsigned long>(size)));
+        int r=seek(static_cast<DWORD>(size));
         if(r) return r;
         result=translateError(f_truncate(&file));
+        linkMapValid=false;
     } else {
         //Enlarging, can't use f_truncate so seek past the end an write
         off_t r=lseek(size,SEEK_SET);
@@ -395,26 +528,116 @@ int Fat32File::fstat(struct stat *pstat) const
 
 int Fat32File::ioctl(int cmd, void *arg)
 {
-    if(cmd!=IOCTL_SYNC) return -ENOTTY;
     Lock<FastMutex> l(mutex);
-    return translateError(f_sync(&file));
+    switch(cmd)
+    {
+        case IOCTL_SYNC:
+        case IOCTL_DATASYNC:
+        {
+            static_cast<Fat32Fs*>(getParent().get())->markClean(this);
+            FRESULT res=cmd==IOCTL_SYNC ? f_sync(&file) : f_datasync(&file);
+            if(res!=FR_OK) return translateError(res);
+            //Report errors of background syncs, once
+            int result=syncError;
+            syncError=0;
+            return result;
+        }
+        case IOCTL_FAST_SEEK:
+            if(arg==nullptr) return -EFAULT;
+            return fastSeek(*reinterpret_cast<int*>(arg)!=0);
+        default:
+            return -ENOTTY;
+    }
+}
+
+int Fat32File::fastSeek(bool enable)
+{
+    if(enable==false)
+    {
+        linkMap.reset();
+        linkMapSize=0;
+        linkMapValid=false;
+        return 0;
+    }
+    if(!linkMap)
+    {
+        //Enough for a file made of up to 7 fragments, grown on demand
+        const unsigned int initialSize=16;
+        linkMap.reset(new (nothrow) DWORD[initialSize]);
+        if(!linkMap) return -ENOMEM;
+        linkMapSize=initialSize;
+    }
+    linkMapValid=false;
+    //Build the map immediately to report errors to the caller
+    int result=updateLinkMap();
+    if(result) fastSeek(false);
+    return result;
+}
+
+int Fat32File::updateLinkMap()
+{
+    for(;;)
+    {
+        linkMap[0]=linkMapSize;
+        file.cltbl=linkMap.get();
+        FRESULT res=f_lseek(&file,CREATE_LINKMAP);
+        file.cltbl=nullptr;
+        if(res==FR_OK) break;
+        if(res!=FR_NOT_ENOUGH_CORE) return translateError(res);
+        //FatFs reports the required size in the first element, leave some
+        //room for the file to grow before reallocating again
+        unsigned int newSize=linkMap[0]+8;
+        linkMap.reset(new (nothrow) DWORD[newSize]);
+        if(!linkMap)
+        {
+            linkMapSize=0;
+            return -ENOMEM;
+        }
+        linkMapSize=newSize;
+    }
+    linkMapValid=true;
+    return 0;
+}
+
+int Fat32File::seek(DWORD pos)
+{
+    //If the map can't be rebuilt, fall back to following the FAT chain
+    if(linkMap && (linkMapValid || updateLinkMap()==0))
+    {
+        file.cltbl=linkMap.get();
+        FRESULT res=f_lseek(&file,pos);
+        file.cltbl=nullptr;
+        return translateError(res);
+    }
+    return translateError(f_lseek(&file,pos));
 }
 
 Fat32File::~Fat32File()
 {
     Lock<FastMutex> l(mutex);
-    if(inode) f_close(&file); //TODO: what to do with error code?
+    static_cast<Fat32Fs*>(getParent().get())->markClean(this);
+    if(inode)
+    {
+        //Release clusters preallocated by fallocate() but not written
+        if(preallocated) f_trim(&file);
+        f_close(&file); //TODO: what to do with error code?
+    }
 }
 
 //
 // class Fat32Fs
 //
 
-Fat32Fs::Fat32Fs(intrusive_ref_ptr<FileBase> disk)
-        : mutex(FastMutex::RECURSIVE), failed(true)
+Fat32Fs::Fat32Fs(intrusive_ref_ptr<FileBase> disk, const Fat32Options& options)
+        : mutex(FastMutex::RECURSIVE), failed(true), options(options)
 {
     filesystem.drv=disk;
     failed=f_mount(&filesystem,1,false)!=FR_OK;
+    if(failed || options.sync!=Fat32Sync::WRITE_BACK) return;
+    flusherThread=Thread::create(flusherLauncher,STACK_DEFAULT_FOR_PTHREAD,
+                                 MAIN_PRIORITY,this,Thread::JOINABLE);
+    //Without the thread fall back to syncing after every write
+    if(flusherThread==nullptr) this->options.sync=Fat32Sync::ALWAYS;
 }
 
 int Fat32Fs::open(intrusive_ref_ptr<FileBase>& file, StringPart& name,
@@ -460,9 +683,8 @@ int Fat32Fs::open(intrusive_ref_ptr<FileBase>& file, StringPart& name,
         }
         f->setInode(st.st_ino);
 
-        #ifdef SYNC_AFTER_WRITE
-        if(f_sync(f->fil())!=FR_OK) return -EFAULT;
-        #endif //SYNC_AFTER_WRITE
+        if(options.sync==Fat32Sync::ALWAYS)
+            if(f_sync(f->fil())!=FR_OK) return -EFAULT;
 
         //If file opened for appending, seek to end of file
         if(flags & _FAPPEND)
@@ -476,7 +698,7 @@ int Fat32Fs::open(intrusive_ref_ptr<FileBase>& file, StringPart& name,
         int parentInode;
         if(name.empty()==false)
         {
-            unsigned int lastSlash=name.findLastOf('/');
+            size_t lastSlash=name.findLastOf('/');
             if(lastSlash!=string::npos)
             {
                 StringPart parent(name,lastSlash);
@@ -565,11 +787,85 @@ int Fat32Fs::rmdir(StringPart& name)
 Fat32Fs::~Fat32Fs()
 {
     if(failed) return;
+    if(flusherThread)
+    {
+        {
+            Lock<FastMutex> l(mutex);
+            quit=true;
+            flusherCv.signal();
+        }
+        flusherThread->join();
+    }
     f_mount(&filesystem,0,true); //TODO: what to do with error code?
     filesystem.drv->ioctl(IOCTL_SYNC,0);
     filesystem.drv.reset();
 }
 
+void Fat32Fs::markDirty(Fat32File *file, unsigned int len)
+{
+    if(file->dirty==false)
+    {
+        file->dirty=true;
+        file->dirtyBytes=0;
+        file->dirtySince=getTime();
+        if(dirtyFiles.empty()) flusherCv.signal(); //Flusher waits for a file
+        dirtyFiles.push_back(file);
+    }
+    unsigned int before=file->dirtyBytes;
+    file->dirtyBytes+=len;
+    //Wake the flusher only once when crossing the threshold
+    if(before<options.writebackBytes && file->dirtyBytes>=options.writebackBytes)
+        flusherCv.signal();
+}
+
+void Fat32Fs::markClean(Fat32File *file)
+{
+    if(file->dirty==false) return;
+    dirtyFiles.removeFast(file);
+    file->dirty=false;
+}
+
+void *Fat32Fs::flusherLauncher(void *arg)
+{
+    reinterpret_cast<Fat32Fs*>(arg)->flusher();
+    return nullptr;
+}
+
+void Fat32Fs::flusher()
+{
+    const long long delay=options.writebackMs*1000000LL;
+    Lock<FastMutex> l(mutex);
+    while(quit==false)
+    {
+        if(dirtyFiles.empty())
+        {
+            flusherCv.wait(l);
+            continue;
+        }
+        //Sync the files that reached a threshold, and wait for the others
+        long long now=getTime();
+        long long wakeup=numeric_limits<long long>::max();
+        for(auto it=dirtyFiles.begin();it!=dirtyFiles.end();)
+        {
+            Fat32File *f=*it;
+            long long deadline=f->dirtySince+delay;
+            if(now<deadline && f->dirtyBytes<options.writebackBytes)
+            {
+                wakeup=min(wakeup,deadline);
+                ++it;
+                continue;
+            }
+            it=dirtyFiles.erase(it);
+            f->dirty=false;
+            //Nobody is waiting for this sync, the error is reported by the
+            //next fsync() on the file
+            if(int res=translateError(f_sync(f->fil()))) f->syncError=res;
+        }
+        if(wakeup!=numeric_limits<long long>::max())
+            flusherCv.timedWait(l,wakeup);
+    }
+}
+
 int Fat32Fs::unlinkRmdirHelper(StringPart& name, bool delDir)
 {
     if(failed) return -ENOENT;
@@ -37,6 +37,32 @@ namespace miosix {
     
 #ifdef WITH_FILESYSTEM
 
+class Fat32File;
+
+/**
+ * When data written to files is synced to the disk
+ */
+enum class Fat32Sync
+{
+    ALWAYS,     ///< After every write, slow but safe
+    WRITE_BACK, ///< By a background thread, after a time or byte threshold
+    ON_CLOSE    ///< Only on fsync() and close()
+};
+
+/**
+ * Mount options of Fat32Fs
+ */
+struct Fat32Options
+{
+    #ifdef SYNC_AFTER_WRITE
+    Fat32Sync sync=Fat32Sync::ALWAYS;                   ///< Sync policy
+    #else //SYNC_AFTER_WRITE
+    Fat32Sync sync=Fat32Sync::WRITE_BACK;               ///< Sync policy
+    #endif //SYNC_AFTER_WRITE
+    unsigned int writebackMs=FATFS_WRITEBACK_MS;        ///< Write-back delay
+    unsigned int writebackBytes=FATFS_WRITEBACK_BYTES;  ///< Write-back size
+};
+
 /**
  * Fat32 Filesystem.
  */
@@ -45,8 +71,11 @@ class Fat32Fs : public FilesystemBase
 public:
     /**
      * Constructor
+     * \param disk block device to mount
+     * \param options mount options
      */
-    Fat32Fs(intrusive_ref_ptr<FileBase> disk);
+    Fat32Fs(intrusive_ref_ptr<FileBase> disk,
+            const Fat32Options& options=Fat32Options());
     
     /**
      * Open a file
@@ -120,10 +149,38 @@ public:
 private:
     
     int unlinkRmdirHelper(StringPart& name, bool delDir);
+
+    /**
+     * Called by Fat32File after a write in write-back mode, with the mutex
+     * locked, to schedule a sync of the file
+     * \param file file that was written
+     * \param len number of bytes written
+     */
+    void markDirty(Fat32File *file, unsigned int len);
+
+    /**
+     * Called by Fat32File with the mutex locked when the file is synced or
+     * closed, to cancel the scheduled sync
+     * \param file file that no longer needs to be synced
+     */
+    void markClean(Fat32File *file);
+
+    /**
+     * Entry point of the thread that syncs files in write-back mode
+     */
+    static void *flusherLauncher(void *arg);
+    void flusher();
     
     FATFS filesystem;
     FastMutex mutex;
     bool failed; ///< Failed to mount
+    Fat32Options options;
+    IntrusiveList<Fat32File> dirtyFiles; ///< Files waiting to be synced
+    ConditionVariable flusherCv;
+    Thread *flusherThread=nullptr;
+    bool quit=false; ///< Tells the flusher thread to terminate
+
+    friend class Fat32File;
 };
 
 #endif //WITH_FILESYSTEM
@@ -617,7 +617,7 @@ static
 int chk_chr (const char* str, int chr) {
 	//while (*str && *str != chr) str++;
 	//return *str;
-    char *result=strchr(str,chr);
+    const char *result=strchr(str,chr);
     if(result) return *result;
     else return 0;
 }
@@ -2815,6 +2815,50 @@ FRESULT f_sync (
 	LEAVE_FF(fp->fs, res);
 }
 
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Synchronize the File Data                                             */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_datasync (
+	FIL* fp		/* Pointer to the file object */
+)
+{
+	FRESULT res;
+	BYTE *dir;
+
+
+	res = validate(fp);					/* Check validity of the object */
+	if (res == FR_OK) {
+		if (fp->flag & FA__WRITTEN) {	/* Has the file been written? */
+			/* Write-back dirty buffer */
+#if !_FS_TINY
+			if (fp->flag & FA__DIRTY) {
+				if (disk_write(fp->fs->drv, fp->buf, fp->dsect, 1))
+					LEAVE_FF(fp->fs, FR_DISK_ERR);
+				fp->flag &= ~FA__DIRTY;
+			}
+#endif
+			/* Update the directory entry only if needed to read back the
+			   data, leave the modification time to f_sync() */
+			res = move_window(fp->fs, fp->dir_sect);
+			if (res == FR_OK) {
+				dir = fp->dir_ptr;
+				if (LD_DWORD(dir+DIR_FileSize) != fp->fsize || ld_clust(fp->fs, dir) != fp->sclust) {
+					ST_DWORD(dir+DIR_FileSize, fp->fsize);	/* Update file size */
+					st_clust(dir, fp->sclust);				/* Update start cluster */
+					fp->fs->wflag = 1;
+				}
+				res = sync_fs(fp->fs);
+			}
+		}
+	}
+
+	LEAVE_FF(fp->fs, res);
+}
+
 #endif /* !_FS_READONLY */
 
 
@@ -3449,6 +3493,147 @@ FRESULT f_truncate (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Allocate a Contiguous Block to the File                               */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_expand (
+	FIL* fp,		/* Pointer to the file object */
+	DWORD fsz		/* Number of bytes the cluster chain shall hold */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD bcs, tcl, ncl, clst, lclst, nxt, scl, stcl, n;
+
+
+	res = validate(fp);						/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->err)							/* Check error */
+		LEAVE_FF(fp->fs, (FRESULT)fp->err);
+	if (!(fp->flag & FA_WRITE))				/* Check access mode */
+		LEAVE_FF(fp->fs, FR_DENIED);
+	fs = fp->fs;
+	bcs = (DWORD)fs->csize * SS(fs);		/* Cluster size */
+	tcl = fsz / bcs + (fsz % bcs != 0);		/* Number of clusters required */
+
+	/* Follow the existing chain to its last cluster */
+	ncl = 0; lclst = 0;
+	for (clst = fp->sclust; clst && ncl < tcl; clst = nxt) {
+		ncl++; lclst = clst;
+		nxt = get_fat(fs, clst);
+		if (nxt == 1) ABORT(fs, FR_INT_ERR);
+		if (nxt == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		if (nxt >= fs->n_fatent) break;		/* End of chain */
+	}
+	if (ncl >= tcl) LEAVE_FF(fs, FR_OK);	/* Already allocated */
+	tcl -= ncl;
+
+	/* Find a free contiguous block, preferably right after the chain */
+	stcl = lclst ? lclst : fs->last_clust;
+	if (stcl < 2 || stcl + 1 >= fs->n_fatent) stcl = 1;
+	clst = scl = stcl + 1; n = 0;
+	for (;;) {
+		nxt = get_fat(fs, clst);
+		if (nxt == 1) ABORT(fs, FR_INT_ERR);
+		if (nxt == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		if (nxt == 0) {						/* Free cluster */
+			if (++n == tcl) break;			/* Found a large enough block */
+		} else {
+			scl = clst + 1; n = 0;			/* Restart after this cluster */
+		}
+		if (++clst >= fs->n_fatent) {		/* Wrap around, blocks can't */
+			clst = scl = 2; n = 0;
+		}
+		if (clst == stcl + 1) break;		/* No block found */
+	}
+
+	if (n < tcl) {	/* Too fragmented, allocate one cluster at a time */
+		for (; tcl; tcl--) {
+			clst = create_chain(fs, lclst);
+			if (clst == 0) LEAVE_FF(fs, FR_DENIED);	/* Disk full */
+			if (clst == 1) ABORT(fs, FR_INT_ERR);
+			if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+			if (!lclst) {
+				fp->sclust = clst;
+				fp->flag |= FA__WRITTEN;
+			}
+			lclst = clst;
+		}
+		LEAVE_FF(fs, FR_OK);
+	}
+
+	/* Create the chain and link it to the file */
+	for (clst = scl, n = tcl; n; clst++, n--) {
+		res = put_fat(fs, clst, (n == 1) ? 0x0FFFFFFF : clst + 1);
+		if (res != FR_OK) ABORT(fs, res);
+	}
+	if (lclst) {
+		res = put_fat(fs, lclst, scl);
+		if (res != FR_OK) ABORT(fs, res);
+	} else {
+		fp->sclust = scl;					/* New chain, update the directory entry */
+		fp->flag |= FA__WRITTEN;
+	}
+	fs->last_clust = scl + tcl - 1;			/* Update FSINFO */
+	if (fs->free_clust != 0xFFFFFFFF) {
+		fs->free_clust -= tcl;
+		fs->fsi_flag |= 1;
+	}
+
+	LEAVE_FF(fs, FR_OK);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Release the Clusters Past the End of the File                         */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_trim (
+	FIL* fp		/* Pointer to the file object */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD bcs, tcl, clst, nxt;
+
+
+	res = validate(fp);						/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->err)							/* Check error */
+		LEAVE_FF(fp->fs, (FRESULT)fp->err);
+	if (!(fp->flag & FA_WRITE))				/* Check access mode */
+		LEAVE_FF(fp->fs, FR_DENIED);
+	fs = fp->fs;
+	if (!fp->sclust) LEAVE_FF(fs, FR_OK);	/* No cluster chain */
+	bcs = (DWORD)fs->csize * SS(fs);		/* Cluster size */
+	tcl = fp->fsize / bcs + (fp->fsize % bcs != 0);	/* Clusters in use */
+	if (tcl == 0) {							/* Empty file, remove the entire chain */
+		res = remove_chain(fs, fp->sclust);
+		fp->sclust = 0;
+		fp->flag |= FA__WRITTEN;
+		if (res != FR_OK) ABORT(fs, res);
+		LEAVE_FF(fs, FR_OK);
+	}
+	for (clst = fp->sclust; ; clst = nxt) {	/* Find the last cluster in use */
+		nxt = get_fat(fs, clst);
+		if (nxt == 1) ABORT(fs, FR_INT_ERR);
+		if (nxt == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		if (nxt >= fs->n_fatent) LEAVE_FF(fs, FR_OK);	/* Nothing past the end */
+		if (--tcl == 0) break;
+	}
+	res = put_fat(fs, clst, 0x0FFFFFFF);
+	if (res == FR_OK) res = remove_chain(fs, nxt);
+	if (res != FR_OK) ABORT(fs, res);
+
+	LEAVE_FF(fs, FR_OK);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Delete a File or Directory                                            */
 /*-----------------------------------------------------------------------*/
@@ -253,7 +253,10 @@ FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data t
 FRESULT f_forward (FIL* fp, UINT(*func)(const BYTE*,UINT), UINT btf, UINT* bf);	/* Forward data to the stream */
 FRESULT f_lseek (FIL* fp, DWORD ofs);								/* Move file pointer of a file object */
 FRESULT f_truncate (FIL* fp);										/* Truncate file */
+FRESULT f_expand (FIL* fp, DWORD fsz);								/* Allocate a contiguous block to the file */
+FRESULT f_trim (FIL* fp);											/* Release the clusters past the end of the file */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
+FRESULT f_datasync (FIL* fp);										/* Flush cached data, without updating the modification time */
 FRESULT f_opendir (FATFS *fs, DIR_* dp, const /*TCHAR*/char *path);						/* Open a directory */
 FRESULT f_closedir (DIR_* dp);										/* Close an open directory */
 FRESULT f_readdir (DIR_* dp, FILINFO* fno);							/* Read a directory item */
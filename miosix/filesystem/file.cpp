@@ -30,6 +30,7 @@
 #include <string>
 #include <fcntl.h>
 #include "file_access.h"
+#include "poll.h"
 #include "config/miosix_settings.h"
 
 using namespace std;
@@ -43,6 +44,11 @@ static_assert(sizeof(off_t)==8,"");
 // class FileBase
 //
 
+int FileBase::poll(int events, PollRegistration *reg)
+{
+    return events & (POLLIN | POLLOUT); //Never blocks
+}
+
 #ifdef WITH_FILESYSTEM
 
 FileBase::FileBase(intrusive_ref_ptr<FilesystemBase> parent, int flags)
@@ -61,6 +67,21 @@ int FileBase::isatty() const
     return 0;
 }
 
+ssize_t FileBase::pread(void *data, size_t len, off_t pos)
+{
+    return -ESPIPE; //Means the file is not seekable
+}
+
+ssize_t FileBase::pwrite(const void *data, size_t len, off_t pos)
+{
+    return -ESPIPE; //Means the file is not seekable
+}
+
+int FileBase::fallocate(int mode, off_t offset, off_t len)
+{
+    return -EOPNOTSUPP;
+}
+
 int FileBase::fcntl(int cmd, int opt)
 {
     switch(cmd)
@@ -33,11 +33,16 @@
 
 #pragma once
 
+#ifndef FALLOC_FL_KEEP_SIZE
+#define FALLOC_FL_KEEP_SIZE 0x01 //Same value as Linux, for fallocate()
+#endif //FALLOC_FL_KEEP_SIZE
+
 namespace miosix {
 
 // Forward decls
 class FilesystemBase;
 class StringPart;
+class PollRegistration;
 
 /**
  * Return value of FileBase::getFileFromMemory()
@@ -113,6 +118,21 @@ public:
      * of errors
      */
     virtual ssize_t read(void *data, size_t len)=0;
+
+    /**
+     * Check whether the file is ready for I/O, used to implement poll() and
+     * select(). Files whose read() or write() can block need to override this
+     * member function. If reg is not nullptr, the file must add it to its
+     * PollQueue before checking its state, and wake the queue every time its
+     * state changes, as explained in the PollQueue documentation.
+     * \param events events the caller is interested in (POLLIN, POLLOUT, ...)
+     * \param reg registration to add to the file PollQueue, or nullptr if the
+     * caller will not wait for state changes
+     * \return the events that are currently ready, which may include POLLERR
+     * and POLLHUP even if not requested. The default implementation reports
+     * the file as always readable and writable
+     */
+    virtual int poll(int events, PollRegistration *reg);
     
     #ifdef WITH_FILESYSTEM
     
@@ -125,6 +145,44 @@ public:
      * completed, or a negative number in case of errors
      */
     virtual off_t lseek(off_t pos, int whence)=0;
+
+    /**
+     * Read data at a given position, without using or changing the file
+     * pointer. Filesystem code should prefer it to an lseek() followed by a
+     * read() when accessing block devices.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file, must not be negative
+     * \return the number of read characters, or a negative number in case
+     * of errors. The default implementation returns -ESPIPE, as for files that
+     * are not seekable
+     */
+    virtual ssize_t pread(void *data, size_t len, off_t pos);
+
+    /**
+     * Write data at a given position, without using or changing the file
+     * pointer.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param pos offset from the beginning of the file, must not be negative
+     * \return the number of written characters, or a negative number in case
+     * of errors. The default implementation returns -ESPIPE, as for files that
+     * are not seekable
+     */
+    virtual ssize_t pwrite(const void *data, size_t len, off_t pos);
+
+    /**
+     * Allocate disk space for the file, so that writes in the given range do
+     * not fail for lack of space nor need to allocate space on the disk
+     * \param mode 0 to extend the file size to offset+len if it is smaller,
+     * filling the gap with zeros, or FALLOC_FL_KEEP_SIZE to only allocate the
+     * space without changing the file size
+     * \param offset start of the range, must not be negative
+     * \param len length of the range, must be greater than zero
+     * \return 0 on success, or a negative number on failure. The default
+     * implementation returns -EOPNOTSUPP
+     */
+    virtual int fallocate(int mode, off_t offset, off_t len);
     
     /**
      * Truncate the file
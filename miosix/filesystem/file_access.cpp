@@ -35,6 +35,7 @@
 #include "fat32/fat32.h"
 #include "littlefs/lfs_miosix.h"
 #include "pipe/pipe.h"
+#include "blockcache/block_cache.h"
 #include "kernel/logging.h"
 #ifdef WITH_PROCESSES
 #include "kernel/process.h"
@@ -140,6 +141,66 @@ void FileDescriptorTable::closeAll()
         atomic_exchange(files+i,intrusive_ref_ptr<FileBase>());
 }
 
+/**
+ * \internal
+ * Validate the buffers passed to preadv() and pwritev()
+ * \return 0 if they are valid, or a negative number
+ */
+static int validateIovec(const struct iovec *iov, int iovcnt)
+{
+    if(iovcnt<0 || iovcnt>IOV_MAX) return -EINVAL;
+    if(iovcnt>0 && iov==nullptr) return -EFAULT;
+    //The total size must fit in the return value
+    size_t total=0;
+    for(int i=0;i<iovcnt;i++)
+    {
+        if(iov[i].iov_len==0) continue;
+        if(iov[i].iov_base==nullptr) return -EFAULT;
+        total+=iov[i].iov_len;
+        if(static_cast<ssize_t>(total)<0 || total<iov[i].iov_len) return -EINVAL;
+    }
+    return 0;
+}
+
+ssize_t FileDescriptorTable::preadv(int fd, const struct iovec *iov,
+        int iovcnt, off_t pos)
+{
+    if(int result=validateIovec(iov,iovcnt)) return result;
+    if(pos<0) return -EINVAL;
+    intrusive_ref_ptr<FileBase> file=getFile(fd);
+    if(!file) return -EBADF;
+    ssize_t total=0;
+    for(int i=0;i<iovcnt;i++)
+    {
+        if(iov[i].iov_len==0) continue;
+        ssize_t result=file->pread(iov[i].iov_base,iov[i].iov_len,pos+total);
+        if(result<0) return total>0 ? total : result;
+        total+=result;
+        //Stop at end of file
+        if(static_cast<size_t>(result)<iov[i].iov_len) break;
+    }
+    return total;
+}
+
+ssize_t FileDescriptorTable::pwritev(int fd, const struct iovec *iov,
+        int iovcnt, off_t pos)
+{
+    if(int result=validateIovec(iov,iovcnt)) return result;
+    if(pos<0) return -EINVAL;
+    intrusive_ref_ptr<FileBase> file=getFile(fd);
+    if(!file) return -EBADF;
+    ssize_t total=0;
+    for(int i=0;i<iovcnt;i++)
+    {
+        if(iov[i].iov_len==0) continue;
+        ssize_t result=file->pwrite(iov[i].iov_base,iov[i].iov_len,pos+total);
+        if(result<0) return total>0 ? total : result;
+        total+=result;
+        if(static_cast<size_t>(result)<iov[i].iov_len) break;
+    }
+    return total;
+}
+
 int FileDescriptorTable::fcntl(int fd, int cmd, int opt)
 {
     intrusive_ref_ptr<FileBase> file=getFile(fd);
@@ -304,14 +365,27 @@ int FileDescriptorTable::pipe(int fds[2])
         }
     }
     if(availableFds<2) return -EMFILE;
-    intrusive_ref_ptr<FileBase> pipe(new Pipe);
-    files[fds[0]]=pipe;
-    files[fds[1]]=pipe;
+    intrusive_ref_ptr<PipeBuffer> buffer(new PipeBuffer);
+    intrusive_ref_ptr<FileBase> readEnd(new Pipe(buffer,O_RDONLY));
+    intrusive_ref_ptr<FileBase> writeEnd(new Pipe(buffer,O_WRONLY));
+    files[fds[0]]=readEnd;
+    files[fds[1]]=writeEnd;
     filesCloexec[fds[0]]=false;
     filesCloexec[fds[1]]=false;
     return 0;
 }
 
+int FileDescriptorTable::poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if(nfds>MAX_OPEN_FILES) return -EINVAL;
+    if(fds==nullptr && nfds>0) return -EFAULT;
+    //Hold a reference to the files for the whole call, so that a concurrent
+    //close() can't delete a file while we are registered in its PollQueue
+    intrusive_ref_ptr<FileBase> polled[MAX_OPEN_FILES];
+    for(nfds_t i=0;i<nfds;i++) polled[i]=getFile(fds[i].fd);
+    return pollFiles(fds,polled,nfds,timeout);
+}
+
 int FileDescriptorTable::statImpl(const char* name, struct stat* pstat, bool f)
 {
     if(name==0 || name[0]=='\0' || pstat==0) return -EFAULT;
@@ -320,6 +394,15 @@ int FileDescriptorTable::statImpl(const char* name, struct stat* pstat, bool f)
     return FilesystemManager::instance().statHelper(path,pstat,f);
 }
 
+int FileDescriptorTable::syncHelper(int fd, int cmd)
+{
+    intrusive_ref_ptr<FileBase> file=getFile(fd);
+    if(!file) return -EBADF;
+    int result=file->ioctl(cmd,nullptr);
+    //Files that can't be synced, such as pipes, report EINVAL like in Linux
+    return result==-ENOTTY ? -EINVAL : result;
+}
+
 string FileDescriptorTable::absolutePath(const char* path)
 {
     size_t len=strlen(path);
@@ -884,6 +967,11 @@ basicFilesystemSetup(intrusive_ref_ptr<Device> dev)
 
     if(dev)
     {
+        #ifdef WITH_BLOCK_CACHE
+        //Filesystems and /dev/sda only see the cached device, so that no one
+        //can bypass dirty blocks in the cache
+        dev=intrusive_ref_ptr<Device>(new BlockCache(dev));
+        #endif //WITH_BLOCK_CACHE
         #ifdef WITH_DEVFS
         #define TRY_MOUNT(x) if (tryMount<x>(#x, dev, rootFs, devfs)) return devfs
         #else
@@ -35,11 +35,38 @@
 #include <sys/stat.h>
 #include "file.h"
 #include "stringpart.h"
+#include "ioctl.h"
+#include "poll.h"
 #include "devfs/devfs.h"
 #include "kernel/sync.h"
 #include "kernel/intrusive.h"
 #include "config/miosix_settings.h"
 
+//Newlib does not provide sys/uio.h, if it is missing declare the subset of it
+//that is needed by preadv() and pwritev()
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#else //__has_include(<sys/uio.h>)
+struct iovec
+{
+    void *iov_base; ///< Buffer
+    size_t iov_len; ///< Buffer size
+};
+extern "C" {
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t pos);
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t pos);
+}
+#endif //__has_include(<sys/uio.h>)
+#ifndef IOV_MAX
+#define IOV_MAX 16 //Minimum value allowed by POSIX
+#endif //IOV_MAX
+
+//Newlib does not declare posix_fallocate() and the Linux-specific fallocate()
+extern "C" {
+int posix_fallocate(int fd, off_t offset, off_t len);
+int fallocate(int fd, int mode, off_t offset, off_t len);
+}
+
 #ifdef WITH_FILESYSTEM
 
 namespace miosix {
@@ -181,6 +208,62 @@ public:
         if(!file) return -EBADF;
         return file->lseek(pos,whence);
     }
+
+    /**
+     * Read data at a given position, without changing the file pointer.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in case
+     * of errors
+     */
+    ssize_t pread(int fd, void *data, size_t len, off_t pos)
+    {
+        if(data==0) return -EFAULT;
+        if(static_cast<ssize_t>(len)<0 || pos<0) return -EINVAL;
+        intrusive_ref_ptr<FileBase> file=getFile(fd);
+        if(!file) return -EBADF;
+        return file->pread(data,len,pos);
+    }
+
+    /**
+     * Write data at a given position, without changing the file pointer.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param pos offset from the beginning of the file
+     * \return the number of written characters, or a negative number in case
+     * of errors
+     */
+    ssize_t pwrite(int fd, const void *data, size_t len, off_t pos)
+    {
+        if(data==0) return -EFAULT;
+        if(static_cast<ssize_t>(len)<0 || pos<0) return -EINVAL;
+        intrusive_ref_ptr<FileBase> file=getFile(fd);
+        if(!file) return -EBADF;
+        return file->pwrite(data,len,pos);
+    }
+
+    /**
+     * Read data at a given position into multiple buffers, without changing
+     * the file pointer.
+     * \param iov buffers to store read data
+     * \param iovcnt number of buffers, at most IOV_MAX
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in case
+     * of errors
+     */
+    ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t pos);
+
+    /**
+     * Write data at a given position from multiple buffers, without changing
+     * the file pointer.
+     * \param iov buffers with the data to write
+     * \param iovcnt number of buffers, at most IOV_MAX
+     * \param pos offset from the beginning of the file
+     * \return the number of written characters, or a negative number in case
+     * of errors
+     */
+    ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t pos);
     
     /**
      * Return file information.
@@ -262,7 +345,7 @@ public:
     int getdents(int fd, void *dp, int len)
     {
         if(dp==0) return -EFAULT;
-        if(reinterpret_cast<unsigned>(dp) & 0x3) return -EFAULT; //Not aligned
+        if(reinterpret_cast<uintptr_t>(dp) & 0x3) return -EFAULT; //Not aligned
         intrusive_ref_ptr<FileBase> file=getFile(fd);
         if(!file) return -EBADF;
         return file->getdents(dp,len);
@@ -335,6 +418,45 @@ public:
         if(!file) return -EBADF;
         return file->ftruncate(size);
     }
+
+    /**
+     * Synchronize a file with the storage device
+     * \param fd file descriptor
+     * \return 0 on success, or a negative number on failure
+     */
+    int fsync(int fd) { return syncHelper(fd,IOCTL_SYNC); }
+
+    /**
+     * Synchronize the data of a file with the storage device, metadata not
+     * needed to read back the data, such as the modification time, may not be
+     * synchronized
+     * \param fd file descriptor
+     * \return 0 on success, or a negative number on failure
+     */
+    int fdatasync(int fd)
+    {
+        int result=syncHelper(fd,IOCTL_DATASYNC);
+        //Files that don't distinguish the two cases only support IOCTL_SYNC
+        if(result==-EINVAL) result=syncHelper(fd,IOCTL_SYNC);
+        return result;
+    }
+
+    /**
+     * Allocate disk space for a file
+     * \param fd file descriptor
+     * \param mode 0 or FALLOC_FL_KEEP_SIZE, see FileBase::fallocate()
+     * \param offset start of the range to allocate
+     * \param len length of the range to allocate
+     * \return 0 on success, or a negative number on failure
+     */
+    int fallocate(int fd, int mode, off_t offset, off_t len)
+    {
+        if(offset<0 || len<=0) return -EINVAL;
+        if(mode & ~FALLOC_FL_KEEP_SIZE) return -EOPNOTSUPP;
+        intrusive_ref_ptr<FileBase> file=getFile(fd);
+        if(!file) return -EBADF;
+        return file->fallocate(mode,offset,len);
+    }
     
     /**
      * Rename a file or directory
@@ -366,6 +488,18 @@ public:
      * \return 0 on success, or a negative number on failure
      */
     int pipe(int fds[2]);
+
+    /**
+     * Wait for one of a set of file descriptors to become ready for I/O
+     * \param fds array of pollfd structs, the revents field is filled by this
+     * member function
+     * \param nfds number of elements of fds, must not exceed MAX_OPEN_FILES
+     * \param timeout timeout in milliseconds, 0 means return immediately,
+     * negative means wait forever
+     * \return the number of fds with nonzero revents, 0 on timeout, or a
+     * negative number on failure
+     */
+    int poll(struct pollfd *fds, nfds_t nfds, int timeout);
     
     /**
      * Retrieves an entry in the file descriptor table
@@ -405,6 +539,14 @@ private:
      */
     int statImpl(const char *name, struct stat *pstat, bool f);
 
+    /**
+     * Implements fsync and fdatasync
+     * \param fd file descriptor
+     * \param cmd IOCTL_SYNC or IOCTL_DATASYNC
+     * \return 0 on success, or a negative number on failure
+     */
+    int syncHelper(int fd, int cmd);
+
     /**
      * Get the first available file descriptor. Must be called with mutex locked
      * to avoid race conditions.
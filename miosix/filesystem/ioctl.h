@@ -36,7 +36,46 @@ enum Ioctl
     IOCTL_TCSETATTR_NOW=102,
     IOCTL_TCSETATTR_FLUSH=103,
     IOCTL_TCSETATTR_DRAIN=104,
-    IOCTL_FLUSH=105
+    IOCTL_FLUSH=105,
+    IOCTL_BLOCK_CACHE_STATS=106,
+    IOCTL_GET_GEOMETRY=107,
+    IOCTL_FAST_SEEK=108, ///< arg is an int*, nonzero enables fast seek
+    IOCTL_DATASYNC=109,  ///< Like IOCTL_SYNC, but metadata may be left unsynced
+    IOCTL_TERMINAL_BUFFERING=110 ///< arg is a const TerminalBuffering*
+};
+
+/**
+ * Output buffering modes of terminals, see TerminalBuffering
+ */
+enum TerminalBufferingMode
+{
+    TERMINAL_UNBUFFERED=0,    ///< Output is written before write() returns
+    TERMINAL_LINE_BUFFERED=1, ///< Output is written when a \n is written
+    TERMINAL_FULLY_BUFFERED=2 ///< Output is written when the buffer is full
+};
+
+/**
+ * Argument of the IOCTL_TERMINAL_BUFFERING ioctl, selects how a terminal
+ * stages output before passing it to the underlying device. In all modes, the
+ * buffer is also written when the terminal is read, and by IOCTL_SYNC and
+ * IOCTL_TCSETATTR_DRAIN
+ */
+struct TerminalBuffering
+{
+    int mode;          ///< One of TerminalBufferingMode
+    unsigned int size; ///< Buffer size in bytes, 0 to keep the current size
+};
+
+/**
+ * Filled by block devices that support the IOCTL_GET_GEOMETRY ioctl, used by
+ * filesystems designed for flash memories to match the device layout
+ */
+struct BlockDeviceGeometry
+{
+    unsigned int readSize;   ///< Minimum read size in bytes
+    unsigned int progSize;   ///< Minimum write size in bytes
+    unsigned int eraseSize;  ///< Erase block size in bytes
+    unsigned int blockCount; ///< Number of erase blocks, 0 if unknown
 };
 
 }
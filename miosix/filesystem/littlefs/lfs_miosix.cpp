@@ -92,8 +92,11 @@ public:
     virtual ssize_t write(const void *buf, size_t count) override;
     virtual ssize_t read(void *buf, size_t count) override;
     virtual off_t lseek(off_t pos, int whence) override;
+    virtual ssize_t pread(void *buf, size_t count, off_t pos) override;
+    virtual ssize_t pwrite(const void *buf, size_t count, off_t pos) override;
     virtual int ftruncate(off_t size) override;
     virtual int fstat(struct stat *pstat) const override;
+    virtual int ioctl(int cmd, void *arg) override;
 
     ~LittleFSFile()
     {
@@ -155,7 +158,8 @@ private:
     int addLastLFSDirEntry(char **pos, char *end);
 };
 
-LittleFS::LittleFS(intrusive_ref_ptr<FileBase> disk)
+LittleFS::LittleFS(intrusive_ref_ptr<FileBase> disk,
+                   const LittleFSOptions& options)
     : // Put the drive instance into the config context. Note that a raw pointer
       // is passed, but the object is kept alive by the intrusive_ref_ptr in the
       // drv member variable. Hence, the object is deleted when the LittleFS
@@ -165,13 +169,40 @@ LittleFS::LittleFS(intrusive_ref_ptr<FileBase> disk)
     int err;
     drv = disk;
 
+    // Start from the device geometry, if it reports one
+    BlockDeviceGeometry geometry = {512, 512, 512, 0};
+    if(disk->ioctl(IOCTL_GET_GEOMETRY, &geometry) != 0)
+        geometry = {512, 512, 512, 0};
+
     config = {};
-    config.read_size = 512;
-    config.prog_size = 512;
-    config.block_size = 512;
-    config.block_cycles = 500;
-    config.cache_size = 512;
-    config.lookahead_size = 512;
+    config.read_size = options.readSize ? options.readSize : geometry.readSize;
+    config.prog_size = options.progSize ? options.progSize : geometry.progSize;
+    config.block_size = options.blockSize ? options.blockSize
+                                          : geometry.eraseSize;
+    // The device size does not change if the block size is overridden
+    if(options.blockCount) config.block_count = options.blockCount;
+    else if(config.block_size) config.block_count = static_cast<lfs_size_t>(
+        static_cast<unsigned long long>(geometry.eraseSize)
+        * geometry.blockCount / config.block_size);
+    config.block_cycles = options.blockCycles ? options.blockCycles : 500;
+    if(options.cacheSize) config.cache_size = options.cacheSize;
+    else config.cache_size = config.read_size > config.prog_size
+                           ? config.read_size : config.prog_size;
+    config.lookahead_size = options.lookaheadSize
+                          ? (options.lookaheadSize + 7) & ~7u : 512;
+
+    // Reject geometries LittleFS would assert on. A zero block count is read
+    // from the superblock when mounting, but formatting needs the device size
+    if(config.read_size == 0 || config.prog_size == 0
+        || config.cache_size == 0 || config.block_size == 0
+        || (options.format && config.block_count == 0)
+        || config.cache_size % config.read_size != 0
+        || config.cache_size % config.prog_size != 0
+        || config.block_size % config.cache_size != 0)
+    {
+        mountError = -EINVAL;
+        return;
+    }
 
     config.context = &context;
 
@@ -183,6 +214,15 @@ LittleFS::LittleFS(intrusive_ref_ptr<FileBase> disk)
     config.lock = miosixLfsLock;
     config.unlock = miosixLfsUnlock;
 
+    if(options.format)
+    {
+        err = lfs_format(&lfs, &config);
+        if(err)
+        {
+            mountError = lfsErrorToPosix(err);
+            return;
+        }
+    }
     err = lfs_mount(&lfs, &config);
     mountError = lfsErrorToPosix(err);
 }
@@ -391,6 +431,43 @@ off_t LittleFSFile::lseek(off_t pos, int whence)
     return lfsErrorToPosix(result);
 }
 
+ssize_t LittleFSFile::pread(void *buf, size_t count, off_t pos)
+{
+    if(pos < 0 || pos > LFS_FILE_MAX) return -EINVAL;
+    LittleFS *lfs_driver = static_cast<LittleFS *>(getParent().get());
+    lfs_t *lfs = lfs_driver->getLfs();
+    // Hold the filesystem lock so that no one sees the moved file position
+    Lock<Mutex> l(lfs_driver->getMutex());
+    lfs_soff_t old = lfs_file_tell(lfs, file.get());
+    if(old < 0) return lfsErrorToPosix(old);
+    lfs_soff_t err = lfs_file_seek(lfs, file.get(),
+                                   static_cast<lfs_off_t>(pos), LFS_SEEK_SET);
+    if(err < 0) return lfsErrorToPosix(err);
+    auto result = lfs_file_read(lfs, file.get(), buf, count);
+    lfs_file_seek(lfs, file.get(), old, LFS_SEEK_SET);
+    if(result>=0) return result;
+    return lfsErrorToPosix(result);
+}
+
+ssize_t LittleFSFile::pwrite(const void *buf, size_t count, off_t pos)
+{
+    if(pos < 0 || pos > LFS_FILE_MAX) return -EINVAL;
+    LittleFS *lfs_driver = static_cast<LittleFS *>(getParent().get());
+    lfs_t *lfs = lfs_driver->getLfs();
+    // Hold the filesystem lock so that no one sees the moved file position
+    Lock<Mutex> l(lfs_driver->getMutex());
+    lfs_soff_t old = lfs_file_tell(lfs, file.get());
+    if(old < 0) return lfsErrorToPosix(old);
+    lfs_soff_t err = lfs_file_seek(lfs, file.get(),
+                                   static_cast<lfs_off_t>(pos), LFS_SEEK_SET);
+    if(err < 0) return lfsErrorToPosix(err);
+    auto result = lfs_file_write(lfs, file.get(), buf, count);
+    if(forceSync) lfs_file_sync(lfs, file.get());
+    lfs_file_seek(lfs, file.get(), old, LFS_SEEK_SET);
+    if(result>=0) return result;
+    return lfsErrorToPosix(result);
+}
+
 int LittleFSFile::ftruncate(off_t size)
 {
     LittleFS *lfs_driver = static_cast<LittleFS *>(getParent().get());
@@ -408,6 +485,15 @@ int LittleFSFile::fstat(struct stat *pstat) const
     return 0;
 }
 
+int LittleFSFile::ioctl(int cmd, void *arg)
+{
+    // LittleFS always commits metadata together with data
+    if(cmd != IOCTL_SYNC && cmd != IOCTL_DATASYNC) return -ENOTTY;
+    LittleFS *lfs_driver = static_cast<LittleFS *>(getParent().get());
+    int err = lfs_file_sync(lfs_driver->getLfs(), file.get());
+    return lfsErrorToPosix(err);
+}
+
 int LittleFSDirectory::getdents(void *dp, int len)
 {
     if(len < minimumBufferSize) return -EINVAL;
@@ -482,11 +568,8 @@ int miosixBlockDeviceRead(const lfs_config *c, lfs_block_t block,
 {
     FileBase *drv = GET_DRIVER_FROM_LFS_CONTEXT(c);
 
-    if(drv->lseek(static_cast<off_t>(c->block_size * block + off), SEEK_SET) < 0)
-    {
-        return LFS_ERR_IO;
-    }
-    if(drv->read(buffer, size) != static_cast<ssize_t>(size))
+    off_t where = static_cast<off_t>(c->block_size) * block + off;
+    if(drv->pread(buffer, size, where) != static_cast<ssize_t>(size))
     {
         return LFS_ERR_IO;
     }
@@ -498,11 +581,8 @@ int miosixBlockDeviceProg(const lfs_config *c, lfs_block_t block,
 {
     FileBase *drv = GET_DRIVER_FROM_LFS_CONTEXT(c);
 
-    if(drv->lseek(static_cast<off_t>(c->block_size * block + off), SEEK_SET) < 0)
-    {
-        return LFS_ERR_IO;
-    }
-    if(drv->write(buffer, size) != static_cast<ssize_t>(size))
+    off_t where = static_cast<off_t>(c->block_size) * block + off;
+    if(drv->pwrite(buffer, size, where) != static_cast<ssize_t>(size))
     {
         return LFS_ERR_IO;
     }
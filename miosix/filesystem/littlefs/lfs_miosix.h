@@ -43,12 +43,34 @@ class LittleFSDirectory;
 struct lfs_driver_context
 {
 public:
-    lfs_driver_context(FileBase *disk) : disk(disk), mutex(Mutex::DEFAULT) {}
+    lfs_driver_context(FileBase *disk) : disk(disk), mutex(Mutex::RECURSIVE) {}
 
     FileBase *disk;
     Mutex mutex;
 };
 
+/**
+ * Mount options of LittleFS. Fields left to zero are taken from the geometry
+ * reported by the device through IOCTL_GET_GEOMETRY or, if the device does
+ * not support it, from the defaults suitable for SD cards (512 bytes).
+ */
+struct LittleFSOptions
+{
+    unsigned int readSize=0;      ///< Minimum read size in bytes
+    unsigned int progSize=0;      ///< Minimum program size in bytes
+    unsigned int blockSize=0;     ///< Erase block size in bytes
+    unsigned int blockCount=0;    ///< Number of blocks, 0 to read it from disk
+    /// Size of the read and program caches, and of the cache of every open
+    /// file. Must be a multiple of readSize and progSize and a factor of
+    /// blockSize. By default the larger of readSize and progSize
+    unsigned int cacheSize=0;
+    /// Size of the lookahead buffer used to find free blocks, every byte
+    /// tracks 8 blocks. Rounded up to a multiple of 8, by default 512
+    unsigned int lookaheadSize=0;
+    int blockCycles=0;            ///< Erase cycles before moving metadata
+    bool format=false;            ///< Format the device before mounting
+};
+
 /**
  * LittleFS Filesystem.
  */
@@ -57,8 +79,12 @@ class LittleFS : public FilesystemBase
 public:
     /**
      * Constructor
+     * \param disk block device to mount
+     * \param options mount options, to override the geometry reported by the
+     * device and the cache sizes
      */
-    LittleFS(intrusive_ref_ptr<FileBase> disk);
+    LittleFS(intrusive_ref_ptr<FileBase> disk,
+             const LittleFSOptions& options=LittleFSOptions());
 
     /**
      * Open a file
@@ -124,6 +150,11 @@ public:
      */
     bool mountFailed() const { return mountError != 0; }
 
+    /**
+     * \return the configuration LittleFS was mounted with
+     */
+    const struct lfs_config& getConfig() const { return config; }
+
     /**
      * Destructor
      */
@@ -131,6 +162,12 @@ public:
 
     lfs_t *getLfs() { return &lfs; }
 
+    /**
+     * \return the mutex LittleFS locks on every operation. It is recursive,
+     * so it can be held across multiple LittleFS calls that must be atomic
+     */
+    Mutex& getMutex() { return context.mutex; }
+
 private:
     // Used to access members of this class in getdents
     friend LittleFSDirectory;
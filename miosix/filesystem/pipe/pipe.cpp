@@ -26,7 +26,8 @@
  ***************************************************************************/
 
 #include "pipe.h"
-#include <algorithm>
+#include <cstring>
+#include <new>
 
 using namespace std;
 
@@ -34,60 +35,154 @@ using namespace std;
 
 namespace miosix {
 
-Pipe::Pipe() : FileBase(intrusive_ref_ptr<FilesystemBase>(),O_RDWR), put(0),
-    get(0), size(0), capacity(defaultSize), buffer(new char[defaultSize]) {}
+//
+// class PipeBuffer
+//
 
-ssize_t Pipe::write(const void *data, size_t len)
+PipeBuffer::PipeBuffer() : put(0), get(0), size(0), capacity(defaultCapacity),
+    buffer(new char[defaultCapacity]), readerClosed(false), writerClosed(false) {}
+
+ssize_t PipeBuffer::write(const void *data, size_t len, bool nonblocking)
 {
     auto d=reinterpret_cast<const char*>(data);
     Lock<FastMutex> l(m);
     ssize_t written=0;
     while(len>0)
     {
-        if(unconnected()) return -EPIPE;
-        int writable=min<int>(len,capacity-size);
-        //HACK: if the other end of the pipe is closed after we wait on the
-        //condition variable, we'll wait forever. To fix that, we set a timeout
-        if(writable==0) cv.timedWait(l,getTime()+pollTime);
-        else {
-            for(int i=0;i<writable;i++)
-            {
-                buffer[put]=d[i];
-                if(++put>=capacity) put=0;
-            }
-            size+=writable;
-            d+=writable;
-            len-=writable;
-            written+=writable;
-            cv.broadcast();
+        if(readerClosed) return written>0 ? written : -EPIPE;
+        if(size==capacity)
+        {
+            if(nonblocking) return written>0 ? written : -EAGAIN;
+            writeCv.wait(l);
+            continue;
+        }
+        //Copy at most two contiguous chunks, before and after wraparound
+        unsigned int writable=len<capacity-size ? len : capacity-size;
+        unsigned int first=writable<capacity-put ? writable : capacity-put;
+        memcpy(buffer+put,d,first);
+        memcpy(buffer,d+first,writable-first);
+        put+=writable;
+        if(put>=capacity) put-=capacity;
+        bool wasEmpty= size==0;
+        size+=writable;
+        d+=writable;
+        len-=writable;
+        written+=writable;
+        //Readers and pollers only wait for the pipe to become non-empty
+        if(wasEmpty)
+        {
+            readCv.broadcast();
+            pq.wakeup();
         }
     }
     return written;
 }
 
-ssize_t Pipe::read(void *data, size_t len)
+ssize_t PipeBuffer::read(void *data, size_t len, bool nonblocking)
 {
     if(len==0) return 0;
     auto d=reinterpret_cast<char*>(data);
     Lock<FastMutex> l(m);
-    for(;;)
+    while(size==0)
     {
-        int readable=min<int>(len,size);
-        if(unconnected() && readable==0) return 0;
-        //HACK: if the other end of the pipe is closed after we wait on the
-        //condition variable, we'll wait forever. To fix that, we set a timeout
-        if(readable==0) cv.timedWait(l,getTime()+pollTime);
-        else {
-            for(int i=0;i<readable;i++)
-            {
-                d[i]=buffer[get];
-                if(++get>=capacity) get=0;
-            }
-            size-=readable;
-            cv.broadcast();
-            return readable;
-        }
+        if(writerClosed) return 0;
+        if(nonblocking) return -EAGAIN;
+        readCv.wait(l);
+    }
+    //Copy at most two contiguous chunks, before and after wraparound
+    unsigned int readable=len<size ? len : size;
+    unsigned int first=readable<capacity-get ? readable : capacity-get;
+    memcpy(d,buffer+get,first);
+    memcpy(d+first,buffer,readable-first);
+    get+=readable;
+    if(get>=capacity) get-=capacity;
+    bool wasFull= size==capacity;
+    size-=readable;
+    //Writers and pollers only wait for the pipe to become non-full
+    if(wasFull)
+    {
+        writeCv.broadcast();
+        pq.wakeup();
+    }
+    return readable;
+}
+
+int PipeBuffer::poll(bool reader, int events, PollRegistration *reg)
+{
+    Lock<FastMutex> l(m);
+    pq.add(reg);
+    int result=0;
+    if(reader)
+    {
+        if(size>0) result|=POLLIN;
+        if(writerClosed) result|=POLLHUP; //Reads return EOF once empty
+    } else {
+        if(readerClosed) result|=POLLERR; //Writes fail with EPIPE
+        else if(size<capacity) result|=POLLOUT;
     }
+    return result;
+}
+
+int PipeBuffer::getCapacity()
+{
+    Lock<FastMutex> l(m);
+    return capacity;
+}
+
+int PipeBuffer::setCapacity(int newCapacity)
+{
+    if(newCapacity<minCapacity) newCapacity=minCapacity;
+    if(newCapacity>maxCapacity) return -EPERM;
+    Lock<FastMutex> l(m);
+    unsigned int c=newCapacity;
+    if(c==capacity) return capacity;
+    if(c<size) return -EBUSY;
+    char *newBuffer=new (nothrow) char[c];
+    if(newBuffer==nullptr) return -ENOMEM;
+    //Move the data at the beginning of the new buffer
+    unsigned int first=size<capacity-get ? size : capacity-get;
+    memcpy(newBuffer,buffer+get,first);
+    memcpy(newBuffer+first,buffer,size-first);
+    delete[] buffer;
+    buffer=newBuffer;
+    get=0;
+    put= size==c ? 0 : size;
+    bool wasFull= size==capacity;
+    capacity=c;
+    if(wasFull && size<capacity)
+    {
+        writeCv.broadcast();
+        pq.wakeup();
+    }
+    return capacity;
+}
+
+void PipeBuffer::endClosed(bool reader)
+{
+    Lock<FastMutex> l(m);
+    if(reader) readerClosed=true;
+    else writerClosed=true;
+    readCv.broadcast();
+    writeCv.broadcast();
+    pq.wakeup();
+}
+
+PipeBuffer::~PipeBuffer() { delete[] buffer; }
+
+//
+// class Pipe
+//
+
+ssize_t Pipe::write(const void *data, size_t len)
+{
+    if(isReadEnd()) return -EBADF;
+    return buffer->write(data,len,flags & O_NONBLOCK);
+}
+
+ssize_t Pipe::read(void *data, size_t len)
+{
+    if(!isReadEnd()) return -EBADF;
+    return buffer->read(data,len,flags & O_NONBLOCK);
 }
 
 off_t Pipe::lseek(off_t pos, int whence) { return -ESPIPE; }
@@ -103,30 +198,25 @@ int Pipe::fcntl(int cmd, int opt)
 {
     switch(cmd)
     {
-        case F_GETFD:
-        case F_GETFL: //TODO: also return file access mode
-            return O_RDWR;
+        case F_SETFL:
+            //Only O_NONBLOCK can be changed, the access mode is fixed
+            flags=(flags & ~O_NONBLOCK) | (opt & O_NONBLOCK);
+            return 0;
+        case F_GETPIPE_SZ:
+            return buffer->getCapacity();
+        case F_SETPIPE_SZ:
+            return buffer->setCapacity(opt);
     }
-    return -EBADF;
+    return FileBase::fcntl(cmd,opt);
 }
 
-Pipe::~Pipe() { delete[] buffer; }
-
-bool Pipe::unconnected()
+int Pipe::poll(int events, PollRegistration *reg)
 {
-    //How many references does an unconnected pipe have? One in the file
-    //descriptor table. Then, since we check whether we are unconnected within
-    //either a read or write operation, either FileDescriptorTable::read or
-    //FileDescriptorTable::write hold a temporary reference to make sure a
-    //concurrent close doesn't lead to a dangling pointer in the middle of a
-    //syscall, bringing the reference count to 2. Finally, to get the reference
-    //count, we need to get the intrusive_shared_ptr first as a temporary through
-    //shared_from_this() and this adds to the reference count, reaching 3.
-    //This should be done with the mutex locked to prevent concurrent calls from
-    //not spotting that we are unconnected
-    return shared_from_this().use_count()<=3;
+    return buffer->poll(isReadEnd(),events,reg);
 }
 
+Pipe::~Pipe() { buffer->endClosed(isReadEnd()); }
+
 } //namespace miosix
 
 #endif //WITH_FILESYSTEM
@@ -28,30 +28,121 @@
 #pragma once
 
 #include "filesystem/file.h"
+#include "filesystem/poll.h"
 #include "kernel/sync.h"
 #include "config/miosix_settings.h"
+#include "stdlib_integration/pipe_fcntl.h"
 
 #ifdef WITH_FILESYSTEM
 
 namespace miosix {
 
 /**
- * Pipe
- * This is an almost standard compliant pipe implementation. A pipe should in
- * theory have two separate file descriptors pointing to two file objects, one
- * for the read end and one for the write end. This pipe implementation is a
- * single file object that does both. This file object is aliased through
- * reference counting to both file descriptors, which can be used
- * interchangeably as read/write end. Code that uses those file descriptor in a
- * standard compliant way won't notice the difference.
+ * The ring buffer shared by the read and write end of a pipe.
+ * Waiting readers, writers and polling threads are woken only when the buffer
+ * goes from empty to non-empty, from full to non-full, or when one of the two
+ * ends is closed, so there is no need for timeouts.
+ */
+class PipeBuffer : public IntrusiveRefCounted<PipeBuffer>
+{
+public:
+    /**
+     * Constructor
+     */
+    PipeBuffer();
+
+    /**
+     * Write data to the pipe
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param nonblocking if true, write only what fits in the buffer instead
+     * of waiting for free space
+     * \return the number of written bytes, or a negative number in case of
+     * errors
+     */
+    ssize_t write(const void *data, size_t len, bool nonblocking);
+
+    /**
+     * Read data from the pipe
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param nonblocking if true, return -EAGAIN instead of waiting when the
+     * pipe is empty
+     * \return the number of read bytes, 0 if the write end is closed and the
+     * pipe is empty, or a negative number in case of errors
+     */
+    ssize_t read(void *data, size_t len, bool nonblocking);
+
+    /**
+     * Check whether one of the two ends is ready for I/O
+     * \param reader true for the read end, false for the write end
+     * \param events events the caller is interested in
+     * \param reg registration to add to the PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    int poll(bool reader, int events, PollRegistration *reg);
+
+    /**
+     * \return the pipe capacity in bytes
+     */
+    int getCapacity();
+
+    /**
+     * Change the pipe capacity
+     * \param newCapacity requested capacity in bytes. Values lower than
+     * minCapacity are rounded up
+     * \return the new capacity, or a negative number in case of errors.
+     * The capacity can't be set lower than the data currently in the pipe
+     */
+    int setCapacity(int newCapacity);
+
+    /**
+     * Called when one of the two ends is closed, wakes all waiting threads
+     * \param reader true for the read end, false for the write end
+     */
+    void endClosed(bool reader);
+
+    /**
+     * Destructor
+     */
+    ~PipeBuffer();
+
+    static const int defaultCapacity=256; ///< Capacity of a new pipe
+    static const int minCapacity=16;      ///< Minimum for F_SETPIPE_SZ
+    static const int maxCapacity=65536;   ///< Maximum for F_SETPIPE_SZ
+
+private:
+    PipeBuffer(const PipeBuffer&)=delete;
+    PipeBuffer& operator=(const PipeBuffer&)=delete;
+
+    FastMutex m;
+    ConditionVariable readCv;  ///< Readers wait here for data
+    ConditionVariable writeCv; ///< Writers wait here for free space
+    PollQueue pq;              ///< Threads polling either end
+    unsigned int put, get, size, capacity;
+    char *buffer;
+    bool readerClosed, writerClosed;
+};
+
+/**
+ * One end of a pipe. Pipes are made of two file objects, the read end and the
+ * write end, sharing a PipeBuffer. When all the file descriptors referring
+ * to an end are closed the file object is deleted, and this wakes any thread
+ * blocked on the other end.
+ *
+ * The file status flag O_NONBLOCK can be set with fcntl(F_SETFL), and the
+ * pipe capacity can be changed with fcntl(F_SETPIPE_SZ) on either end.
  */
 class Pipe : public FileBase
 {
 public:
     /**
      * Constructor
+     * \param buffer the buffer shared by the two ends
+     * \param flags O_RDONLY for the read end, O_WRONLY for the write end
      */
-    Pipe();
+    Pipe(intrusive_ref_ptr<PipeBuffer> buffer, int flags)
+        : FileBase(intrusive_ref_ptr<FilesystemBase>(),flags), buffer(buffer) {}
 
     /**
      * Write data to the file, if the file supports writing.
@@ -103,6 +194,14 @@ public:
      */
     virtual int fcntl(int cmd, int opt);
 
+    /**
+     * Check whether the pipe is ready for I/O
+     * \param events events the caller is interested in
+     * \param reg registration to add to the pipe PollQueue, or nullptr
+     * \return the events that are currently ready
+     */
+    virtual int poll(int events, PollRegistration *reg);
+
     /**
      * Destructor
      */
@@ -110,17 +209,11 @@ public:
 
 private:
     /**
-     * \return true if there is only one file descriptor associated with the pipe
-     * Must be called with mutex locked
+     * \return true if this is the read end
      */
-    bool unconnected();
+    bool isReadEnd() const { return (flags & O_ACCMODE)==O_RDONLY; }
 
-    static const int defaultSize=256;
-    static const int pollTime=100000000; //100ms
-    FastMutex m;
-    ConditionVariable cv;
-    int put, get, size, capacity;
-    char *buffer;
+    intrusive_ref_ptr<PipeBuffer> buffer;
 };
 
 } //namespace miosix
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "poll.h"
+#include "file.h"
+#include "kernel/kernel.h"
+#include <memory>
+#include <new>
+#include <errno.h>
+
+using namespace std;
+
+namespace miosix {
+
+//
+// class PollQueue
+//
+
+void PollQueue::add(PollRegistration *reg)
+{
+    if(reg==nullptr) return;
+    FastInterruptDisableLock dLock;
+    IRQadd(reg);
+}
+
+void PollQueue::IRQadd(PollRegistration *reg)
+{
+    if(reg==nullptr || reg->queue!=nullptr) return;
+    reg->queue=this;
+    registrations.push_back(reg);
+}
+
+void PollQueue::wakeup()
+{
+    bool hppw=false;
+    {
+        FastInterruptDisableLock dLock;
+        IRQwakeup(hppw);
+    }
+    if(hppw) Thread::yield();
+}
+
+void PollQueue::IRQwakeup(bool& hppw)
+{
+    for(PollRegistration *reg : registrations)
+    {
+        PollWaiter *waiter=reg->waiter;
+        waiter->ready=true;
+        //A thread polling many files may be woken by more than one of them
+        Thread *t=waiter->thread;
+        if(t==nullptr) continue;
+        waiter->thread=nullptr;
+        t->IRQwakeup();
+        if(Thread::IRQgetCurrentThread()->IRQgetPriority()<t->IRQgetPriority())
+            hppw=true;
+    }
+}
+
+void PollQueue::remove(PollRegistration *reg)
+{
+    FastInterruptDisableLock dLock;
+    if(reg->queue==nullptr) return;
+    reg->queue->registrations.removeFast(reg);
+    reg->queue=nullptr;
+}
+
+//
+// pollFiles
+//
+
+int pollFiles(struct pollfd *fds, const intrusive_ref_ptr<FileBase> *files,
+        nfds_t nfds, int timeout)
+{
+    long long deadline=timeout>0 ? getTime()+timeout*1000000LL : 0;
+    bool mayBlock=timeout!=0;
+    //Registrations are only needed if we may block
+    unique_ptr<PollRegistration[]> regs;
+    PollWaiter waiter;
+    if(mayBlock && nfds>0)
+    {
+        regs.reset(new (nothrow) PollRegistration[nfds]);
+        if(!regs) return -ENOMEM;
+        for(nfds_t i=0;i<nfds;i++) regs[i].waiter=&waiter;
+    }
+    bool registered=false;
+    int result;
+    for(;;)
+    {
+        result=0;
+        for(nfds_t i=0;i<nfds;i++)
+        {
+            fds[i].revents=0;
+            if(fds[i].fd<0) continue; //Negative fds are ignored by poll()
+            if(!files[i]) fds[i].revents=POLLNVAL;
+            else {
+                //POLLERR and POLLHUP are reported even if not requested
+                int events=fds[i].events | POLLERR | POLLHUP;
+                PollRegistration *reg=registered || !regs ? nullptr : &regs[i];
+                fds[i].revents=files[i]->poll(events,reg) & events;
+            }
+            if(fds[i].revents) result++;
+        }
+        registered=true;
+        if(result>0 || mayBlock==false) break;
+
+        //Registrations stay in place across iterations, so any state change
+        //occurring from here on sets waiter.ready and is not lost
+        FastInterruptDisableLock dLock;
+        waiter.thread=Thread::IRQgetCurrentThread();
+        while(waiter.ready==false)
+        {
+            if(timeout<0) Thread::IRQenableIrqAndWait(dLock);
+            else if(Thread::IRQenableIrqAndTimedWait(dLock,deadline)
+                    ==TimedWaitResult::Timeout)
+            {
+                mayBlock=false; //Check the files one last time, then return
+                break;
+            }
+        }
+        waiter.thread=nullptr;
+        waiter.ready=false;
+    }
+    if(regs) for(nfds_t i=0;i<nfds;i++) PollQueue::remove(&regs[i]);
+    return result;
+}
+
+} //namespace miosix
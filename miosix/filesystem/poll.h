@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "kernel/intrusive.h"
+#include "config/miosix_settings.h"
+
+//Also provides the poll.h subset if newlib does not
+#include "stdlib_integration/poll_select.h"
+
+namespace miosix {
+
+class Thread;
+class FileBase;
+class PollQueue;
+
+/**
+ * \internal
+ * Wait token of a thread blocked in pollFiles(). There is one for each call
+ * to pollFiles(), shared by all the PollRegistration of that call.
+ */
+struct PollWaiter
+{
+    Thread *thread=nullptr; ///< Thread to wake, nullptr if it is not sleeping
+    bool ready=false;       ///< Set when one of the polled files changed state
+};
+
+/**
+ * Links a thread blocked in poll() to the PollQueue of one of the files it is
+ * polling. Registrations are owned by pollFiles(), which removes them from
+ * their queue before returning. Drivers only need to pass them to
+ * PollQueue::add() or PollQueue::IRQadd() from their poll() member function.
+ */
+class PollRegistration : public IntrusiveListItem
+{
+public:
+    PollRegistration() : waiter(nullptr), queue(nullptr) {}
+
+    PollRegistration(const PollRegistration&)=delete;
+    PollRegistration& operator=(const PollRegistration&)=delete;
+
+private:
+    PollWaiter *waiter; ///< Thread to notify
+    PollQueue *queue;   ///< Queue this registration is in, or nullptr
+
+    friend class PollQueue;
+    friend int pollFiles(struct pollfd *fds,
+            const intrusive_ref_ptr<FileBase> *files, nfds_t nfds, int timeout);
+};
+
+/**
+ * A list of threads waiting in poll() for a file or device to change state.
+ * Every file or device implementing poll() with something more than the
+ * "always ready" default behavior needs one of these, and must call wakeup()
+ * or IRQwakeup() every time its readiness may have changed, for example when
+ * data becomes available to read or buffer space becomes available to write.
+ *
+ * To avoid lost wakeups, poll() implementations must register the thread
+ * before checking the file state, and state changes must happen before the
+ * corresponding wakeup. This is naturally the case if registration and state
+ * checking occur with the same mutex locked (or interrupts disabled, for
+ * drivers) that protects state changes.
+ *
+ * This class is interrupt-safe.
+ */
+class PollQueue
+{
+public:
+    /**
+     * Constructor
+     */
+    PollQueue() {}
+
+    /**
+     * Add a registration to this queue. Can only be called from poll().
+     * \param reg registration passed to poll(), can be nullptr in which case
+     * nothing is done
+     */
+    void add(PollRegistration *reg);
+
+    /**
+     * Add a registration to this queue. Can only be called from poll(), with
+     * interrupts disabled.
+     * \param reg registration passed to poll(), can be nullptr in which case
+     * nothing is done
+     */
+    void IRQadd(PollRegistration *reg);
+
+    /**
+     * Wake all the threads polling on this queue. Can only be called from a
+     * thread context, with interrupts enabled.
+     */
+    void wakeup();
+
+    /**
+     * Wake all the threads polling on this queue, without triggering a
+     * reschedule. Only for use in IRQ handlers.
+     * \param hppw is set to `true' if a scheduler update is necessary to
+     * wake up a formerly sleeping thread with `Scheduler::IRQfindNextThread()`.
+     * Otherwise it is not modified.
+     */
+    void IRQwakeup(bool& hppw);
+
+    /**
+     * \internal
+     * Remove a registration from the queue it is in, if any
+     * \param reg registration to remove
+     */
+    static void remove(PollRegistration *reg);
+
+    PollQueue(const PollQueue&)=delete;
+    PollQueue& operator=(const PollQueue&)=delete;
+
+private:
+    IntrusiveList<PollRegistration> registrations;
+};
+
+/**
+ * Wait for one of a set of files to become ready for I/O. This is the
+ * implementation of poll() on top of FileBase::poll(), independent of how the
+ * file objects are obtained from file descriptors.
+ * \param fds array of pollfd structs. The revents field is filled by this
+ * function
+ * \param files array of nfds files, files[i] corresponds to fds[i]. An empty
+ * pointer for a non negative fds[i].fd reports POLLNVAL
+ * \param nfds number of elements of fds and files
+ * \param timeout timeout in milliseconds, 0 means return immediately,
+ * negative means wait forever
+ * \return the number of fds with nonzero revents, or a negative number on
+ * failure
+ */
+int pollFiles(struct pollfd *fds, const intrusive_ref_ptr<FileBase> *files,
+        nfds_t nfds, int timeout);
+
+} //namespace miosix
@@ -27,10 +27,12 @@
 
 #include "romfs.h"
 #include <string>
+#include <memory>
 #include <errno.h>
 #include <fcntl.h>
 #include "filesystem/path.h"
 #include "kernel/logging.h"
+#include "kernel/sync.h"
 #include "interfaces/endianness.h"
 #include "util/util.h"
 #include "romfs_types.h"
@@ -50,9 +52,9 @@ const void *getRomFsAddressAfterKernel()
     extern char _etext asm("_etext");
     const char *kernelEnd=&_etext+(&_edata-&_data);
     // Align the resulting pointer
-    const unsigned int align=romFsImageAlignment;
+    const uintptr_t align=romFsImageAlignment;
     kernelEnd=reinterpret_cast<const char*>(
-             (reinterpret_cast<unsigned int>(kernelEnd)+align-1) & (0-align));
+             (reinterpret_cast<uintptr_t>(kernelEnd)+align-1) & (0-align));
     // Check for romfs start marker
     bool valid=true;
     for(int i=0;i<5;i++) if(kernelEnd[i]!='w') valid=false;
@@ -94,9 +96,10 @@ static void fillStatHelper(struct stat* pstat, const RomFsDirectoryEntry *entry,
  */
 static const RomFsDirectoryEntry *nextEntry(const RomFsDirectoryEntry *entry)
 {
-    auto last=reinterpret_cast<unsigned int>(entry->name+strlen(entry->name)+1);
+    const uintptr_t align=romFsStructAlignment;
+    auto last=reinterpret_cast<uintptr_t>(entry->name+strlen(entry->name)+1);
     return reinterpret_cast<const RomFsDirectoryEntry *>(
-        (last+romFsStructAlignment-1) & (0-romFsStructAlignment));
+        (last+align-1) & (0-align));
 }
 
 /**
@@ -143,6 +146,26 @@ public:
      */
     virtual off_t lseek(off_t pos, int whence);
 
+    /**
+     * Read data at a given position, without changing the file pointer.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pread(void *data, size_t len, off_t pos);
+
+    /**
+     * Write data at a given position, without changing the file pointer.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \param pos offset from the beginning of the file
+     * \return the number of written characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pwrite(const void *data, size_t len, off_t pos);
+
     /**
      * Truncate the file
      * \param size new file size
@@ -167,8 +190,10 @@ public:
      */
     virtual MemoryMappedFile getFileFromMemory();
 
-private:
+protected:
     const RomFsDirectoryEntry * const entry;
+
+private:
     off_t seekPoint; ///< Seek point (note that off_t is 64bit)
 };
 
@@ -176,19 +201,31 @@ ssize_t MemoryMappedRomFsFile::write(const void *data, size_t len) { return -EIN
 
 ssize_t MemoryMappedRomFsFile::read(void *data, size_t len)
 {
+    ssize_t result=pread(data,len,seekPoint);
+    if(result>0) seekPoint+=result;
+    return result;
+}
+
+ssize_t MemoryMappedRomFsFile::pread(void *data, size_t len, off_t pos)
+{
+    if(pos<0) return -EINVAL;
     unsigned int size=fromLittleEndian32(entry->size);
-    if(seekPoint>=size) return 0;
-    size_t toRead=min<size_t>(len,size-seekPoint);
+    if(pos>=size) return 0;
+    size_t toRead=min<size_t>(len,size-pos);
     #ifdef __NO_EXCEPTIONS
     auto parent=static_pointer_cast<MemoryMappedRomFs>(getParent());
     #else
     auto parent=dynamic_pointer_cast<MemoryMappedRomFs>(getParent());
     #endif
-    memcpy(data,parent->ptr(fromLittleEndian32(entry->inode))+seekPoint,toRead);
-    seekPoint+=toRead;
+    memcpy(data,parent->ptr(fromLittleEndian32(entry->inode))+pos,toRead);
     return toRead;
 }
 
+ssize_t MemoryMappedRomFsFile::pwrite(const void *data, size_t len, off_t pos)
+{
+    return -EINVAL;
+}
+
 off_t MemoryMappedRomFsFile::lseek(off_t pos, int whence)
 {
     off_t newSeekPoint=seekPoint;
@@ -229,6 +266,173 @@ MemoryMappedFile MemoryMappedRomFsFile::getFileFromMemory()
                             fromLittleEndian32(entry->size));
 }
 
+/**
+ * Decompress a block in the LZ4 block format
+ * \param src compressed data
+ * \param srcSize compressed data size
+ * \param dst decompressed data will be stored here
+ * \param dstSize expected decompressed size
+ * \return true if the block was decompressed successfully and its size is
+ * exactly dstSize, false if the data is corrupted
+ */
+static bool lz4Decompress(const unsigned char *src, unsigned int srcSize,
+                          unsigned char *dst, unsigned int dstSize)
+{
+    const unsigned char *srcEnd=src+srcSize;
+    unsigned char *out=dst;
+    unsigned char *dstEnd=dst+dstSize;
+    auto readLength=[&](unsigned int length)->unsigned int {
+        if(length!=15) return length;
+        unsigned char b;
+        do {
+            if(src>=srcEnd) return 0xffffffff;
+            b=*src++;
+            length+=b;
+        } while(b==255);
+        return length;
+    };
+    for(;;)
+    {
+        if(src>=srcEnd) return false;
+        unsigned int token=*src++;
+        //Literals
+        unsigned int length=readLength(token>>4);
+        if(length>static_cast<unsigned int>(srcEnd-src)) return false;
+        if(length>static_cast<unsigned int>(dstEnd-out)) return false;
+        memcpy(out,src,length);
+        out+=length;
+        src+=length;
+        if(src==srcEnd) break; //The last sequence has only literals
+        //Match
+        if(srcEnd-src<2) return false;
+        unsigned int offset=src[0] | src[1]<<8;
+        src+=2;
+        if(offset==0 || offset>static_cast<unsigned int>(out-dst)) return false;
+        length=readLength(token & 0xf);
+        if(length>=0xffffffff-4) return false;
+        length+=4;
+        if(length>static_cast<unsigned int>(dstEnd-out)) return false;
+        //Byte by byte, as source and destination may overlap
+        const unsigned char *match=out-offset;
+        for(unsigned int i=0;i<length;i++) out[i]=match[i];
+        out+=length;
+    }
+    return out==dstEnd;
+}
+
+/**
+ * Compressed file class for MemoryMappedRomFs. Blocks are decompressed on
+ * demand into a buffer of one block, so unlike uncompressed files, these
+ * can't be executed in place
+ */
+class MemoryMappedRomFsCompressedFile : public MemoryMappedRomFsFile
+{
+public:
+    /**
+     * Constructor
+     * \param parent pointer to parent filesystem
+     * \param flags file open flags
+     * \param entry directory entry containing the file information
+     * \param header compressed file header
+     */
+    MemoryMappedRomFsCompressedFile(intrusive_ref_ptr<FilesystemBase> parent,
+            int flags, const RomFsDirectoryEntry *entry,
+            const RomFsCompressedFile *header)
+            : MemoryMappedRomFsFile(parent,flags,entry), header(header) {}
+
+    /**
+     * Read data at a given position, without changing the file pointer.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \param pos offset from the beginning of the file
+     * \return the number of read characters, or a negative number in
+     * case of errors
+     */
+    virtual ssize_t pread(void *data, size_t len, off_t pos);
+
+    /**
+     * Compressed files are not stored as a contiguous block
+     * \return {nullptr,0}
+     */
+    virtual MemoryMappedFile getFileFromMemory();
+
+private:
+    /**
+     * Decompress a block
+     * \param block block number
+     * \param size uncompressed size of the block
+     * \param dst decompressed data will be stored here
+     * \return true on success
+     */
+    bool decompressBlock(unsigned int block, unsigned int size,
+                         unsigned char *dst);
+
+    const RomFsCompressedFile * const header;
+    std::unique_ptr<unsigned char[]> buffer; ///< Last decompressed block
+    unsigned int bufferBlock=0xffffffff;     ///< Block stored in buffer
+    FastMutex mutex;                         ///< Protects buffer
+};
+
+ssize_t MemoryMappedRomFsCompressedFile::pread(void *data, size_t len, off_t pos)
+{
+    if(pos<0) return -EINVAL;
+    unsigned int size=fromLittleEndian32(entry->size);
+    if(pos>=size) return 0;
+    size_t toRead=min<size_t>(len,size-pos);
+    const unsigned int shift=header->blockShift;
+    const unsigned int blockSize=1<<shift;
+    auto out=reinterpret_cast<unsigned char*>(data);
+    unsigned int offset=pos;
+    Lock<FastMutex> l(mutex);
+    for(size_t remaining=toRead;remaining>0;)
+    {
+        unsigned int block=offset>>shift;
+        unsigned int blockStart=block<<shift;
+        unsigned int thisBlockSize=min(blockSize,size-blockStart);
+        unsigned int inBlock=offset-blockStart;
+        unsigned int n=min<size_t>(remaining,thisBlockSize-inBlock);
+        if(n==thisBlockSize)
+        {
+            //Whole block requested, skip the buffer
+            if(decompressBlock(block,n,out)==false) return -EIO;
+        } else {
+            if(bufferBlock!=block)
+            {
+                if(!buffer) buffer.reset(new unsigned char[blockSize]);
+                bufferBlock=0xffffffff;
+                if(decompressBlock(block,thisBlockSize,buffer.get())==false)
+                    return -EIO;
+                bufferBlock=block;
+            }
+            memcpy(out,buffer.get()+inBlock,n);
+        }
+        out+=n;
+        offset+=n;
+        remaining-=n;
+    }
+    return toRead;
+}
+
+MemoryMappedFile MemoryMappedRomFsCompressedFile::getFileFromMemory()
+{
+    return MemoryMappedFile(nullptr,0);
+}
+
+bool MemoryMappedRomFsCompressedFile::decompressBlock(unsigned int block,
+        unsigned int size, unsigned char *dst)
+{
+    unsigned int begin=fromLittleEndian32(header->blocks[block]);
+    unsigned int end=fromLittleEndian32(header->blocks[block+1]);
+    if(end<begin) return false;
+    auto src=reinterpret_cast<const unsigned char*>(header)+begin;
+    if(end-begin==size)
+    {
+        memcpy(dst,src,size); //Block stored uncompressed
+        return true;
+    }
+    return lz4Decompress(src,end-begin,dst,size);
+}
+
 /**
  * Directory class for MemoryMappedRomFs
  */
@@ -302,10 +506,21 @@ int MemoryMappedRomFsDirectory::getdents(void *dp, int len)
 //
 
 MemoryMappedRomFs::MemoryMappedRomFs(const void *baseAddress)
-    : base(reinterpret_cast<const char*>(baseAddress)), failed(false)
+    : base(reinterpret_cast<const char*>(baseAddress)), failed(false),
+      sortedIndex(false), compression(false)
 {
     auto header=ptr<const RomFsHeader*>(0);
     if(strncmp(header->fsName,"RomFs 2.01",11)==0) return;
+    if(strncmp(header->fsName,"RomFs 2.02",11)==0)
+    {
+        auto features=fromLittleEndian32(header->features);
+        sortedIndex=(features & ROMFS_SORTED_INDEX)!=0;
+        compression=(features & ROMFS_COMPRESSION)!=0;
+        if((features & ~romFsKnownFeatures)==0) return;
+        errorLog("Unsupported FS features 0x%x\n",features);
+        failed=true;
+        return;
+    }
     errorLog("Unexpected FS version %s\n",header->fsName);
     failed=true;
 }
@@ -320,9 +535,22 @@ int MemoryMappedRomFs::open(intrusive_ref_ptr<FileBase>& file, StringPart& name,
     switch(fromLittleEndian16(entry->mode) & S_IFMT)
     {
         case S_IFREG:
-            file=intrusive_ref_ptr<FileBase>(new MemoryMappedRomFsFile(
-                shared_from_this(),flags,entry));
+        {
+            unsigned int inode=fromLittleEndian32(entry->inode);
+            if(compression && (inode & romFsCompressedFlag))
+            {
+                auto header=ptr<const RomFsCompressedFile*>(
+                    inode & ~romFsCompressedFlag);
+                if(header->algorithm!=ROMFS_LZ4) return -EIO;
+                file=intrusive_ref_ptr<FileBase>(
+                    new MemoryMappedRomFsCompressedFile(shared_from_this(),
+                    flags,entry,header));
+            } else {
+                file=intrusive_ref_ptr<FileBase>(new MemoryMappedRomFsFile(
+                    shared_from_this(),flags,entry));
+            }
             break;
+        }
         case S_IFDIR:
             file=intrusive_ref_ptr<FileBase>(new MemoryMappedRomFsDirectory(
                 shared_from_this(),entry));
@@ -370,17 +598,43 @@ const RomFsDirectoryEntry *MemoryMappedRomFs::findEntry(StringPart& name)
     while(auto element=pw.next())
     {
         if((fromLittleEndian16(entry->mode) & S_IFMT)!=S_IFDIR) return nullptr;
-        unsigned int inode=fromLittleEndian32(entry->inode);
-        const void *end=ptr(inode+fromLittleEndian32(entry->size));
-        entry=ptr<const RomFsDirectoryEntry *>(inode+sizeof(RomFsFirstEntry));
-        while(entry<end)
+        entry=findInDirectory(entry,element->c_str());
+        if(entry==nullptr) return nullptr; //Not found
+    }
+    return entry;
+}
+
+const RomFsDirectoryEntry *MemoryMappedRomFs::findInDirectory(
+        const RomFsDirectoryEntry *dir, const char *name)
+{
+    unsigned int inode=fromLittleEndian32(dir->inode);
+    unsigned int last=inode+fromLittleEndian32(dir->size);
+    if(sortedIndex)
+    {
+        last=(last+romFsStructAlignment-1) & (0-romFsStructAlignment);
+        auto index=ptr<const RomFsDirectoryIndex *>(last);
+        unsigned int lo=0, hi=fromLittleEndian32(index->count);
+        while(lo<hi)
         {
-            if(strcmp(element->c_str(),entry->name)==0) break;
-            entry=nextEntry(entry);
+            unsigned int mid=lo+(hi-lo)/2;
+            auto entry=ptr<const RomFsDirectoryEntry *>(
+                fromLittleEndian32(index->entries[mid]));
+            int cmp=strcmp(name,entry->name);
+            if(cmp==0) return entry;
+            if(cmp<0) hi=mid;
+            else lo=mid+1;
         }
-        if(entry>=end) return nullptr; //Not found
+        return nullptr;
     }
-    return entry;
+    //Images without the index, such as RomFs 2.01, require a linear scan
+    const void *end=ptr(last);
+    auto entry=ptr<const RomFsDirectoryEntry *>(inode+sizeof(RomFsFirstEntry));
+    while(entry<end)
+    {
+        if(strcmp(name,entry->name)==0) return entry;
+        entry=nextEntry(entry);
+    }
+    return nullptr;
 }
 
 } //namespace miosix
@@ -155,8 +155,18 @@ private:
      */
     const RomFsDirectoryEntry *findEntry(StringPart& name);
 
+    /**
+     * \param dir directory entry of the directory where to search
+     * \param name name of a file/directory/symlink in that directory
+     * \return corresponding entry if found, or nullptr
+     */
+    const RomFsDirectoryEntry *findInDirectory(const RomFsDirectoryEntry *dir,
+                                               const char *name);
+
     const char * const base;
-    bool failed; ///< Failed to mount
+    bool failed;      ///< Failed to mount
+    bool sortedIndex; ///< Directories have a sorted name index
+    bool compression; ///< Regular files may be compressed
 };
 
 } //namespace miosix
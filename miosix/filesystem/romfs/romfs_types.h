@@ -35,12 +35,27 @@
 struct RomFsHeader
 {
     char marker[6];            ///< 5 'w' characters, null terminated
-    char fsName[11];           ///< "RomFs 2.00", null terminated
+    char fsName[11];           ///< "RomFs 2.02", null terminated
     char osName[7];            ///< "Miosix", null terminated
     unsigned int imageSize;    ///< Size of the entire filesystem image
-    unsigned int unused;       ///< Reserved for future use, set as 0 for now
+    unsigned int features;     ///< RomFsFeatures bitmask, was unused till 2.01
 };
 
+/**
+ * Optional features of a RomFs image, stored in RomFsHeader::features.
+ * RomFs 2.01 images predate this field, which is always 0 for them
+ */
+enum RomFsFeatures : unsigned int
+{
+    /// Every directory is followed by a RomFsDirectoryIndex
+    ROMFS_SORTED_INDEX=1,
+    /// Regular files may be compressed, see RomFsCompressedFile
+    ROMFS_COMPRESSION=2
+};
+
+/// Bitmask of all features understood by this version of RomFs
+const unsigned int romFsKnownFeatures=ROMFS_SORTED_INDEX | ROMFS_COMPRESSION;
+
 /**
  * Every directory starts with an entry of this type
  */
@@ -61,6 +76,47 @@ struct __attribute__((packed)) RomFsDirectoryEntry
     char name[];              ///< File name, null teminated
 };
 
+/**
+ * Name index of a directory, stored at the first aligned offset after the last
+ * entry of the directory if the ROMFS_SORTED_INDEX feature is set. Allows to
+ * look up a name with a binary search instead of a linear scan
+ */
+struct RomFsDirectoryIndex
+{
+    unsigned int count;     ///< Number of entries in the directory
+    unsigned int entries[]; ///< Entry offsets, sorted by strcmp() of the names
+};
+
+/**
+ * Compression algorithms of RomFsCompressedFile
+ */
+enum RomFsCompression : unsigned char
+{
+    ROMFS_LZ4=1 ///< LZ4 block format, without frame
+};
+
+/**
+ * Header of a compressed regular file. The file content is split in blocks of
+ * 1<<blockShift bytes that are compressed independently, so that seeking only
+ * requires to decompress a single block. A compressed file is marked by
+ * setting romFsCompressedFlag in RomFsDirectoryEntry::inode, while
+ * RomFsDirectoryEntry::size is the uncompressed file size
+ */
+struct RomFsCompressedFile
+{
+    unsigned char algorithm;  ///< One of RomFsCompression
+    unsigned char blockShift; ///< log2 of the uncompressed block size
+    unsigned short unused;    ///< Reserved for future use, set as 0 for now
+    /// Offset of each compressed block from the start of this header, plus the
+    /// end offset of the last block. Blocks whose compressed size is equal to
+    /// their uncompressed size are stored without compression
+    unsigned int blocks[];
+};
+
+/// Set in RomFsDirectoryEntry::inode of compressed regular files. Being file
+/// inodes aligned to at least romFsStructAlignment, this bit is otherwise 0
+const unsigned int romFsCompressedFlag=1;
+
 /// Alignment of all filesystem data structures. Must be a power of 2. Chosen as
 /// 4 bytes for compatibility to architectures without unaligned memory accesses
 const unsigned int romFsStructAlignment=4;
@@ -78,3 +134,6 @@ static_assert(romFsImageAlignment>=romFsStructAlignment,"");
 static_assert(sizeof(RomFsHeader)==32,"");
 static_assert(sizeof(RomFsFirstEntry)==4,"");
 static_assert(sizeof(RomFsDirectoryEntry)==14,"");
+static_assert(sizeof(RomFsDirectoryIndex)==4,"");
+static_assert(sizeof(RomFsCompressedFile)==4,"");
+static_assert(romFsStructAlignment>romFsCompressedFlag,"");
@@ -26,7 +26,9 @@
  ***************************************************************************/
 
 //Makes memrchr available in newer GCCs
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif //_GNU_SOURCE
 #include <string.h>
 
 #include "stringpart.h"
@@ -37,6 +37,8 @@
    || defined(_ARCH_CORTEXM4_ATSAM4L) || defined(_ARCH_CORTEXM3_EFM32G) \
    || defined(_ARCH_CORTEXM0PLUS_STM32L0) || defined(_ARCH_CORTEXM0PLUS_RP2040)
 #include "core/endianness_impl_cortexMx.h"
+#elif defined(_ARCH_LINUX_HOST)
+#include "core/endianness_impl_x86.h"
 #else
 #error "No endianness code for this architecture"
 #endif
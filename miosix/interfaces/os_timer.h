@@ -65,6 +65,34 @@ namespace miosix {
 // application code. For comments about the intended behavior, see kernel.h
 //long long getTime() noexcept;
 //long long IRQgetTime() noexcept;
+
+#ifdef WITH_PROCESSES
+/**
+ * \internal
+ * Data that processes read to compute the current time without a syscall.
+ * It is mapped read-only in the address space of processes, which compute
+ * the time as
+ * \code
+ * tick=upperTick | *counter; //+(1<<counterBits) if the overflow bit is set
+ * ns=tick*tick2nsInteger + (tick*tick2nsFraction)>>32;
+ * \endcode
+ * retrying if sequence changes in the meantime.
+ * NOTE: the layout is duplicated in libsyscalls/crt1.cpp, keep them in sync.
+ */
+struct alignas(32) TimePage
+{
+    unsigned int sequence;            ///< Incremented when upperTick changes
+    const volatile unsigned int *counter; ///< Hardware timer counter register
+    unsigned long long upperTick;     ///< Upper bits of the time in ticks
+    const volatile unsigned int *overflowFlag; ///< Overflow flag register
+    unsigned char overflowBit;        ///< Bit of the overflow flag
+    unsigned char counterBits;        ///< Number of bits of the counter
+    unsigned int tick2nsInteger;      ///< Integer part of the tick2ns factor
+    unsigned int tick2nsFraction;     ///< Fractional part of the tick2ns factor
+};
+
+static_assert(sizeof(TimePage)==32,"TimePage must fit a 32 byte MPU region");
+#endif //WITH_PROCESSES
     
 namespace internal {
 
@@ -117,6 +145,16 @@ void IRQosTimerSetTime(long long ns) noexcept;
  */
 unsigned int osTimerGetFrequency();
 
+#ifdef WITH_PROCESSES
+/**
+ * \internal
+ * It is used by the kernel, and should not be used by end users.
+ * \return the time page, or nullptr if the hardware timer can't be read by
+ * unprivileged code, in this case processes get the time through a syscall
+ */
+const TimePage *osTimerGetTimePage();
+#endif //WITH_PROCESSES
+
 } //namespace internal
 
 /**
@@ -158,6 +196,15 @@ unsigned int osTimerGetFrequency();
  * };
  * \endcode
  * 
+ * If the timer counter and overflow flag can be made readable by unprivileged
+ * code, the derived class can also implement
+ * \code
+ *     static void IRQinitTimePage(TimePage& page) {}
+ * \endcode
+ * to fill the counter, overflowFlag and overflowBit fields of the time page
+ * and make it readable by processes, that will then get the time without
+ * performing a syscall.
+ * 
  * \tparam D the derived class (see curiously recurring template pattern)
  * \tparam bits the bits of the underlying hardware timer, up to 32 bit.
  * \tparam quirkAdvance some timers don't like being set very close to the
@@ -178,6 +225,9 @@ public:
     long long upperIrqTick = 0;  //Extended interrupt time point (upper bits)
     miosix::TimeConversion tc;
     bool lateIrq=false;
+    #ifdef WITH_PROCESSES
+    TimePage timePage={}; //Time page for processes, unused if counter==nullptr
+    #endif //WITH_PROCESSES
     
     /**
      * \return the current time in ticks
@@ -275,6 +325,7 @@ public:
                     lateIrq=true;
                 }
             }
+            IRQupdateTimePage();
         }
         D::IRQstartTimer();
     }
@@ -335,6 +386,7 @@ public:
         {
             D::IRQclearOverflowFlag();
             upperTimeTick += upperIncr;
+            IRQupdateTimePage();
         }
     }
     
@@ -345,9 +397,46 @@ public:
     {
         D::IRQinitTimer();
         tc=TimeConversion(D::IRQTimerFrequency());
+        #ifdef WITH_PROCESSES
+        timePage.counterBits=bits;
+        timePage.tick2nsInteger=tc.getTick2nsConversion().integerPart();
+        timePage.tick2nsFraction=tc.getTick2nsConversion().fractionalPart();
+        D::IRQinitTimePage(timePage);
+        #endif //WITH_PROCESSES
         D::IRQstartTimer();
     }
 
+    #ifdef WITH_PROCESSES
+    /**
+     * Default implementation for timers that can't be read by unprivileged
+     * code, processes will get the time through a syscall
+     * \param page time page
+     */
+    static void IRQinitTimePage(TimePage& page) {}
+
+    /**
+     * \return the time page, or nullptr if processes can't use it
+     */
+    const TimePage *getTimePage() const
+    {
+        return timePage.counter!=nullptr ? &timePage : nullptr;
+    }
+    #endif //WITH_PROCESSES
+
+    /**
+     * Must be called after every change to upperTimeTick.
+     * Since processes can't run while this code is executing, there's no need
+     * to mark the update as in progress, incrementing the sequence afterwards
+     * is enough for processes to notice it
+     */
+    inline void IRQupdateTimePage()
+    {
+        #ifdef WITH_PROCESSES
+        timePage.upperTick=upperTimeTick;
+        timePage.sequence++;
+        #endif //WITH_PROCESSES
+    }
+
     //From here, member functions only useful for specific type of drivers
 
     /**
@@ -359,6 +448,7 @@ public:
     void IRQquirkIncrementUpperCounter()
     {
         upperTimeTick += upperIncr;
+        IRQupdateTimePage();
     }
 
     /**
@@ -375,6 +465,21 @@ public:
 
 } //namespace miosix
 
+/**
+ * \internal
+ * Used by DEFAULT_OS_TIMER_INTERFACE_IMPLMENTATION, expands to nothing if
+ * processes are disabled
+ */
+#ifdef WITH_PROCESSES
+#define DEFAULT_OS_TIMER_TIME_PAGE_IMPLEMENTATION(timer) \
+const TimePage *osTimerGetTimePage()               \
+{                                                  \
+    return timer.getTimePage();                    \
+}
+#else //WITH_PROCESSES
+#define DEFAULT_OS_TIMER_TIME_PAGE_IMPLEMENTATION(timer)
+#endif //WITH_PROCESSES
+
 /**
  * This macro is a shorthand for implementing the os timer interface in terms of
  * the TimerAdapter class. Just declare this macro <b>inside the miosix
@@ -432,6 +537,8 @@ unsigned int osTimerGetFrequency()                 \
     return timer.IRQTimerFrequency();              \
 }                                                  \
                                                    \
+DEFAULT_OS_TIMER_TIME_PAGE_IMPLEMENTATION(timer)   \
+                                                   \
 } //namespace internal
 
 /**
@@ -0,0 +1,206 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "heap_counter.h"
+#include "kernel/kernel.h"
+#include "kernel/process.h"
+#include "stdlib_integration/libc_integration.h"
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <new>
+
+#ifdef WITH_HEAP_COUNTER
+
+using namespace std;
+
+namespace miosix {
+
+extern volatile Thread *runningThread;
+
+HeapCounterRecord HeapCounter::bootRecord;
+HeapCounterRecord *HeapCounter::tail = &HeapCounter::bootRecord;
+volatile unsigned int HeapCounter::nRecords = 1;
+
+void HeapCounter::collect(vector<Data>& data)
+{
+    // Same as CPUProfiler, the vector can't be resized with the kernel paused,
+    // so resize it first and retry if the number of records changed meanwhile
+    for(;;)
+    {
+        unsigned int n = getRecordCount();
+        data.resize(n);
+        PauseKernelLock pLock;
+        if(n != getRecordCount()) continue;
+        auto i1 = data.begin();
+        for(auto i2 = PKbegin(); i2 != PKend(); ++i2) *i1++ = *i2;
+        return;
+    }
+}
+
+HeapCounter::Data HeapCounter::getActiveThreadData()
+{
+    PauseKernelLock pLock;
+    HeapCounterRecord *record = Thread::PKgetCurrentThread()->heapCounter;
+    if(record == nullptr) return Data();
+    return *iterator(record);
+}
+
+string HeapCounter::report()
+{
+    vector<Data> data;
+    collect(data);
+    string result;
+    char line[80];
+    result += "Heap usage by thread\n"
+              "Thread           Pid     Live     Peak   Blocks   Allocs\n";
+    for(auto& d : data)
+    {
+        if(d.thread) sniprintf(line, sizeof(line), "%-10p", d.thread);
+        else strcpy(line, d.terminated ? "terminated" : "boot      ");
+        result += line;
+        sniprintf(line, sizeof(line), " %8d %8u %8u %8u %8u\n",
+            static_cast<int>(d.pid), d.liveBytes, d.peakBytes, d.liveBlocks,
+            d.allocCount);
+        result += line;
+    }
+    #ifdef WITH_PROCESSES
+    result += "Heap usage by process\n"
+              "     Pid     Live   Blocks\n";
+    for(unsigned int i = 0; i < data.size(); i++)
+    {
+        // Print each pid once, summing all the records with that pid
+        bool printed = false;
+        for(unsigned int j = 0; j < i; j++)
+            if(data[j].pid == data[i].pid) printed = true;
+        if(printed) continue;
+        unsigned int liveBytes = 0, liveBlocks = 0;
+        for(unsigned int j = i; j < data.size(); j++)
+        {
+            if(data[j].pid != data[i].pid) continue;
+            liveBytes += data[j].liveBytes;
+            liveBlocks += data[j].liveBlocks;
+        }
+        sniprintf(line, sizeof(line), "%8d %8u %8u\n",
+            static_cast<int>(data[i].pid), liveBytes, liveBlocks);
+        result += line;
+    }
+    #endif //WITH_PROCESSES
+    return result;
+}
+
+HeapCounterRecord *HeapCounter::PKallocated(size_t size)
+{
+    // Can't use PKgetCurrentThread() as before the kernel is started it would
+    // allocate the idle thread, calling back into the memory allocator
+    Thread *cur = const_cast<Thread*>(runningThread);
+    HeapCounterRecord *record;
+    if(cur == nullptr) record = &bootRecord;
+    else if(cur->heapCounter) record = cur->heapCounter;
+    else {
+        void *mem = PKallocateUntracked(sizeof(HeapCounterRecord));
+        if(mem == nullptr) return nullptr;
+        record = new (mem) HeapCounterRecord;
+        record->thread = cur;
+        #ifdef WITH_PROCESSES
+        if(cur->proc) record->pid = cur->proc->getPid();
+        #endif //WITH_PROCESSES
+        record->prev = tail;
+        tail->next = record;
+        tail = record;
+        nRecords++;
+        cur->heapCounter = record;
+    }
+    record->liveBytes += size;
+    if(record->liveBytes > record->peakBytes)
+        record->peakBytes = record->liveBytes;
+    record->liveBlocks++;
+    record->allocCount++;
+    return record;
+}
+
+void HeapCounter::PKdeallocated(HeapCounterRecord *record, size_t size)
+{
+    if(record == nullptr) return;
+    record->liveBytes -= size;
+    record->liveBlocks--;
+    if(record->terminated && record->liveBlocks == 0) PKremoveRecord(record);
+}
+
+void HeapCounter::PKreallocated(HeapCounterRecord *record, size_t oldSize,
+                                size_t newSize)
+{
+    if(record == nullptr) return;
+    record->liveBytes = record->liveBytes - oldSize + newSize;
+    if(record->liveBytes > record->peakBytes)
+        record->peakBytes = record->liveBytes;
+    record->allocCount++;
+}
+
+void HeapCounter::threadDeleted(HeapCounterRecord *record)
+{
+    if(record == nullptr) return;
+    PauseKernelLock pLock;
+    record->thread = nullptr;
+    record->terminated = true;
+    if(record->liveBlocks == 0) PKremoveRecord(record);
+}
+
+void HeapCounter::PKremoveRecord(HeapCounterRecord *record)
+{
+    // The boot record is never removed, so prev is never nullptr
+    record->prev->next = record->next;
+    if(record->next) record->next->prev = record->prev;
+    else tail = record->prev;
+    nRecords--;
+    record->~HeapCounterRecord();
+    PKdeallocateUntracked(record);
+}
+
+#ifdef WITH_DEVFS
+
+ssize_t HeapCounterDevice::readBlock(void *buffer, size_t size, off_t where)
+{
+    string text = HeapCounter::report();
+    if(where >= static_cast<off_t>(text.size())) return 0;
+    size_t len = text.size() - static_cast<size_t>(where);
+    if(len > size) len = size;
+    memcpy(buffer, text.data() + where, len);
+    return len;
+}
+
+ssize_t HeapCounterDevice::writeBlock(const void *buffer, size_t size,
+                                      off_t where)
+{
+    return -EBADF;
+}
+
+#endif //WITH_DEVFS
+
+} //namespace miosix
+
+#endif //WITH_HEAP_COUNTER
@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "config/miosix_settings.h"
+#include <sys/types.h>
+#include <vector>
+#include <string>
+
+#ifdef WITH_HEAP_COUNTER
+
+#ifdef WITH_DEVFS
+#include "filesystem/devfs/devfs.h"
+#endif //WITH_DEVFS
+
+namespace miosix {
+
+class Thread;
+
+/**
+ * \addtogroup Kernel
+ * \{
+ */
+
+/**
+ * \internal
+ * Heap usage counters of a thread. Every allocated block points to the record
+ * of the thread that allocated it, so records of terminated threads are kept
+ * until all the memory they allocated has been freed.
+ */
+struct HeapCounterRecord
+{
+    /// Thread the record belongs to, nullptr for the boot record and for
+    /// terminated threads
+    Thread *thread = nullptr;
+    /// Process the thread belonged to when the record was created
+    pid_t pid = 0;
+    /// True if the thread has terminated
+    bool terminated = false;
+    /// Bytes currently allocated
+    unsigned int liveBytes = 0;
+    /// Maximum value reached by liveBytes
+    unsigned int peakBytes = 0;
+    /// Number of blocks currently allocated
+    unsigned int liveBlocks = 0;
+    /// Cumulative number of allocations, including reallocations
+    unsigned int allocCount = 0;
+    /// Previous record in the list used by HeapCounter
+    HeapCounterRecord *prev = nullptr;
+    /// Next record in the list used by HeapCounter
+    HeapCounterRecord *next = nullptr;
+};
+
+/**
+ * HeapCounter keeps track of how much heap memory each thread has allocated.
+ * It is intended for debugging purposes, such as finding memory leaks, and is
+ * enabled only if the symbol `WITH_HEAP_COUNTER` has been defined in
+ * config/miosix_settings.h. As the counters are maintained by the memory
+ * allocator, `WITH_TLSF_MALLOC` is also required.
+ *
+ * The implementation adds a pointer-sized tag at the end of every heap block,
+ * that points to the counters of the thread that allocated it. This means:
+ *  - Memory freed or reallocated by a thread other than the one that
+ *    allocated it is accounted towards the thread that allocated it.
+ *  - When a thread terminates without freeing all the memory it allocated,
+ *    its counters are kept, and are marked as terminated, until the memory is
+ *    freed. A terminated thread that is never removed from the list is thus
+ *    a likely memory leak.
+ *  - Sizes are the usable size of the blocks, including the tag, and not the
+ *    size passed to malloc.
+ *
+ * Processes have their own heap that is not tracked, what is accounted for a
+ * process is the kernel heap memory allocated by its threads while performing
+ * system calls.
+ *
+ * Retrieving the counters is performed through the iterator returned by
+ * PKbegin(). Keep the kernel paused while you traverse the iterator, and do
+ * not allocate or free memory while doing so. Alternatively, collect() takes
+ * care of copying all the counters in a vector.
+ *
+ * The list accessible through the iterator always satisfies the following
+ * properties:
+ *  - The first item accounts for memory allocated before the kernel was
+ *    started, and has a null thread pointer.
+ *  - The other items are listed in the order in which threads allocated memory
+ *    for the first time. Threads that never allocated memory are not listed.
+ *
+ * When `WITH_DEVFS` is also defined, a text dump of the counters can be read
+ * from /dev/heapstat
+ */
+class HeapCounter
+{
+public:
+    /**
+     * Struct used to return the heap counters for a specific thread.
+     */
+    struct Data
+    {
+        /// The thread the data belongs to, nullptr for the first item and for
+        /// terminated threads
+        Thread *thread = nullptr;
+        /// Process the thread belongs to, 0 for kernel threads
+        pid_t pid = 0;
+        /// True if the thread has terminated
+        bool terminated = false;
+        /// Bytes currently allocated
+        unsigned int liveBytes = 0;
+        /// Maximum number of bytes allocated at the same time
+        unsigned int peakBytes = 0;
+        /// Number of blocks currently allocated
+        unsigned int liveBlocks = 0;
+        /// Cumulative number of allocations, including reallocations
+        unsigned int allocCount = 0;
+    };
+
+    /**
+     * HeapCounter data iterator type
+     */
+    class iterator
+    {
+    public:
+        inline iterator operator++()
+        {
+            cur = cur->next;
+            return *this;
+        }
+        inline iterator operator++(int)
+        {
+            iterator result = *this;
+            cur = cur->next;
+            return result;
+        }
+        inline Data operator*()
+        {
+            Data res;
+            res.thread = cur->thread;
+            res.pid = cur->pid;
+            res.terminated = cur->terminated;
+            res.liveBytes = cur->liveBytes;
+            res.peakBytes = cur->peakBytes;
+            res.liveBlocks = cur->liveBlocks;
+            res.allocCount = cur->allocCount;
+            return res;
+        }
+        inline bool operator==(const iterator& rhs) { return cur==rhs.cur; }
+        inline bool operator!=(const iterator& rhs) { return cur!=rhs.cur; }
+    private:
+        friend class HeapCounter;
+        HeapCounterRecord *cur;
+        iterator(HeapCounterRecord *cur) : cur(cur) {}
+    };
+
+    /**
+     * \returns the number of items in the list.
+     * \warning This method is only provided for the purpose of reserving enough
+     * memory for collecting the data. The value it returns may change at any
+     * time.
+     */
+    static inline unsigned int getRecordCount()
+    {
+        return nRecords;
+    }
+
+    /**
+     * \returns the begin iterator for the heap counters.
+     */
+    static iterator PKbegin()
+    {
+        return iterator(&bootRecord);
+    }
+
+    /**
+     * \returns the end iterator for the heap counters.
+     */
+    static iterator PKend()
+    {
+        return iterator(nullptr);
+    }
+
+    /**
+     * Copy the heap counters of all threads.
+     * \param data the counters are stored here, in the same order as they are
+     * returned by the iterator
+     */
+    static void collect(std::vector<Data>& data);
+
+    /**
+     * \returns the heap counters of the currently active thread.
+     */
+    static Data getActiveThreadData();
+
+    /**
+     * \returns a human readable table of the heap counters of all threads and,
+     * if `WITH_PROCESSES` is defined, the totals for each process.
+     */
+    static std::string report();
+
+    /**
+     * \internal
+     * Called by the memory allocator, with the kernel paused, when a block is
+     * allocated.
+     * \param size size of the block
+     * \return the record the block must be tagged with, can be nullptr if
+     * there was not enough memory to allocate a record
+     */
+    static HeapCounterRecord *PKallocated(size_t size);
+
+    /**
+     * \internal
+     * Called by the memory allocator, with the kernel paused, when a block is
+     * deallocated.
+     * \param record the record the block was tagged with
+     * \param size size of the block
+     */
+    static void PKdeallocated(HeapCounterRecord *record, size_t size);
+
+    /**
+     * \internal
+     * Called by the memory allocator, with the kernel paused, when a block is
+     * reallocated. The block stays accounted to the thread that allocated it.
+     * \param record the record the block was tagged with
+     * \param oldSize size of the block before the reallocation
+     * \param newSize size of the block after the reallocation
+     */
+    static void PKreallocated(HeapCounterRecord *record, size_t oldSize,
+                              size_t newSize);
+
+    /**
+     * \internal
+     * Called when a thread is deleted.
+     * \param record the record of the thread, can be nullptr if the thread
+     * never allocated memory
+     */
+    static void threadDeleted(HeapCounterRecord *record);
+
+private:
+    // HeapCounter cannot be constructed
+    HeapCounter() = delete;
+
+    /**
+     * \internal
+     * Remove a record from the list and free it.
+     */
+    static void PKremoveRecord(HeapCounterRecord *record);
+
+    static HeapCounterRecord bootRecord; ///< Head of the record list
+    static HeapCounterRecord *tail;      ///< Tail of the record list
+    static volatile unsigned int nRecords; ///< Number of records in the list
+};
+
+#ifdef WITH_DEVFS
+
+/**
+ * Device that returns HeapCounter::report() as a text file, installed in DevFs
+ * as /dev/heapstat. The report is generated again on each read, so for a
+ * consistent snapshot read it with a buffer large enough for the entire file.
+ */
+class HeapCounterDevice : public Device
+{
+public:
+    /**
+     * Constructor
+     */
+    HeapCounterDevice() : Device(Device::BLOCK) {}
+
+    /**
+     * Read a block of data
+     * \param buffer buffer where read data will be stored
+     * \param size buffer size
+     * \param where where to read from
+     * \return number of bytes read or a negative number on failure
+     */
+    virtual ssize_t readBlock(void *buffer, size_t size, off_t where);
+
+    /**
+     * Write a block of data
+     * \param buffer buffer where take data to write
+     * \param size buffer size
+     * \param where where to write to
+     * \return number of bytes written or a negative number on failure
+     */
+    virtual ssize_t writeBlock(const void *buffer, size_t size, off_t where);
+};
+
+#endif //WITH_DEVFS
+
+/**
+ * \}
+ */
+
+} //namespace miosix
+
+#endif //WITH_HEAP_COUNTER
@@ -33,6 +33,10 @@
 
 #include <iostream>
 #include <cassert>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
 
 // Unused stubs as the test code only tests IntrusiveList
 inline int atomicSwap(volatile int*, int) { return 0; }
@@ -160,6 +164,102 @@ IntrusiveListItem *IntrusiveListBase::erase(IntrusiveListItem *cur)
     return result;
 }
 
+//
+// class IntrusivePairingHeapBase
+//
+
+void IntrusivePairingHeapBase::push(IntrusivePairingHeapItem *item, LessFn less)
+{
+    if(root==nullptr) root=item;
+    else root=link(root,item,less);
+}
+
+void IntrusivePairingHeapBase::pop(LessFn less)
+{
+    IntrusivePairingHeapItem *removedItem=root;
+    root=mergePairs(removedItem->child,less);
+    removedItem->child=nullptr;
+}
+
+bool IntrusivePairingHeapBase::removeFast(IntrusivePairingHeapItem *item,
+        LessFn less)
+{
+    if(item==root)
+    {
+        pop(less);
+        return true;
+    }
+    if(item->prev==nullptr) return false; //Not in the heap
+    //Detach the subtree rooted at item from its parent
+    if(item->prev->child==item) item->prev->child=item->next;
+    else item->prev->next=item->next;
+    if(item->next!=nullptr) item->next->prev=item->prev;
+    item->next=nullptr;
+    item->prev=nullptr;
+    //Merge back the children of item
+    IntrusivePairingHeapItem *subtree=mergePairs(item->child,less);
+    item->child=nullptr;
+    if(subtree!=nullptr) root=link(root,subtree,less);
+    return true;
+}
+
+IntrusivePairingHeapItem *IntrusivePairingHeapBase::link(
+        IntrusivePairingHeapItem *a, IntrusivePairingHeapItem *b, LessFn less)
+{
+    if(less(b,a))
+    {
+        IntrusivePairingHeapItem *temp=a;
+        a=b;
+        b=temp;
+    }
+    //Make b the leftmost child of a
+    b->next=a->child;
+    if(a->child!=nullptr) a->child->prev=b;
+    b->prev=a;
+    a->child=b;
+    return a;
+}
+
+IntrusivePairingHeapItem *IntrusivePairingHeapBase::mergePairs(
+        IntrusivePairingHeapItem *first, LessFn less)
+{
+    if(first==nullptr) return nullptr;
+    //First pass, left to right, link siblings in pairs. The resulting heaps
+    //are kept in a list in reverse order, using the next pointer
+    IntrusivePairingHeapItem *pairs=nullptr;
+    while(first!=nullptr)
+    {
+        IntrusivePairingHeapItem *a=first;
+        IntrusivePairingHeapItem *b=a->next;
+        a->prev=nullptr;
+        if(b==nullptr)
+        {
+            a->next=pairs;
+            pairs=a;
+            break;
+        }
+        first=b->next;
+        a->next=nullptr;
+        b->next=nullptr;
+        b->prev=nullptr;
+        a=link(a,b,less);
+        a->next=pairs;
+        pairs=a;
+    }
+    //Second pass, right to left, link all the heaps into a single one
+    IntrusivePairingHeapItem *result=pairs;
+    pairs=pairs->next;
+    result->next=nullptr;
+    while(pairs!=nullptr)
+    {
+        IntrusivePairingHeapItem *h=pairs;
+        pairs=pairs->next;
+        h->next=nullptr;
+        result=link(result,h,less);
+    }
+    return result;
+}
+
 #ifdef INTRUSIVE_LIST_ERROR_CHECK
 #warning "INTRUSIVE_LIST_ERROR_CHECK should not be enabled in release builds"
 void IntrusiveListBase::fail()
@@ -174,7 +274,7 @@ void IntrusiveListBase::fail()
 
 } //namespace miosix
 
-//Testsuite for IntrusiveList. Compile with:
+//Testsuite for IntrusiveList and IntrusivePairingHeap. Compile with:
 //g++ -DTEST_ALGORITHM -DINTRUSIVE_LIST_ERROR_CHECK -fsanitize=address -m32
 //    -std=c++14 -Wall -O2 -o test intrusive.cpp; ./test
 #ifdef TEST_ALGORITHM
@@ -299,6 +399,140 @@ void threeItemCheck(IntrusiveList<IntrusiveListItem>& list, IntrusiveListItem& a
     assert(c.next==nullptr);
 }
 
+class HeapTestItem : public IntrusivePairingHeapItem
+{
+public:
+    HeapTestItem(long long key=0) : key(key) {}
+    long long key;
+};
+
+class HeapTestListItem : public IntrusiveListItem
+{
+public:
+    HeapTestListItem(long long key=0) : key(key) {}
+    long long key;
+};
+
+struct HeapTestCompare
+{
+    bool operator()(const HeapTestItem& a, const HeapTestItem& b) const
+    {
+        return a.key<b.key;
+    }
+};
+
+typedef IntrusivePairingHeap<HeapTestItem,HeapTestCompare> TestHeap;
+
+void emptyCheck(HeapTestItem& x)
+{
+    //Glass box check
+    assert(x.child==nullptr); assert(x.next==nullptr); assert(x.prev==nullptr);
+}
+
+/**
+ * Randomized test of the pairing heap against a sorted std::vector
+ */
+void heapRandomTest()
+{
+    mt19937 rng(0);
+    const int numItems=1000;
+    vector<HeapTestItem> items(numItems);
+    vector<bool> inHeap(numItems,false);
+    vector<long long> keys; //Keys in the heap, kept sorted
+    TestHeap heap;
+    for(int iter=0;iter<100000;iter++)
+    {
+        int i=rng()%numItems;
+        switch(rng()%3)
+        {
+            case 0: //push
+                if(inHeap[i]) break;
+                items[i].key=rng()%10000;
+                heap.push(&items[i]);
+                inHeap[i]=true;
+                keys.insert(upper_bound(keys.begin(),keys.end(),items[i].key),
+                            items[i].key);
+                break;
+            case 1: //pop
+                if(heap.empty()) break;
+                assert(heap.top()->key==keys.front());
+                inHeap[heap.top()-&items[0]]=false;
+                {
+                    HeapTestItem *t=heap.top();
+                    heap.pop();
+                    emptyCheck(*t);
+                }
+                keys.erase(keys.begin());
+                break;
+            case 2: //removeFast
+                assert(heap.removeFast(&items[i])==inHeap[i]);
+                emptyCheck(items[i]);
+                if(inHeap[i]==false) break;
+                inHeap[i]=false;
+                keys.erase(lower_bound(keys.begin(),keys.end(),items[i].key));
+                break;
+        }
+        assert(heap.empty()==keys.empty());
+        if(!heap.empty()) assert(heap.top()->key==keys.front());
+    }
+    while(!heap.empty())
+    {
+        assert(heap.top()->key==keys.front());
+        heap.pop();
+        keys.erase(keys.begin());
+    }
+    assert(keys.empty());
+}
+
+/**
+ * Compare the cost of adding an item to a sorted IntrusiveList, as the kernel
+ * used to do for the sleeping threads, and to an IntrusivePairingHeap, as a
+ * function of the number of items already present.
+ */
+void heapBenchmark()
+{
+    cout<<"n,sorted list insert (ns),pairing heap insert (ns)"<<endl;
+    mt19937 rng(0);
+    for(int n=1;n<=1024;n*=2)
+    {
+        const int iterations=100000/n+100;
+        vector<HeapTestListItem> listItems(n+1);
+        vector<HeapTestItem> heapItems(n+1);
+        for(int i=0;i<=n;i++) listItems[i].key=heapItems[i].key=rng()%1000000;
+        IntrusiveList<HeapTestListItem> list;
+        TestHeap heap;
+        for(int i=0;i<n;i++)
+        {
+            auto it=list.begin();
+            while(it!=list.end() && (*it)->key<listItems[i].key) ++it;
+            list.insert(it,&listItems[i]);
+            heap.push(&heapItems[i]);
+        }
+        //Repeatedly add and remove the same item, in a worst case position
+        auto *li=&listItems[n];
+        auto *hi=&heapItems[n];
+        li->key=hi->key=1000000;
+        auto t0=chrono::steady_clock::now();
+        for(int j=0;j<iterations;j++)
+        {
+            auto it=list.begin();
+            while(it!=list.end() && (*it)->key<li->key) ++it;
+            list.insert(it,li);
+            list.removeFast(li);
+        }
+        auto t1=chrono::steady_clock::now();
+        for(int j=0;j<iterations;j++)
+        {
+            heap.push(hi);
+            heap.removeFast(hi);
+        }
+        auto t2=chrono::steady_clock::now();
+        cout<<n<<','
+            <<chrono::duration<double,nano>(t1-t0).count()/iterations<<','
+            <<chrono::duration<double,nano>(t2-t1).count()/iterations<<endl;
+    }
+}
+
 int main()
 {
     IntrusiveListItem a,b,c;
@@ -405,7 +639,34 @@ int main()
     emptyCheck(list);
     emptyCheck(a);
 
+    //
+    // Testing IntrusivePairingHeap
+    //
+    {
+        HeapTestItem x(3), y(1), z(2);
+        TestHeap heap;
+        assert(heap.empty());
+        assert(heap.removeFast(&x)==false); //Not present, heap empty
+        heap.push(&x);
+        assert(heap.top()==&x);
+        assert(heap.removeFast(&y)==false); //Not present, heap not empty
+        heap.push(&y);
+        heap.push(&z);
+        assert(heap.top()==&y);
+        assert(heap.removeFast(&z)==true); //Present, not at the top
+        emptyCheck(z);
+        assert(heap.top()==&y);
+        assert(heap.removeFast(&y)==true); //Present, at the top
+        emptyCheck(y);
+        assert(heap.top()==&x);
+        heap.pop();
+        emptyCheck(x);
+        assert(heap.empty());
+    }
+    heapRandomTest();
+
     cout<<"Test passed"<<endl;
+    heapBenchmark();
     return 0;
 }
 
@@ -401,14 +401,17 @@ intrusive_ref_ptr<T> intrusive_ref_ptr<T>::atomic_exchange(
     T *temp=r.object;
     if(temp) atomicAdd(&temp->intrusive.referenceCount,1);
     
+    #if __SIZEOF_POINTER__==__SIZEOF_INT__
     // Check that the following reinterpret_casts will work as intended.
-    // This also means that this code won't work on 64bit machines but for
-    // Miosix this isn't a problem for now.
     static_assert(sizeof(void*)==sizeof(int),"");
     
     int tempInt=reinterpret_cast<int>(temp);
     volatile int *objectAddrInt=reinterpret_cast<volatile int*>(&object);
     temp=reinterpret_cast<T*>(atomicSwap(objectAddrInt,tempInt));
+    #else //__SIZEOF_POINTER__==__SIZEOF_INT__
+    // On 64bit machines pointers do not fit in an int
+    temp=__atomic_exchange_n(&object,temp,__ATOMIC_SEQ_CST);
+    #endif //__SIZEOF_POINTER__==__SIZEOF_INT__
     
     intrusive_ref_ptr<T> result; // This gets initialized with nullptr
     // This does not increment referenceCount, as the pointer was swapped
@@ -865,4 +868,147 @@ public:
     bool empty() const { return IntrusiveListBase::empty(); }
 };
 
+//Forward declarations
+class IntrusivePairingHeapBase;
+template<typename T, typename Compare>
+class IntrusivePairingHeap;
+
+/**
+ * Base class from which all items to be put in an IntrusivePairingHeap must
+ * derive, contains the pointers that create the heap
+ */
+class IntrusivePairingHeapItem
+{
+private:
+    IntrusivePairingHeapItem *child=nullptr; ///< Leftmost child
+    IntrusivePairingHeapItem *next=nullptr;  ///< Right sibling
+    ///Left sibling, or parent if this is the leftmost child
+    IntrusivePairingHeapItem *prev=nullptr;
+
+    friend class IntrusivePairingHeapBase;
+    template<typename T, typename Compare>
+    friend class IntrusivePairingHeap;
+};
+
+/**
+ * \internal
+ * Base class of IntrusivePairingHeap with the non-template-dependent part to
+ * improve code size when instantiationg multiple IntrusivePairingHeaps
+ */
+class IntrusivePairingHeapBase
+{
+protected:
+    /// Type of the function used to compare items, returns true if a<b
+    typedef bool (*LessFn)(IntrusivePairingHeapItem *a, IntrusivePairingHeapItem *b);
+
+    IntrusivePairingHeapBase() : root(nullptr) {}
+
+    void push(IntrusivePairingHeapItem *item, LessFn less);
+
+    void pop(LessFn less);
+
+    bool removeFast(IntrusivePairingHeapItem *item, LessFn less);
+
+    IntrusivePairingHeapItem *top() { return root; }
+
+    bool empty() const { return root==nullptr; }
+
+private:
+    /**
+     * Link two heaps whose roots have no siblings
+     * \param a first heap, must not be nullptr
+     * \param b second heap, must not be nullptr
+     * \param less comparison function
+     * \return the root of the resulting heap
+     */
+    static IntrusivePairingHeapItem *link(IntrusivePairingHeapItem *a,
+            IntrusivePairingHeapItem *b, LessFn less);
+
+    /**
+     * Two pass merge of a list of siblings, implemented without recursion as
+     * it is called from IRQ context where stack space is scarce
+     * \param first leftmost sibling, can be nullptr
+     * \param less comparison function
+     * \return the root of the resulting heap, or nullptr if first is nullptr
+     */
+    static IntrusivePairingHeapItem *mergePairs(IntrusivePairingHeapItem *first,
+            LessFn less);
+
+    IntrusivePairingHeapItem *root;
+};
+
+/**
+ * A min priority queue implemented as a pairing heap that only accepts objects
+ * that derive from IntrusivePairingHeapItem.
+ *
+ * Like IntrusiveList, no dynamic memory allocation is performed and the caller
+ * is responsible for managing the lifetime of the objects put in the heap.
+ * Insertion is O(1), while removing the top item or an arbitrary item is
+ * O(log n) amortized.
+ *
+ * \tparam T type of the items, must derive from IntrusivePairingHeapItem
+ * \tparam Compare a default constructible function object whose operator()
+ * takes two const T& and returns true if the first is less than the second.
+ * The least item is at the top of the heap
+ */
+template<typename T, typename Compare>
+class IntrusivePairingHeap : private IntrusivePairingHeapBase
+{
+public:
+    /**
+     * Constructor, produces an empty heap
+     */
+    IntrusivePairingHeap() {}
+
+    /**
+     * Disabled copy constructor and operator=
+     * Since intrusive heaps do not store objects by value, and an item can
+     * only belong to at most one heap, intrusive heaps are not copyable.
+     */
+    IntrusivePairingHeap(const IntrusivePairingHeap&)=delete;
+    IntrusivePairingHeap& operator=(const IntrusivePairingHeap&)=delete;
+
+    /**
+     * Adds an item to the heap
+     * \param item item to add
+     */
+    void push(T *item) { IntrusivePairingHeapBase::push(item,less); }
+
+    /**
+     * Removes the top item of the heap. Heap must not be empty
+     */
+    void pop() { IntrusivePairingHeapBase::pop(less); }
+
+    /**
+     * Remove an arbitrary item from the heap
+     * NOTE: can ONLY be called if you are sure the item to remove is either not
+     * in any heap (in this case, nothing is done) or is in the heap it is being
+     * removed from. Trying to remove an item that is present in another heap
+     * produces undefined bahavior.
+     * \param item item to remove, must not be nullptr
+     * \return true if the item was removed, false if the item was not present
+     * in the heap
+     */
+    bool removeFast(T *item)
+    {
+        return IntrusivePairingHeapBase::removeFast(item,less);
+    }
+
+    /**
+     * \return a pointer to the least item. Heap must not be empty
+     */
+    T* top() { return static_cast<T*>(IntrusivePairingHeapBase::top()); }
+
+    /**
+     * \return true if the heap is empty
+     */
+    bool empty() const { return IntrusivePairingHeapBase::empty(); }
+
+private:
+    static bool less(IntrusivePairingHeapItem *a, IntrusivePairingHeapItem *b)
+    {
+        return Compare()(*static_cast<T*>(a),*static_cast<T*>(b));
+    }
+};
+
 } //namespace miosix
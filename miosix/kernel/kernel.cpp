@@ -33,6 +33,7 @@
 #include "sync.h"
 #include "stage_2_boot.h"
 #include "process.h"
+#include "heap_counter.h"
 #include "kernel/scheduler/scheduler.h"
 #include "stdlib_integration/libc_integration.h"
 #include "interfaces/os_timer.h"
@@ -65,7 +66,7 @@ volatile Thread *runningThread=nullptr;///<\internal Thread currently running
 ///\internal True if there are threads in the DELETED status. Used by idle thread
 static volatile bool existDeleted=false;
 
-IntrusiveList<SleepData> sleepingList;///list of sleeping threads
+SleepingList sleepingList;///list of sleeping threads
 
 ///\internal !=0 after pauseKernel(), ==0 after restartKernel()
 volatile int kernelRunning=0;
@@ -121,7 +122,7 @@ void *idleThread(void *argv)
             {
                 if(sleepingList.empty()==false)
                 {
-                    long long wakeup=sleepingList.front()->wakeupTime;
+                    long long wakeup=sleepingList.top()->wakeupTime;
                     sleep=!IRQdeepSleep(wakeup);
                 } else sleep=!IRQdeepSleep();
             } else sleep=true;
@@ -269,25 +270,6 @@ bool isKernelRunning()
 //long long getTime() noexcept
 //long long IRQgetTime() noexcept
 
-/**
- * \internal
- * Used by Thread::sleep() and pthread_cond_timedwait() to add a thread to
- * sleeping list. The list is sorted by the wakeupTime field to reduce time
- * required to wake threads during context switch.
- * Interrupts must be disabled prior to calling this function.
- */
-static void IRQaddToSleepingList(SleepData *x)
-{
-    if(sleepingList.empty() || sleepingList.front()->wakeupTime>=x->wakeupTime)
-    {
-        sleepingList.push_front(x);
-    } else {
-        auto it=sleepingList.begin();
-        while(it!=sleepingList.end() && (*it)->wakeupTime<x->wakeupTime) ++it;
-        sleepingList.insert(it,x);
-    }
-}
-
 /**
  * \internal
  * Called to check if it's time to wake some thread.
@@ -300,16 +282,17 @@ bool IRQwakeThreads(long long currentTime)
     if(sleepingList.empty()) return false; //If no item in list, return
     
     bool result=false;
-    //Since list is sorted, if we don't need to wake the first element
-    //we don't need to wake the other too
-    for(auto it=sleepingList.begin();it!=sleepingList.end();)
+    //Since the top of the heap is the first thread to wake, if we don't need
+    //to wake it we don't need to wake the others too
+    while(sleepingList.empty()==false)
     {
-        if(currentTime<(*it)->wakeupTime) break;
+        SleepData *d=sleepingList.top();
+        if(currentTime<d->wakeupTime) break;
         //Wake both threads doing absoluteSleep() and timedWait()
-        (*it)->thread->flags.IRQclearSleepAndWait();
-        if(const_cast<Thread*>(runningThread)->IRQgetPriority()<(*it)->thread->IRQgetPriority())
+        d->thread->flags.IRQclearSleepAndWait();
+        if(const_cast<Thread*>(runningThread)->IRQgetPriority()<d->thread->IRQgetPriority())
             result=true;
-        it=sleepingList.erase(it);
+        sleepingList.pop();
     }
     return result;
 }
@@ -391,7 +374,7 @@ void Thread::nanoSleepUntil(long long absoluteTimeNs)
         FastInterruptDisableLock dLock;
         SleepData d(const_cast<Thread*>(runningThread),absoluteTimeNs);
         d.thread->flags.IRQsetSleep(); //Sleeping thread: set sleep flag
-        IRQaddToSleepingList(&d);
+        sleepingList.push(&d);
         {
             FastInterruptEnableLock eLock(dLock);
             Thread::yield();
@@ -519,8 +502,7 @@ void Thread::setPriority(Priority pr)
         Mutex *walk=running->mutexLocked;
         while(walk!=nullptr)
         {
-            if(walk->waiting.empty()==false)
-                pr=std::max(pr,walk->waiting.front()->PKgetPriority());
+            pr=walk->PKinheritedPriority(pr);
             walk=walk->next;
         }
     }
@@ -541,6 +523,12 @@ void Thread::terminate()
     if(this->flags.isDeleting()) return; //Prevent sleep interruption abuse
     this->flags.IRQsetDeleting();
     this->flags.IRQclearSleepAndWait(); //Interruptibility
+    #ifdef WITH_PROCESSES
+    //A process thread running userspace code may never perform a syscall, so
+    //make it resume in kernelspace, right after the SVC that brought it to
+    //userspace, where it will notice that it has to terminate
+    this->flags.IRQsetUserspace(false);
+    #endif //WITH_PROCESSES
 }
 
 bool Thread::testTerminate()
@@ -627,6 +615,20 @@ int Thread::getStackSize()
     return getCurrentThread()->stacksize;
 }
 
+/**
+ * \internal
+ * \param ctxsave saved registers of a thread
+ * \return the saved stack pointer, which on 64 bit architectures spans two
+ * words of ctxsave
+ */
+static inline uintptr_t savedStackPointer(const volatile unsigned int *ctxsave)
+{
+    uintptr_t result;
+    memcpy(&result,const_cast<const unsigned int*>(ctxsave)
+           +stackPtrOffsetInCtxsave,sizeof(result));
+    return result;
+}
+
 void Thread::IRQstackOverflowCheck()
 {
     const unsigned int watermarkSize=WATERMARK_LEN/sizeof(unsigned int);
@@ -636,16 +638,16 @@ void Thread::IRQstackOverflowCheck()
         bool overflow=false;
         for(unsigned int i=0;i<watermarkSize;i++)
             if(runningThread->userWatermark[i]!=WATERMARK_FILL) overflow=true;
-        if(runningThread->userCtxsave[stackPtrOffsetInCtxsave] <
-            reinterpret_cast<unsigned int>(runningThread->userWatermark+watermarkSize))
+        if(savedStackPointer(runningThread->userCtxsave) <
+            reinterpret_cast<uintptr_t>(runningThread->userWatermark+watermarkSize))
             overflow=true;
         if(overflow) IRQreportFault(miosix_private::FaultData(fault::STACKOVERFLOW,0));
     } else {
     #endif //WITH_PROCESSES
     for(unsigned int i=0;i<watermarkSize;i++)
         if(runningThread->watermark[i]!=WATERMARK_FILL) errorHandler(STACK_OVERFLOW);
-    if(runningThread->ctxsave[stackPtrOffsetInCtxsave] <
-        reinterpret_cast<unsigned int>(runningThread->watermark+watermarkSize))
+    if(savedStackPointer(runningThread->ctxsave) <
+        reinterpret_cast<uintptr_t>(runningThread->watermark+watermarkSize))
         errorHandler(STACK_OVERFLOW);
     #ifdef WITH_PROCESSES
     }
@@ -659,6 +661,8 @@ void Thread::IRQhandleSvc(unsigned int svcNumber)
     if(runningThread->proc==kernel) errorHandler(UNEXPECTED);
     if(svcNumber==static_cast<unsigned int>(Syscall::USERSPACE))
     {
+        //A thread that has to terminate shall not go back to userspace
+        if(const_cast<Thread*>(runningThread)->flags.isDeleting()) return;
         const_cast<Thread*>(runningThread)->flags.IRQsetUserspace(true);
         ::ctxsave=runningThread->userCtxsave;
         //We know it's not the kernel, so the cast is safe
@@ -689,9 +693,10 @@ miosix_private::SyscallParameters Thread::switchToUserspace()
     return result;
 }
 
-Thread *Thread::createUserspace(void *(*startfunc)(void *), Process *proc)
+Thread *Thread::createUserspace(void *(*startfunc)(void *), void *argv,
+        Process *proc)
 {
-    Thread *thread=doCreate(startfunc,SYSTEM_MODE_PROCESS_STACK_SIZE,nullptr,
+    Thread *thread=doCreate(startfunc,SYSTEM_MODE_PROCESS_STACK_SIZE,argv,
             Thread::DEFAULT,false);
     if(thread==nullptr) return nullptr;
 
@@ -735,9 +740,9 @@ void Thread::setupUserspaceContext(unsigned int entry, int argc, void *argvSp,
     //Initialize registers
     void *(*startfunc)(void*)=reinterpret_cast<void *(*)(void*)>(entry);
     //NOTE: for the main thread in a process userWatermark is also the end of
-    //the heap, used by _sbrk_r. When we'll implement threads in processes that
-    //pointer will just point to the watermark end of the thread, but userspace
-    //threads can just ignore that value so we'll pass it unconditionally
+    //the heap, used by _sbrk_r. For the other threads it just points to the
+    //watermark end of the thread, but they ignore that value so we pass it
+    //unconditionally
     miosix_private::initCtxsave(runningThread->userCtxsave,startfunc,
         argc,argvSp,envp,gotBase,runningThread->userWatermark);
 }
@@ -759,6 +764,9 @@ Thread::Thread(unsigned int *watermark, unsigned int stacksize,
     proc=kernel;
     userCtxsave=nullptr;
     #endif //WITH_PROCESSES
+    #ifdef WITH_HEAP_COUNTER
+    heapCounter=nullptr;
+    #endif //WITH_HEAP_COUNTER
 }
 
 Thread::~Thread()
@@ -771,6 +779,9 @@ Thread::~Thread()
     #ifdef WITH_PROCESSES
     if(userCtxsave) delete[] userCtxsave;
     #endif //WITH_PROCESSES
+    #ifdef WITH_HEAP_COUNTER
+    HeapCounter::threadDeleted(heapCounter);
+    #endif //WITH_HEAP_COUNTER
 }
 
 Thread *Thread::doCreate(void*(*startfunc)(void*) , unsigned int stacksize,
@@ -874,7 +885,7 @@ TimedWaitResult Thread::IRQenableIrqAndTimedWaitImpl(long long absoluteTimeNs)
     Thread *t=const_cast<Thread*>(runningThread);
     SleepData sleepData(t,absoluteTimeNs);
     t->flags.IRQsetWait(true); //timedWait thread: set wait flag
-    IRQaddToSleepingList(&sleepData);
+    sleepingList.push(&sleepData);
     auto savedNesting=interruptDisableNesting; //For InterruptDisableLock
     interruptDisableNesting=0;
     miosix_private::doEnableInterrupts();
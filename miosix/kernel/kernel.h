@@ -438,10 +438,12 @@ enum class TimedWaitResult
 class SleepData;
 class MemoryProfiling;
 class Mutex;
+class MutexWaitToken;
 class ConditionVariable;
 #ifdef WITH_PROCESSES
 class ProcessBase;
 #endif //WITH_PROCESSES
+struct HeapCounterRecord;
 
 /**
  * This class represents a thread. It has methods for creating, deleting and
@@ -1100,9 +1102,11 @@ private:
      * Create a thread to be used inside a process. The thread is created in
      * WAIT status, a wakeup() on it is required to actually start it.
      * \param startfunc entry point
+     * \param argv argument passed to the entry point
      * \param proc process to which this thread belongs
      */
-    static Thread *createUserspace(void *(*startfunc)(void *), Process *proc);
+    static Thread *createUserspace(void *(*startfunc)(void *), void *argv,
+            Process *proc);
     
     /**
      * Setup the userspace context of the thread, so that it can be later
@@ -1200,8 +1204,9 @@ private:
     Priority savedPriority;
     ///List of mutextes locked by this thread
     Mutex *mutexLocked;
-    ///If the thread is waiting on a Mutex, mutexWaiting points to that Mutex
-    Mutex *mutexWaiting;
+    ///If the thread is waiting on a Mutex, mutexWaiting points to the token
+    ///that links the thread in the Mutex waiting queue
+    MutexWaitToken *mutexWaiting;
     unsigned int *watermark;///< pointer to watermark area
     unsigned int ctxsave[CTXSAVE_SIZE];///< Holds cpu registers during ctxswitch
     unsigned int stacksize;///< Contains stack size
@@ -1230,6 +1235,10 @@ private:
     #ifdef WITH_CPU_TIME_COUNTER
     CPUTimeCounterPrivateThreadData timeCounterData;
     #endif //WITH_CPU_TIME_COUNTER
+    #ifdef WITH_HEAP_COUNTER
+    ///Heap usage counters, nullptr if the thread never allocated memory
+    HeapCounterRecord *heapCounter;
+    #endif //WITH_HEAP_COUNTER
     
     //friend functions
     //Needs access to flags
@@ -1257,6 +1266,10 @@ private:
     //Needs access to timeCounterData
     friend class CPUTimeCounter;
     #endif //WITH_CPU_TIME_COUNTER
+    #ifdef WITH_HEAP_COUNTER
+    //Needs access to heapCounter and proc
+    friend class HeapCounter;
+    #endif //WITH_HEAP_COUNTER
 };
 
 /**
@@ -1264,7 +1277,7 @@ private:
  * This class is used to make a list of sleeping threads.
  * It is used by the kernel, and should not be used by end users.
  */
-class SleepData : public IntrusiveListItem
+class SleepData : public IntrusivePairingHeapItem
 {
 public:
     SleepData(Thread *thread, long long wakeupTime)
@@ -1278,6 +1291,43 @@ public:
     long long wakeupTime;
 };
 
+/**
+ * \internal
+ * This class is used to make the priority ordered queue of threads waiting to
+ * lock a Mutex. It is allocated on the stack of the waiting thread, so locking
+ * a contended Mutex never allocates memory.
+ */
+class MutexWaitToken : public IntrusivePairingHeapItem
+{
+public:
+    MutexWaitToken(Thread *thread, Mutex *mutex) : thread(thread), mutex(mutex) {}
+
+    ///\internal Thread that is waiting
+    Thread *thread;
+
+    ///\internal Mutex the thread is waiting on
+    Mutex *mutex;
+};
+
+/**
+ * \internal
+ * Function object to sort sleeping threads by wakeup time
+ */
+struct SleepDataCompare
+{
+    bool operator()(const SleepData& a, const SleepData& b) const
+    {
+        return a.wakeupTime<b.wakeupTime;
+    }
+};
+
+/**
+ * \internal
+ * Type of the list of sleeping threads. It is a priority queue so that the
+ * time to add a thread does not depend on the number of sleeping threads.
+ */
+typedef IntrusivePairingHeap<SleepData,SleepDataCompare> SleepingList;
+
 /**
  * \}
  */
@@ -41,6 +41,9 @@
 #include "sync.h"
 #include "process_pool.h"
 #include "process.h"
+#include "filesystem/pipe/pipe.h"
+#include "stdlib_integration/pipe_fcntl.h"
+#include "interfaces/os_timer.h"
 
 using namespace std;
 
@@ -140,7 +143,8 @@ pid_t Process::create(ElfProgram&& program, ArgsBlock&& args)
         parent->childs.push_back(proc.get());
         p.processes[proc->pid]=proc.get();
     }
-    auto thr=Thread::createUserspace(Process::start,proc.get());
+    //The main thread is started with a null argument
+    auto thr=Thread::createUserspace(Process::start,nullptr,proc.get());
     if(thr==nullptr)
     {
         Lock<Mutex> l(p.procMutex);
@@ -148,11 +152,12 @@ pid_t Process::create(ElfProgram&& program, ArgsBlock&& args)
         parent->childs.remove(proc.get());
         throw runtime_error("Thread creation failed");
     }
-    //Cannot throw bad_alloc due to the reserve in Process's constructor.
-    //This ensures we will never be in the uncomfortable situation where a
-    //thread has already been created but there's no memory to list it
+    //Cannot throw bad_alloc as the main thread entry was inserted in Process's
+    //constructor. This ensures we will never be in the uncomfortable situation
+    //where a thread has already been created but there's no memory to list it
     //among the threads of a process
-    proc->threads.push_back(thr);
+    proc->threads[0].thread=thr;
+    proc->liveThreads=1;
     thr->wakeup(); //Actually start the thread, now that everything is set up
     pid_t result=proc->pid;
     proc.release(); //Do not delete the pointer
@@ -241,11 +246,12 @@ pid_t Process::waitpid(pid_t pid, int* exit, int options)
 Process::~Process() {}
 
 Process::Process(const FileDescriptorTable& fdt, ElfProgram&& program,
-        ArgsBlock&& args) : ProcessBase(fdt), waitCount(0), zombie(false)
+        ArgsBlock&& args) : ProcessBase(fdt), waitCount(0), zombie(false),
+        exitCode(0)
 {
     //This is required so that bad_alloc can never be thrown when the first
-    //thread of the process will be stored in this vector
-    threads.reserve(1);
+    //thread of the process will be stored in this map
+    threads[0];
     load(std::move(program),std::move(args));
 }
 
@@ -288,41 +294,42 @@ void Process::load(ElfProgram&& program, ArgsBlock&& args)
             image.getProcessBasePointer(),image.getProcessImageSize());
 }
 
-void *Process::start(void *)
+void *Process::start(void *argv)
 {
     //This function is never called with a kernel thread, so the cast is safe
     Process *proc=static_cast<Process*>(Thread::getCurrentThread()->proc);
-    bool running=true;
-    do {
-        unsigned int entry=proc->program.getEntryPoint();
-        Thread::setupUserspaceContext(entry,proc->argc,proc->argvSp,proc->envp,
-            proc->image.getProcessBasePointer(),proc->image.getMainStackSize());
-        SvcResult svcResult=Resume;
-        do {
-            miosix_private::SyscallParameters sp=Thread::switchToUserspace();
-
-            bool fault=proc->fault.faultHappened();
-            //Handle svc only if no fault occurred
-            if(fault==false) svcResult=proc->handleSvc(sp);
-
-            if(Thread::testTerminate() || svcResult==Exit) running=false;
-            if(fault || svcResult==Segfault)
-            {
-                running=false;
-                proc->exitCode=SIGSEGV; //Segfault
-                #ifdef WITH_ERRLOG
-                iprintf("Process %d terminated due to a fault\n"
-                        "* Code base address was 0x%x\n"
-                        "* Data base address was %p\n",proc->pid,
-                        proc->program.getElfBase(),
-                        proc->image.getProcessBasePointer());
-                proc->mpu.dumpConfiguration();
-                if(fault) proc->fault.print();
-                #endif //WITH_ERRLOG
-            }
-        } while(running && svcResult!=Execve);
-        if(svcResult==Execve) proc->fileTable.cloexec();
-    } while(running);
+    //The main thread is started with a null argv, the other ones with their
+    //ThreadInfo, whose fields are set before the thread is started
+    ThreadInfo info;
+    if(argv) info=*static_cast<ThreadInfo*>(argv);
+    for(;;)
+    {
+        auto gotBase=proc->image.getProcessBasePointer();
+        if(argv==nullptr)
+        {
+            unsigned int entry=proc->program.getEntryPoint();
+            Thread::setupUserspaceContext(entry,proc->argc,proc->argvSp,
+                proc->envp,gotBase,proc->image.getMainStackSize());
+        } else {
+            Thread::setupUserspaceContext(info.entry,info.arg,
+                info.stackBase+info.stackSize,nullptr,gotBase,
+                info.stackSize-WATERMARK_LEN);
+        }
+        if(proc->runUserspace()!=Execve) break;
+        proc->fileTable.cloexec();
+        argv=nullptr; //The thread that called execve is the new main thread
+    }
+
+    bool last;
+    {
+        Lock<FastMutex> l(proc->threadMutex);
+        proc->currentThreadInfo()->second.thread=nullptr;
+        last=--proc->liveThreads==0;
+        proc->threadExited.broadcast();
+    }
+    //The last thread to exit terminates the process. The other threads must
+    //not touch the Process after this point, as it may be deleted by waitpid
+    if(last==false) return nullptr;
     proc->fileTable.closeAll();
     {
         Processes& p=Processes::instance();
@@ -347,6 +354,39 @@ void *Process::start(void *)
     return nullptr;
 }
 
+Process::SvcResult Process::runUserspace()
+{
+    for(;;)
+    {
+        miosix_private::SyscallParameters sp=Thread::switchToUserspace();
+        //A thread terminated while running userspace code gets here without
+        //having performed a syscall, so sp must not be used
+        if(Thread::testTerminate()) return ThreadExit;
+
+        bool faulted=fault.faultHappened();
+        //Handle svc only if no fault occurred
+        SvcResult svcResult=faulted ? Segfault : handleSvc(sp);
+        if(svcResult==Segfault)
+        {
+            {
+                Lock<FastMutex> l(threadMutex);
+                terminateProcess(SIGSEGV); //Segfault
+            }
+            #ifdef WITH_ERRLOG
+            iprintf("Process %d terminated due to a fault\n"
+                    "* Code base address was 0x%x\n"
+                    "* Data base address was %p\n",pid,
+                    program.getElfBase(),image.getProcessBasePointer());
+            mpu.dumpConfiguration();
+            if(faulted) fault.print();
+            #endif //WITH_ERRLOG
+            return Segfault;
+        }
+        if(svcResult!=Resume) return svcResult;
+        if(Thread::testTerminate()) return ThreadExit;
+    }
+}
+
 Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
 {
     try {
@@ -409,6 +449,80 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                 break;
             }
 
+            //The 64 bit offset of pread, pwrite, preadv and pwritev does not
+            //fit in the syscall parameters, the last one points to it instead
+            case Syscall::PREAD:
+            {
+                int fd=sp.getParameter(0);
+                void *ptr=reinterpret_cast<void*>(sp.getParameter(1));
+                size_t size=sp.getParameter(2);
+                auto pos=reinterpret_cast<const off_t*>(sp.getParameter(3));
+                if(mpu.withinForWriting(ptr,size) &&
+                   mpu.withinForReading(pos,sizeof(off_t)))
+                {
+                    ssize_t result=fileTable.pread(fd,ptr,size,*pos);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::PWRITE:
+            {
+                int fd=sp.getParameter(0);
+                void *ptr=reinterpret_cast<void*>(sp.getParameter(1));
+                size_t size=sp.getParameter(2);
+                auto pos=reinterpret_cast<const off_t*>(sp.getParameter(3));
+                if(mpu.withinForReading(ptr,size) &&
+                   mpu.withinForReading(pos,sizeof(off_t)))
+                {
+                    ssize_t result=fileTable.pwrite(fd,ptr,size,*pos);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::PREADV:
+            case Syscall::PWRITEV:
+            {
+                bool isRead=sp.getSyscallId()==static_cast<int>(Syscall::PREADV);
+                int fd=sp.getParameter(0);
+                auto iov=reinterpret_cast<const struct iovec*>(sp.getParameter(1));
+                int iovcnt=sp.getParameter(2);
+                auto pos=reinterpret_cast<const off_t*>(sp.getParameter(3));
+                //Copy the buffer list before validating it, so that it can't
+                //change afterwards
+                struct iovec kiov[IOV_MAX];
+                if(iovcnt<0 || iovcnt>IOV_MAX)
+                {
+                    sp.setParameter(0,-EINVAL);
+                    break;
+                }
+                if((iovcnt>0 &&
+                    !mpu.withinForReading(iov,iovcnt*sizeof(struct iovec))) ||
+                   !mpu.withinForReading(pos,sizeof(off_t)))
+                {
+                    sp.setParameter(0,-EFAULT);
+                    break;
+                }
+                bool ok=true;
+                for(int i=0;i<iovcnt;i++)
+                {
+                    kiov[i]=iov[i];
+                    if(kiov[i].iov_len==0) continue;
+                    if(isRead) ok=mpu.withinForWriting(kiov[i].iov_base,kiov[i].iov_len);
+                    else ok=mpu.withinForReading(kiov[i].iov_base,kiov[i].iov_len);
+                    if(!ok) break;
+                }
+                if(ok)
+                {
+                    ssize_t result;
+                    if(isRead) result=fileTable.preadv(fd,kiov,iovcnt,*pos);
+                    else result=fileTable.pwritev(fd,kiov,iovcnt,*pos);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
             case Syscall::STAT:
             {
                 auto file=reinterpret_cast<const char*>(sp.getParameter(0));
@@ -460,6 +574,7 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                     case F_DUPFD: //Third parameter is int, no validation needed
                     case F_SETFD:
                     case F_SETFL:
+                    case F_SETPIPE_SZ:
                         result=fileTable.fcntl(sp.getParameter(0),cmd,
                                                sp.getParameter(2));
                         break;
@@ -611,6 +726,33 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                 break;
             }
 
+            case Syscall::FALLOCATE:
+            {
+                //Offset and length are passed in an array on the stack
+                auto args=reinterpret_cast<const off_t*>(sp.getParameter(3));
+                if(mpu.withinForReading(args,2*sizeof(off_t)))
+                {
+                    int result=fileTable.fallocate(sp.getParameter(0),
+                        sp.getParameter(1),args[0],args[1]);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::FSYNC:
+            {
+                int result=fileTable.fsync(sp.getParameter(0));
+                sp.setParameter(0,result);
+                break;
+            }
+
+            case Syscall::FDATASYNC:
+            {
+                int result=fileTable.fdatasync(sp.getParameter(0));
+                sp.setParameter(0,result);
+                break;
+            }
+
             case Syscall::RENAME:
             {
                 auto oldp=reinterpret_cast<const char*>(sp.getParameter(0));
@@ -732,7 +874,8 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
 
             case Syscall::EXIT:
             {
-                exitCode=(sp.getParameter(0) & 0xff)<<8;
+                Lock<FastMutex> l(threadMutex);
+                terminateProcess((sp.getParameter(0) & 0xff)<<8);
                 return Exit;
             }
 
@@ -751,9 +894,33 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                         ElfProgram program(path);
                         if(program.errorCode()==0)
                         {
+                            {
+                                Lock<FastMutex> l(threadMutex);
+                                //Another thread is terminating the process
+                                if(exiting) return ThreadExit;
+                                //Done first as it may throw. The calling thread
+                                //becomes the main thread of the new program
+                                ThreadInfo& mainInfo=threads[0];
+                                //Terminate all other threads, and wait for them
+                                //as they may still be using the process memory
+                                exiting=true;
+                                Thread *self=Thread::getCurrentThread();
+                                for(auto& t : threads)
+                                    if(t.second.thread!=nullptr
+                                        && t.second.thread!=self)
+                                        t.second.thread->terminate();
+                                while(liveThreads>1) threadExited.wait(l);
+                                for(auto it=threads.begin();it!=threads.end();)
+                                {
+                                    if(it->first!=0) it=threads.erase(it);
+                                    else ++it;
+                                }
+                                mainInfo=ThreadInfo();
+                                mainInfo.thread=self;
+                                tidCounter=1;
+                                exiting=false;
+                            }
                             try {
-                                //TODO: when threads within processes are
-                                //implemented, kill all other threads
                                 load(std::move(program),std::move(args));
                             } catch(exception& e) {
                                 //TODO currently load causes the old process
@@ -879,8 +1046,94 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                 break;
             }
 
+            case Syscall::POLL:
+            {
+                auto fds=reinterpret_cast<struct pollfd*>(sp.getParameter(0));
+                nfds_t nfds=sp.getParameter(1);
+                int timeout=sp.getParameter(2);
+                //Check nfds first, so that the size can't overflow
+                if(nfds>MAX_OPEN_FILES) sp.setParameter(0,-EINVAL);
+                else if(nfds==0 || mpu.withinForWriting(fds,nfds*sizeof(struct pollfd)))
+                {
+                    int result=fileTable.poll(fds,nfds,timeout);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::THREAD_CREATE:
+            {
+                unsigned int entry=sp.getParameter(0);
+                unsigned int arg=sp.getParameter(1);
+                auto stackBase=reinterpret_cast<char*>(sp.getParameter(2));
+                unsigned int stackSize=sp.getParameter(3);
+                //The stack end is the initial stack pointer, so it needs to be
+                //aligned, and the stack must fit at least the watermark
+                if(reinterpret_cast<unsigned int>(stackBase) % CTXSAVE_STACK_ALIGNMENT
+                    || stackSize % CTXSAVE_STACK_ALIGNMENT
+                    || stackSize<MIN_PROCESS_STACK_SIZE+WATERMARK_LEN)
+                    sp.setParameter(0,-EINVAL);
+                else if(mpu.withinForWriting(stackBase,stackSize))
+                {
+                    int result=createThread(entry,arg,stackBase,stackSize);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::THREAD_EXIT:
+            {
+                Lock<FastMutex> l(threadMutex);
+                currentThreadInfo()->second.result=sp.getParameter(0);
+                return ThreadExit;
+            }
+
+            case Syscall::THREAD_JOIN:
+            {
+                int tid=sp.getParameter(0);
+                auto result=reinterpret_cast<unsigned int*>(sp.getParameter(1));
+                bool block=sp.getParameter(2)==0;
+                if(result==nullptr || (aligned(result)
+                    && mpu.withinForWriting(result,sizeof(unsigned int))))
+                {
+                    sp.setParameter(0,joinThread(tid,result,block));
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::FUTEX_WAIT:
+            {
+                auto addr=reinterpret_cast<unsigned int*>(sp.getParameter(0));
+                unsigned int expected=sp.getParameter(1);
+                long long absTime=sp.getParameter(2);
+                absTime|=static_cast<long long>(sp.getParameter(3))<<32;
+                if(aligned(addr) && mpu.withinForWriting(addr,sizeof(unsigned int)))
+                {
+                    sp.setParameter(0,futexWait(addr,expected,absTime));
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::FUTEX_WAKE:
+            {
+                //Waiting threads have been validated when calling FUTEX_WAIT,
+                //so an invalid address just matches no waiting thread
+                auto addr=reinterpret_cast<unsigned int*>(sp.getParameter(0));
+                int count=sp.getParameter(1);
+                sp.setParameter(0,futexWake(addr,count));
+                break;
+            }
+
+            case Syscall::TIME_PAGE:
+            {
+                //The page is mapped read-only for all processes, reading it
+                //lets processes get the time without performing GETTIME
+                auto page=internal::osTimerGetTimePage();
+                sp.setParameter(0,reinterpret_cast<unsigned int>(page));
+                break;
+            }
+
             default:
-                exitCode=SIGSYS; //Bad syscall
                 #ifdef WITH_ERRLOG
                 iprintf("Unexpected syscall number %d\n",sp.getSyscallId());
                 #endif //WITH_ERRLOG
@@ -892,6 +1145,130 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
     return Resume;
 }
 
+void Process::terminateProcess(int code)
+{
+    if(exiting) return;
+    exiting=true;
+    exitCode=code;
+    Thread *self=Thread::getCurrentThread();
+    for(auto& t : threads)
+        if(t.second.thread!=nullptr && t.second.thread!=self)
+            t.second.thread->terminate();
+}
+
+int Process::createThread(unsigned int entry, unsigned int arg,
+        char *stackBase, unsigned int stackSize)
+{
+    Lock<FastMutex> l(threadMutex);
+    if(exiting || threads.size()>=MAX_PROCESS_THREADS) return -EAGAIN;
+    for(;;tidCounter++)
+    {
+        if(tidCounter<=0) tidCounter=1; //Zero is the main thread
+        if(threads.find(tidCounter)==threads.end()) break;
+    }
+    int tid=tidCounter++;
+    ThreadInfo& info=threads[tid];
+    info.entry=entry;
+    info.arg=arg;
+    info.stackBase=stackBase;
+    info.stackSize=stackSize;
+    auto thr=Thread::createUserspace(Process::start,&info,this);
+    if(thr==nullptr)
+    {
+        threads.erase(tid);
+        return -EAGAIN;
+    }
+    info.thread=thr;
+    liveThreads++;
+    thr->wakeup();
+    return tid;
+}
+
+int Process::joinThread(int tid, unsigned int *result, bool block)
+{
+    Lock<FastMutex> l(threadMutex);
+    auto it=threads.find(tid);
+    if(it==threads.end()) return -ESRCH;
+    if(it==currentThreadInfo()) return -EDEADLK;
+    if(it->second.joining) return -EINVAL;
+    if(it->second.thread!=nullptr)
+    {
+        if(block==false) return -EBUSY;
+        it->second.joining=true;
+        while(it->second.thread!=nullptr)
+        {
+            if(Thread::testTerminate())
+            {
+                it->second.joining=false;
+                return -EINTR;
+            }
+            threadExited.wait(l);
+        }
+    }
+    if(result) *result=it->second.result;
+    threads.erase(it);
+    return 0;
+}
+
+map<int,Process::ThreadInfo>::iterator Process::currentThreadInfo()
+{
+    Thread *self=Thread::getCurrentThread();
+    for(auto it=threads.begin();it!=threads.end();++it)
+        if(it->second.thread==self) return it;
+    errorHandler(UNEXPECTED);
+    return threads.end();
+}
+
+int Process::futexWait(const unsigned int *addr, unsigned int expected,
+        long long absTime)
+{
+    FutexWaiter waiter(addr,Thread::getCurrentThread());
+    auto result=TimedWaitResult::NoTimeout;
+    {
+        //Comparing the word with interrupts disabled makes the comparison and
+        //the wait atomic with respect to userspace code of other threads and
+        //to futexWake()
+        FastInterruptDisableLock dLock;
+        if(Thread::testTerminate()) return -EINTR;
+        if(*const_cast<volatile const unsigned int*>(addr)!=expected)
+            return -EAGAIN;
+        futexWaiters.push_back(&waiter);
+        if(absTime<0) Thread::IRQenableIrqAndWait(dLock);
+        else result=Thread::IRQenableIrqAndTimedWait(dLock,absTime);
+        if(waiter.thread==nullptr) return 0;
+        futexWaiters.removeFast(&waiter); //Timeout or termination
+    }
+    if(Thread::testTerminate()) return -EINTR;
+    return result==TimedWaitResult::Timeout ? -ETIMEDOUT : 0;
+}
+
+int Process::futexWake(const unsigned int *addr, int count)
+{
+    int woken=0;
+    bool hppw=false;
+    {
+        FastInterruptDisableLock dLock;
+        for(auto it=futexWaiters.begin();it!=futexWaiters.end() && woken<count;)
+        {
+            FutexWaiter *waiter=*it;
+            if(waiter->addr!=addr)
+            {
+                ++it;
+                continue;
+            }
+            it=futexWaiters.erase(it);
+            waiter->thread->IRQwakeup();
+            if(waiter->thread->IRQgetPriority()
+                >Thread::IRQgetCurrentThread()->IRQgetPriority()) hppw=true;
+            waiter->thread=nullptr;
+            woken++;
+        }
+    }
+    //If a woken thread has higher priority than our priority, yield
+    if(hppw) Thread::yield();
+    return woken;
+}
+
 pid_t Process::getNewPid()
 {
     auto& p=Processes::instance();
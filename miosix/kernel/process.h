@@ -187,8 +187,36 @@ private:
     void load(ElfProgram&& program, ArgsBlock&& args);
     
     /**
-     * Contains the process' main loop. 
-     * \param argv the process pointer is passed here
+     * Per-thread data of a thread belonging to the process
+     */
+    class ThreadInfo
+    {
+    public:
+        Thread *thread=nullptr;    ///< Kernel thread, nullptr once it exited
+        unsigned int entry=0;      ///< Userspace entry point, unused by main
+        unsigned int arg=0;        ///< Argument passed to the entry point
+        char *stackBase=nullptr;   ///< Lowest address of the userspace stack
+        unsigned int stackSize=0;  ///< Userspace stack size, with watermark
+        unsigned int result=0;     ///< Value passed to THREAD_EXIT
+        bool joining=false;        ///< True if a thread is joining this one
+    };
+
+    /**
+     * A thread blocked in FUTEX_WAIT, allocated on the stack of the thread
+     */
+    class FutexWaiter : public IntrusiveListItem
+    {
+    public:
+        FutexWaiter(const unsigned int *addr, Thread *thread)
+            : addr(addr), thread(thread) {}
+
+        const unsigned int *addr;  ///< Word of process memory waited upon
+        Thread *thread;            ///< Waiting thread, nullptr once woken
+    };
+
+    /**
+     * Contains the main loop of a thread of the process
+     * \param argv the ThreadInfo of the thread is passed here
      * \return null
      */
     static void *start(void *argv);
@@ -198,8 +226,16 @@ private:
         Resume=0,   ///< Process can switch to userspace and resume operation
         Exit=1,     ///< Process exited
         Execve=2,   ///< Process can resume, but the program has been switched
-        Segfault=3  ///< Unrecoverable error occurred
+        Segfault=3, ///< Unrecoverable error occurred
+        ThreadExit=4///< The thread exited or was terminated
     };
+
+    /**
+     * Run the current thread in userspace, serving its syscalls, until it
+     * exits, faults or performs an execve
+     * \return the reason why the thread stopped running userspace code
+     */
+    SvcResult runUserspace();
     
     /**
      * Handle a supervisor call
@@ -208,6 +244,62 @@ private:
      * terminated
      */
     SvcResult handleSvc(miosix_private::SyscallParameters sp);
+
+    /**
+     * Start the termination of the whole process, by terminating all its
+     * threads but the calling one. Only the first call has an effect.
+     * Must be called with threadMutex locked
+     * \param code process exit code
+     */
+    void terminateProcess(int code);
+
+    /**
+     * Create a new thread in the process
+     * \param entry userspace entry point
+     * \param arg argument passed to the entry point
+     * \param stackBase lowest address of the userspace stack
+     * \param stackSize userspace stack size, watermark included
+     * \return the tid of the new thread, or a negative error code
+     */
+    int createThread(unsigned int entry, unsigned int arg, char *stackBase,
+            unsigned int stackSize);
+
+    /**
+     * Wait for a thread of the process to terminate
+     * \param tid tid of the thread to join
+     * \param result the value passed to THREAD_EXIT is stored here, if not null
+     * \param block if false, return -EBUSY instead of waiting
+     * \return 0 on success, or a negative error code
+     */
+    int joinThread(int tid, unsigned int *result, bool block);
+
+    /**
+     * \return the ThreadInfo of the current thread. Must be called with
+     * threadMutex locked
+     */
+    std::map<int,ThreadInfo>::iterator currentThreadInfo();
+
+    /**
+     * Block the current thread until futexWake() is called on the same
+     * address, as long as the word still contains the expected value
+     * \param addr word in the process memory
+     * \param expected value the word is expected to contain
+     * \param absTime absolute timeout in nanoseconds, or a negative value to
+     * wait without timeout
+     * \return 0 if woken (also spuriously), -EAGAIN if the word did not
+     * contain the expected value, -ETIMEDOUT on timeout, or -EINTR if the
+     * thread was terminated
+     */
+    int futexWait(const unsigned int *addr, unsigned int expected,
+            long long absTime);
+
+    /**
+     * Wake threads blocked in futexWait() on a word in the process memory
+     * \param addr word in the process memory
+     * \param count maximum number of threads to wake
+     * \return the number of threads that have been woken
+     */
+    int futexWake(const unsigned int *addr, int count);
     
     /**
      * \return an unique pid that is not zero and is not already in use in the
@@ -223,7 +315,16 @@ private:
     void *argvSp; ///< Ptr to argument array within ProcessImage and initial sp
     void *envp; ///< Pointer to the environment array within the ProcessImage
     
-    std::vector<Thread *> threads; ///<Threads that belong to the process
+    ///Threads that belong to the process, including the terminated ones that
+    ///have not been joined yet, by tid. The main thread has tid 0
+    std::map<int,ThreadInfo> threads;
+    FastMutex threadMutex; ///< Guards threads and the counters below
+    ConditionVariable threadExited; ///< Signaled when a thread exits
+    int tidCounter=1;    ///< Used to assign a tid to a new thread
+    int liveThreads=0;   ///< Number of threads that have not exited yet
+    bool exiting=false;  ///< True if the process is terminating
+    ///Threads blocked in futexWait(), guarded by disabling interrupts
+    IntrusiveList<FutexWaiter> futexWaiters;
     
     ///Contains the count of active wait calls which specifically requested
     ///to wait on this process
@@ -368,7 +469,10 @@ enum class Syscall
     DUP2      = 31,
     PIPE      = 32,
     ACCESS    = 33,
-    //From 34 to 37 reserved for future use
+    PREAD     = 34,
+    PWRITE    = 35,
+    PREADV    = 36,
+    PWRITEV   = 37,
 
     // Time syscalls
     GETTIME   = 38,
@@ -396,6 +500,26 @@ enum class Syscall
     MOUNT     = 56,
     UMOUNT    = 57,
     MKFS      = 58, //Moving filesystem creation code to kernel
+
+    // I/O multiplexing syscalls
+    POLL      = 59,
+
+    // File space allocation syscalls
+    FALLOCATE = 60,
+
+    // File synchronization syscalls
+    FSYNC     = 61,
+    FDATASYNC = 62,
+
+    // Thread syscalls
+    THREAD_CREATE  = 63,
+    THREAD_EXIT    = 64,
+    THREAD_JOIN    = 65,
+    FUTEX_WAIT     = 66,
+    FUTEX_WAKE     = 67,
+
+    // Time syscalls
+    TIME_PAGE      = 68,
 };
 
 } //namespace miosix
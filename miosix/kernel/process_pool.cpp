@@ -28,7 +28,6 @@
 #include "process_pool.h"
 #include <stdexcept>
 #include <cstring>
-#include <algorithm>
 #ifndef TEST_ALLOC
 #include "core/memory_protection.h"
 #endif //TEST_ALLOC
@@ -39,12 +38,6 @@ using namespace std;
 
 namespace miosix {
 
-///This constant specifies the size of the minimum allocatable block,
-///in bits. So for example 10 is 1KB.
-static const unsigned int blockBits=10;
-///This constant is the the size of the minimum allocatable block, in bytes.
-static const unsigned int blockSize=1<<blockBits;
-
 ProcessPool& ProcessPool::instance()
 {
     #ifndef TEST_ALLOC
@@ -65,37 +58,31 @@ pair<unsigned int *, unsigned int> ProcessPool::allocate(unsigned int size)
 {
     #ifndef TEST_ALLOC
     miosix::Lock<miosix::FastMutex> l(mutex);
-    size=MPUConfiguration::roundSizeForMPU(max(size,blockSize));
+    size=MPUConfiguration::roundSizeForMPU(size<blockSize ? blockSize : size);
     #else //TEST_ALLOC
     //Size adjustment not supported during test_alloc due to missing mpu header
     if((size & (size - 1)) || size<blockSize)
             throw runtime_error("ProcessPool::allocate unsupported size");
     #endif //TEST_ALLOC
-    if(size>poolSize) throw bad_alloc();
-    
-    unsigned int offset=0;
-    if(reinterpret_cast<unsigned int>(poolBase) % size)
-        offset=size-(reinterpret_cast<unsigned int>(poolBase) % size);
-    unsigned int startBit=offset/blockSize;
-    unsigned int sizeBit=size/blockSize;
+    unsigned int order=__builtin_ctz(size)-blockBits;
+    if(order>=numOrders) throw bad_alloc();
 
-    for(unsigned int i=startBit;i<=poolSize/blockSize;i+=sizeBit)
+    //Find the smallest non empty free list with blocks large enough
+    unsigned int candidates=nonEmpty & ~((1u<<order)-1);
+    if(candidates==0) throw bad_alloc();
+    unsigned int k=__builtin_ctz(candidates);
+    unsigned int i=freeLists[k];
+    removeFree(i);
+    //Split the block, the upper halves go back to the free lists
+    while(k>order)
     {
-        bool notEmpty=false;
-        for(unsigned int j=0;j<sizeBit;j++)
-        {
-            if(testBit(i+j)==0) continue;
-            notEmpty=true;
-            break;
-        }
-        if(notEmpty) continue;
-        
-        for(unsigned int j=0;j<sizeBit;j++) setBit(i+j);
-        unsigned int *result=poolBase+i*blockSize/sizeof(unsigned int);
-        allocatedBlocks[result]=size;
-        return make_pair(result,size);
+        k--;
+        addFree(i+(1<<k),k);
+        splits++;
     }
-    throw bad_alloc();
+    blocks[i].order=order;
+    blocks[i].state=USED;
+    return make_pair(reinterpret_cast<unsigned int*>(blockAddress(i)),size);
 }
 
 void ProcessPool::deallocate(unsigned int *ptr)
@@ -103,48 +90,342 @@ void ProcessPool::deallocate(unsigned int *ptr)
     #ifndef TEST_ALLOC
     miosix::Lock<miosix::FastMutex> l(mutex);
     #endif //TEST_ALLOC
-    map<unsigned int*, unsigned int>::iterator it= allocatedBlocks.find(ptr);
-    if(it==allocatedBlocks.end())
+    size_t p=reinterpret_cast<size_t>(ptr);
+    size_t start=blockAddress(0);
+    unsigned int i=(p-start)/blockSize;
+    if(p<start || (p-start)%blockSize || i>=numBlocks || blocks[i].state!=USED)
     #ifndef TEST_ALLOC
         errorHandler(UNEXPECTED);
     #else //TEST_ALLOC
         throw runtime_error("ProcessPool::deallocate corrupted pointer");
     #endif //TEST_ALLOC
-    unsigned int size =(it->second)/blockSize;
-    unsigned int firstBit=(reinterpret_cast<unsigned int>(ptr)-
-                           reinterpret_cast<unsigned int>(poolBase))/blockSize;
-    for(unsigned int i=firstBit;i<firstBit+size;i++) clearBit(i);
-    allocatedBlocks.erase(it);
+    
+    //Coalesce with the buddy as long as it is entirely free. The buddy is
+    //computed on the absolute address as blocks must be aligned to their size
+    size_t first=start/blockSize;
+    unsigned int order=blocks[i].order;
+    while(order+1<numOrders)
+    {
+        size_t buddy=(first+i)^(size_t(1)<<order);
+        if(buddy<first) break;
+        buddy-=first;
+        if(buddy+(1<<order)>numBlocks) break;
+        if(blocks[buddy].state!=FREE || blocks[buddy].order!=order) break;
+        removeFree(buddy);
+        if(buddy<i)
+        {
+            blocks[i].state=INTERIOR;
+            i=buddy;
+        } else blocks[buddy].state=INTERIOR;
+        order++;
+        merges++;
+    }
+    addFree(i,order);
+}
+
+ProcessPoolStats ProcessPool::getStats()
+{
+    #ifndef TEST_ALLOC
+    miosix::Lock<miosix::FastMutex> l(mutex);
+    #endif //TEST_ALLOC
+    ProcessPoolStats result;
+    for(unsigned int i=0;i<numBlocks;i=nextHead(i))
+    {
+        unsigned int size=blockSize<<blocks[i].order;
+        if(blocks[i].state==USED)
+        {
+            result.usedBytes+=size;
+            result.usedBlocks++;
+        } else {
+            result.freeBytes+=size;
+            result.freeBlocks++;
+        }
+    }
+    if(nonEmpty) result.largestFree=blockSize<<(31-__builtin_clz(nonEmpty));
+    result.splits=splits;
+    result.merges=merges;
+    return result;
 }
 
 ProcessPool::ProcessPool(unsigned int *poolBase, unsigned int poolSize)
-    : poolBase(poolBase), poolSize(poolSize)
+    : nonEmpty(0), splits(0), merges(0)
 {
-    int numBytes=poolSize/blockSize/8;
-    bitmap=new unsigned int[numBytes/sizeof(unsigned int)];
-    memset(bitmap,0,numBytes);
+    size_t start=reinterpret_cast<size_t>(poolBase);
+    size_t end=start+poolSize;
+    start=(start+blockSize-1) & ~size_t(blockSize-1);
+    this->poolBase=reinterpret_cast<unsigned int*>(start);
+    numBlocks=end>start ? (end-start)/blockSize : 0;
+    if(numBlocks>=none) numBlocks=none-1;
+    blocks=new Block[numBlocks];
+    for(unsigned int i=0;i<numBlocks;i++) blocks[i].state=INTERIOR;
+    for(unsigned int i=0;i<numOrders;i++) freeLists[i]=none;
+
+    //Split the pool in the largest blocks that are aligned to their size
+    size_t first=start/blockSize;
+    for(unsigned int i=0;i<numBlocks;)
+    {
+        unsigned int order=0;
+        while(order+1<numOrders && ((first+i) & ((size_t(2)<<order)-1))==0
+            && i+(size_t(2)<<order)<=numBlocks) order++;
+        addFree(i,order);
+        i+=1<<order;
+    }
 }
 
 ProcessPool::~ProcessPool()
 {
-    delete[] bitmap;
+    delete[] blocks;
+}
+
+void ProcessPool::addFree(unsigned int i, unsigned int order)
+{
+    blocks[i].next=freeLists[order];
+    blocks[i].prev=none;
+    blocks[i].order=order;
+    blocks[i].state=FREE;
+    if(freeLists[order]!=none) blocks[freeLists[order]].prev=i;
+    freeLists[order]=i;
+    nonEmpty|=1u<<order;
 }
 
+void ProcessPool::removeFree(unsigned int i)
+{
+    unsigned int order=blocks[i].order;
+    unsigned short next=blocks[i].next;
+    unsigned short prev=blocks[i].prev;
+    if(prev==none) freeLists[order]=next;
+    else blocks[prev].next=next;
+    if(next!=none) blocks[next].prev=prev;
+    if(freeLists[order]==none) nonEmpty&=~(1u<<order);
+}
+
+#ifdef TEST_ALLOC
+bool ProcessPool::check()
+{
+    size_t first=blockAddress(0)/blockSize;
+    unsigned int freeCount[numOrders]={0};
+    for(unsigned int i=0;i<numBlocks;i=nextHead(i))
+    {
+        unsigned int order=blocks[i].order;
+        if(blocks[i].state==INTERIOR || order>=numOrders) return false;
+        if((first+i) & ((size_t(1)<<order)-1)) return false; //Misaligned
+        if(i+(1<<order)>numBlocks) return false;
+        for(unsigned int j=i+1;j<i+(1<<order);j++)
+            if(blocks[j].state!=INTERIOR) return false;
+        if(blocks[i].state!=FREE) continue;
+        freeCount[order]++;
+        //Two free buddies should have been coalesced
+        size_t buddy=(first+i)^(size_t(1)<<order);
+        if(buddy>=first && buddy-first+(1<<order)<=numBlocks &&
+           blocks[buddy-first].state==FREE && blocks[buddy-first].order==order)
+            return false;
+    }
+    for(unsigned int k=0;k<numOrders;k++)
+    {
+        if(((nonEmpty>>k) & 1)!=(freeLists[k]!=none)) return false;
+        unsigned int count=0;
+        unsigned short prev=none;
+        for(unsigned int i=freeLists[k];i!=none;i=blocks[i].next)
+        {
+            if(blocks[i].state!=FREE || blocks[i].order!=k) return false;
+            if(blocks[i].prev!=prev) return false;
+            prev=i;
+            if(++count>freeCount[k]) return false;
+        }
+        if(count!=freeCount[k]) return false;
+    }
+    return true;
+}
+#endif //TEST_ALLOC
+
 } //namespace miosix
 
 #ifdef TEST_ALLOC
-//g++ -m32 -o pp -DTEST_ALLOC -DWITH_PROCESSES process_pool.cpp && ./pp
-int main()
+//Fuzz test and benchmark, use -i for an interactive test
+//g++ -O2 -o pp -DTEST_ALLOC -DWITH_PROCESSES process_pool.cpp && ./pp
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace miosix;
+
+/**
+ * The allocator ProcessPool used to have, that scans a bitmap for the first
+ * free block. It is used as a reference model in the fuzz test, as it fails
+ * only if there is no aligned free block of the requested size, and to
+ * compare performance in the benchmark
+ */
+class BitmapPool
+{
+public:
+    BitmapPool(size_t base, unsigned int size) : base(base), used(size/1024) {}
+
+    size_t allocate(unsigned int size)
+    {
+        unsigned int sizeBit=size/1024;
+        unsigned int startBit=base%size ? (size-base%size)/1024 : 0;
+        for(unsigned int i=startBit;i+sizeBit<=used.size();i+=sizeBit)
+        {
+            bool notEmpty=false;
+            for(unsigned int j=0;j<sizeBit;j++)
+            {
+                if(used[i+j]==false) continue;
+                notEmpty=true;
+                break;
+            }
+            if(notEmpty) continue;
+            for(unsigned int j=0;j<sizeBit;j++) used[i+j]=true;
+            allocated[base+i*1024]=size;
+            return base+i*1024;
+        }
+        return 0;
+    }
+
+    void deallocate(size_t p)
+    {
+        auto it=allocated.find(p);
+        unsigned int firstBit=(p-base)/1024;
+        for(unsigned int i=0;i<it->second/1024;i++) used[firstBit+i]=false;
+        allocated.erase(it);
+    }
+
+    /// Mark a block allocated by another allocator as used
+    bool markUsed(size_t p, unsigned int size)
+    {
+        unsigned int firstBit=(p-base)/1024;
+        for(unsigned int i=0;i<size/1024;i++)
+        {
+            if(used[firstBit+i]) return false;
+            used[firstBit+i]=true;
+        }
+        allocated[p]=size;
+        return true;
+    }
+
+private:
+    size_t base;
+    vector<bool> used;
+    map<size_t,unsigned int> allocated;
+};
+
+static void fail(const char *msg)
+{
+    cout<<"Error: "<<msg<<endl;
+    exit(1);
+}
+
+/**
+ * Produces power of two sizes from 1KB to 64KB, smaller sizes more likely
+ */
+static unsigned int randomSize(mt19937& rng)
+{
+    unsigned int r=rng()%64;
+    unsigned int order=0;
+    while(order<6 && (r & (1<<order))) order++;
+    return 1024<<order;
+}
+
+/**
+ * Performs random allocations and deallocations, checking them against the
+ * reference allocator
+ */
+static void fuzzTest(size_t base, unsigned int size, unsigned int iterations)
+{
+    ProcessPool pool(reinterpret_cast<unsigned int*>(base),size);
+    if(pool.check()==false) fail("inconsistent after construction");
+    ProcessPoolStats initial=pool.getStats();
+    //The reference allocator only uses the pool part aligned to 1KB
+    size_t alignedBase=(base+1023) & ~size_t(1023);
+    size_t end=base+size;
+    BitmapPool ref(alignedBase,end>alignedBase ? end-alignedBase : 0);
+    vector<pair<size_t,unsigned int>> live;
+    mt19937 rng(base ^ size);
+    unsigned int failures=0;
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        if(live.empty()==false && rng()%2)
+        {
+            unsigned int id=rng()%live.size();
+            pool.deallocate(reinterpret_cast<unsigned int*>(live[id].first));
+            ref.deallocate(live[id].first);
+            live[id]=live.back();
+            live.pop_back();
+        } else {
+            unsigned int s=randomSize(rng);
+            try {
+                auto result=pool.allocate(s);
+                size_t p=reinterpret_cast<size_t>(result.first);
+                if(result.second!=s) fail("wrong size");
+                if(p%s) fail("misaligned");
+                if(p<base || p+s>end) fail("outside pool");
+                if(ref.markUsed(p,s)==false) fail("overlapping blocks");
+                live.push_back(make_pair(p,s));
+            } catch(bad_alloc&) {
+                //Must fail only if there is really no room
+                size_t p=ref.allocate(s);
+                if(p!=0) fail("allocation failed but there was room");
+                failures++;
+            }
+        }
+        if(i%256==0 && pool.check()==false) fail("inconsistent");
+    }
+    ProcessPoolStats st=pool.getStats();
+    cout<<"Pool "<<hex<<base<<dec<<" size "<<size<<": "<<live.size()
+        <<" blocks live, "<<failures<<" failed allocations, "<<st.splits
+        <<" splits, "<<st.merges<<" merges, free "<<st.freeBytes<<" in "
+        <<st.freeBlocks<<" blocks, largest free "<<st.largestFree<<endl;
+    for(auto& b : live) pool.deallocate(reinterpret_cast<unsigned int*>(b.first));
+    if(pool.check()==false) fail("inconsistent");
+    st=pool.getStats();
+    //Everything must have been coalesced back
+    if(st.usedBytes!=0 || st.freeBlocks!=initial.freeBlocks ||
+       st.freeBytes!=initial.freeBytes) fail("not coalesced");
+}
+
+/**
+ * Run the same sequence of allocations and deallocations with the given
+ * functions, printing the average, 99.9th percentile and worst case time per
+ * call
+ */
+template<typename Alloc, typename Free>
+static void benchmark(const char *name, Alloc alloc, Free dealloc)
+{
+    using namespace std::chrono;
+    const unsigned int iterations=200000;
+    vector<pair<size_t,unsigned int>> slots(128,make_pair(0,0));
+    vector<long long> times(iterations);
+    mt19937 rng(1);
+    long long total=0;
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        auto& slot=slots[rng()%slots.size()];
+        unsigned int size=randomSize(rng);
+        auto start=steady_clock::now();
+        if(slot.first) { dealloc(slot.first); slot.first=0; }
+        else slot.first=alloc(size);
+        times[i]=duration_cast<nanoseconds>(steady_clock::now()-start).count();
+        total+=times[i];
+    }
+    for(auto& slot : slots) if(slot.first) dealloc(slot.first);
+    sort(times.begin(),times.end());
+    cout<<name<<": average "<<total/iterations<<"ns, p99.9 "
+        <<times[iterations-iterations/1000]<<"ns, worst "<<times.back()
+        <<"ns"<<endl;
+}
+
+static void interactive()
 {
-    using namespace miosix;
     ProcessPool& pool=ProcessPool::instance();
     while(1)
     {
         cout<<"a<size(exponent)>|d<addr>"<<endl;
-        unsigned int param;
+        size_t param;
         char op;
         string line;
-        getline(cin,line);
+        if(!getline(cin,line)) return;
         stringstream ss(line);
         ss>>op;
         switch(op)
@@ -173,6 +454,34 @@ int main()
         }
     }
 }
+
+int main(int argc, char *argv[])
+{
+    if(argc>1 && string(argv[1])=="-i")
+    {
+        interactive();
+        return 0;
+    }
+    //Pools whose base is not aligned to their size, nor to 1KB, with sizes
+    //that are not a power of two
+    fuzzTest(0x20008000,96*1024,200000);
+    fuzzTest(0x20000400,1024*1024+3*1024+17,200000);
+    fuzzTest(0x10001c10,513*1024,200000);
+    fuzzTest(0x20000000,2*1024,1000);
+
+    const size_t base=0x20000000;
+    const unsigned int size=4*1024*1024;
+    ProcessPool pool(reinterpret_cast<unsigned int*>(base),size);
+    BitmapPool ref(base,size);
+    benchmark("buddy",[&](unsigned int s)->size_t {
+        try {
+            return reinterpret_cast<size_t>(pool.allocate(s).first);
+        } catch(bad_alloc&) { return 0; }
+    },[&](size_t p){ pool.deallocate(reinterpret_cast<unsigned int*>(p)); });
+    benchmark("bitmap",[&](unsigned int s){ return ref.allocate(s); },
+                       [&](size_t p){ ref.deallocate(p); });
+    cout<<"Test passed"<<endl;
+}
 #endif //TEST_ALLOC
 
 #endif //WITH_PROCESSES
@@ -27,7 +27,6 @@
 
 #pragma once
 
-#include <map>
 #include <utility>
 
 #ifndef TEST_ALLOC
@@ -42,9 +41,30 @@
 
 namespace miosix {
 
+/**
+ * Statistics about the process pool
+ */
+struct ProcessPoolStats
+{
+    unsigned int usedBytes=0;   ///< Bytes currently allocated
+    unsigned int usedBlocks=0;  ///< Number of allocated blocks
+    unsigned int freeBytes=0;   ///< Bytes currently free
+    unsigned int freeBlocks=0;  ///< Number of free blocks
+    unsigned int largestFree=0; ///< Largest block that can be allocated
+    unsigned int splits=0;      ///< Number of times a block has been split
+    unsigned int merges=0;      ///< Number of times two buddies were coalesced
+};
+
 /**
  * This class allows to handle a memory area reserved for the allocation of
  * processes' images. This memory area is called process pool.
+ *
+ * As the memory protection unit requires blocks to be power of two sized and
+ * aligned to their size, the pool is managed by a buddy allocator. The pool
+ * is initially split in the largest aligned power of two blocks that fit, and
+ * free blocks are kept in one free list per size, so both allocation and
+ * deallocation take a time proportional to the logarithm of the pool size.
+ * The block metadata is stored outside of the pool itself.
  */
 class ProcessPool
 {
@@ -74,6 +94,11 @@ public:
      * \throws runtime_error if the pointer is invalid
      */
     void deallocate(unsigned int *ptr);
+
+    /**
+     * \return statistics about the process pool
+     */
+    ProcessPoolStats getStats();
     
     #ifdef TEST_ALLOC
     /**
@@ -82,39 +107,42 @@ public:
     void printAllocatedBlocks()
     {
         using namespace std;
-        map<unsigned int*, unsigned int>::iterator it;
         cout<<endl;
-        for(it=allocatedBlocks.begin();it!=allocatedBlocks.end();it++)
-            cout <<"block of size " << it->second
-                 << " allocated @ " << it->first<<endl;
-        
-        cout<<"Bitmap:"<<endl;
-        const int SHIFT = 8 * sizeof(unsigned int);
-        const unsigned int MASK = 1 << (SHIFT-1);
-        int bitarray[32];
-        for(int i=0; i<(poolSize/blockSize)/(sizeof(unsigned int)*8);i++)
-        {   
-            int value=bitmap[i];
-            for ( int j = 0; j < SHIFT; j++ ) 
-            {
-                bitarray[31-j]= ( value & MASK ? 1 : 0 );
-                value <<= 1;
-            }
-            for(int j=0;j<32;j++)
-                cout<<bitarray[j];
-            cout << endl;
-        }  
+        for(unsigned int i=0;i<numBlocks;i=nextHead(i))
+            cout<<(blocks[i].state==USED ? "used" : "free")
+                <<" block of size "<<(blockSize<<blocks[i].order)
+                <<" @ "<<hex<<blockAddress(i)<<dec<<endl;
+        for(unsigned int i=0;i<numOrders;i++)
+        {
+            if(freeLists[i]==none) continue;
+            cout<<"Free list "<<(blockSize<<i)<<":";
+            for(unsigned int j=freeLists[i];j!=none;j=blocks[j].next)
+                cout<<" "<<hex<<blockAddress(j)<<dec;
+            cout<<endl;
+        }
     }
+
+    /**
+     * Check the consistency of the allocator data structures
+     * \return true if consistent
+     */
+    bool check();
     #endif //TEST_ALLOC
     
 private:
     ProcessPool(const ProcessPool&);
     ProcessPool& operator= (const ProcessPool&);
     
+    #ifdef TEST_ALLOC
+public: //The tests create pools with arbitrary base and size
+    #endif //TEST_ALLOC
     /**
      * Constructor.
-     * \param poolBase address of the start of the process pool.
-     * \param poolSize size of the process pool. Must be a multiple of blockSize
+     * \param poolBase address of the start of the process pool. If not
+     * aligned to blockSize, the part before the first aligned address is
+     * not used
+     * \param poolSize size of the process pool. If not a multiple of blockSize
+     * the remainder is not used. At most 64MB are used
      */
     ProcessPool(unsigned int *poolBase, unsigned int poolSize);
     
@@ -122,40 +150,76 @@ private:
      * Destructor
      */
     ~ProcessPool();
-    
+
+private:
+    /// Block states
+    enum BlockState : unsigned char
+    {
+        INTERIOR, ///< Not the first minimum size block of a buddy block
+        FREE,     ///< First minimum size block of a free buddy block
+        USED      ///< First minimum size block of an allocated buddy block
+    };
+
     /**
-     * \param bit bit to test, from 0 to poolSize/blockSize
-     * \return true if the bit is set
+     * Metadata of a minimum size block. Only the first minimum size block of a
+     * buddy block has meaningful metadata.
      */
-    bool testBit(unsigned int bit)
+    struct Block
     {
-        return (bitmap[bit/(sizeof(unsigned int)*8)] &
-            1<<(bit % (sizeof(unsigned int)*8))) ? true : false;
-    }
-    
+        unsigned short next;  ///< Next block in free list, or none
+        unsigned short prev;  ///< Previous block in free list, or none
+        unsigned char order;  ///< Block size is blockSize<<order
+        BlockState state;     ///< Block state
+    };
+
     /**
-     * \param bit bit to set, from 0 to poolSize/blockSize
+     * \param i index of a minimum size block
+     * \return its address
      */
-    void setBit(unsigned int bit)
+    size_t blockAddress(unsigned int i) const
     {
-        bitmap[(bit/(sizeof(unsigned int)*8))] |= 
-            1<<(bit % (sizeof(unsigned int)*8));
+        return reinterpret_cast<size_t>(poolBase)+i*blockSize;
     }
-    
+
     /**
-     * \param bit bit to clear, from 0 to poolSize/blockSize
+     * \param i index of the first minimum size block of a buddy block
+     * \return index of the first minimum size block of the next buddy block
      */
-    void clearBit(unsigned int bit)
+    unsigned int nextHead(unsigned int i) const
     {
-        bitmap[bit/(sizeof(unsigned int)*8)] &= 
-            ~(1<<(bit % (sizeof(unsigned int)*8)));
+        return i+(1<<blocks[i].order);
     }
-    
-    unsigned int *bitmap;   ///< Pointer to the status of the allocator
+
+    /**
+     * Add a buddy block to the free list of its order
+     * \param i index of the first minimum size block
+     * \param order block order
+     */
+    void addFree(unsigned int i, unsigned int order);
+
+    /**
+     * Remove a buddy block from the free list of its order
+     * \param i index of the first minimum size block
+     */
+    void removeFree(unsigned int i);
+
+    ///This constant specifies the size of the minimum allocatable block,
+    ///in bits. So for example 10 is 1KB.
+    static const unsigned int blockBits=10;
+    ///This constant is the the size of the minimum allocatable block, in bytes.
+    static const unsigned int blockSize=1<<blockBits;
+    ///Number of block sizes, from blockSize to 2GB
+    static const unsigned int numOrders=32-blockBits;
+    ///Marks the end of a free list
+    static const unsigned short none=0xffff;
+
+    Block *blocks;          ///< Metadata of each minimum size block
     unsigned int *poolBase; ///< Base address of the entire pool
-    unsigned int poolSize;  ///< Size of the pool, in bytes
-    ///Lists all allocated blocks, allows to retrieve their sizes
-    std::map<unsigned int*,unsigned int> allocatedBlocks;
+    unsigned int numBlocks; ///< Size of the pool, in minimum size blocks
+    unsigned int nonEmpty;  ///< Bit i is set if freeLists[i] is not empty
+    unsigned short freeLists[numOrders]; ///< Free list for each block size
+    unsigned int splits;    ///< Number of splits, for statistics
+    unsigned int merges;    ///< Number of merges, for statistics
     #ifndef TEST_ALLOC
     miosix::FastMutex mutex; ///< Mutex to guard concurrent access
     #endif //TEST_ALLOC
@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <stdexcept>
 #include <algorithm>
+#include <new>
 #include "error.h"
 #include "pthread_private.h"
 #include "stdlib_integration/libc_integration.h"
@@ -61,12 +62,12 @@ int pthread_create(pthread_t *pthread, const pthread_attr_t *attr,
     Priority priority=MAIN_PRIORITY;
     if(attr!=NULL)
     {
-        if(attr->detachstate==PTHREAD_CREATE_DETACHED)
+        if(fields(attr)->detachstate==PTHREAD_CREATE_DETACHED)
             opt=Thread::DEFAULT;
-        stacksize=attr->stacksize;
+        stacksize=fields(attr)->stacksize;
         #ifndef SCHED_TYPE_EDF
         // Cap priority value in the range between 0 and PRIORITY_MAX-1
-        int prio=std::min(std::max(0,attr->schedparam.sched_priority),
+        int prio=std::min(std::max(0,fields(attr)->schedparam.sched_priority),
                           PRIORITY_MAX-1);
         // Swap unix-based priority back to the miosix one.
         priority=(PRIORITY_MAX-1)-prio;
@@ -108,11 +109,11 @@ int pthread_equal(pthread_t t1, pthread_t t2)
 int pthread_attr_init(pthread_attr_t *attr)
 {
     //We only use three fields of pthread_attr_t so initialize only these
-    attr->detachstate=PTHREAD_CREATE_JOINABLE;
-    attr->stacksize=STACK_DEFAULT_FOR_PTHREAD;
+    fields(attr)->detachstate=PTHREAD_CREATE_JOINABLE;
+    fields(attr)->stacksize=STACK_DEFAULT_FOR_PTHREAD;
     //Default priority level is one above minimum.
     #ifndef SCHED_TYPE_EDF
-    attr->schedparam.sched_priority=PRIORITY_MAX-1-MAIN_PRIORITY;
+    fields(attr)->schedparam.sched_priority=PRIORITY_MAX-1-MAIN_PRIORITY;
     #endif //SCHED_TYPE_EDF
     return 0;
 }
@@ -124,7 +125,7 @@ int pthread_attr_destroy(pthread_attr_t *attr)
 
 int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate)
 {
-    *detachstate=attr->detachstate;
+    *detachstate=fields(attr)->detachstate;
     return 0;
 }
 
@@ -132,34 +133,34 @@ int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate)
 {
     if(detachstate!=PTHREAD_CREATE_JOINABLE &&
        detachstate!=PTHREAD_CREATE_DETACHED) return EINVAL;
-    attr->detachstate=detachstate;
+    fields(attr)->detachstate=detachstate;
     return 0;
 }
 
 int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize)
 {
-    *stacksize=attr->stacksize;
+    *stacksize=fields(attr)->stacksize;
     return 0;
 }
 
 int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize)
 {
     if(stacksize<STACK_MIN) return EINVAL;
-    attr->stacksize=stacksize;
+    fields(attr)->stacksize=stacksize;
     return 0;
 }
 
 int pthread_attr_getschedparam(const pthread_attr_t *attr,
                                struct sched_param *param)
 {
-    *param = attr->schedparam;
+    *param = fields(attr)->schedparam;
     return 0;
 }
 
 int pthread_attr_setschedparam(pthread_attr_t *attr,
                                const struct sched_param *param)
 {
-    attr->schedparam = *param;
+    fields(attr)->schedparam = *param;
     return 0;
 }
 
@@ -192,9 +193,30 @@ int sched_yield()
 // Mutex API
 //
 
+//pthread_mutexattr_t has no protocol and prioceiling fields, so the protocol
+//is stored in the low byte of the otherwise unused type field, and the
+//priority ceiling in the remaining bits
+
+static inline int mutexattrProtocol(const pthread_mutexattr_t *attr)
+{
+    return fields(attr)->type & 0xff;
+}
+
+static inline int mutexattrPrioceiling(const pthread_mutexattr_t *attr)
+{
+    return fields(attr)->type>>8;
+}
+
+static inline void mutexattrSet(pthread_mutexattr_t *attr, int protocol,
+        int prioceiling)
+{
+    fields(attr)->type=(protocol & 0xff) | (prioceiling<<8);
+}
+
 int	pthread_mutexattr_init(pthread_mutexattr_t *attr)
 {
-    attr->recursive=PTHREAD_MUTEX_DEFAULT;
+    fields(attr)->recursive=PTHREAD_MUTEX_DEFAULT;
+    mutexattrSet(attr,PTHREAD_PRIO_NONE,0);
     return 0;
 }
 
@@ -205,7 +227,7 @@ int	pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
 
 int pthread_mutexattr_gettype(const pthread_mutexattr_t *attr, int *kind)
 {
-    *kind=attr->recursive;
+    *kind=fields(attr)->recursive;
     return 0;
 }
 
@@ -214,53 +236,138 @@ int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int kind)
     switch(kind)
     {
         case PTHREAD_MUTEX_DEFAULT:
-            attr->recursive=PTHREAD_MUTEX_DEFAULT;
+            fields(attr)->recursive=PTHREAD_MUTEX_DEFAULT;
             return 0;
         case PTHREAD_MUTEX_RECURSIVE:
-            attr->recursive=PTHREAD_MUTEX_RECURSIVE;
+            fields(attr)->recursive=PTHREAD_MUTEX_RECURSIVE;
+            return 0;
+        default:
+            return EINVAL;
+    }
+}
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr,
+        int *protocol)
+{
+    *protocol=mutexattrProtocol(attr);
+    return 0;
+}
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol)
+{
+    switch(protocol)
+    {
+        case PTHREAD_PRIO_NONE:
+        case PTHREAD_PRIO_INHERIT:
+            mutexattrSet(attr,protocol,mutexattrPrioceiling(attr));
+            return 0;
+        case PTHREAD_PRIO_PROTECT:
+            #ifndef SCHED_TYPE_EDF
+            mutexattrSet(attr,protocol,mutexattrPrioceiling(attr));
             return 0;
+            #else //SCHED_TYPE_EDF
+            return ENOTSUP; //Deadlines can't be used as a ceiling
+            #endif //SCHED_TYPE_EDF
         default:
             return EINVAL;
     }
 }
 
+int pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+        int *prioceiling)
+{
+    *prioceiling=mutexattrPrioceiling(attr);
+    return 0;
+}
+
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+        int prioceiling)
+{
+    #ifndef SCHED_TYPE_EDF
+    if(prioceiling<0 || prioceiling>PRIORITY_MAX-1) return EINVAL;
+    mutexattrSet(attr,mutexattrProtocol(attr),prioceiling);
+    return 0;
+    #else //SCHED_TYPE_EDF
+    return ENOTSUP;
+    #endif //SCHED_TYPE_EDF
+}
+
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
 {
-    mutex->owner=0;
-    mutex->first=0;
+    fields(mutex)->owner=0;
+    fields(mutex)->first=0;
     //No need to initialize mutex->last
     if(attr!=0)
     {
-        mutex->recursive= attr->recursive==PTHREAD_MUTEX_RECURSIVE ? 0 : -1;
-    } else mutex->recursive=-1;
+        bool recursive=fields(attr)->recursive==PTHREAD_MUTEX_RECURSIVE;
+        fields(mutex)->recursive=recursive ? 0 : -1;
+        int protocol=mutexattrProtocol(attr);
+        if(protocol!=PTHREAD_PRIO_NONE)
+        {
+            //Priority inheritance and priority ceiling are provided by the
+            //kernel Mutex, allocate one and make this mutex a handle to it
+            Mutex::Options opt=recursive ? Mutex::RECURSIVE : Mutex::DEFAULT;
+            Mutex *impl;
+            #ifndef SCHED_TYPE_EDF
+            if(protocol==PTHREAD_PRIO_PROTECT)
+            {
+                // Swap unix-based priority back to the miosix one.
+                Priority ceiling=(PRIORITY_MAX-1)-mutexattrPrioceiling(attr);
+                impl=new (std::nothrow) Mutex(ceiling,opt);
+            } else
+            #endif //SCHED_TYPE_EDF
+            impl=new (std::nothrow) Mutex(opt);
+            if(impl==nullptr) return ENOMEM;
+            fields(mutex)->first=reinterpret_cast<WaitingList*>(impl);
+            fields(mutex)->recursive=PTHREAD_MUTEX_KERNEL_IMPL;
+        }
+    } else fields(mutex)->recursive=-1;
     return 0;
 }
 
 int pthread_mutex_destroy(pthread_mutex_t *mutex)
 {
-    if(mutex->owner!=0) return EBUSY;
+    if(Mutex *impl=kernelMutexImpl(mutex))
+    {
+        {
+            //Also a recursive mutex locked by the caller can't be destroyed
+            PauseKernelLock dLock;
+            if(impl->PKisLocked()) return EBUSY;
+        }
+        delete impl;
+        fields(mutex)->recursive=-1;
+        fields(mutex)->first=0;
+        return 0;
+    }
+    if(fields(mutex)->owner!=0) return EBUSY;
     return 0;
 }
 
 int pthread_mutex_lock(pthread_mutex_t *mutex)
 {
+    if(Mutex *impl=kernelMutexImpl(mutex))
+    {
+        impl->lock();
+        return 0;
+    }
     FastInterruptDisableLock dLock;
-    IRQdoMutexLock(mutex,dLock);
+    IRQdoMutexLock(fields(mutex),dLock);
     return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t *mutex)
 {
+    if(Mutex *impl=kernelMutexImpl(mutex)) return impl->tryLock() ? 0 : EBUSY;
     FastInterruptDisableLock dLock;
     void *p=reinterpret_cast<void*>(Thread::IRQgetCurrentThread());
-    if(mutex->owner==0)
+    if(fields(mutex)->owner==0)
     {
-        mutex->owner=p;
+        fields(mutex)->owner=p;
         return 0;
     }
-    if(mutex->owner==p && mutex->recursive>=0)
+    if(fields(mutex)->owner==p && fields(mutex)->recursive>=0)
     {
-        mutex->recursive++;
+        fields(mutex)->recursive++;
         return 0;
     }
     return EBUSY;
@@ -268,14 +375,19 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex)
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex)
 {
+    if(Mutex *impl=kernelMutexImpl(mutex))
+    {
+        impl->unlock();
+        return 0;
+    }
     #ifndef SCHED_TYPE_EDF
     FastInterruptDisableLock dLock;
-    IRQdoMutexUnlock(mutex);
+    IRQdoMutexUnlock(fields(mutex));
     #else //SCHED_TYPE_EDF
     bool hppw;
     {
         FastInterruptDisableLock dLock;
-        hppw=IRQdoMutexUnlock(mutex);
+        hppw=IRQdoMutexUnlock(fields(mutex));
     }
     if(hppw) Thread::yield(); //If the woken thread has higher priority, yield
     #endif //SCHED_TYPE_EDF
@@ -287,10 +399,11 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex)
 //
 
 //The pthread_cond_t API is implemented simply as a wrapper around the native
-//Miosix C++ ConditionVariable. Therefore the memory layout of pthread_cond_t
-//and of ConditionVariable must be exactly the same.
+//Miosix C++ ConditionVariable. Therefore a ConditionVariable must fit in the
+//memory of a pthread_cond_t. With the Miosix C library the two are exactly the
+//same size, other C libraries may have a larger pthread_cond_t.
 
-static_assert(sizeof(ConditionVariable)==sizeof(pthread_cond_t),"Invalid pthread_cond_t size");
+static_assert(sizeof(ConditionVariable)<=sizeof(pthread_cond_t),"Invalid pthread_cond_t size");
 
 int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
 {
@@ -312,14 +425,17 @@ int pthread_cond_destroy(pthread_cond_t *cond)
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
     auto *impl=reinterpret_cast<ConditionVariable*>(cond);
-    impl->wait(mutex);
+    if(Mutex *m=kernelMutexImpl(mutex)) impl->wait(*m);
+    else impl->wait(mutex);
     return 0;
 }
 
 int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime)
 {
     auto *impl=reinterpret_cast<ConditionVariable*>(cond);
-    TimedWaitResult res = impl->timedWait(mutex,timespec2ll(abstime));
+    TimedWaitResult res;
+    if(Mutex *m=kernelMutexImpl(mutex)) res=impl->timedWait(*m,timespec2ll(abstime));
+    else res=impl->timedWait(mutex,timespec2ll(abstime));
     return res == TimedWaitResult::Timeout ? ETIMEDOUT : 0;
 }
 
@@ -375,16 +491,16 @@ int pthread_cond_broadcast(pthread_cond_t *cond)
 
 int pthread_once(pthread_once_t *once, void (*func)())
 {
-    if(once==nullptr || func==nullptr || once->is_initialized!=1) return EINVAL;
+    if(fields(once)->is_initialized!=1) return EINVAL;
 
     bool again;
     do {
         {
             FastInterruptDisableLock dLock;
-            switch(once->init_executed)
+            switch(fields(once)->init_executed)
             {
                 case 0: //We're the first ones (or previous call has thrown)
-                    once->init_executed=1;
+                    fields(once)->init_executed=1;
                     again=false;
                     break;
                 case 1: //Call started but not ended
@@ -407,11 +523,11 @@ int pthread_once(pthread_once_t *once, void (*func)())
     try {
         func();
     } catch(...) {
-        once->init_executed=0; //We failed, let some other thread try
+        fields(once)->init_executed=0; //We failed, let some other thread try
         throw;
     }
     #endif //__NO_EXCEPTIONS
-    once->init_executed=2; //We succeeded
+    fields(once)->init_executed=2; //We succeeded
     return 0;
 }
 
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <pthread.h>
+
+/**
+ * \file pthread_prio.h
+ * Newlib declares the pthread mutex protocol API only if
+ * _POSIX_THREAD_PRIO_PROTECT is defined. Miosix implements it in pthread.cpp
+ * on top of the Mutex priority inheritance and priority ceiling protocols,
+ * so applications that need it should include this header.
+ */
+
+#ifndef _POSIX_THREAD_PRIO_PROTECT
+#ifndef PTHREAD_PRIO_NONE
+#define PTHREAD_PRIO_NONE    0
+#define PTHREAD_PRIO_INHERIT 1
+#define PTHREAD_PRIO_PROTECT 2
+#endif //PTHREAD_PRIO_NONE
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr,
+        int *protocol);
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
+int pthread_mutexattr_getprioceiling(const pthread_mutexattr_t *attr,
+        int *prioceiling);
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+        int prioceiling);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //_POSIX_THREAD_PRIO_PROTECT
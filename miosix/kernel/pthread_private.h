@@ -31,19 +31,107 @@
 #pragma once
 
 #include <pthread.h>
+#include <cstddef>
 #include "kernel.h"
 #include "intrusive.h"
 #include "sync.h"
+#include "pthread_prio.h"
+
+#ifndef _NEWLIB_VERSION
+//With other C libraries the pthread types have a different layout, so the
+//architecture defines the fields used by Miosix, stored in their storage
+#include "pthread_types_impl.h"
+#endif //_NEWLIB_VERSION
 
 namespace miosix {
 
+#ifdef _NEWLIB_VERSION
+
+//The Miosix C library defines the pthread types with the fields used by Miosix
+typedef pthread_mutex_t PthreadMutex;
+typedef pthread_mutexattr_t PthreadMutexattr;
+typedef pthread_attr_t PthreadAttr;
+typedef pthread_once_t PthreadOnce;
+
+#endif //_NEWLIB_VERSION
+
+/**
+ * \param mutex a pthread mutex
+ * \return the fields of the mutex used by Miosix
+ */
+static inline PthreadMutex *fields(pthread_mutex_t *mutex)
+{
+    return reinterpret_cast<PthreadMutex*>(mutex);
+}
+
+/**
+ * \param attr a pthread mutex attribute
+ * \return the fields of the attribute used by Miosix
+ */
+static inline PthreadMutexattr *fields(pthread_mutexattr_t *attr)
+{
+    return reinterpret_cast<PthreadMutexattr*>(attr);
+}
+
+static inline const PthreadMutexattr *fields(const pthread_mutexattr_t *attr)
+{
+    return reinterpret_cast<const PthreadMutexattr*>(attr);
+}
+
+/**
+ * \param attr a pthread attribute
+ * \return the fields of the attribute used by Miosix
+ */
+static inline PthreadAttr *fields(pthread_attr_t *attr)
+{
+    return reinterpret_cast<PthreadAttr*>(attr);
+}
+
+static inline const PthreadAttr *fields(const pthread_attr_t *attr)
+{
+    return reinterpret_cast<const PthreadAttr*>(attr);
+}
+
+/**
+ * \param once a pthread once
+ * \return the fields of the once used by Miosix
+ */
+static inline PthreadOnce *fields(pthread_once_t *once)
+{
+    return reinterpret_cast<PthreadOnce*>(once);
+}
+
+/// Value of the recursive field of a pthread_mutex_t that is not implemented
+/// by the functions in this file, but is a handle to a kernel Mutex, used for
+/// the PTHREAD_PRIO_INHERIT and PTHREAD_PRIO_PROTECT protocols
+const int PTHREAD_MUTEX_KERNEL_IMPL=-2;
+
+/**
+ * \param mutex a pthread mutex
+ * \return the kernel Mutex that implements the pthread mutex, or nullptr if
+ * the pthread mutex is implemented by the functions in this file
+ */
+static inline Mutex *kernelMutexImpl(pthread_mutex_t *mutex)
+{
+    if(fields(mutex)->recursive!=PTHREAD_MUTEX_KERNEL_IMPL) return nullptr;
+    return reinterpret_cast<Mutex*>(fields(mutex)->first);
+}
+
+//The lock functions put an element on the stack of the waiting thread in the
+//list of waiting threads. This is safe as they return only after the unlocking
+//thread removed the element from the list, but newer compilers warn about it
+#if __GNUC__>=12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif //__GNUC__>=12
+
 /**
  * \internal
  * Implementation code to lock a mutex. Must be called with interrupts disabled
  * \param mutex mutex to be locked
  * \param d The instance of FastInterruptDisableLock used to disable interrupts
  */
-static inline void IRQdoMutexLock(pthread_mutex_t *mutex,
+static inline void IRQdoMutexLock(PthreadMutex *mutex,
         FastInterruptDisableLock& d)
 {
     void *p=reinterpret_cast<void*>(Thread::IRQgetCurrentThread());
@@ -92,7 +180,7 @@ static inline void IRQdoMutexLock(pthread_mutex_t *mutex,
  * means the mutex is locked one level deep (as if lock() was called once),
  * one means two levels deep, etc. 
  */
-static inline void IRQdoMutexLockToDepth(pthread_mutex_t *mutex,
+static inline void IRQdoMutexLockToDepth(PthreadMutex *mutex,
         FastInterruptDisableLock& d, unsigned int depth)
 {
     void *p=reinterpret_cast<void*>(Thread::IRQgetCurrentThread());
@@ -132,6 +220,10 @@ static inline void IRQdoMutexLockToDepth(pthread_mutex_t *mutex,
     if(mutex->recursive>=0) mutex->recursive=depth;
 }
 
+#if __GNUC__>=12
+#pragma GCC diagnostic pop
+#endif //__GNUC__>=12
+
 /**
  * \internal
  * Implementation code to unlock a mutex.
@@ -140,7 +232,7 @@ static inline void IRQdoMutexLockToDepth(pthread_mutex_t *mutex,
  * \return true if a higher priority thread was woken,
  * only if EDF scheduler is selected, otherwise it always returns false
  */
-static inline bool IRQdoMutexUnlock(pthread_mutex_t *mutex)
+static inline bool IRQdoMutexUnlock(PthreadMutex *mutex)
 {
 //    Safety check removed for speed reasons
 //    if(mutex->owner!=reinterpret_cast<void*>(Thread::IRQgetCurrentThread()))
@@ -176,7 +268,7 @@ static inline bool IRQdoMutexUnlock(pthread_mutex_t *mutex)
  * owner). Zero means the mutex is locked one level deep (lock() was called
  * once), one means two levels deep, etc. 
  */
-static inline unsigned int IRQdoMutexUnlockAllDepthLevels(pthread_mutex_t *mutex)
+static inline unsigned int IRQdoMutexUnlockAllDepthLevels(PthreadMutex *mutex)
 {
 //    Safety check removed for speed reasons
 //    if(mutex->owner!=reinterpret_cast<void*>(Thread::IRQgetCurrentThread()))
@@ -41,7 +41,7 @@ namespace miosix {
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
 extern volatile bool pendingWakeup;
-extern IntrusiveList<SleepData> sleepingList;
+extern SleepingList sleepingList;
 
 //Internal
 static long long burstStart=0;
@@ -51,7 +51,7 @@ static long long nextPreemption=numeric_limits<long long>::max();
 static inline void IRQsetNextPreemptionForIdle()
 {
     if(sleepingList.empty()) nextPreemption=numeric_limits<long long>::max();
-    else nextPreemption=sleepingList.front()->wakeupTime;
+    else nextPreemption=sleepingList.top()->wakeupTime;
     #ifdef WITH_CPU_TIME_COUNTER
     burstStart=IRQgetTime();
     #endif // WITH_CPU_TIME_COUNTER
@@ -65,7 +65,7 @@ static inline void IRQsetNextPreemption(long long burst)
 {
     long long firstWakeupInList;
     if(sleepingList.empty()) firstWakeupInList=numeric_limits<long long>::max();
-    else firstWakeupInList=sleepingList.front()->wakeupTime;
+    else firstWakeupInList=sleepingList.top()->wakeupTime;
     burstStart=IRQgetTime();
     nextPreemption=min(firstWakeupInList,burstStart+burst);
     internal::IRQosTimerSetInterrupt(nextPreemption);
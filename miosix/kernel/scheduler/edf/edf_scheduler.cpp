@@ -41,7 +41,7 @@ namespace miosix {
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
 extern volatile bool pendingWakeup;
-extern IntrusiveList<SleepData> sleepingList;
+extern SleepingList sleepingList;
 
 //Static members
 static long long nextPreemption=numeric_limits<long long>::max();
@@ -119,7 +119,7 @@ long long EDFScheduler::IRQgetNextPreemption()
 static void IRQsetNextPreemption()
 {
     if(sleepingList.empty()) nextPreemption=numeric_limits<long long>::max();
-    else nextPreemption=sleepingList.front()->wakeupTime;
+    else nextPreemption=sleepingList.top()->wakeupTime;
 
     //We could not set an interrupt if the sleeping list is empty, but then we
     //would spuriously run the scheduler at every rollover of the hardware timer
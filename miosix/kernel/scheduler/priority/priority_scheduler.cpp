@@ -38,11 +38,13 @@ namespace miosix {
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
 extern volatile bool pendingWakeup;
-extern IntrusiveList<SleepData> sleepingList;
+extern SleepingList sleepingList;
 
 //Internal data
 static long long nextPeriodicPreemption=std::numeric_limits<long long>::max();
 
+static_assert(PRIORITY_MAX<=32,"readyBitmap can only hold 32 priorities");
+
 //
 // class PriorityScheduler
 //
@@ -59,6 +61,17 @@ bool PriorityScheduler::PKaddThread(Thread *thread,
         thread->schedData.next=threadList[priority.get()]->schedData.next;
         threadList[priority.get()]->schedData.next=thread;
     }
+    {
+        //Note: can't use FastInterruptDisableLock here since this code is
+        //also called *before* the kernel is started.
+        //Using FastInterruptDisableLock would enable interrupts prematurely
+        InterruptDisableLock dLock;
+        if(thread->flags.isReady() && !thread->schedData.lastReadyStatus)
+        {
+            IRQaddToReadyQueue(thread);
+            thread->schedData.lastReadyStatus=true;
+        }
+    }
     return true;
 }
 
@@ -142,8 +155,18 @@ void PriorityScheduler::PKsetPriority(Thread *thread,
         PrioritySchedulerPriority newPriority)
 {
     PrioritySchedulerPriority oldPriority=thread->PKgetPriority();
-    //First set priority to the new value
-    thread->schedData.priority=newPriority;
+    //First move the thread to the ready queue of the new priority, if it is
+    //ready. Interrupts need to be disabled as the ready queues are also
+    //modified by IRQwaitStatusHook
+    {
+        FastInterruptDisableLock dLock;
+        if(thread->schedData.lastReadyStatus)
+        {
+            IRQremoveFromReadyQueue(thread);
+            thread->schedData.priority=newPriority;
+            IRQaddToReadyQueue(thread);
+        } else thread->schedData.priority=newPriority;
+    }
     //Then remove the thread from its old list
     if(threadList[oldPriority.get()]==thread)
     {
@@ -193,6 +216,20 @@ void PriorityScheduler::PKsetPriority(Thread *thread,
     }
 }
 
+void PriorityScheduler::IRQwaitStatusHook(Thread* t)
+{
+    if(t->flags.isReady())
+    {
+        if(t->schedData.lastReadyStatus) return;
+        IRQaddToReadyQueue(t);
+        t->schedData.lastReadyStatus=true;
+    } else {
+        if(!t->schedData.lastReadyStatus) return;
+        IRQremoveFromReadyQueue(t);
+        t->schedData.lastReadyStatus=false;
+    }
+}
+
 void PriorityScheduler::IRQsetIdleThread(Thread *idleThread)
 {
     idleThread->schedData.priority=-1;
@@ -208,7 +245,7 @@ static long long IRQsetNextPreemption(bool runningIdleThread)
 {
     long long first;
     if(sleepingList.empty()) first=std::numeric_limits<long long>::max();
-    else first=sleepingList.front()->wakeupTime;
+    else first=sleepingList.top()->wakeupTime;
 
     long long t=IRQgetTime();
     if(runningIdleThread) nextPeriodicPreemption=first;
@@ -230,42 +267,39 @@ void PriorityScheduler::IRQfindNextThread()
     #ifdef WITH_CPU_TIME_COUNTER
     Thread *prev=const_cast<Thread*>(runningThread);
     #endif // WITH_CPU_TIME_COUNTER
-    for(int i=PRIORITY_MAX-1;i>=0;i--)
+    if(readyBitmap!=0)
     {
-        if(threadList[i]==nullptr) continue;
-        Thread *temp=threadList[i]->schedData.next;
-        for(;;)
+        //Highest priority with at least one READY thread
+        int i=31-__builtin_clz(readyBitmap);
+        Thread *temp=readyList[i];
+        //The running thread is still at the head if it was the only ready one
+        //when it was chosen, skip it so that the threads that became ready
+        //since then are chosen first, as round robin requires
+        if(temp==runningThread) temp=temp->schedData.readyNext;
+        runningThread=temp;
+        #ifdef WITH_PROCESSES
+        if(const_cast<Thread*>(runningThread)->flags.isInUserspace()==false)
         {
-            if(temp->flags.isReady())
-            {
-                //Found a READY thread, so run this one
-                runningThread=temp;
-                #ifdef WITH_PROCESSES
-                if(const_cast<Thread*>(runningThread)->flags.isInUserspace()==false)
-                {
-                    ctxsave=runningThread->ctxsave;
-                    MPUConfiguration::IRQdisable();
-                } else {
-                    ctxsave=runningThread->userCtxsave;
-                    //A kernel thread is never in userspace, so the cast is safe
-                    static_cast<Process*>(runningThread->proc)->mpu.IRQenable();
-                }
-                #else //WITH_PROCESSES
-                ctxsave=temp->ctxsave;
-                #endif //WITH_PROCESSES
-                //Rotate to next thread so that next time the list is walked
-                //a different thread, if available, will be chosen first
-                threadList[i]=temp;
-                #ifndef WITH_CPU_TIME_COUNTER
-                IRQsetNextPreemption(false);
-                #else //WITH_CPU_TIME_COUNTER
-                auto t=IRQsetNextPreemption(false);
-                IRQprofileContextSwitch(prev->timeCounterData,temp->timeCounterData,t);
-                #endif //WITH_CPU_TIME_COUNTER
-                return;
-            } else temp=temp->schedData.next;
-            if(temp==threadList[i]->schedData.next) break;
+            ctxsave=runningThread->ctxsave;
+            MPUConfiguration::IRQdisable();
+        } else {
+            ctxsave=runningThread->userCtxsave;
+            //A kernel thread is never in userspace, so the cast is safe
+            static_cast<Process*>(runningThread->proc)->mpu.IRQenable();
         }
+        #else //WITH_PROCESSES
+        ctxsave=temp->ctxsave;
+        #endif //WITH_PROCESSES
+        //Rotate to next thread so that next time the ready queue is used
+        //a different thread, if available, will be chosen first
+        readyList[i]=temp->schedData.readyNext;
+        #ifndef WITH_CPU_TIME_COUNTER
+        IRQsetNextPreemption(false);
+        #else //WITH_CPU_TIME_COUNTER
+        auto t=IRQsetNextPreemption(false);
+        IRQprofileContextSwitch(prev->timeCounterData,temp->timeCounterData,t);
+        #endif //WITH_CPU_TIME_COUNTER
+        return;
     }
     //No thread found, run the idle thread
     runningThread=idle;
@@ -281,7 +315,46 @@ void PriorityScheduler::IRQfindNextThread()
     #endif //WITH_CPU_TIME_COUNTER
 }
 
+void PriorityScheduler::IRQaddToReadyQueue(Thread *thread)
+{
+    int i=thread->schedData.priority.get();
+    Thread *head=readyList[i];
+    if(head==nullptr)
+    {
+        readyList[i]=thread;
+        thread->schedData.readyNext=thread;//Circular list
+        thread->schedData.readyPrev=thread;
+        readyBitmap|=1u<<i;
+    } else {
+        //Insert at the tail, that is just before the head, so that the thread
+        //runs after all the ones that were already ready
+        thread->schedData.readyNext=head;
+        thread->schedData.readyPrev=head->schedData.readyPrev;
+        head->schedData.readyPrev->schedData.readyNext=thread;
+        head->schedData.readyPrev=thread;
+    }
+}
+
+void PriorityScheduler::IRQremoveFromReadyQueue(Thread *thread)
+{
+    int i=thread->schedData.priority.get();
+    if(thread->schedData.readyNext==thread)
+    {
+        //Only one element in the list
+        readyList[i]=nullptr;
+        readyBitmap&=~(1u<<i);
+    } else {
+        thread->schedData.readyPrev->schedData.readyNext=thread->schedData.readyNext;
+        thread->schedData.readyNext->schedData.readyPrev=thread->schedData.readyPrev;
+        if(readyList[i]==thread) readyList[i]=thread->schedData.readyNext;
+    }
+    thread->schedData.readyNext=nullptr;
+    thread->schedData.readyPrev=nullptr;
+}
+
 Thread *PriorityScheduler::threadList[PRIORITY_MAX]={nullptr};
+Thread *PriorityScheduler::readyList[PRIORITY_MAX]={nullptr};
+unsigned int PriorityScheduler::readyBitmap=0;
 Thread *PriorityScheduler::idle=nullptr;
 
 } //namespace miosix
@@ -111,7 +111,7 @@ public:
      * its running status. For example when a thread become sleeping, waiting,
      * deleted or if it exits the sleeping or waiting status
      */
-    static void IRQwaitStatusHook(Thread* t) {}
+    static void IRQwaitStatusHook(Thread* t);
 
     /**
      * \internal
@@ -137,10 +137,35 @@ public:
 
 private:
 
+    /**
+     * \internal
+     * Add a thread to the tail of the ready queue of its priority.
+     * Can only be called with interrupts disabled.
+     * \param thread thread to add, must not be already in the ready queue
+     */
+    static void IRQaddToReadyQueue(Thread *thread);
+
+    /**
+     * \internal
+     * Remove a thread from the ready queue of its priority.
+     * Can only be called with interrupts disabled.
+     * \param thread thread to remove, must be in the ready queue
+     */
+    static void IRQremoveFromReadyQueue(Thread *thread);
+
     ///\internal Vector of lists of threads, there's one list for each priority
     ///Each list s a circular list.
     static Thread *threadList[PRIORITY_MAX];
 
+    ///\internal Vector of ready queues, there's one for each priority. Each
+    ///ready queue is a circular doubly linked list containing only the threads
+    ///in the READY status, so that finding the next thread to run does not
+    ///depend on the number of blocked threads
+    static Thread *readyList[PRIORITY_MAX];
+
+    ///\internal Bit i is set if readyList[i] is not empty
+    static unsigned int readyBitmap;
+
     ///\internal idle thread
     static Thread *idle;
 };
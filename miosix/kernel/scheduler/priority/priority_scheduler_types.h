@@ -130,6 +130,13 @@ public:
     ///list to the new priority list.
     PrioritySchedulerPriority priority;
     Thread *next;///<Pointer to next thread of the same priority. CIRCULAR list
+    ///Pointers to the next and previous thread in the ready queue of the same
+    ///priority. CIRCULAR doubly linked list, only threads in the READY status
+    ///are in the ready queue
+    Thread *readyNext;
+    Thread *readyPrev;
+    ///True if the thread is currently in its ready queue
+    bool lastReadyStatus;
 };
 
 } //namespace miosix
@@ -40,6 +40,7 @@ start the kernel and filesystem.
 #include "interfaces/deep_sleep.h"
 // Miosix kernel
 #include "kernel.h"
+#include "stage_2_boot.h"
 #include "filesystem/file_access.h"
 #include "error.h"
 #include "logging.h"
@@ -55,6 +56,7 @@ int main(int argc, char *argv[]);
 
 namespace miosix {
 
+#ifndef ARCH_CRT_CALLS_CONSTRUCTORS
 /**
  * \internal
  * Calls C++ global constructors
@@ -70,6 +72,7 @@ static void callConstructors(unsigned long *start, unsigned long *end)
         funcptr();
     }
 }
+#endif //ARCH_CRT_CALLS_CONSTRUCTORS
 
 void *mainLoader(void *argv)
 {
@@ -80,6 +83,7 @@ void *mainLoader(void *argv)
     bspInit2();
 
     //Initialize application C++ global constructors (called after boot)
+    #ifndef ARCH_CRT_CALLS_CONSTRUCTORS
     extern unsigned long __preinit_array_start asm("__preinit_array_start");
     extern unsigned long __preinit_array_end asm("__preinit_array_end");
     extern unsigned long __init_array_start asm("__init_array_start");
@@ -89,6 +93,7 @@ void *mainLoader(void *argv)
     callConstructors(&__preinit_array_start, &__preinit_array_end);
     callConstructors(&__init_array_start, &__init_array_end);
     callConstructors(&_ctor_start, &_ctor_end);
+    #endif //ARCH_CRT_CALLS_CONSTRUCTORS
     
     bootlog("OS Timer freq = %d Hz\n", internal::osTimerGetFrequency());
     bootlog("Available heap %d out of %d Bytes\n",
@@ -121,9 +126,11 @@ extern "C" void _init()
     using namespace miosix;
 
     //Initialize kernel C++ global constructors (called before boot)
+    #ifndef ARCH_CRT_CALLS_CONSTRUCTORS
     extern unsigned long __miosix_init_array_start asm("__miosix_init_array_start");
     extern unsigned long __miosix_init_array_end asm("__miosix_init_array_end");
     callConstructors(&__miosix_init_array_start, &__miosix_init_array_end);
+    #endif //ARCH_CRT_CALLS_CONSTRUCTORS
 
     if(areInterruptsEnabled()) errorHandler(INTERRUPTS_ENABLED_AT_BOOT);
     IRQbspInit();
@@ -29,23 +29,11 @@
 #include "kernel.h"
 #include "error.h"
 #include "pthread_private.h"
-#include <algorithm>
 
 using namespace std;
 
 namespace miosix {
 
-/**
- * Helper lambda to sort threads in a min heap to implement priority inheritance
- * \param lhs first thread to compare
- * \param rhs second thread to compare
- * \return true if lhs->getPriority() < rhs->getPriority()
- */
-static auto PKlowerPriority=[](Thread *lhs, Thread *rhs)
-{
-    return lhs->PKgetPriority().mutexLessOp(rhs->PKgetPriority());
-};
-
 //
 // class FastMutex
 //
@@ -66,7 +54,13 @@ FastMutex::FastMutex(Options opt)
 // class Mutex
 //
 
-Mutex::Mutex(Options opt): owner(nullptr), next(nullptr), waiting()
+Mutex::Mutex(Options opt): owner(nullptr), next(nullptr), hasCeiling(false)
+{
+    recursiveDepth= opt==RECURSIVE ? 0 : -1;
+}
+
+Mutex::Mutex(Priority ceiling, Options opt): owner(nullptr), next(nullptr),
+        ceiling(ceiling), hasCeiling(true)
 {
     recursiveDepth= opt==RECURSIVE ? 0 : -1;
 }
@@ -83,6 +77,7 @@ void Mutex::PKlock(PauseKernelLock& dLock)
         //Add this mutex to the list of mutexes locked by owner
         this->next=owner->mutexLocked;
         owner->mutexLocked=this;
+        PKraiseToCeiling();
         return;
     }
 
@@ -98,24 +93,25 @@ void Mutex::PKlock(PauseKernelLock& dLock)
         } else errorHandler(MUTEX_DEADLOCK); //Bad, deadlock
     }
 
-    //Add thread to mutex' waiting queue
-    waiting.push_back(p);
-    push_heap(waiting.begin(),waiting.end(),PKlowerPriority);
+    //Add thread to mutex' waiting queue. The token is on this thread's stack
+    //and is removed from the queue by the thread that gives us the mutex
+    if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
+    MutexWaitToken token(p,this);
+    p->mutexWaiting=&token;
+    waiting.push(&token);
 
     //Handle priority inheritance
-    if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
-    p->mutexWaiting=this;
-    if(owner->PKgetPriority().mutexLessOp(p->PKgetPriority()))
+    Thread *walk=owner;
+    while(walk->PKgetPriority().mutexLessOp(p->PKgetPriority()))
     {
-        Thread *walk=owner;
-        for(;;)
-        {
-            Scheduler::PKsetPriority(walk,p->PKgetPriority());
-            if(walk->mutexWaiting==nullptr) break;
-            make_heap(walk->mutexWaiting->waiting.begin(),
-                      walk->mutexWaiting->waiting.end(),PKlowerPriority);
-            walk=walk->mutexWaiting->owner;
-        }
+        //If walk is itself waiting on a mutex, its position in that mutex'
+        //waiting queue depends on its priority, so reinsert it
+        MutexWaitToken *walkToken=walk->mutexWaiting;
+        if(walkToken!=nullptr) walkToken->mutex->waiting.removeFast(walkToken);
+        Scheduler::PKsetPriority(walk,p->PKgetPriority());
+        if(walkToken==nullptr) break;
+        walkToken->mutex->waiting.push(walkToken);
+        walk=walkToken->mutex->owner;
     }
 
     //The while is necessary to protect against spurious wakeups
@@ -135,6 +131,7 @@ void Mutex::PKlockToDepth(PauseKernelLock& dLock, unsigned int depth)
         //Add this mutex to the list of mutexes locked by owner
         this->next=owner->mutexLocked;
         owner->mutexLocked=this;
+        PKraiseToCeiling();
         return;
     }
 
@@ -150,24 +147,25 @@ void Mutex::PKlockToDepth(PauseKernelLock& dLock, unsigned int depth)
         } else errorHandler(MUTEX_DEADLOCK); //Bad, deadlock
     }
 
-    //Add thread to mutex' waiting queue
-    waiting.push_back(p);
-    push_heap(waiting.begin(),waiting.end(),PKlowerPriority);
+    //Add thread to mutex' waiting queue. The token is on this thread's stack
+    //and is removed from the queue by the thread that gives us the mutex
+    if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
+    MutexWaitToken token(p,this);
+    p->mutexWaiting=&token;
+    waiting.push(&token);
 
     //Handle priority inheritance
-    if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
-    p->mutexWaiting=this;
-    if(owner->PKgetPriority().mutexLessOp(p->PKgetPriority()))
+    Thread *walk=owner;
+    while(walk->PKgetPriority().mutexLessOp(p->PKgetPriority()))
     {
-        Thread *walk=owner;
-        for(;;)
-        {
-            Scheduler::PKsetPriority(walk,p->PKgetPriority());
-            if(walk->mutexWaiting==nullptr) break;
-            make_heap(walk->mutexWaiting->waiting.begin(),
-                      walk->mutexWaiting->waiting.end(),PKlowerPriority);
-            walk=walk->mutexWaiting->owner;
-        }
+        //If walk is itself waiting on a mutex, its position in that mutex'
+        //waiting queue depends on its priority, so reinsert it
+        MutexWaitToken *walkToken=walk->mutexWaiting;
+        if(walkToken!=nullptr) walkToken->mutex->waiting.removeFast(walkToken);
+        Scheduler::PKsetPriority(walk,p->PKgetPriority());
+        if(walkToken==nullptr) break;
+        walkToken->mutex->waiting.push(walkToken);
+        walk=walkToken->mutex->owner;
     }
 
     //The while is necessary to protect against spurious wakeups
@@ -187,6 +185,7 @@ bool Mutex::PKtryLock(PauseKernelLock& dLock)
         //Add this mutex to the list of mutexes locked by owner
         this->next=owner->mutexLocked;
         owner->mutexLocked=this;
+        PKraiseToCeiling();
         return true;
     }
     if(owner==p && recursiveDepth>=0)
@@ -240,9 +239,7 @@ bool Mutex::PKunlock(PauseKernelLock& dLock)
         Mutex *walk=owner->mutexLocked;
         while(walk!=nullptr)
         {
-            if(walk->waiting.empty()==false)
-                if(pr.mutexLessOp(walk->waiting.front()->PKgetPriority()))
-                    pr=walk->waiting.front()->PKgetPriority();
+            pr=walk->PKinheritedPriority(pr);
             walk=walk->next;
         }
         if(pr!=owner->PKgetPriority()) Scheduler::PKsetPriority(owner,pr);
@@ -252,24 +249,24 @@ bool Mutex::PKunlock(PauseKernelLock& dLock)
     if(waiting.empty()==false)
     {
         //There is at least another thread waiting
-        owner=waiting.front();
-        pop_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-        waiting.pop_back();
-        if(owner->mutexWaiting!=this) errorHandler(UNEXPECTED);
+        MutexWaitToken *token=waiting.top();
+        waiting.pop();
+        owner=token->thread;
+        if(owner->mutexWaiting!=token) errorHandler(UNEXPECTED);
         owner->mutexWaiting=nullptr;
         owner->PKwakeup();
         if(owner->mutexLocked==nullptr) owner->savedPriority=owner->PKgetPriority();
         //Add this mutex to the list of mutexes locked by owner
         this->next=owner->mutexLocked;
         owner->mutexLocked=this;
+        PKraiseToCeiling();
         //Handle priority inheritance of new owner
         if(waiting.empty()==false &&
-                owner->PKgetPriority().mutexLessOp(waiting.front()->PKgetPriority()))
-                Scheduler::PKsetPriority(owner,waiting.front()->PKgetPriority());
+                owner->PKgetPriority().mutexLessOp(waiting.top()->thread->PKgetPriority()))
+                Scheduler::PKsetPriority(owner,waiting.top()->thread->PKgetPriority());
         return p->PKgetPriority().mutexLessOp(owner->PKgetPriority());
     } else {
         owner=nullptr; //No threads waiting
-        std::vector<Thread *>().swap(waiting); //Save some RAM
         return false;
     }
 }
@@ -311,9 +308,7 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
         Mutex *walk=owner->mutexLocked;
         while(walk!=nullptr)
         {
-            if(walk->waiting.empty()==false)
-                if(pr.mutexLessOp(walk->waiting.front()->PKgetPriority()))
-                    pr=walk->waiting.front()->PKgetPriority();
+            pr=walk->PKinheritedPriority(pr);
             walk=walk->next;
         }
         if(pr!=owner->PKgetPriority()) Scheduler::PKsetPriority(owner,pr);
@@ -323,23 +318,23 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
     if(waiting.empty()==false)
     {
         //There is at least another thread waiting
-        owner=waiting.front();
-        pop_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-        waiting.pop_back();
-        if(owner->mutexWaiting!=this) errorHandler(UNEXPECTED);
+        MutexWaitToken *token=waiting.top();
+        waiting.pop();
+        owner=token->thread;
+        if(owner->mutexWaiting!=token) errorHandler(UNEXPECTED);
         owner->mutexWaiting=nullptr;
         owner->PKwakeup();
         if(owner->mutexLocked==nullptr) owner->savedPriority=owner->PKgetPriority();
         //Add this mutex to the list of mutexes locked by owner
         this->next=owner->mutexLocked;
         owner->mutexLocked=this;
+        PKraiseToCeiling();
         //Handle priority inheritance of new owner
         if(waiting.empty()==false &&
-                owner->PKgetPriority().mutexLessOp(waiting.front()->PKgetPriority()))
-                Scheduler::PKsetPriority(owner,waiting.front()->PKgetPriority());
+                owner->PKgetPriority().mutexLessOp(waiting.top()->thread->PKgetPriority()))
+                Scheduler::PKsetPriority(owner,waiting.top()->thread->PKgetPriority());
     } else {
         owner=nullptr; //No threads waiting
-        std::vector<Thread *>().swap(waiting); //Save some RAM
     }
     
     if(recursiveDepth<0) return 0;
@@ -353,7 +348,7 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
 //
 
 //Memory layout must be kept in sync with pthread_cond, see pthread.cpp
-static_assert(sizeof(ConditionVariable)==sizeof(pthread_cond_t),"");
+static_assert(sizeof(ConditionVariable)<=sizeof(pthread_cond_t),"");
 
 void ConditionVariable::wait(Mutex& m)
 {
@@ -370,11 +365,11 @@ void ConditionVariable::wait(pthread_mutex_t *m)
 {
     WaitToken listItem(Thread::getCurrentThread());
     FastInterruptDisableLock dLock;
-    unsigned int depth=IRQdoMutexUnlockAllDepthLevels(m);
+    unsigned int depth=IRQdoMutexUnlockAllDepthLevels(fields(m));
     condList.push_back(&listItem); //Putting this thread last on the list (lifo policy)
     Thread::IRQenableIrqAndWait(dLock);
     condList.removeFast(&listItem); //In case of spurious wakeup
-    IRQdoMutexLockToDepth(m,dLock,depth);
+    IRQdoMutexLockToDepth(fields(m),dLock,depth);
 }
 
 TimedWaitResult ConditionVariable::timedWait(Mutex& m, long long absTime)
@@ -393,11 +388,11 @@ TimedWaitResult ConditionVariable::timedWait(pthread_mutex_t *m, long long absTi
 {
     WaitToken listItem(Thread::getCurrentThread());
     FastInterruptDisableLock dLock;
-    unsigned int depth=IRQdoMutexUnlockAllDepthLevels(m);
+    unsigned int depth=IRQdoMutexUnlockAllDepthLevels(fields(m));
     condList.push_back(&listItem); //Putting this thread last on the list (lifo policy)
     auto result=Thread::IRQenableIrqAndTimedWait(dLock,absTime);
     condList.removeFast(&listItem); //In case of timeout or spurious wakeup
-    IRQdoMutexLockToDepth(m,dLock,depth);
+    IRQdoMutexLockToDepth(fields(m),dLock,depth);
     return result;
 }
 
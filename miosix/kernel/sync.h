@@ -31,7 +31,6 @@
 #include "kernel.h"
 #include "kernel/scheduler/scheduler.h"
 #include "intrusive.h"
-#include <vector>
 
 namespace miosix {
 
@@ -116,6 +115,19 @@ private:
 //Forward declaration
 class ConditionVariable;
 
+/**
+ * \internal
+ * Function object to sort the threads waiting on a Mutex so that the highest
+ * priority thread is on top of the heap
+ */
+struct MutexWaitTokenCompare
+{
+    bool operator()(const MutexWaitToken& a, const MutexWaitToken& b) const
+    {
+        return b.thread->PKgetPriority().mutexLessOp(a.thread->PKgetPriority());
+    }
+};
+
 /**
  * A mutex class with support for priority inheritance. If a thread tries to
  * enter a critical section which is not free, it will be put to sleep and
@@ -126,6 +138,14 @@ class ConditionVariable;
  * mutex with new or on the stack must be done with care, to avoid deleting a
  * locked mutex, and to avoid situations where a thread tries to lock a
  * deleted mutex.<br>
+ * A mutex can optionally be given a priority ceiling, implementing the
+ * immediate priority ceiling protocol. The priority of a thread that locks
+ * the mutex is raised to the ceiling as soon as it acquires the lock, and
+ * restored when it unlocks it. If the ceiling is set to the highest priority
+ * of the threads that use the mutex, on a single core a thread can be blocked
+ * at most by one critical section, and no priority inheritance chain is ever
+ * walked. Priority inheritance is still performed if a thread with a priority
+ * higher than the ceiling tries to lock the mutex.<br>
  */
 class Mutex
 {
@@ -145,6 +165,15 @@ public:
      */
     Mutex(Options opt=DEFAULT);
 
+    /**
+     * Constructor, initializes a mutex with a priority ceiling.
+     * \param ceiling priority the thread that locks the mutex is raised to
+     * while it holds the lock. Threads already having a higher priority keep
+     * their priority
+     * \param opt mutex options
+     */
+    Mutex(Priority ceiling, Options opt=DEFAULT);
+
     /**
      * Locks the critical section. If the critical section is already locked,
      * the thread will be queued in a wait list.
@@ -187,6 +216,15 @@ public:
         #endif //SCHED_TYPE_EDF
     }
 
+    /**
+     * Can be called only with kernel paused.
+     * \return true if the mutex is locked by any thread, including the caller
+     */
+    bool PKisLocked() const
+    {
+        return owner!=nullptr;
+    }
+
     //Unwanted methods
     Mutex(const Mutex& s) = delete;
     Mutex& operator= (const Mutex& s) = delete;
@@ -244,6 +282,33 @@ private:
      */
     unsigned int PKunlockAllDepthLevels(PauseKernelLock& dLock);
 
+    /**
+     * Called when owner has just acquired the mutex, raises its priority to
+     * the mutex ceiling, if the mutex has one.
+     * Can be called only with kernel paused.
+     */
+    void PKraiseToCeiling()
+    {
+        if(hasCeiling && owner->PKgetPriority().mutexLessOp(ceiling))
+            Scheduler::PKsetPriority(owner,ceiling);
+    }
+
+    /**
+     * \param pr priority of a thread, possibly inherited from other mutexes
+     * \return the max between pr and the priority this mutex causes its owner
+     * to have, which is the priority of the highest priority waiting thread,
+     * and the ceiling if the mutex has one.
+     * Can be called only with kernel paused.
+     */
+    Priority PKinheritedPriority(Priority pr)
+    {
+        if(hasCeiling && pr.mutexLessOp(ceiling)) pr=ceiling;
+        if(waiting.empty()==false)
+            if(pr.mutexLessOp(waiting.top()->thread->PKgetPriority()))
+                pr=waiting.top()->thread->PKgetPriority();
+        return pr;
+    }
+
     /// Thread currently inside critical section, if NULL the critical section
     /// is free
     Thread *owner;
@@ -252,12 +317,18 @@ private:
     /// thread that owns this mutex. This field is necessary to make the list.
     Mutex *next;
 
-    /// Waiting thread are stored in this min-heap, sorted by priority
-    std::vector<Thread *> waiting;
+    /// Waiting thread are stored in this heap, the highest priority on top
+    IntrusivePairingHeap<MutexWaitToken,MutexWaitTokenCompare> waiting;
 
     /// Used to hold nesting depth for recursive mutexes, -1 if not recursive
     int recursiveDepth;
 
+    /// Priority ceiling, only meaningful if hasCeiling is true
+    Priority ceiling;
+
+    /// True if the mutex uses the priority ceiling protocol
+    bool hasCeiling;
+
     //Friends
     friend class ConditionVariable;
     friend class Thread;
@@ -0,0 +1,499 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "tlsf.h"
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+namespace miosix {
+
+/**
+ * \param x a nonzero number
+ * \return the index of the most significant bit set
+ */
+static inline unsigned int fls(size_t x)
+{
+    return sizeof(unsigned long)*8-1-__builtin_clzl(x);
+}
+
+/**
+ * \param x a nonzero number
+ * \return the index of the least significant bit set
+ */
+static inline unsigned int ffs(unsigned int x)
+{
+    return __builtin_ctz(x);
+}
+
+bool TlsfHeap::addPool(void *start, size_t size)
+{
+    if(poolStart!=nullptr) return false;
+    uintptr_t begin=reinterpret_cast<uintptr_t>(start);
+    uintptr_t end=begin+size;
+    begin=(begin+alignment-1) & ~(alignment-1);
+    end&=~(alignment-1);
+    //Room for the first block and for the zero size block marking the end
+    if(end<=begin || end-begin<2*headerSize+minBlockSize) return false;
+    size=end-begin-2*headerSize;
+    if(size>maxBlockSize) size=maxBlockSize;
+
+    flBitmap=0;
+    memset(slBitmap,0,sizeof(slBitmap));
+    memset(lists,0,sizeof(lists));
+    usedBytes=usedBlocks=highWatermark=0;
+
+    Block *b=reinterpret_cast<Block*>(begin);
+    b->prevPhys=nullptr;
+    b->size=size;
+    Block *sentinel=nextPhys(b);
+    sentinel->prevPhys=b;
+    sentinel->size=0;
+    poolStart=reinterpret_cast<char*>(b);
+    poolEnd=reinterpret_cast<char*>(sentinel)+headerSize;
+    insertFree(b);
+    return true;
+}
+
+void *TlsfHeap::allocate(size_t size)
+{
+    size=adjustSize(size);
+    if(size==0) return nullptr;
+    Block *b=findFree(size);
+    if(b==nullptr) return nullptr;
+    trim(b,size);
+    markUsed(b);
+    return toPtr(b);
+}
+
+void *TlsfHeap::allocateAligned(size_t align, size_t size)
+{
+    if(align<=alignment) return allocate(size);
+    if((align & (align-1)) || align>maxBlockSize) return nullptr;
+    size=adjustSize(size);
+    if(size==0) return nullptr;
+    //If the block found is not aligned, the part before the aligned address
+    //must be large enough to become a free block
+    const size_t gapMin=headerSize+minBlockSize;
+    size_t searchSize=adjustSize(size+align+gapMin);
+    if(searchSize==0) return nullptr;
+    Block *b=findFree(searchSize);
+    if(b==nullptr) return nullptr;
+
+    uintptr_t p=reinterpret_cast<uintptr_t>(toPtr(b));
+    uintptr_t a=(p+align-1) & ~(align-1);
+    if(a!=p && a-p<gapMin) a=(p+gapMin+align-1) & ~(align-1);
+    if(a!=p)
+    {
+        size_t gap=a-p;
+        Block *n=fromPtr(reinterpret_cast<void*>(a));
+        n->prevPhys=b;
+        n->size=blockSize(b)-gap;
+        nextPhys(n)->prevPhys=n;
+        b->size=gap-headerSize;
+        //The block before b can't be free, as free blocks are always merged
+        insertFree(b);
+        b=n;
+    }
+    trim(b,size);
+    markUsed(b);
+    return toPtr(b);
+}
+
+void *TlsfHeap::reallocate(void *ptr, size_t size)
+{
+    if(ptr==nullptr) return allocate(size);
+    if(size==0)
+    {
+        deallocate(ptr);
+        return nullptr;
+    }
+    size_t adjusted=adjustSize(size);
+    if(adjusted==0) return nullptr;
+    Block *b=fromPtr(ptr);
+    size_t oldSize=blockSize(b);
+    Block *n=nextPhys(b);
+    if(adjusted<=oldSize || (isFree(n) &&
+       oldSize+headerSize+blockSize(n)>=adjusted))
+    {
+        //Resize in place, growing into the following free block if needed
+        usedBytes-=oldSize;
+        mergeNext(b);
+        trim(b,adjusted);
+        usedBytes+=blockSize(b);
+        size_t end=reinterpret_cast<char*>(nextPhys(b))-poolStart;
+        highWatermark=max(highWatermark,end);
+        return ptr;
+    }
+    void *result=allocate(size);
+    if(result==nullptr) return nullptr;
+    memcpy(result,ptr,oldSize);
+    deallocate(ptr);
+    return result;
+}
+
+void TlsfHeap::deallocate(void *ptr)
+{
+    if(ptr==nullptr) return;
+    Block *b=fromPtr(ptr);
+    if(isFree(b)) return; //Double free
+    usedBytes-=headerSize+blockSize(b);
+    usedBlocks--;
+    Block *p=b->prevPhys;
+    if(p!=nullptr && isFree(p))
+    {
+        removeFree(p);
+        p->size+=headerSize+blockSize(b);
+        nextPhys(p)->prevPhys=p;
+        b=p;
+    }
+    mergeNext(b);
+    insertFree(b);
+}
+
+size_t TlsfHeap::usableSize(void *ptr) const
+{
+    return blockSize(fromPtr(ptr));
+}
+
+TlsfStats TlsfHeap::stats() const
+{
+    TlsfStats result;
+    result.usedBytes=usedBytes;
+    result.usedBlocks=usedBlocks;
+    result.highWatermark=highWatermark;
+    result.freeBytes=0;
+    result.freeBlocks=0;
+    result.largestFree=0;
+    for(unsigned int fl=0;fl<flCount;fl++)
+    {
+        if((flBitmap & (1u<<fl))==0) continue;
+        for(unsigned int sl=0;sl<slCount;sl++)
+        {
+            for(Block *b=lists[fl][sl];b!=nullptr;b=b->nextFree)
+            {
+                result.freeBytes+=blockSize(b);
+                result.freeBlocks++;
+                result.largestFree=max(result.largestFree,blockSize(b));
+            }
+        }
+    }
+    return result;
+}
+
+bool TlsfHeap::check() const
+{
+    if(poolStart==nullptr) return true;
+    size_t used=0, numUsed=0, numFree=0;
+    const Block *prev=nullptr;
+    const Block *b=reinterpret_cast<const Block*>(poolStart);
+    for(;;)
+    {
+        if(b->prevPhys!=prev) return false;
+        if(blockSize(b)==0) break; //End of pool
+        if(isFree(b))
+        {
+            if(prev!=nullptr && isFree(prev)) return false; //Not merged
+            unsigned int fl, sl;
+            mapping(blockSize(b),fl,sl);
+            const Block *walk=lists[fl][sl];
+            while(walk!=nullptr && walk!=b) walk=walk->nextFree;
+            if(walk==nullptr) return false; //Not in its free list
+            numFree++;
+        } else {
+            used+=headerSize+blockSize(b);
+            numUsed++;
+        }
+        prev=b;
+        b=nextPhys(b);
+        if(reinterpret_cast<const char*>(b)>=poolEnd) return false;
+    }
+    if(reinterpret_cast<const char*>(b)+headerSize!=poolEnd) return false;
+    if(used!=usedBytes || numUsed!=usedBlocks) return false;
+    size_t listed=0;
+    for(unsigned int fl=0;fl<flCount;fl++)
+    {
+        bool flNotEmpty=false;
+        for(unsigned int sl=0;sl<slCount;sl++)
+        {
+            bool notEmpty=lists[fl][sl]!=nullptr;
+            if(notEmpty!=((slBitmap[fl] & (1u<<sl))!=0)) return false;
+            flNotEmpty|=notEmpty;
+            for(Block *w=lists[fl][sl];w!=nullptr;w=w->nextFree)
+            {
+                if(isFree(w)==false) return false;
+                listed++;
+            }
+        }
+        if(flNotEmpty!=((flBitmap & (1u<<fl))!=0)) return false;
+    }
+    return listed==numFree;
+}
+
+size_t TlsfHeap::adjustSize(size_t size)
+{
+    if(size>maxBlockSize) return 0;
+    size=(size+alignment-1) & ~(alignment-1);
+    return size<minBlockSize ? minBlockSize : size;
+}
+
+void TlsfHeap::mapping(size_t size, unsigned int& fl, unsigned int& sl)
+{
+    if(size<smallBlockSize)
+    {
+        fl=0;
+        sl=size/(smallBlockSize/slCount);
+    } else {
+        unsigned int f=fls(size);
+        sl=(size>>(f-slLog2)) ^ slCount;
+        fl=f-flShift+1;
+    }
+}
+
+void TlsfHeap::insertFree(Block *b)
+{
+    unsigned int fl, sl;
+    mapping(blockSize(b),fl,sl);
+    b->size|=freeFlag;
+    b->prevFree=nullptr;
+    b->nextFree=lists[fl][sl];
+    if(b->nextFree) b->nextFree->prevFree=b;
+    lists[fl][sl]=b;
+    flBitmap|=1u<<fl;
+    slBitmap[fl]|=1u<<sl;
+}
+
+void TlsfHeap::removeFree(Block *b)
+{
+    unsigned int fl, sl;
+    mapping(blockSize(b),fl,sl);
+    b->size&=~freeFlag;
+    if(b->nextFree) b->nextFree->prevFree=b->prevFree;
+    if(b->prevFree) b->prevFree->nextFree=b->nextFree;
+    else {
+        lists[fl][sl]=b->nextFree;
+        if(lists[fl][sl]==nullptr)
+        {
+            slBitmap[fl]&=~(1u<<sl);
+            if(slBitmap[fl]==0) flBitmap&=~(1u<<fl);
+        }
+    }
+}
+
+TlsfHeap::Block *TlsfHeap::findFree(size_t size)
+{
+    //Round up to the next list boundary, so that any block in the list found
+    //is large enough (good fit, not best fit, to bound the search time)
+    if(size>=smallBlockSize) size+=(size_t(1)<<(fls(size)-slLog2))-1;
+    unsigned int fl, sl;
+    mapping(size,fl,sl);
+    if(fl>=flCount) return nullptr;
+    unsigned int slMap=slBitmap[fl] & (~0u<<sl);
+    if(slMap==0)
+    {
+        unsigned int flMap= fl+1<flCount ? flBitmap & (~0u<<(fl+1)) : 0;
+        if(flMap==0) return nullptr;
+        fl=ffs(flMap);
+        slMap=slBitmap[fl];
+    }
+    sl=ffs(slMap);
+    Block *b=lists[fl][sl];
+    removeFree(b);
+    return b;
+}
+
+void TlsfHeap::trim(Block *b, size_t size)
+{
+    size_t remaining=blockSize(b)-size;
+    if(remaining<headerSize+minBlockSize) return;
+    Block *n=reinterpret_cast<Block*>(reinterpret_cast<char*>(toPtr(b))+size);
+    n->prevPhys=b;
+    n->size=remaining-headerSize;
+    nextPhys(n)->prevPhys=n;
+    b->size=size;
+    insertFree(mergeNext(n));
+}
+
+TlsfHeap::Block *TlsfHeap::mergeNext(Block *b)
+{
+    Block *n=nextPhys(b);
+    if(isFree(n))
+    {
+        removeFree(n);
+        b->size+=headerSize+blockSize(n);
+        nextPhys(b)->prevPhys=b;
+    }
+    return b;
+}
+
+void TlsfHeap::markUsed(Block *b)
+{
+    usedBytes+=headerSize+blockSize(b);
+    usedBlocks++;
+    size_t end=reinterpret_cast<char*>(nextPhys(b))-poolStart;
+    highWatermark=max(highWatermark,end);
+}
+
+} //namespace miosix
+
+#ifdef TEST_ALLOC
+//Stress test and benchmark, comparing with the host malloc
+//g++ -O2 -o tlsf -DTEST_ALLOC tlsf.cpp && ./tlsf
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+using namespace miosix;
+
+/**
+ * Produces a repeatable sequence of allocation sizes, mostly small with a
+ * long tail of large ones, like an embedded application
+ */
+static size_t randomSize(mt19937& rng)
+{
+    unsigned int r=rng()%100;
+    if(r<70) return 1+rng()%64;
+    if(r<95) return 1+rng()%1024;
+    return 1+rng()%32768;
+}
+
+static void fail(const char *msg)
+{
+    cout<<"Error: "<<msg<<endl;
+    exit(1);
+}
+
+static void stressTest(TlsfHeap& heap, unsigned int iterations)
+{
+    struct Slot { unsigned char *p; size_t size; };
+    vector<Slot> slots(512,Slot{nullptr,0});
+    mt19937 rng(0);
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        unsigned int id=rng()%slots.size();
+        Slot& s=slots[id];
+        unsigned char fill=id & 0xff;
+        if(s.p!=nullptr)
+        {
+            for(size_t j=0;j<s.size;j++) if(s.p[j]!=fill) fail("data corrupted");
+            switch(rng()%3)
+            {
+                case 0:
+                {
+                    size_t size=randomSize(rng);
+                    auto p=reinterpret_cast<unsigned char*>(heap.reallocate(s.p,size));
+                    if(p==nullptr) continue; //Out of memory, old block valid
+                    for(size_t j=s.size;j<size;j++) p[j]=fill;
+                    s.p=p;
+                    s.size=size;
+                    break;
+                }
+                default:
+                    heap.deallocate(s.p);
+                    s.p=nullptr;
+                    break;
+            }
+        } else {
+            size_t size=randomSize(rng);
+            size_t align=0;
+            if(rng()%8==0) align=size_t(1)<<(4+rng()%8);
+            void *p= align ? heap.allocateAligned(align,size) : heap.allocate(size);
+            if(p==nullptr) continue;
+            if(reinterpret_cast<uintptr_t>(p) & (TlsfHeap::alignment-1))
+                fail("misaligned");
+            if(align && (reinterpret_cast<uintptr_t>(p) & (align-1)))
+                fail("misaligned (memalign)");
+            if(heap.usableSize(p)<size) fail("usableSize");
+            s.p=reinterpret_cast<unsigned char*>(p);
+            s.size=size;
+            memset(s.p,fill,size);
+        }
+        if(i%1024==0 && heap.check()==false) fail("heap inconsistent");
+    }
+    TlsfStats st=heap.stats();
+    cout<<"After stress test: used "<<st.usedBytes<<" in "<<st.usedBlocks
+        <<" blocks, free "<<st.freeBytes<<" in "<<st.freeBlocks
+        <<" blocks, largest free "<<st.largestFree<<", fragmentation "
+        <<(st.freeBytes ? 100-100*st.largestFree/st.freeBytes : 0)<<"%"<<endl;
+    for(auto& s : slots) heap.deallocate(s.p);
+    if(heap.check()==false) fail("heap inconsistent");
+    st=heap.stats();
+    if(st.usedBytes!=0 || st.freeBlocks!=1) fail("memory leaked");
+}
+
+/**
+ * Run the same sequence of allocations and deallocations with the given
+ * functions, printing the average, 99.99th percentile and worst case time per
+ * call. The worst case on a host OS includes preemptions and is only
+ * indicative, the percentile is more meaningful
+ */
+template<typename Alloc, typename Free>
+static void benchmark(const char *name, Alloc alloc, Free dealloc)
+{
+    using namespace std::chrono;
+    const unsigned int iterations=1000000;
+    vector<void*> slots(1024,nullptr);
+    vector<long long> times(iterations);
+    mt19937 rng(1);
+    long long total=0;
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        void*& p=slots[rng()%slots.size()];
+        size_t size=randomSize(rng);
+        auto start=steady_clock::now();
+        if(p) { dealloc(p); p=nullptr; }
+        else p=alloc(size);
+        times[i]=duration_cast<nanoseconds>(steady_clock::now()-start).count();
+        total+=times[i];
+    }
+    for(auto p : slots) if(p) dealloc(p);
+    sort(times.begin(),times.end());
+    cout<<name<<": average "<<total/iterations<<"ns, p99.99 "
+        <<times[iterations-iterations/10000]<<"ns, worst "<<times.back()
+        <<"ns"<<endl;
+}
+
+int main()
+{
+    const size_t poolSize=16*1024*1024;
+    void *pool=malloc(poolSize);
+    memset(pool,0,poolSize); //Do not measure page faults
+    static TlsfHeap heap;
+    if(heap.addPool(pool,poolSize)==false) fail("addPool");
+    stressTest(heap,4000000);
+    benchmark("tlsf",[](size_t s){ return heap.allocate(s); },
+                     [](void *p){ heap.deallocate(p); });
+    benchmark("host malloc",[](size_t s){ return malloc(s); },
+                            [](void *p){ free(p); });
+    cout<<"Test passed"<<endl;
+    free(pool);
+}
+#endif //TEST_ALLOC
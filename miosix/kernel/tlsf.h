@@ -0,0 +1,219 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace miosix {
+
+/**
+ * Statistics about the state of a TlsfHeap
+ */
+struct TlsfStats
+{
+    size_t usedBytes;       ///< Bytes in allocated blocks, including headers
+    size_t freeBytes;       ///< Bytes in free blocks, excluding headers
+    size_t largestFree;     ///< Size of the largest block that can be allocated
+    size_t usedBlocks;      ///< Number of allocated blocks
+    size_t freeBlocks;      ///< Number of free blocks
+    size_t highWatermark;   ///< Highest offset from pool start ever allocated
+};
+
+/**
+ * Two level segregated fit (TLSF) memory allocator.
+ * Free blocks are kept in a two level array of lists, the first level indexed
+ * by the power of two of the block size and the second level linearly
+ * subdividing each power of two range. Two bitmaps record which lists are not
+ * empty, so that finding a suitable free block, splitting it and coalescing
+ * blocks when they are freed all take a time that does not depend on the
+ * number of blocks in the heap. Using a good fit policy and immediate
+ * coalescing also keeps fragmentation low over long uptimes.
+ *
+ * This class performs no locking, and all its member functions are meant to
+ * be called with a lock held. It also does not have a constructor, so that
+ * a global instance is zero initialized and can be used before global
+ * constructors are called. Call addPool() before allocating memory.
+ */
+class TlsfHeap
+{
+public:
+    /**
+     * Give the allocator the memory to manage. Can be called only once.
+     * \param start start of the memory area
+     * \param size size of the memory area
+     * \return true on success, false if the area is too small
+     */
+    bool addPool(void *start, size_t size);
+
+    /**
+     * \return true if addPool() was called
+     */
+    bool hasPool() const { return poolStart!=nullptr; }
+
+    /**
+     * Allocate memory
+     * \param size size in bytes of the memory to allocate
+     * \return the allocated memory, aligned to alignment, or nullptr if out
+     * of memory
+     */
+    void *allocate(size_t size);
+
+    /**
+     * Allocate aligned memory
+     * \param align required alignment, must be a power of two
+     * \param size size in bytes of the memory to allocate
+     * \return the allocated memory, or nullptr if out of memory
+     */
+    void *allocateAligned(size_t align, size_t size);
+
+    /**
+     * Change the size of an allocated block, moving it if required
+     * \param ptr block to resize, if nullptr this is the same as allocate()
+     * \param size new size. If zero, the block is freed and nullptr returned
+     * \return the resized block, or nullptr if out of memory, in which case
+     * the original block is left untouched
+     */
+    void *reallocate(void *ptr, size_t size);
+
+    /**
+     * Free memory
+     * \param ptr memory to free, if nullptr nothing is done
+     */
+    void deallocate(void *ptr);
+
+    /**
+     * \param ptr an allocated block
+     * \return the usable size of the block, which is greater than or equal to
+     * the size requested when it was allocated
+     */
+    size_t usableSize(void *ptr) const;
+
+    /**
+     * \return statistics about the heap. Takes a time proportional to the
+     * number of free blocks, but not to the number of allocated blocks
+     */
+    TlsfStats stats() const;
+
+    /**
+     * Walk the whole heap checking its consistency. Slow, meant for testing
+     * \return true if the heap is consistent
+     */
+    bool check() const;
+
+    /// Alignment of the returned memory
+    static const size_t alignment=2*sizeof(void*);
+
+private:
+    /**
+     * Header preceding every block. The free list pointers are only valid if
+     * the block is free, otherwise they are the start of the user data
+     */
+    struct Block
+    {
+        Block *prevPhys; ///< Previous block in memory, nullptr for the first
+        size_t size;     ///< Size of the data area, ORed with the flags
+        Block *nextFree; ///< Next block in the free list
+        Block *prevFree; ///< Previous block in the free list
+    };
+
+    static const size_t freeFlag=1;   ///< Block is free
+    static const size_t flagMask=alignment-1;
+    static const size_t headerSize=2*sizeof(void*);
+    static const size_t minBlockSize=2*sizeof(void*); ///< Room for the links
+
+    static const unsigned int alignLog2= sizeof(void*)==4 ? 3 : 4;
+    static const unsigned int slLog2=3; ///< log2 of second level lists
+    static const unsigned int slCount=1<<slLog2;
+    static const unsigned int flShift=slLog2+alignLog2;
+    static const unsigned int flMax=27; ///< Blocks must be smaller than 2^flMax
+    static const unsigned int flCount=flMax-flShift+1;
+    static const size_t smallBlockSize=size_t(1)<<flShift;
+    static const size_t maxBlockSize=(size_t(1)<<flMax)-alignment;
+
+    static size_t blockSize(const Block *b) { return b->size & ~flagMask; }
+    static bool isFree(const Block *b) { return b->size & freeFlag; }
+    static void *toPtr(Block *b)
+    {
+        return reinterpret_cast<char*>(b)+headerSize;
+    }
+    static Block *fromPtr(void *p)
+    {
+        return reinterpret_cast<Block*>(reinterpret_cast<char*>(p)-headerSize);
+    }
+    static Block *nextPhys(const Block *b)
+    {
+        return reinterpret_cast<Block*>(reinterpret_cast<char*>(
+            const_cast<Block*>(b))+headerSize+blockSize(b));
+    }
+
+    /**
+     * Round a requested size to a valid block size
+     * \return the block size, or 0 if size is too large
+     */
+    static size_t adjustSize(size_t size);
+
+    /**
+     * Compute the list where blocks of a given size are stored
+     */
+    static void mapping(size_t size, unsigned int& fl, unsigned int& sl);
+
+    void insertFree(Block *b);
+    void removeFree(Block *b);
+
+    /**
+     * Find and remove from the free lists a block of at least size bytes
+     */
+    Block *findFree(size_t size);
+
+    /**
+     * Split block b, which is not in the free lists, so that it is size bytes
+     * long. The remaining part, if large enough, becomes a free block
+     */
+    void trim(Block *b, size_t size);
+
+    /**
+     * Merge a free block with the following block, if that is free too
+     */
+    Block *mergeNext(Block *b);
+
+    /**
+     * Update statistics when block b is allocated
+     */
+    void markUsed(Block *b);
+
+    char *poolStart;
+    char *poolEnd;
+    size_t usedBytes;
+    size_t usedBlocks;
+    size_t highWatermark;
+    unsigned int flBitmap;
+    unsigned char slBitmap[flCount];
+    Block *lists[flCount][slCount];
+};
+
+} //namespace miosix
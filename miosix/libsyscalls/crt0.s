@@ -541,44 +541,202 @@ pipe:
 /* TODO: missing syscalls: access */
 
 /**
- * miosix::getTime, nonstandard syscall
- * \return long long time in nanoseconds, relative to clock monotonic
- */
-.section .text._ZN6miosix7getTimeEv
-.global _ZN6miosix7getTimeEv
-.type _ZN6miosix7getTimeEv, %function
-_ZN6miosix7getTimeEv:
-	movs r0, #4
-	movs r3, #38
+ * pread, read from file at a given offset without changing the file pointer
+ * \param fd file descriptor
+ * \param buf data to be read
+ * \param size buffer length
+ * \param pos offset from the beginning of the file, passed in the stack as it
+ * is a long long. The syscall takes a pointer to it (r12) as it does not fit
+ * in the syscall parameters
+ * \return number of read bytes or -1 if errors
+ */
+.section .text.pread
+.global pread
+.type pread, %function
+pread:
+	mov  r12, sp
+	movs r3, #34
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * pwrite, write to file at a given offset without changing the file pointer
+ * \param fd file descriptor
+ * \param buf data to be written
+ * \param size buffer length
+ * \param pos offset from the beginning of the file, passed as for pread
+ * \return number of written bytes or -1 if errors
+ */
+.section .text.pwrite
+.global pwrite
+.type pwrite, %function
+pwrite:
+	mov  r12, sp
+	movs r3, #35
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * preadv, read from file at a given offset into multiple buffers
+ * \param fd file descriptor
+ * \param iov array of struct iovec
+ * \param iovcnt number of elements in iov
+ * \param pos offset from the beginning of the file, passed as for pread
+ * \return number of read bytes or -1 if errors
+ */
+.section .text.preadv
+.global preadv
+.type preadv, %function
+preadv:
+	mov  r12, sp
+	movs r3, #36
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * pwritev, write to file at a given offset from multiple buffers
+ * \param fd file descriptor
+ * \param iov array of struct iovec
+ * \param iovcnt number of elements in iov
+ * \param pos offset from the beginning of the file, passed as for pread
+ * \return number of written bytes or -1 if errors
+ */
+.section .text.pwritev
+.global pwritev
+.type pwritev, %function
+pwritev:
+	mov  r12, sp
+	movs r3, #37
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * fallocate, allocate disk space for a file
+ * \param fd file descriptor
+ * \param mode 0 or FALLOC_FL_KEEP_SIZE
+ * \param offset start of the range, a long long passed in r2,r3
+ * \param len length of the range, a long long passed in the stack.
+ * The syscall takes a pointer (r12) to offset and len, so offset is stored
+ * in the stack right below len
+ * \return 0 on success, or -1 if errors
+ */
+.section .text.fallocate
+.global fallocate
+.type fallocate, %function
+fallocate:
+	sub  sp, sp, #8
+	str  r2, [sp]
+	str  r3, [sp, #4]
+	mov  r12, sp
+	movs r3, #60
+	svc  0
+	add  sp, sp, #8
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * posix_fallocate, allocate disk space for a file
+ * \param fd file descriptor
+ * \param offset start of the range, passed as for fallocate
+ * \param len length of the range, passed as for fallocate
+ * \return 0 on success, or the error code, errno is not set
+ */
+.section .text.posix_fallocate
+.global posix_fallocate
+.type posix_fallocate, %function
+posix_fallocate:
+	movs r1, #0
+	sub  sp, sp, #8
+	str  r2, [sp]
+	str  r3, [sp, #4]
+	mov  r12, sp
+	movs r3, #60
 	svc  0
+	add  sp, sp, #8
+	negs r0, r0
 	bx   lr
 
 /**
- * clock_gettime
+ * fsync, synchronize a file with the storage device
+ * \param fd file descriptor
+ * \return 0 on success, -1 on failure
+ */
+.section .text.fsync
+.global fsync
+.type fsync, %function
+fsync:
+	movs r3, #61
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * fdatasync, synchronize the data of a file with the storage device
+ * \param fd file descriptor
+ * \return 0 on success, -1 on failure
+ */
+.section .text.fdatasync
+.global fdatasync
+.type fdatasync, %function
+fdatasync:
+	movs r3, #62
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * poll
+ * \param fds array of struct pollfd
+ * \param nfds number of elements in fds
+ * \param timeout timeout in milliseconds, negative to wait forever
+ * \return the number of ready file descriptors, 0 on timeout, -1 on failure
+ */
+.section .text.poll
+.global poll
+.type poll, %function
+poll:
+	movs r3, #59
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
+/**
+ * __miosix_gettime, get the time through the GETTIME syscall, used when the
+ * time page is not available
  * \param clockid which clock
- * \param tp struct timespec*
- * \return in Miosix this syscall always returns 0, if the clockid is wrong
- * the default clock is returned
- */
-.section .text.clock_gettime
-.global clock_gettime
-.type clock_gettime, %function
-clock_gettime:
-	push {r4, lr}
-	movs r4, r1
+ * \return long long time in nanoseconds
+ */
+.section .text.__miosix_gettime
+.global __miosix_gettime
+.type __miosix_gettime, %function
+__miosix_gettime:
 	movs r3, #38
 	svc  0
-	adr  r3, .L500
-	ldrd r2, [r3]
-	bl   __aeabi_ldivmod
-	strd r0, [r4]
-	str  r2, [r4, #8]
-	movs r0, #0
-	pop  {r4, pc}
-	.align 2
-.L500:
-	.word 1000000000
-	.word 0
+	bx   lr
+
+/**
+ * __miosix_time_page, get the address of the time page
+ * \return the time page, or 0 if processes can't read the time directly
+ */
+.section .text.__miosix_time_page
+.global __miosix_time_page
+.type __miosix_time_page, %function
+__miosix_time_page:
+	movs r3, #68
+	svc  0
+	bx   lr
 
 /**
  * clock_settime
@@ -766,6 +924,87 @@ getppid:
 
 /* TODO: missing syscalls: getuid, getgid, geteuid, getegid, setuid, setgid */
 
+/*
+ * Thread syscalls, used to implement the pthread API in pthread.cpp. Unlike the
+ * other syscalls they do not set errno, they return a negative error code.
+ */
+
+/**
+ * __miosix_thread_create, create a thread
+ * \param entry thread entry point
+ * \param arg argument passed to the entry point
+ * \param stack lowest address of the thread stack
+ * \param size stack size, watermark included
+ * \return the tid of the new thread, or a negative error code
+ */
+.section .text.__miosix_thread_create
+.global __miosix_thread_create
+.type __miosix_thread_create, %function
+__miosix_thread_create:
+	mov  r12, r3
+	movs r3, #63
+	svc  0
+	bx   lr
+
+/**
+ * __miosix_thread_exit, terminate the calling thread
+ * \param result value returned to the thread that joins this one
+ * This syscall does not return
+ */
+.section .text.__miosix_thread_exit
+.global __miosix_thread_exit
+.type __miosix_thread_exit, %function
+__miosix_thread_exit:
+	movs r3, #64
+	svc  0
+
+/**
+ * __miosix_thread_join, wait for a thread to terminate
+ * \param tid tid of the thread to join
+ * \param result the value passed to thread exit is stored here, can be null
+ * \param nonblock if nonzero, fail with -EBUSY instead of waiting
+ * \return 0 on success, or a negative error code
+ */
+.section .text.__miosix_thread_join
+.global __miosix_thread_join
+.type __miosix_thread_join, %function
+__miosix_thread_join:
+	movs r3, #65
+	svc  0
+	bx   lr
+
+/**
+ * __miosix_futex_wait, wait until woken by __miosix_futex_wake, as long as the
+ * word at addr contains the expected value
+ * \param addr unsigned int*
+ * \param expected unsigned int
+ * \param absTime long long absolute timeout in nanoseconds, negative to wait
+ * without timeout
+ * \return 0 if woken, or a negative error code
+ */
+.section .text.__miosix_futex_wait
+.global __miosix_futex_wait
+.type __miosix_futex_wait, %function
+__miosix_futex_wait:
+	mov  r12, r3 /* Upper 32bit of absTime moved to 4th syscall parameter (r12) */
+	movs r3, #66
+	svc  0
+	bx   lr
+
+/**
+ * __miosix_futex_wake, wake threads waiting on a word
+ * \param addr unsigned int*
+ * \param count int maximum number of threads to wake
+ * \return the number of woken threads
+ */
+.section .text.__miosix_futex_wake
+.global __miosix_futex_wake
+.type __miosix_futex_wake, %function
+__miosix_futex_wake:
+	movs r3, #67
+	svc  0
+	bx   lr
+
 /* common jump target for all failing syscalls with 32 bit return value */
 .section .text.__seterrno32
 syscallfailed32:
@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
 #include <sys/stat.h>
@@ -38,7 +39,7 @@
 #include <sys/ioctl.h>
 #include <sys/wait.h>
 #include <reent.h>
-#include <cxxabi.h>
+#include "poll_select.h"
 
 constexpr int numAtexitEntries=2; ///< Number of entries per AtexitBlock
 
@@ -54,6 +55,90 @@ struct AtexitBlock
 
 static AtexitBlock head = {}; ///< Head of the AtexitBlock list
 
+/**
+ * Data that the kernel keeps updated to let processes compute the time
+ * without a syscall. NOTE: must match TimePage in interfaces/os_timer.h
+ */
+struct TimePage
+{
+    unsigned int sequence;            ///< Incremented when upperTick changes
+    const volatile unsigned int *counter; ///< Hardware timer counter register
+    unsigned long long upperTick;     ///< Upper bits of the time in ticks
+    const volatile unsigned int *overflowFlag; ///< Overflow flag register
+    unsigned char overflowBit;        ///< Bit of the overflow flag
+    unsigned char counterBits;        ///< Number of bits of the counter
+    unsigned int tick2nsInteger;      ///< Integer part of the tick2ns factor
+    unsigned int tick2nsFraction;     ///< Fractional part of the tick2ns factor
+};
+static_assert(sizeof(TimePage)==32,"TimePage does not match the kernel one");
+
+// Time syscalls, in crt0.s
+extern "C" {
+long long __miosix_gettime(clockid_t clockid);
+const volatile TimePage *__miosix_time_page();
+}
+
+/**
+ * \return the time page, or nullptr if the time can only be read through the
+ * GETTIME syscall
+ */
+static const volatile TimePage *getTimePage()
+{
+    //Threads racing here at most ask the kernel more than once, or use the
+    //syscall to get the time once more than needed
+    static const volatile TimePage *timePage=nullptr;
+    static bool timePageQueried=false;
+    if(timePageQueried==false)
+    {
+        timePage=__miosix_time_page();
+        timePageQueried=true;
+    }
+    return timePage;
+}
+
+/**
+ * \param page the time page
+ * \return the time in nanoseconds, computed as the kernel does in
+ * TimerAdapter::IRQgetTimeNs()
+ */
+static long long timeFromPage(const volatile TimePage *page)
+{
+    for(;;)
+    {
+        unsigned int sequence=page->sequence;
+        unsigned long long tick=page->upperTick;
+        unsigned int counter=*page->counter;
+        //Pending bit trick, the timer may have just overflowed and its
+        //interrupt not run yet
+        bool overflow=(*page->overflowFlag>>page->overflowBit) & 1;
+        tick|=counter;
+        if(overflow && *page->counter>=counter) tick+=1ULL<<page->counterBits;
+        //If the overflow interrupt ran in the meantime, start again
+        if(page->sequence!=sequence) continue;
+        //Same algorithm as mul64x32d32() in kernel/timeconversion.cpp
+        unsigned int bi=page->tick2nsInteger;
+        unsigned int bf=page->tick2nsFraction;
+        unsigned int tickLo=tick;
+        unsigned int tickHi=tick>>32;
+        unsigned long long ns=static_cast<unsigned long long>(bi)*tickLo;
+        ns+=static_cast<unsigned long long>(bf)*tickHi;
+        ns+=(static_cast<unsigned long long>(bf)*tickLo)>>32;
+        ns+=static_cast<unsigned long long>(bi*tickHi)<<32;
+        return ns;
+    }
+}
+
+/**
+ * \param clockid which clock, currently all clocks are the same
+ * \return the time in nanoseconds
+ */
+static long long getTimeNs(clockid_t clockid)
+{
+    auto page=getTimePage();
+    if(page) return timeFromPage(page);
+    return __miosix_gettime(clockid);
+}
+
 extern "C" {
 
 /**
@@ -210,39 +295,7 @@ void *_sbrk_r(struct _reent *ptr, ptrdiff_t incr)
     return reinterpret_cast<void*>(prevHeapEnd);
 }
 
-/**
- * \internal
- * __malloc_lock, called by malloc to ensure memory allocation thread safety
- */
-void __malloc_lock()
-{
-    // For now processes can't have threads, so do nothing
-}
-
-/**
- * \internal
- * __malloc_unlock, called by malloc after performing operations on the heap
- */
-void __malloc_unlock()
-{
-    // For now processes can't have threads, so do nothing
-}
-
-/**
- * \internal
- * __getreent(), return the reentrancy structure of the current thread.
- * Used by newlib to make the C standard library thread safe
- */
-struct _reent *__getreent()
-{
-    // For now processes can't have threads, so always return the global one
-    return _GLOBAL_REENT;
-}
-
-
-
-
-
+//NOTE: __malloc_lock, __malloc_unlock and __getreent are in pthread.cpp
 
 int _open_r(struct _reent *ptr, const char *name, int flags, int mode)
 {
@@ -371,6 +424,19 @@ int _getpid_r(struct _reent* ptr)
     return getpid();
 }
 
+/**
+ * clock_gettime
+ * In Miosix this function always returns 0, if the clockid is wrong the
+ * default clock is returned
+ */
+int clock_gettime(clockid_t clockid, struct timespec *tp)
+{
+    long long t=getTimeNs(clockid);
+    tp->tv_sec=t/1000000000;
+    tp->tv_nsec=t%1000000000;
+    return 0;
+}
+
 clock_t times(struct tms *tim)
 {
     struct timespec tp;
@@ -419,84 +485,23 @@ pid_t wait(int *status)
     return waitpid(-1,status,0);
 }
 
-// TODO: implement when processes can spawn threads
-int pthread_mutex_unlock(pthread_mutex_t *mutex)  { return 0; }
-int pthread_mutex_lock(pthread_mutex_t *mutex)    { return 0; }
-int pthread_mutex_destroy(pthread_mutex_t *mutex) { return 0; }
-int pthread_setcancelstate(int state, int *oldstate) { return 0; }
-
-int pthread_once(pthread_once_t *once, void (*func)())
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+           struct timeval *timeout)
 {
-    //TODO: make thread-safe when processes can spawn threads
-    if(once==nullptr || func==nullptr || once->is_initialized!=1) return EINVAL;
-    if(once->init_executed==0)
-    {
-        func();
-        once->init_executed=2; //We succeeded
-    }
-    return 0;
+    return miosix::selectOnPoll(nfds,readfds,writefds,exceptfds,timeout);
 }
 
 } // extern "C"
 
-union MiosixGuard
-{
-    //miosix::Thread *owner;
-    unsigned int flag;
-};
+namespace miosix {
 
-namespace __cxxabiv1
-{
-
-struct __cxa_exception; //A forward declaration of this one is enough
-
-/*
- * This struct was taken from libsupc++/unwind-cxx.h Unfortunately that file
- * is not deployed in the gcc installation so we can't just #include it.
- * It is required on a per-thread basis to make C++ exceptions thread safe.
+/**
+ * miosix::getTime, nonstandard
+ * \return time in nanoseconds, relative to clock monotonic
  */
-struct __cxa_eh_globals
-{
-    __cxa_exception *caughtExceptions;
-    unsigned int uncaughtExceptions;
-    //Should be __ARM_EABI_UNWINDER__ but that's only usable inside gcc
-    #ifdef __ARM_EABI__
-    __cxa_exception* propagatingExceptions;
-    #endif //__ARM_EABI__
-};
-
-static __cxa_eh_globals eh = { 0 };
-
-extern "C" __cxa_eh_globals* __cxa_get_globals_fast()
-{
-    return &eh; //TODO: one per-thread when processes can spawn threads
-}
-
-extern "C" __cxa_eh_globals* __cxa_get_globals()
-{
-    return &eh; //TODO: one per-thread when processes can spawn threads
-}
-
-extern "C" int __cxa_guard_acquire(__guard *g)
-{
-    //TODO: make thread-safe when processes can spawn threads
-    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
-    if(guard->flag==1) return 0; //Object already initialized, good
-    return 1;
-}
-
-extern "C" void __cxa_guard_release(__guard *g) noexcept
-{
-    //TODO: make thread-safe when processes can spawn threads
-    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
-    guard->flag=1;
-}
-
-extern "C" void __cxa_guard_abort(__guard *g) noexcept
+long long getTime() noexcept
 {
-    //TODO: make thread-safe when processes can spawn threads
-    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
-    guard->flag=0;
+    return getTimeNs(CLOCK_MONOTONIC);
 }
 
-} //namespace __cxxabiv1
+} //namespace miosix
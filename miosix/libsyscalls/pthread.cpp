@@ -0,0 +1,705 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <ctime>
+#include <errno.h>
+#include <pthread.h>
+#include <reent.h>
+#include <cxxabi.h>
+#include <config/miosix_settings.h>
+
+using namespace miosix;
+
+// Thread syscalls, in crt0.s. They return a negative error code on failure
+extern "C" {
+int __miosix_thread_create(void (*entry)(void*), void *arg, char *stack,
+                           unsigned int size);
+void __miosix_thread_exit(void *result) __attribute__((noreturn));
+int __miosix_thread_join(int tid, void **result, int nonblock);
+int __miosix_futex_wait(unsigned int *addr, unsigned int expected,
+                        long long absTime);
+int __miosix_futex_wake(unsigned int *addr, int count);
+}
+
+namespace __cxxabiv1
+{
+
+struct __cxa_exception; //A forward declaration of this one is enough
+
+/*
+ * This struct was taken from libsupc++/unwind-cxx.h Unfortunately that file
+ * is not deployed in the gcc installation so we can't just #include it.
+ * It is required on a per-thread basis to make C++ exceptions thread safe.
+ */
+struct __cxa_eh_globals
+{
+    __cxa_exception *caughtExceptions;
+    unsigned int uncaughtExceptions;
+    //Should be __ARM_EABI_UNWINDER__ but that's only usable inside gcc
+    #ifdef __ARM_EABI__
+    __cxa_exception* propagatingExceptions;
+    #endif //__ARM_EABI__
+};
+
+} //namespace __cxxabiv1
+
+using __cxxabiv1::__cxa_eh_globals;
+
+/**
+ * Userspace data of a thread, pthread_t is a pointer to it.
+ * For threads other than the main one, it is allocated together with the
+ * thread's C library reentrancy structure and its stack
+ */
+struct ThreadData
+{
+    int tid;                     ///< Thread id used by the kernel
+    void *(*start)(void *);      ///< Thread entry point
+    void *arg;                   ///< Entry point argument
+    struct _reent *reent;        ///< C library per-thread data, not main
+    __cxa_eh_globals eh;         ///< C++ exceptions per-thread data
+    bool detached;               ///< True if the thread can't be joined
+    bool exiting;                ///< True if the thread is terminating
+    ThreadData *next;            ///< Next detached thread to reap
+};
+
+/**
+ * Used to find the ThreadData of the running thread from its stack pointer,
+ * so that __getreent() and __cxa_get_globals() don't need a syscall. Entries
+ * are read without locking, so they are written in a specific order: low and
+ * data before high when an entry is added, and high first when it is removed.
+ */
+struct ThreadStack
+{
+    char *low;                   ///< Lowest address of the stack
+    char *high;                  ///< Highest address of the stack, or nullptr
+    ThreadData *data;            ///< Thread data, or nullptr if entry is free
+};
+
+static ThreadData mainThread; ///< Zero-initialized, usable before constructors
+static ThreadStack threadStacks[MAX_PROCESS_THREADS-1]; ///< Not the main one
+static ThreadData *detachedThreads=nullptr; ///< Terminated detached threads
+static int liveThreads=1; ///< Threads that did not call pthread_exit
+/// Guards threadStacks and detachedThreads
+static pthread_mutex_t threadMutex=PTHREAD_MUTEX_INITIALIZER;
+
+/// As long as the process has a single thread, currentThread() doesn't need
+/// to scan threadStacks
+static bool multithreaded=false;
+
+/**
+ * \return the ThreadData of the current thread
+ */
+static ThreadData *currentThread()
+{
+    if(multithreaded==false) return &mainThread;
+    char *sp;
+    asm volatile("mov %0, sp" : "=r"(sp));
+    for(auto& s : threadStacks)
+    {
+        //A thread's stack has been allocated before it started running, and
+        //is deallocated after it terminated, so even if entries are modified
+        //during the scan, the only one that can match is the current thread's
+        char *high=__atomic_load_n(&s.high,__ATOMIC_ACQUIRE);
+        if(high==nullptr || sp>high || sp<s.low) continue;
+        return s.data;
+    }
+    return &mainThread;
+}
+
+/**
+ * Entry point of all threads but the main one, called by the kernel
+ * \param t thread data
+ */
+static void threadLauncher(void *t)
+{
+    auto data=reinterpret_cast<ThreadData*>(t);
+    pthread_exit(data->start(data->arg));
+}
+
+/**
+ * Remove a thread from threadStacks and deallocate its memory.
+ * Must be called with threadMutex locked
+ * \param t thread data, must have already been joined
+ */
+static void freeThread(ThreadData *t)
+{
+    if(t==&mainThread) return;
+    for(auto& s : threadStacks)
+    {
+        if(s.data!=t) continue;
+        __atomic_store_n(&s.high,nullptr,__ATOMIC_RELEASE);
+        s.data=nullptr;
+        break;
+    }
+    free(t);
+}
+
+/**
+ * Join the terminated detached threads, to reclaim their memory.
+ * Must be called with threadMutex locked
+ */
+static void reapDetachedThreads()
+{
+    ThreadData **walk=&detachedThreads;
+    while(*walk)
+    {
+        ThreadData *t=*walk;
+        //The thread may still be running the last few instructions before
+        //terminating, in that case it will be reaped the next time
+        if(__miosix_thread_join(t->tid,nullptr,1)==-EBUSY)
+        {
+            walk=&t->next;
+            continue;
+        }
+        *walk=t->next;
+        freeThread(t);
+    }
+}
+
+/// Set in the owner word of a locked mutex when threads may be waiting for it.
+/// ThreadData is word aligned, so the bit is never set in a thread pointer
+static const unsigned int mutexWaiters=1;
+
+/**
+ * The owner field of a pthread_mutex_t is the futex word of the mutex. It is
+ * zero if the mutex is unlocked, otherwise it contains the ThreadData of the
+ * owner, with mutexWaiters set if the unlock needs to wake waiting threads
+ * \param mutex a mutex
+ * \return the futex word of the mutex
+ */
+static inline unsigned int *ownerWord(pthread_mutex_t *mutex)
+{
+    return reinterpret_cast<unsigned int*>(&mutex->owner);
+}
+
+/**
+ * The first field of a pthread_cond_t is the futex word of the condition
+ * variable, incremented by every signal and broadcast
+ * \param cond a condition variable
+ * \return the futex word of the condition variable
+ */
+static inline unsigned int *condSequence(pthread_cond_t *cond)
+{
+    return reinterpret_cast<unsigned int*>(&cond->first);
+}
+
+/**
+ * The last field of a pthread_cond_t counts the waiting threads, so that
+ * signal and broadcast can skip the syscall if there are none
+ * \param cond a condition variable
+ * \return the number of waiting threads
+ */
+static inline unsigned int *condWaiters(pthread_cond_t *cond)
+{
+    return reinterpret_cast<unsigned int*>(&cond->last);
+}
+
+/**
+ * Lock a mutex. Only if the mutex is already locked by another thread a
+ * syscall is needed, to wait until it is unlocked
+ * \param mutex mutex to lock
+ * \param block if false, return EBUSY instead of waiting
+ * \return 0 on success, or an error code
+ */
+static int mutexLock(pthread_mutex_t *mutex, bool block)
+{
+    unsigned int *word=ownerWord(mutex);
+    auto self=reinterpret_cast<unsigned int>(currentThread());
+    unsigned int old=0;
+    if(__atomic_compare_exchange_n(word,&old,self,false,
+        __ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) return 0;
+    if((old & ~mutexWaiters)==self)
+    {
+        if(mutex->recursive<0) return block ? EDEADLK : EBUSY;
+        mutex->recursive++;
+        return 0;
+    }
+    if(block==false) return EBUSY;
+    for(;;)
+    {
+        if(old==0)
+        {
+            //Other threads may still be waiting, so lock it as contended
+            if(__atomic_compare_exchange_n(word,&old,self|mutexWaiters,false,
+                __ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) return 0;
+            continue;
+        }
+        //Tell the owner it has to wake us when unlocking
+        if((old & mutexWaiters)==0 &&
+           __atomic_compare_exchange_n(word,&old,old|mutexWaiters,false,
+                __ATOMIC_RELAXED,__ATOMIC_RELAXED)==false) continue;
+        __miosix_futex_wait(word,old|mutexWaiters,-1);
+        old=__atomic_load_n(word,__ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Wait on a condition variable
+ * \param cond condition variable
+ * \param mutex mutex locked by the current thread, relocked before returning
+ * \param absTime absolute timeout in nanoseconds, or a negative value to wait
+ * without timeout
+ * \return 0 on success, or an error code
+ */
+static int condWait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                    long long absTime)
+{
+    unsigned int *word=ownerWord(mutex);
+    auto self=reinterpret_cast<unsigned int>(currentThread());
+    if((__atomic_load_n(word,__ATOMIC_RELAXED) & ~mutexWaiters)!=self)
+        return EPERM;
+    //Reading the sequence before unlocking the mutex ensures that a signal
+    //sent after the unlock makes the wait return immediately
+    __atomic_add_fetch(condWaiters(cond),1,__ATOMIC_SEQ_CST);
+    unsigned int seq=__atomic_load_n(condSequence(cond),__ATOMIC_SEQ_CST);
+    int depth=mutex->recursive;
+    if(depth>0) mutex->recursive=0;
+    pthread_mutex_unlock(mutex);
+    int result=__miosix_futex_wait(condSequence(cond),seq,absTime);
+    __atomic_sub_fetch(condWaiters(cond),1,__ATOMIC_RELAXED);
+    mutexLock(mutex,true);
+    mutex->recursive=depth;
+    return result==-ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+/**
+ * Wake threads waiting on a condition variable
+ * \param cond condition variable
+ * \param count maximum number of threads to wake
+ * \return 0
+ */
+static int condWake(pthread_cond_t *cond, int count)
+{
+    __atomic_add_fetch(condSequence(cond),1,__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(condWaiters(cond),__ATOMIC_SEQ_CST)!=0)
+        __miosix_futex_wake(condSequence(cond),count);
+    return 0;
+}
+
+extern "C" {
+
+//
+// Thread related API
+//
+
+int pthread_create(pthread_t *pthread, const pthread_attr_t *attr,
+    void *(*start)(void *), void *arg)
+{
+    unsigned int stackSize=STACK_DEFAULT_FOR_PTHREAD;
+    bool detached=false;
+    if(attr!=nullptr)
+    {
+        detached=attr->detachstate==PTHREAD_CREATE_DETACHED;
+        stackSize=attr->stacksize;
+    }
+    //The end of the stack is the initial stack pointer, so it must be aligned
+    constexpr unsigned int align=CTXSAVE_STACK_ALIGNMENT;
+    stackSize=(stackSize+WATERMARK_LEN+align-1)/align*align;
+    //malloc returns memory aligned to 8 bytes, as required by CTXSAVE_STACK_ALIGNMENT
+    constexpr unsigned int reentOffset=(sizeof(ThreadData)+align-1)/align*align;
+    constexpr unsigned int stackOffset=
+        (reentOffset+sizeof(struct _reent)+align-1)/align*align;
+    char *mem=reinterpret_cast<char*>(malloc(stackOffset+stackSize));
+    if(mem==nullptr) return EAGAIN;
+    auto t=reinterpret_cast<ThreadData*>(mem);
+    memset(t,0,sizeof(ThreadData));
+    t->start=start;
+    t->arg=arg;
+    t->reent=reinterpret_cast<struct _reent*>(mem+reentOffset);
+    _REENT_INIT_PTR(t->reent);
+    t->detached=detached;
+    char *stack=mem+stackOffset;
+
+    pthread_mutex_lock(&threadMutex);
+    multithreaded=true;
+    reapDetachedThreads();
+    ThreadStack *entry=nullptr;
+    for(auto& s : threadStacks)
+    {
+        if(s.data!=nullptr) continue;
+        entry=&s;
+        break;
+    }
+    int result=EAGAIN;
+    if(entry!=nullptr)
+    {
+        entry->low=stack;
+        entry->data=t;
+        __atomic_store_n(&entry->high,stack+stackSize,__ATOMIC_RELEASE);
+        __atomic_add_fetch(&liveThreads,1,__ATOMIC_RELAXED);
+        int tid=__miosix_thread_create(threadLauncher,t,stack,stackSize);
+        if(tid>=0)
+        {
+            //The thread may already be running, but it doesn't need its tid
+            t->tid=tid;
+            *pthread=reinterpret_cast<pthread_t>(t);
+            result=0;
+        } else {
+            __atomic_sub_fetch(&liveThreads,1,__ATOMIC_RELAXED);
+            __atomic_store_n(&entry->high,nullptr,__ATOMIC_RELEASE);
+            entry->data=nullptr;
+            result=-tid;
+        }
+    }
+    pthread_mutex_unlock(&threadMutex);
+    if(result!=0) free(mem);
+    return result;
+}
+
+int pthread_join(pthread_t pthread, void **value_ptr)
+{
+    auto t=reinterpret_cast<ThreadData*>(pthread);
+    if(t->detached) return EINVAL;
+    int result=__miosix_thread_join(t->tid,value_ptr,0);
+    if(result<0) return -result;
+    pthread_mutex_lock(&threadMutex);
+    freeThread(t);
+    pthread_mutex_unlock(&threadMutex);
+    return 0;
+}
+
+int pthread_detach(pthread_t pthread)
+{
+    auto t=reinterpret_cast<ThreadData*>(pthread);
+    pthread_mutex_lock(&threadMutex);
+    int result=0;
+    if(t->detached) result=EINVAL;
+    else {
+        t->detached=true;
+        //Thread already terminating, it is up to us to reap it
+        if(t->exiting)
+        {
+            t->next=detachedThreads;
+            detachedThreads=t;
+        }
+        reapDetachedThreads();
+    }
+    pthread_mutex_unlock(&threadMutex);
+    return result;
+}
+
+void pthread_exit(void *value_ptr)
+{
+    //As in POSIX, the process exits when its last thread terminates
+    if(__atomic_sub_fetch(&liveThreads,1,__ATOMIC_RELAXED)==0) exit(0);
+    ThreadData *t=currentThread();
+    if(t!=&mainThread) _reclaim_reent(t->reent);
+    pthread_mutex_lock(&threadMutex);
+    t->exiting=true;
+    if(t->detached)
+    {
+        t->next=detachedThreads;
+        detachedThreads=t;
+    }
+    pthread_mutex_unlock(&threadMutex);
+    __miosix_thread_exit(value_ptr);
+}
+
+pthread_t pthread_self()
+{
+    return reinterpret_cast<pthread_t>(currentThread());
+}
+
+int pthread_equal(pthread_t t1, pthread_t t2)
+{
+    return t1==t2;
+}
+
+int pthread_attr_init(pthread_attr_t *attr)
+{
+    //We only use two fields of pthread_attr_t so initialize only these
+    attr->detachstate=PTHREAD_CREATE_JOINABLE;
+    attr->stacksize=STACK_DEFAULT_FOR_PTHREAD;
+    return 0;
+}
+
+int pthread_attr_destroy(pthread_attr_t *attr)
+{
+    return 0; //That was easy
+}
+
+int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate)
+{
+    *detachstate=attr->detachstate;
+    return 0;
+}
+
+int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate)
+{
+    if(detachstate!=PTHREAD_CREATE_JOINABLE &&
+       detachstate!=PTHREAD_CREATE_DETACHED) return EINVAL;
+    attr->detachstate=detachstate;
+    return 0;
+}
+
+int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize)
+{
+    *stacksize=attr->stacksize;
+    return 0;
+}
+
+int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize)
+{
+    if(stacksize<MIN_PROCESS_STACK_SIZE) return EINVAL;
+    attr->stacksize=stacksize;
+    return 0;
+}
+
+int pthread_setcancelstate(int state, int *oldstate) { return 0; }
+
+//
+// Mutex API
+//
+
+int	pthread_mutexattr_init(pthread_mutexattr_t *attr)
+{
+    attr->recursive=PTHREAD_MUTEX_DEFAULT;
+    return 0;
+}
+
+int	pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
+{
+    return 0; //Do nothing
+}
+
+int pthread_mutexattr_gettype(const pthread_mutexattr_t *attr, int *kind)
+{
+    *kind=attr->recursive;
+    return 0;
+}
+
+int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int kind)
+{
+    switch(kind)
+    {
+        case PTHREAD_MUTEX_DEFAULT:
+            attr->recursive=PTHREAD_MUTEX_DEFAULT;
+            return 0;
+        case PTHREAD_MUTEX_RECURSIVE:
+            attr->recursive=PTHREAD_MUTEX_RECURSIVE;
+            return 0;
+        default:
+            return EINVAL;
+    }
+}
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
+{
+    mutex->owner=nullptr;
+    mutex->first=nullptr;
+    mutex->last=nullptr;
+    //-1 if not recursive, otherwise the number of times the mutex was locked,
+    //minus one. It is only accessed by the thread owning the mutex
+    if(attr!=nullptr && attr->recursive==PTHREAD_MUTEX_RECURSIVE)
+        mutex->recursive=0;
+    else mutex->recursive=-1;
+    return 0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t *mutex)
+{
+    return *ownerWord(mutex)==0 ? 0 : EBUSY;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    return mutexLock(mutex,true);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex)
+{
+    return mutexLock(mutex,false);
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    unsigned int *word=ownerWord(mutex);
+    auto self=reinterpret_cast<unsigned int>(currentThread());
+    if((__atomic_load_n(word,__ATOMIC_RELAXED) & ~mutexWaiters)!=self)
+        return EPERM;
+    if(mutex->recursive>0)
+    {
+        mutex->recursive--;
+        return 0;
+    }
+    if(__atomic_exchange_n(word,0,__ATOMIC_RELEASE) & mutexWaiters)
+        __miosix_futex_wake(word,1);
+    return 0;
+}
+
+//
+// Condition variable API
+//
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
+{
+    //attr is currently not considered, the only clock supported for
+    //pthread_cond_timedwait is CLOCK_MONOTONIC
+    cond->first=nullptr;
+    cond->last=nullptr;
+    return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t *cond)
+{
+    return __atomic_load_n(condWaiters(cond),__ATOMIC_RELAXED)==0 ? 0 : EBUSY;
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    return condWait(cond,mutex,-1);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime)
+{
+    long long t=abstime->tv_sec*1000000000LL+abstime->tv_nsec;
+    return condWait(cond,mutex,t<0 ? 0 : t);
+}
+
+int pthread_cond_signal(pthread_cond_t *cond)
+{
+    return condWake(cond,1);
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond)
+{
+    return condWake(cond,INT_MAX);
+}
+
+//
+// Once API
+//
+
+int pthread_once(pthread_once_t *once, void (*func)())
+{
+    if(once==nullptr || func==nullptr || once->is_initialized!=1) return EINVAL;
+    if(once->init_executed==2) return 0; //Already called, return immediately
+    //Recursive, as func may call pthread_once on another pthread_once_t
+    static pthread_mutex_t onceMutex=PTHREAD_MUTEX_RECURSIVE_INITIALIZER_NP;
+    pthread_mutex_lock(&onceMutex);
+    if(once->init_executed==0)
+    {
+        once->init_executed=1;
+        func();
+        once->init_executed=2; //We succeeded
+    }
+    pthread_mutex_unlock(&onceMutex);
+    return 0;
+}
+
+//
+// C library and C++ runtime thread safety
+//
+
+/// Recursive as newlib may call malloc while already holding the lock
+static pthread_mutex_t mallocMutex=PTHREAD_MUTEX_RECURSIVE_INITIALIZER_NP;
+
+/**
+ * \internal
+ * __malloc_lock, called by malloc to ensure memory allocation thread safety
+ */
+void __malloc_lock()
+{
+    pthread_mutex_lock(&mallocMutex);
+}
+
+/**
+ * \internal
+ * __malloc_unlock, called by malloc after performing operations on the heap
+ */
+void __malloc_unlock()
+{
+    pthread_mutex_unlock(&mallocMutex);
+}
+
+/**
+ * \internal
+ * __getreent(), return the reentrancy structure of the current thread.
+ * Used by newlib to make the C standard library thread safe
+ */
+struct _reent *__getreent()
+{
+    ThreadData *t=currentThread();
+    return t==&mainThread ? _GLOBAL_REENT : t->reent;
+}
+
+} // extern "C"
+
+union MiosixGuard
+{
+    unsigned int flag;
+};
+
+namespace __cxxabiv1
+{
+
+/// Recursive as the constructor of a static object may construct another one
+static pthread_mutex_t guardMutex=PTHREAD_MUTEX_RECURSIVE_INITIALIZER_NP;
+
+extern "C" __cxa_eh_globals* __cxa_get_globals_fast()
+{
+    return &currentThread()->eh;
+}
+
+extern "C" __cxa_eh_globals* __cxa_get_globals()
+{
+    return &currentThread()->eh;
+}
+
+extern "C" int __cxa_guard_acquire(__guard *g)
+{
+    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
+    if(guard->flag==1) return 0; //Object already initialized, good
+    pthread_mutex_lock(&guardMutex);
+    //Check again, another thread may have initialized it in the meantime
+    if(guard->flag==1)
+    {
+        pthread_mutex_unlock(&guardMutex);
+        return 0;
+    }
+    return 1; //Caller constructs the object, then calls __cxa_guard_release
+}
+
+extern "C" void __cxa_guard_release(__guard *g) noexcept
+{
+    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
+    guard->flag=1;
+    pthread_mutex_unlock(&guardMutex);
+}
+
+extern "C" void __cxa_guard_abort(__guard *g) noexcept
+{
+    volatile MiosixGuard *guard=reinterpret_cast<volatile MiosixGuard*>(g);
+    guard->flag=0;
+    pthread_mutex_unlock(&guardMutex);
+}
+
+} //namespace __cxxabiv1
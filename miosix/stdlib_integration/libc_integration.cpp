@@ -37,14 +37,23 @@
 #include <sys/stat.h>
 #include <sys/fcntl.h>
 #include <sys/times.h>
+#include <malloc.h>
+#include <errno.h>
+#include <stdint.h>
 //// Settings
 #include "config/miosix_settings.h"
 //// Filesystem
 #include "filesystem/file_access.h"
+#include "filesystem/poll.h"
+#include "filesystem/pipe/pipe.h"
+#include "poll_select.h"
+#include "pipe_fcntl.h"
 //// Console
 #include "kernel/logging.h"
 //// kernel interface
 #include "kernel/kernel.h"
+#include "kernel/tlsf.h"
+#include "kernel/heap_counter.h"
 #include "kernel/process.h"
 #include "interfaces/bsp.h"
 #include "interfaces/os_timer.h"
@@ -53,6 +62,12 @@ using namespace std;
 
 namespace miosix {
 
+//The heap is managed here only when Miosix is linked with newlib, otherwise
+//the C library integration of the architecture takes care of it
+#ifdef _NEWLIB_VERSION
+
+#ifndef WITH_TLSF_MALLOC
+
 // This holds the max heap usage since the program started.
 // It is written by _sbrk_r and read by getMaxHeap()
 static unsigned int maxHeapEnd=0;
@@ -65,6 +80,115 @@ unsigned int getMaxHeap()
     return maxHeapEnd;
 }
 
+unsigned int getLargestFreeHeapBlock()
+{
+    extern char _heap_end asm("_heap_end"); //defined in the linker script
+    //The top chunk of the newlib heap is contiguous with the memory that has
+    //not yet been given to malloc through _sbrk_r
+    struct mallinfo mallocData=_mallinfo_r(__getreent());
+    char *curHeapEnd=reinterpret_cast<char*>(_sbrk_r(__getreent(),0));
+    return mallocData.keepcost+(&_heap_end-curHeapEnd);
+}
+
+#else //WITH_TLSF_MALLOC
+
+/// The heap, initialized on first use as malloc may be called before global
+/// constructors. Only accessed with the kernel paused
+static TlsfHeap heap;
+
+/**
+ * Give the whole heap area defined in the linker script to the allocator.
+ * Must be called with the kernel paused
+ */
+static void initHeap()
+{
+    if(heap.hasPool()) return;
+    extern char _end asm("_end"); //defined in the linker script
+    extern char _heap_end asm("_heap_end"); //defined in the linker script
+    heap.addPool(&_end,&_heap_end-&_end);
+}
+
+/**
+ * \return the heap statistics
+ */
+static TlsfStats heapStats()
+{
+    PauseKernelLock dLock;
+    initHeap();
+    return heap.stats();
+}
+
+unsigned int getMaxHeap()
+{
+    extern char _end asm("_end"); //defined in the linker script
+    return reinterpret_cast<unsigned int>(&_end)+heapStats().highWatermark;
+}
+
+unsigned int getLargestFreeHeapBlock()
+{
+    return heapStats().largestFree;
+}
+
+#ifdef WITH_HEAP_COUNTER
+
+/// Every block ends with a pointer to the HeapCounterRecord it is accounted to
+static const size_t tagSize=sizeof(HeapCounterRecord*);
+
+/**
+ * \param mem an allocated block
+ * \return a pointer to the tag of the block
+ */
+static inline HeapCounterRecord **tagOf(void *mem)
+{
+    char *end=reinterpret_cast<char*>(mem)+heap.usableSize(mem);
+    return reinterpret_cast<HeapCounterRecord**>(end-tagSize);
+}
+
+void *PKallocateUntracked(size_t size)
+{
+    initHeap();
+    return heap.allocate(size);
+}
+
+void PKdeallocateUntracked(void *mem)
+{
+    heap.deallocate(mem);
+}
+
+#else //WITH_HEAP_COUNTER
+
+static const size_t tagSize=0;
+
+#endif //WITH_HEAP_COUNTER
+
+/**
+ * Account a newly allocated block to the current thread.
+ * Must be called with the kernel paused
+ * \param mem the allocated block, or nullptr
+ */
+static inline void PKtrackAllocation(void *mem)
+{
+    #ifdef WITH_HEAP_COUNTER
+    if(mem) *tagOf(mem)=HeapCounter::PKallocated(heap.usableSize(mem));
+    #endif //WITH_HEAP_COUNTER
+}
+
+/**
+ * Remove a block that is about to be deallocated from the accounting.
+ * Must be called with the kernel paused
+ * \param mem the block, or nullptr
+ */
+static inline void PKtrackDeallocation(void *mem)
+{
+    #ifdef WITH_HEAP_COUNTER
+    if(mem) HeapCounter::PKdeallocated(*tagOf(mem),heap.usableSize(mem));
+    #endif //WITH_HEAP_COUNTER
+}
+
+#endif //WITH_TLSF_MALLOC
+
+#endif //_NEWLIB_VERSION
+
 /**
  * \return the global C reentrancy structure
  */
@@ -129,12 +253,14 @@ int __register_exitproc(int type, void (*fn)(void*), void *arg, void *d)
  */
 void __call_exitprocs(int code, void *d) {}
 
+#ifdef _NEWLIB_VERSION
 /**
  * \internal
  * Required by C++ standard library.
  * See http://lists.debian.org/debian-gcc/2003/07/msg00057.html
  */
 void *__dso_handle=(void*) &__dso_handle;
+#endif //_NEWLIB_VERSION
 
 
 
@@ -154,12 +280,19 @@ void _exit(int n)
     for(;;) ; //Required to avoid a warning about noreturn functions
 }
 
+#ifdef _NEWLIB_VERSION
+
 /**
  * \internal
  * _sbrk_r, allocates memory dynamically
  */
 void *_sbrk_r(struct _reent *ptr, ptrdiff_t incr)
 {
+    #ifdef WITH_TLSF_MALLOC
+    //The whole heap is managed by the TLSF allocator
+    ptr->_errno=ENOMEM;
+    return reinterpret_cast<void*>(-1);
+    #else //WITH_TLSF_MALLOC
     //This is the absolute start of the heap
     extern char _end asm("_end"); //defined in the linker script
     //This is the absolute end of the heap
@@ -192,6 +325,7 @@ void *_sbrk_r(struct _reent *ptr, ptrdiff_t incr)
         miosix::maxHeapEnd=reinterpret_cast<unsigned int>(curHeapEnd);
     
     return reinterpret_cast<void*>(prevHeapEnd);
+    #endif //WITH_TLSF_MALLOC
 }
 
 void *sbrk(ptrdiff_t incr)
@@ -225,6 +359,124 @@ void __malloc_unlock()
     miosix::restartKernel();
 }
 
+#ifdef WITH_TLSF_MALLOC
+
+//
+// TLSF memory allocator, replaces the newlib one
+// ==============================================
+
+/**
+ * \internal
+ * Called when an allocation fails
+ */
+static void *heapExhausted(struct _reent *ptr)
+{
+    #ifdef __NO_EXCEPTIONS
+    // When exceptions are disabled operator new would return nullptr, which
+    // would cause undefined behaviour. So when exceptions are disabled,
+    // a heap overflow causes a reboot.
+    errorLog("\n***Heap overflow\n");
+    _exit(1);
+    #endif //__NO_EXCEPTIONS
+    ptr->_errno=ENOMEM;
+    return nullptr;
+}
+
+void *_malloc_r(struct _reent *ptr, size_t size)
+{
+    void *result=nullptr;
+    if(size<=SIZE_MAX-miosix::tagSize)
+    {
+        miosix::PauseKernelLock dLock;
+        miosix::initHeap();
+        result=miosix::heap.allocate(size+miosix::tagSize);
+        miosix::PKtrackAllocation(result);
+    }
+    return result ? result : heapExhausted(ptr);
+}
+
+void _free_r(struct _reent *ptr, void *mem)
+{
+    miosix::PauseKernelLock dLock;
+    miosix::PKtrackDeallocation(mem);
+    miosix::heap.deallocate(mem);
+}
+
+void *_realloc_r(struct _reent *ptr, void *mem, size_t size)
+{
+    if(mem==nullptr) return _malloc_r(ptr,size);
+    if(size==0)
+    {
+        _free_r(ptr,mem);
+        return nullptr;
+    }
+    void *result=nullptr;
+    if(size<=SIZE_MAX-miosix::tagSize)
+    {
+        miosix::PauseKernelLock dLock;
+        #ifdef WITH_HEAP_COUNTER
+        //Resizing in place moves the tag, so save it before reallocating
+        miosix::HeapCounterRecord *record=*miosix::tagOf(mem);
+        size_t oldSize=miosix::heap.usableSize(mem);
+        #endif //WITH_HEAP_COUNTER
+        result=miosix::heap.reallocate(mem,size+miosix::tagSize);
+        #ifdef WITH_HEAP_COUNTER
+        //The block stays accounted to the thread that allocated it
+        if(result)
+        {
+            miosix::HeapCounter::PKreallocated(record,oldSize,
+                miosix::heap.usableSize(result));
+            *miosix::tagOf(result)=record;
+        }
+        #endif //WITH_HEAP_COUNTER
+    }
+    return result ? result : heapExhausted(ptr);
+}
+
+void *_calloc_r(struct _reent *ptr, size_t num, size_t size)
+{
+    size_t total;
+    if(__builtin_mul_overflow(num,size,&total)) return heapExhausted(ptr);
+    void *result=_malloc_r(ptr,total);
+    if(result) memset(result,0,total);
+    return result;
+}
+
+void *_memalign_r(struct _reent *ptr, size_t align, size_t size)
+{
+    void *result=nullptr;
+    if(size<=SIZE_MAX-miosix::tagSize)
+    {
+        miosix::PauseKernelLock dLock;
+        miosix::initHeap();
+        result=miosix::heap.allocateAligned(align,size+miosix::tagSize);
+        miosix::PKtrackAllocation(result);
+    }
+    return result ? result : heapExhausted(ptr);
+}
+
+size_t _malloc_usable_size_r(struct _reent *ptr, void *mem)
+{
+    if(mem==nullptr) return 0;
+    miosix::PauseKernelLock dLock;
+    return miosix::heap.usableSize(mem)-miosix::tagSize;
+}
+
+struct mallinfo _mallinfo_r(struct _reent *ptr)
+{
+    miosix::TlsfStats stats=miosix::heapStats();
+    struct mallinfo result;
+    memset(&result,0,sizeof(result));
+    result.arena=stats.usedBytes+stats.freeBytes;
+    result.ordblks=stats.freeBlocks;
+    result.uordblks=stats.usedBytes;
+    result.fordblks=stats.freeBytes;
+    result.usmblks=stats.highWatermark;
+    return result;
+}
+
+#endif //WITH_TLSF_MALLOC
+
 /**
  * \internal
  * __getreent(), return the reentrancy structure of the current thread.
@@ -235,6 +487,8 @@ struct _reent *__getreent()
     return miosix::getReent();
 }
 
+#endif //_NEWLIB_VERSION
+
 
 
 
@@ -427,6 +681,118 @@ off_t lseek(int fd, off_t pos, int whence)
     return _lseek_r(miosix::getReent(),fd,pos,whence);
 }
 
+/**
+ * \internal
+ * pread, read from a file at a given position
+ */
+ssize_t pread(int fd, void *buf, size_t size, off_t pos)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        ssize_t result=miosix::getFileDescriptorTable().pread(fd,buf,size,pos);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * pwrite, write to a file at a given position
+ */
+ssize_t pwrite(int fd, const void *buf, size_t size, off_t pos)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        ssize_t result=miosix::getFileDescriptorTable().pwrite(fd,buf,size,pos);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * preadv, read from a file at a given position into multiple buffers
+ */
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t pos)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        ssize_t result=miosix::getFileDescriptorTable().preadv(fd,iov,iovcnt,pos);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * pwritev, write to a file at a given position from multiple buffers
+ */
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t pos)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        ssize_t result=miosix::getFileDescriptorTable().pwritev(fd,iov,iovcnt,pos);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
 /**
  * \internal
  * _fstat_r, return file info
@@ -617,9 +983,11 @@ int fcntl(int fd, int cmd, ...)
         case F_DUPFD:
         case F_SETFD:
         case F_SETFL:
+        case F_SETPIPE_SZ:
             va_start(arg,cmd);
             result=_fcntl_r(r,fd,cmd,va_arg(arg,int));
             va_end(arg);
+            break;
         default:
             result=_fcntl_r(r,fd,cmd,0);
     }
@@ -662,10 +1030,12 @@ int _ioctl_r(struct _reent *ptr, int fd, int cmd, void *arg)
     #endif //WITH_FILESYSTEM
 }
 
+#ifdef _NEWLIB_VERSION
 int ioctl(int fd, int cmd, void *arg)
 {
     return _ioctl_r(miosix::getReent(),fd,cmd,arg);
 }
+#endif //_NEWLIB_VERSION
 
 /**
  * \internal
@@ -951,6 +1321,114 @@ int ftruncate(int fd, off_t size)
     #endif //WITH_FILESYSTEM
 }
 
+/**
+ * \internal
+ * fallocate, allocate disk space for a file
+ */
+int fallocate(int fd, int mode, off_t offset, off_t len)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        int result=miosix::getFileDescriptorTable().fallocate(fd,mode,offset,len);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * posix_fallocate, allocate disk space for a file. Unlike fallocate, errors
+ * are returned and not reported through errno
+ */
+int posix_fallocate(int fd, off_t offset, off_t len)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        return -miosix::getFileDescriptorTable().fallocate(fd,0,offset,len);
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        return ENOMEM;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    return EBADF;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * fsync, synchronize a file with the storage device
+ */
+int fsync(int fd)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        int result=miosix::getFileDescriptorTable().fsync(fd);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * fdatasync, synchronize the data of a file with the storage device
+ */
+int fdatasync(int fd)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        int result=miosix::getFileDescriptorTable().fdatasync(fd);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=EBADF;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
 /**
  * \internal
  * _rename_r, rename a file or directory
@@ -1084,6 +1562,58 @@ int pipe(int fds[2])
     #endif //WITH_FILESYSTEM
 }
 
+/**
+ * \internal
+ * poll, wait for one of a set of file descriptors to become ready for I/O
+ */
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    #ifdef WITH_FILESYSTEM
+
+    #ifndef __NO_EXCEPTIONS
+    try {
+    #endif //__NO_EXCEPTIONS
+        int result=miosix::getFileDescriptorTable().poll(fds,nfds,timeout);
+        if(result>=0) return result;
+        miosix::getReent()->_errno=-result;
+        return -1;
+    #ifndef __NO_EXCEPTIONS
+    } catch(exception& e) {
+        miosix::getReent()->_errno=ENOMEM;
+        return -1;
+    }
+    #endif //__NO_EXCEPTIONS
+
+    #else //WITH_FILESYSTEM
+    //Without filesystem stdin, stdout and stderr are the only file descriptors
+    const nfds_t maxFds=3;
+    if(nfds>maxFds)
+    {
+        miosix::getReent()->_errno=EINVAL;
+        return -1;
+    }
+    miosix::intrusive_ref_ptr<miosix::FileBase> files[maxFds];
+    for(nfds_t i=0;i<nfds;i++)
+        if(fds[i].fd==STDIN_FILENO || fds[i].fd==STDOUT_FILENO
+            || fds[i].fd==STDERR_FILENO)
+            files[i]=miosix::DefaultConsole::instance().getTerminal();
+    int result=miosix::pollFiles(fds,files,nfds,timeout);
+    if(result>=0) return result;
+    miosix::getReent()->_errno=-result;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+/**
+ * \internal
+ * select, implemented on top of poll
+ */
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+           struct timeval *timeout)
+{
+    return miosix::selectOnPoll(nfds,readfds,writefds,exceptfds,timeout);
+}
+
 /*
  * Time API in Miosix
  * ==================
@@ -1109,7 +1639,6 @@ int pipe(int fds[2])
 
 int clock_gettime(clockid_t clock_id, struct timespec *tp)
 {
-    if(tp==nullptr) return -1;
     //TODO: support CLOCK_REALTIME
     miosix::ll2timespec(miosix::getTime(),tp);
     return 0;
@@ -1351,6 +1880,8 @@ int posix_spawn(pid_t *pid, const char *path,
 // Check that newlib has been configured correctly
 // ===============================================
 
+#ifdef _NEWLIB_VERSION
+
 #ifndef _REENT_SMALL
 #error "_REENT_SMALL not defined"
 #endif //_REENT_SMALL
@@ -1362,3 +1893,5 @@ int posix_spawn(pid_t *pid, const char *path,
 #ifndef __DYNAMIC_REENT__
 #error "__DYNAMIC_REENT__ not defined"
 #endif
+
+#endif //_NEWLIB_VERSION
@@ -32,6 +32,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <sys/time.h>
+#include "config/miosix_settings.h"
 
 #ifndef COMPILING_MIOSIX
 #error "This is header is private, it can't be used outside Miosix itself."
@@ -48,6 +49,38 @@ namespace miosix {
  */
 unsigned int getMaxHeap();
 
+/**
+ * \internal
+ * \return the size of the largest free block in the heap, that is, the largest
+ * size that can be allocated with a single malloc. With the newlib allocator
+ * only the free memory at the end of the heap is considered, so the returned
+ * value is a lower bound. Implementation detail, what you'd want to call is
+ * most likely MemoryProfiling::getLargestFreeHeapBlock().
+ */
+unsigned int getLargestFreeHeapBlock();
+
+#ifdef WITH_HEAP_COUNTER
+
+/**
+ * \internal
+ * Allocate memory from the heap without accounting it in HeapCounter. Used by
+ * HeapCounter to allocate its own data structures. Must be called with the
+ * kernel paused
+ * \param size size of the memory to allocate
+ * \return the allocated memory or nullptr if the heap is full
+ */
+void *PKallocateUntracked(size_t size);
+
+/**
+ * \internal
+ * Free memory allocated with PKallocateUntracked(). Must be called with the
+ * kernel paused
+ * \param mem memory to free
+ */
+void PKdeallocateUntracked(void *mem);
+
+#endif //WITH_HEAP_COUNTER
+
 /**
  * \internal
  * Used by the kernel during the boot process to switch the C standard library
@@ -92,7 +125,10 @@ inline void ll2timespec(long long ns, struct timespec *tp)
     tp->tv_sec = a;
     tp->tv_nsec = static_cast<long>(b);
     #else //__ARM_EABI__
+    //On 64 bit architectures a single division instruction computes both
+    #if __SIZEOF_LONG__<8
     #warning Warning POSIX time API not optimized for this platform
+    #endif //__SIZEOF_LONG__<8
     tp->tv_sec = ns / nsPerSec;
     tp->tv_nsec = static_cast<long>(ns % nsPerSec);
     #endif //__ARM_EABI__
@@ -232,6 +232,7 @@ void __verbose_terminate_handler()
 // C++ static constructors support, to achieve thread safety
 // =========================================================
 
+#ifdef __ARM_EABI__
 //This is weird, despite almost everywhere in GCC's documentation it is said
 //that __guard is 8 bytes, it is actually only four.
 union MiosixGuard
@@ -239,6 +240,20 @@ union MiosixGuard
     miosix::Thread *owner;
     unsigned int flag;
 };
+#else //__ARM_EABI__
+//In the generic C++ ABI the guard is 8 bytes, but the compiler only checks its
+//first byte to know if the object is initialized, so the owner is stored
+//shifted by eight bits to keep that byte @ 0 during the initialization
+struct MiosixGuard
+{
+    unsigned long long flag;
+};
+
+static inline unsigned long long guardOwner(miosix::Thread *t)
+{
+    return static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(t))<<8;
+}
+#endif //__ARM_EABI__
 
 namespace __cxxabiv1
 {
@@ -259,6 +274,7 @@ extern "C" int __cxa_guard_acquire(__guard *g)
         if(guard->flag==0)
         {
             //Object uninitialized, and no other thread trying to initialize it
+            #ifdef __ARM_EABI__
             guard->owner=miosix::Thread::IRQgetCurrentThread();
 
             //guard->owner serves the double task of being the thread id of
@@ -268,11 +284,18 @@ extern "C" int __cxa_guard_acquire(__guard *g)
             //that Thread* pointers never have bit #0 @ 1, and this assetion
             //checks that this condition really holds
             if(guard->flag & 1) miosix::errorHandler(miosix::UNEXPECTED);
+            #else //__ARM_EABI__
+            guard->flag=guardOwner(miosix::Thread::IRQgetCurrentThread());
+            #endif //__ARM_EABI__
             return 1;
         }
 
         //If we get here, the object is being initialized by another thread
+        #ifdef __ARM_EABI__
         if(guard->owner==miosix::Thread::IRQgetCurrentThread())
+        #else //__ARM_EABI__
+        if(guard->flag==guardOwner(miosix::Thread::IRQgetCurrentThread()))
+        #endif //__ARM_EABI__
         {
             //Wait, the other thread initializing the object is this thread?!?
             //We have a recursive initialization error. Not throwing an
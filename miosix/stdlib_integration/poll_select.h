@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent                                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include <sys/select.h>
+#include <errno.h>
+#include <limits.h>
+#include "config/miosix_settings.h"
+
+/*
+ * This file is shared by the kernel and libsyscalls, as neither has a select()
+ * syscall, so both implement it on top of poll()
+ */
+
+//Newlib does not provide poll.h, so if it is missing define the subset of it
+//that Miosix implements
+#if __has_include(<poll.h>)
+#include <poll.h>
+#else //__has_include(<poll.h>)
+#define POLLIN   0x0001 ///< There is data to read
+#define POLLPRI  0x0002 ///< There is urgent data to read
+#define POLLOUT  0x0004 ///< Writing now will not block
+#define POLLERR  0x0008 ///< Error condition (output only)
+#define POLLHUP  0x0010 ///< Hang up (output only)
+#define POLLNVAL 0x0020 ///< Invalid file descriptor (output only)
+
+typedef unsigned int nfds_t;
+
+struct pollfd
+{
+    int fd;        ///< File descriptor
+    short events;  ///< Requested events
+    short revents; ///< Returned events
+};
+
+extern "C" int poll(struct pollfd *fds, nfds_t nfds, int timeout);
+#endif //__has_include(<poll.h>)
+
+namespace miosix {
+
+/**
+ * \internal
+ * select, implemented on top of poll. Sets errno on failure
+ */
+inline int selectOnPoll(int nfds, fd_set *readfds, fd_set *writefds,
+        fd_set *exceptfds, struct timeval *timeout)
+{
+    if(nfds<0 || (timeout && (timeout->tv_sec<0 || timeout->tv_usec<0
+        || timeout->tv_usec>=1000000)))
+    {
+        errno=EINVAL;
+        return -1;
+    }
+    //No larger set of file descriptors can be valid
+    struct pollfd fds[MAX_OPEN_FILES];
+    nfds_t n=0;
+    for(int fd=0;fd<nfds;fd++)
+    {
+        short events=0;
+        if(readfds && FD_ISSET(fd,readfds)) events|=POLLIN;
+        if(writefds && FD_ISSET(fd,writefds)) events|=POLLOUT;
+        if(exceptfds && FD_ISSET(fd,exceptfds)) events|=POLLPRI;
+        if(events==0) continue;
+        if(fd>=MAX_OPEN_FILES)
+        {
+            errno=EBADF;
+            return -1;
+        }
+        fds[n].fd=fd;
+        fds[n].events=events;
+        n++;
+    }
+    int ms=-1;
+    if(timeout)
+    {
+        //Round up, a select must not time out earlier than requested
+        long long t=timeout->tv_sec*1000LL+(timeout->tv_usec+999)/1000;
+        ms=t<INT_MAX ? t : INT_MAX;
+    }
+    if(poll(fds,n,ms)<0) return -1;
+    for(nfds_t i=0;i<n;i++)
+    {
+        if((fds[i].revents & POLLNVAL)==0) continue;
+        errno=EBADF;
+        return -1;
+    }
+    if(readfds) FD_ZERO(readfds);
+    if(writefds) FD_ZERO(writefds);
+    if(exceptfds) FD_ZERO(exceptfds);
+    int result=0;
+    for(nfds_t i=0;i<n;i++)
+    {
+        //Report errors and hangups as readable, as a read won't block
+        short r=fds[i].revents;
+        if((fds[i].events & POLLIN) && (r & (POLLIN | POLLHUP | POLLERR)))
+        {
+            FD_SET(fds[i].fd,readfds);
+            result++;
+        }
+        if((fds[i].events & POLLOUT) && (r & (POLLOUT | POLLERR)))
+        {
+            FD_SET(fds[i].fd,writefds);
+            result++;
+        }
+        if((fds[i].events & POLLPRI) && (r & POLLPRI))
+        {
+            FD_SET(fds[i].fd,exceptfds);
+            result++;
+        }
+    }
+    return result;
+}
+
+} //namespace miosix
@@ -30,9 +30,11 @@
  * some utilities
  */
 #include <cstdio>
+#include <cstdint>
 #include <malloc.h>
 #include "util.h"
 #include "kernel/kernel.h"
+#include "kernel/heap_counter.h"
 #include "stdlib_integration/libc_integration.h"
 #include "config/miosix_settings.h" //For WATERMARK_FILL and STACK_FILL
 
@@ -52,6 +54,7 @@ void MemoryProfiling::print()
     unsigned int curFreeHeap=getCurrentFreeHeap();
     unsigned int absFreeHeap=getAbsoluteFreeHeap();
     unsigned int heapSize=getHeapSize();
+    unsigned int largestFree=getLargestFreeHeapBlock();
 
     iprintf("Stack memory statistics.\n"
             "Size: %u\n"
@@ -60,11 +63,13 @@ void MemoryProfiling::print()
             "Heap memory statistics.\n"
             "Size: %u\n"
             "Used (current/max): %u/%u\n"
-            "Free (current/min): %u/%u\n",
+            "Free (current/min): %u/%u\n"
+            "Largest free block: %u (fragmentation %u%%)\n",
             stackSize,stackSize-curFreeStack,stackSize-absFreeStack,
             curFreeStack,absFreeStack,
             heapSize,heapSize-curFreeHeap,heapSize-absFreeHeap,
-            curFreeHeap,absFreeHeap);
+            curFreeHeap,absFreeHeap,
+            largestFree,getHeapFragmentation());
 }
 
 unsigned int MemoryProfiling::getStackSize()
@@ -93,15 +98,23 @@ unsigned int MemoryProfiling::getAbsoluteFreeStack()
 
 unsigned int MemoryProfiling::getCurrentFreeStack()
 {
+    #ifdef __ARM_EABI__
     register int *stack_ptr asm("sp");
+    #else //__ARM_EABI__
+    void *stack_ptr=__builtin_frame_address(0);
+    #endif //__ARM_EABI__
     const unsigned int *walk=Thread::getStackBottom();
-    unsigned int freeStack=(reinterpret_cast<unsigned int>(stack_ptr)
-                          - reinterpret_cast<unsigned int>(walk));
+    unsigned int freeStack=(reinterpret_cast<uintptr_t>(stack_ptr)
+                          - reinterpret_cast<uintptr_t>(walk));
     //This takes into account CTXSAVE_ON_STACK.
     if(freeStack<=CTXSAVE_ON_STACK) return 0;
     return freeStack-CTXSAVE_ON_STACK;
 }
 
+//When Miosix is not linked with newlib, the C library integration of the
+//architecture provides these
+#ifdef _NEWLIB_VERSION
+
 unsigned int MemoryProfiling::getHeapSize()
 {
     //These extern variables are defined in the linker script
@@ -131,14 +144,39 @@ unsigned int MemoryProfiling::getCurrentFreeHeap()
     return getHeapSize()-mallocData.uordblks;
 }
 
+#endif //_NEWLIB_VERSION
+
+unsigned int MemoryProfiling::getLargestFreeHeapBlock()
+{
+    return miosix::getLargestFreeHeapBlock(); //From libc_integration
+}
+
+unsigned int MemoryProfiling::getHeapFragmentation()
+{
+    unsigned int curFreeHeap=getCurrentFreeHeap();
+    unsigned int largestFree=getLargestFreeHeapBlock();
+    if(curFreeHeap==0 || largestFree>=curFreeHeap) return 0;
+    return 100-static_cast<unsigned long long>(largestFree)*100/curFreeHeap;
+}
+
+#ifdef WITH_HEAP_COUNTER
+void MemoryProfiling::printHeapCounters()
+{
+    string text=HeapCounter::report();
+    iprintf("%s",text.c_str());
+}
+#endif //WITH_HEAP_COUNTER
+
 /**
  * \internal
  * used by memDump
  */
 static void memPrint(const char *data, char len)
 {
-    iprintf("0x%08x | ",reinterpret_cast<unsigned int>(data));
-    for(int i=0;i<len;i++) iprintf("%02x ",data[i]);
+    iprintf("0x%08lx | ",static_cast<unsigned long>(
+        reinterpret_cast<uintptr_t>(data)));
+    for(int i=0;i<len;i++)
+        iprintf("%02x ",static_cast<unsigned char>(data[i]));
     for(int i=0;i<(16-len);i++) iprintf("   ");
     iprintf("| ");
     for(int i=0;i<len;i++)
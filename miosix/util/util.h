@@ -99,6 +99,33 @@ public:
      */
     static unsigned int getCurrentFreeHeap();
 
+    /**
+     * \return the size of the largest free block in the heap, that is, the
+     * largest size that can currently be allocated with a single malloc.<br>
+     * With the newlib allocator only the free memory at the end of the heap
+     * is considered, so the returned value is a lower bound. It is exact if
+     * WITH_TLSF_MALLOC is defined.
+     */
+    static unsigned int getLargestFreeHeapBlock();
+
+    /**
+     * \return heap fragmentation as a percentage, computed as
+     * 100*(1-largestFreeHeapBlock/currentFreeHeap). It is zero if the free
+     * heap is all in a single block, and approaches 100 as the free heap is
+     * split in many small blocks.
+     */
+    static unsigned int getHeapFragmentation();
+
+    #ifdef WITH_HEAP_COUNTER
+    /**
+     * Prints the heap memory allocated by each thread, as tracked by
+     * HeapCounter. Threads that terminated without freeing all the memory they
+     * allocated are listed as terminated, and are likely memory leaks.
+     * Requires `WITH_HEAP_COUNTER` to be defined in config/miosix_settings.h.
+     */
+    static void printHeapCounters();
+    #endif //WITH_HEAP_COUNTER
+
 private:
     //All member functions static, disallow creating instances
     MemoryProfiling();
@@ -43,7 +43,12 @@ namespace miosix {
 #define tts(x) #x
 #define ts(x) tts(x)
 
-#if defined(__GNUC__) && !defined(__clang__)
+#if defined(__GNUC__) && !defined(__clang__) && !defined(_MIOSIX_GCC_PATCH_MAJOR)
+//Not a Miosix compiler, such as the host compiler of the Linux host simulator
+#define CV ", gcc " \
+    ts(__GNUC__) "." ts(__GNUC_MINOR__) "." ts(__GNUC_PATCHLEVEL__)
+#define AU __attribute__((used))
+#elif defined(__GNUC__) && !defined(__clang__)
 #define CV ", gcc " \
     ts(__GNUC__) "." ts(__GNUC_MINOR__) "." ts(__GNUC_PATCHLEVEL__) \
     "-mp" ts(_MIOSIX_GCC_PATCH_MAJOR) "." ts(_MIOSIX_GCC_PATCH_MINOR)